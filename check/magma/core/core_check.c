@@ -377,6 +377,26 @@ START_TEST (check_inx_append_m) {
 }
 END_TEST
 
+START_TEST (check_inx_prune_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+#ifdef MAGMA_PROVIDE_TOKYO_PRIVATE_H
+	outcome = check_inx_prune_sthread(M_INX_TREE, errmsg);
+#else
+	// Tree tests should fail without tree support, in which case we negate the result and wipe the error message buffer.
+	if ((outcome = !check_inx_prune_sthread(M_INX_TREE, errmsg))) st_wipe(errmsg);
+#endif
+	if (outcome) outcome = check_inx_prune_sthread(M_INX_HASHED, errmsg);
+	if (outcome) outcome = check_inx_prune_sthread(M_INX_LINKED, errmsg);
+
+	log_test("CORE / INDEX / PRUNE / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
 START_TEST (check_constants) {
 
 	log_disable();
@@ -1066,6 +1086,20 @@ START_TEST (check_ip_localhost_s) {
 }
 END_TEST
 
+START_TEST (check_ip_trie_s) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) result = check_ip_trie_sthread(errmsg);
+
+	log_test("CORE / HOST / ADDRESS / TRIE / SINGLE THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+
+}
+END_TEST
+
 Suite * suite_check_core(void) {
 
 	Suite *s = suite_create("\tCore");
@@ -1102,6 +1136,7 @@ Suite * suite_check_core(void) {
 	suite_check_testcase(s, "CORE", "Host / Address / Octet / S", check_address_octet_s);
 	suite_check_testcase(s, "CORE", "Host / Address / Local / S", check_ip_localhost_s);
 	suite_check_testcase(s, "CORE", "Host / Address / Private / S", check_ip_private_s);
+	suite_check_testcase(s, "CORE", "Host / Address / Trie / S", check_ip_trie_s);
 
 	suite_check_testcase(s, "CORE", "Encoding / Quoted Printable", check_qp);
 	suite_check_testcase(s, "CORE", "Encoding / Hex", check_hex);
@@ -1128,6 +1163,7 @@ Suite * suite_check_core(void) {
 #endif
 	suite_check_testcase(s, "CORE", "Indexes / Append/S", check_inx_append_s);
 	suite_check_testcase(s, "CORE", "Indexes / Append/M", check_inx_append_m);
+	suite_check_testcase(s, "CORE", "Indexes / Prune/S", check_inx_prune_s);
 
 	return s;
 }
@@ -50,11 +50,15 @@ bool_t	  check_inx_append_helper(inx_t *);
 void	  check_inx_append_test(inx_t *);
 bool_t 	  check_inx_append_sthread(MAGMA_INDEX, stringer_t*);
 bool_t 	  check_inx_append_mthread(MAGMA_INDEX, stringer_t*);
+bool_t    check_inx_prune_odd(chr_t *val, uint64_t *removed);
+bool_t    check_inx_prune_sthread(MAGMA_INDEX inx_type, stringer_t *errmsg);
 
 /// ip_check.c
 bool_t check_uint16_to_hex_st(uint16_t val, stringer_t *buff);
 bool_t check_ip_private_sthread(stringer_t *errmsg);
 bool_t check_ip_localhost_sthread(stringer_t *errmsg);
+void check_ip_trie_random(void *buffer, size_t length);
+bool_t check_ip_trie_sthread(stringer_t *errmsg);
 
 /// linked_check.c
 bool_t   check_indexes_linked_cursor(char **errmsg);
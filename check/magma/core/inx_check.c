@@ -329,3 +329,69 @@ bool_t check_inx_append_mthread(MAGMA_INDEX inx_type, stringer_t *errmsg) {
 
 	return outcome;
 }
+
+bool_t check_inx_prune_odd(chr_t *val, uint64_t *removed) {
+
+	uint64_t num = 0;
+
+	if (!uint64_conv_ns(val, &num) || !(num % 2)) {
+		return false;
+	}
+
+	(*removed)++;
+	return true;
+}
+
+bool_t check_inx_prune_sthread(MAGMA_INDEX inx_type, stringer_t *errmsg) {
+
+	void *val;
+	chr_t snum[64];
+	inx_t *inx = NULL;
+	bool_t outcome = true;
+	uint64_t removed = 0, pruned;
+	multi_t key = mt_set_type(mt_get_null(), M_TYPE_UINT64);
+
+	if (!(inx = inx_alloc(inx_type | M_INX_LOCK_MANUAL, &ns_free))) {
+		st_sprint(errmsg, "An error occured during initial allocation in the inx check prune test.");
+		return false;
+	}
+
+	inx_lock_write(inx);
+
+	for (uint64_t i = 1; outcome && i <= INX_CHECK_OBJECTS; i++) {
+
+		key.val.u64 = i;
+		snprintf(snum, 64, "%lu", i);
+
+		if (!(val = ns_dupe(snum)) || !inx_insert(inx, key, val)) {
+			st_sprint(errmsg, "An error occured while populating the index.");
+			ns_cleanup(val);
+			outcome = false;
+		}
+	}
+
+	// Every odd record should be removed in a single call, without disturbing the even records.
+	if (outcome && (pruned = inx_prune(inx, (bool_t (*)(void *, void *))&check_inx_prune_odd, &removed)) != INX_CHECK_OBJECTS / 2) {
+		st_sprint(errmsg, "The wrong number of records was pruned. { pruned = %lu / matched = %lu }", pruned, removed);
+		outcome = false;
+	}
+	else if (outcome && inx_count(inx) != INX_CHECK_OBJECTS - (INX_CHECK_OBJECTS / 2)) {
+		st_sprint(errmsg, "The index holds the wrong number of records after pruning. { count = %lu }", inx_count(inx));
+		outcome = false;
+	}
+
+	for (uint64_t i = 1; outcome && i <= INX_CHECK_OBJECTS; i++) {
+
+		key.val.u64 = i;
+
+		if ((i % 2) == (inx_find(inx, key) != NULL)) {
+			st_sprint(errmsg, "A record was %s by the prune. { key = %lu }", (i % 2) ? "left behind" : "removed", i);
+			outcome = false;
+		}
+	}
+
+	inx_unlock(inx);
+	inx_cleanup(inx);
+
+	return outcome;
+}
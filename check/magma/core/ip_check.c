@@ -786,3 +786,123 @@ bool_t check_ip_localhost_sthread(stringer_t *errmsg) {
 
 	return true;
 }
+
+void check_ip_trie_random(void *buffer, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		((uchr_t *)buffer)[i] = rand_get_uint8();
+	}
+	return;
+}
+
+bool_t check_ip_trie_sthread(stringer_t *errmsg) {
+
+	ip_t *addresses;
+	subnet_t *subnets, fixed;
+	bool_t result = true;
+	uint64_t start, linear_time, trie_time;
+	subnet_trie_t *trie = NULL, *active = NULL;
+	uint32_t length, *expected, count = 4096, lookups = 16384, matches = 0;
+
+	if (!(trie = subnet_trie_alloc()) || !(subnets = mm_alloc(sizeof(subnet_t) * count)) ||
+		!(addresses = mm_alloc(sizeof(ip_t) * lookups)) || !(expected = mm_alloc(sizeof(uint32_t) * lookups))) {
+		st_sprint(errmsg, "Unable to allocate the subnet trie check.");
+		return false;
+	}
+
+	// Generate random subnets, with a mix of IPv4 and IPv6 prefixes. Prefixes shorter than eight bits would match most
+	// random addresses, so they are kept rare.
+	for (uint32_t i = 0; i < count && result; i++) {
+
+		subnets[i].address.family = (i % 4) ? AF_INET : AF_INET6;
+		subnets[i].mask = rand_get_uint32() % ((subnets[i].address.family == AF_INET ? 32 : 128) + 1);
+
+		if (subnets[i].mask < 8 && (i % 64)) {
+			subnets[i].mask += 8;
+		}
+
+		if (subnets[i].address.family == AF_INET) check_ip_trie_random(&(subnets[i].address.ip4), sizeof(struct in_addr));
+		else check_ip_trie_random(&(subnets[i].address.ip6), sizeof(struct in6_addr));
+
+		if (!subnet_trie_add(trie, &(subnets[i]), NULL)) {
+			st_sprint(errmsg, "Unable to add a subnet to the trie. { subnet = %u }", i);
+			result = false;
+		}
+	}
+
+	// Half of the addresses fall inside a random subnet, so there are plenty of matches. Mapped IPv4 addresses are matched
+	// against the IPv4 subnets by the trie, but not by ip_matches_subnet(), so they are avoided.
+	for (uint32_t i = 0; i < lookups; i++) {
+
+		if (i % 2) {
+			addresses[i] = subnets[rand_get_uint32() % count].address;
+			if (addresses[i].family == AF_INET) ((uchr_t *)&(addresses[i].ip4))[3] ^= rand_get_uint8();
+			else ((uchr_t *)&(addresses[i].ip6))[15] ^= rand_get_uint8();
+		}
+		else if ((addresses[i].family = (i % 4) ? AF_INET6 : AF_INET) == AF_INET) {
+			check_ip_trie_random(&(addresses[i].ip4), sizeof(struct in_addr));
+		}
+		else {
+			check_ip_trie_random(&(addresses[i].ip6), sizeof(struct in6_addr));
+		}
+
+		if (addresses[i].family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&(addresses[i].ip6))) {
+			((uchr_t *)&(addresses[i].ip6))[0] = 0x20;
+		}
+	}
+
+	// Find the longest match with a linear scan, which is how the bypass list used to be checked.
+	start = time_monotonic_ms();
+
+	for (uint32_t i = 0; i < lookups; i++) {
+		expected[i] = UINT32_MAX;
+		for (uint32_t j = 0; j < count; j++) {
+			if (ip_matches_subnet(&(subnets[j]), &(addresses[i])) && (expected[i] == UINT32_MAX || subnets[j].mask > expected[i])) {
+				expected[i] = subnets[j].mask;
+			}
+		}
+	}
+
+	linear_time = time_monotonic_ms() - start;
+	start = time_monotonic_ms();
+
+	for (uint32_t i = 0; i < lookups && result; i++) {
+		if (!subnet_trie_match(trie, &(addresses[i]), NULL, &length)) {
+			length = UINT32_MAX;
+		}
+		else {
+			matches++;
+		}
+
+		if (length != expected[i]) {
+			st_sprint(errmsg, "The subnet trie returned the wrong prefix length. { trie = %i / linear = %i }", (int_t)length, (int_t)expected[i]);
+			result = false;
+		}
+	}
+
+	trie_time = time_monotonic_ms() - start;
+
+	if (result) {
+		log_unit("%u lookups against %u subnets took %lu milliseconds using a linear scan, and %lu milliseconds using the trie. { matches = %u }",
+			lookups, count, linear_time, trie_time, matches);
+	}
+
+	// An IPv4 address mapped into the IPv6 address space should match the IPv4 subnets.
+	if (result && (!ip_subnet_st("203.0.113.0/24", &fixed) || !subnet_trie_add(trie, &fixed, NULL) || !ip_addr_st("::ffff:203.0.113.7", &(addresses[0])) ||
+		!subnet_trie_match(trie, &(addresses[0]), NULL, &length) || length < 24)) {
+		st_sprint(errmsg, "The subnet trie failed to match a mapped IPv4 address.");
+		result = false;
+	}
+
+	// Publishing a replacement should hand back the original, so the caller can free it once the readers are done.
+	if (result && (subnet_trie_swap(&active, trie) || subnet_trie_get(&active) != trie || subnet_trie_swap(&active, NULL) != trie)) {
+		st_sprint(errmsg, "The subnet trie wasn't published correctly.");
+		result = false;
+	}
+
+	subnet_trie_free(trie);
+	mm_free(subnets);
+	mm_free(addresses);
+	mm_free(expected);
+
+	return result;
+}
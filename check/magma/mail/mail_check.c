@@ -50,6 +50,20 @@ START_TEST (check_mail_headers_s) {
 }
 END_TEST
 
+START_TEST (check_mail_summary_s) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) result = check_mail_summary_sthread(errmsg);
+	if (status() && result) result = check_mail_summary_lru_sthread(errmsg);
+
+	log_test("MAIL / SUMMARY / SINGLE THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
 Suite * suite_check_mail(void) {
 
 	Suite *s = suite_create("\tMail");
@@ -57,6 +71,7 @@ Suite * suite_check_mail(void) {
 	suite_check_testcase(s, "MAIL", "Mail Store/S", check_mail_store_s);
 	suite_check_testcase(s, "MAIL", "Mail Load/S", check_mail_load_s);
 	suite_check_testcase(s, "MAIL", "Mail Headers/S", check_mail_headers_s);
+	suite_check_testcase(s, "MAIL", "Mail Summary/S", check_mail_summary_s);
 
 	return s;
 }
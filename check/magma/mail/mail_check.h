@@ -16,6 +16,10 @@ bool_t   check_mail_load_sthread(stringer_t *errmsg);
 /// headers_check.c
 bool_t   check_mail_headers_sthread(stringer_t *errmsg);
 
+/// summary_check.c
+bool_t   check_mail_summary_lru_sthread(stringer_t *errmsg);
+bool_t   check_mail_summary_sthread(stringer_t *errmsg);
+
 /// mail_check.c
 Suite *  suite_check_mail(void);
 
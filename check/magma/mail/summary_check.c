@@ -0,0 +1,157 @@
+
+/**
+ * @file /magma/check/magma/mail/summary_check.c
+ */
+
+#include "magma_check.h"
+
+extern inx_t *mail_summaries;
+
+bool_t check_mail_summary_sthread(stringer_t *errmsg) {
+
+	size_t length;
+	bool_t result = true;
+	mail_summary_t *summary = NULL;
+	stringer_t *data = NULL, *header, *expected, *fields[MAIL_SUMMARY_FIELDS];
+	uint32_t max = check_message_max();
+	chr_t *names[MAIL_SUMMARY_FIELDS] = {
+		"Date", "Subject", "From", "Sender", "Reply-To", "To", "Cc", "Bcc", "In-Reply-To", "Message-Id", "Return-Path"
+	};
+
+	for (uint32_t i = 0; i < max && result && status(); i++) {
+
+		if (!(data = check_message_get(i)) || !(length = mail_header_end(data))) {
+			st_sprint(errmsg, "Failed to get the message header. { message = %i }", i);
+			st_cleanup(data);
+			return false;
+		}
+
+		header = PLACER(st_char_get(data), length);
+
+		if (!(summary = mail_summary_build(header, NULL)) || !mail_summary_copy(summary, NULL, fields)) {
+			st_sprint(errmsg, "Failed to build the message summary. { message = %i }", i);
+			mm_cleanup(summary);
+			st_free(data);
+			return false;
+		}
+
+		// Every field should match the value extracted from the header directly.
+		for (int_t j = 0; j < MAIL_SUMMARY_FIELDS && result; j++) {
+
+			expected = mail_header_fetch_cleaned(header, NULLER(names[j]));
+
+			if (st_empty(expected) != st_empty(fields[j]) || (!st_empty(expected) && st_cmp_cs_eq(expected, fields[j]))) {
+				st_sprint(errmsg, "The message summary didn't match the header. { message = %i / field = %s }", i, names[j]);
+				result = false;
+			}
+
+			st_cleanup(expected);
+		}
+
+		for (int_t j = 0; j < MAIL_SUMMARY_FIELDS; j++) {
+			st_cleanup(fields[j]);
+		}
+
+		// A summary read for a message marked as junk should have the label added to its subject.
+		if (result && mail_summary_copy(summary, mail_summary_label(MAIL_MARK_JUNK), fields)) {
+
+			if (st_cmp_cs_starts(fields[MAIL_SUMMARY_SUBJECT], NULLER("JUNK:"))) {
+				st_sprint(errmsg, "The message summary subject wasn't labeled. { message = %i }", i);
+				result = false;
+			}
+
+			for (int_t j = 0; j < MAIL_SUMMARY_FIELDS; j++) {
+				st_cleanup(fields[j]);
+			}
+		}
+
+		mm_free(summary);
+		st_free(data);
+	}
+
+	return result;
+}
+
+bool_t check_mail_summary_lru_sthread(stringer_t *errmsg) {
+
+	bool_t result = true;
+	meta_message_t meta;
+	mail_summary_t *summary;
+	stringer_t *fields[MAIL_SUMMARY_FIELDS];
+	uint32_t limit = magma.storage.summaries.cache_limit;
+	uint64_t base = UINT64_MAX - 16, present[] = { base + 1, base + 3, base + 4 };
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	// The cache is disabled, so there is nothing to evict.
+	if (!mail_summaries) {
+		return true;
+	}
+
+	mm_wipe(&meta, sizeof(meta_message_t));
+	magma.storage.summaries.cache_limit = 3;
+
+	for (uint64_t i = 1; i <= 3 && result; i++) {
+		if (!(summary = mail_summary_build(NULLER("Subject: LRU\r\n\r\n"), NULL))) {
+			st_sprint(errmsg, "Failed to build a message summary.");
+			result = false;
+		}
+		else {
+			mail_summary_insert(base + i, summary);
+		}
+	}
+
+	// Reading the oldest summary makes it the most recently used, so the second summary should be removed next.
+	meta.messagenum = base + 1;
+
+	if (result && !mail_summary_get(&meta, NULL, NULL, fields)) {
+		st_sprint(errmsg, "Failed to read a cached message summary.");
+		result = false;
+	}
+	else if (result) {
+		for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) st_cleanup(fields[i]);
+	}
+
+	if (result && !(summary = mail_summary_build(NULLER("Subject: LRU\r\n\r\n"), NULL))) {
+		st_sprint(errmsg, "Failed to build a message summary.");
+		result = false;
+	}
+	else if (result) {
+		mail_summary_insert(base + 4, summary);
+	}
+
+	inx_lock_read(mail_summaries);
+
+	if (result && inx_count(mail_summaries) != 3) {
+		st_sprint(errmsg, "The summary cache grew past its limit. { count = %lu }", inx_count(mail_summaries));
+		result = false;
+	}
+
+	key.val.u64 = base + 2;
+
+	if (result && inx_find(mail_summaries, key)) {
+		st_sprint(errmsg, "The least recently used summary wasn't evicted.");
+		result = false;
+	}
+
+	for (size_t i = 0; i < sizeof(present) / sizeof(uint64_t) && result; i++) {
+		key.val.u64 = present[i];
+		if (!inx_find(mail_summaries, key)) {
+			st_sprint(errmsg, "A recently used summary was evicted. { messagenum = %lu }", present[i]);
+			result = false;
+		}
+	}
+
+	inx_unlock(mail_summaries);
+
+	// Remove the test summaries, and restore the configured limit.
+	inx_lock_write(mail_summaries);
+	for (uint64_t i = 1; i <= 4; i++) {
+		key.val.u64 = base + i;
+		inx_delete(mail_summaries, key);
+	}
+	inx_unlock(mail_summaries);
+
+	magma.storage.summaries.cache_limit = limit;
+
+	return result;
+}
@@ -0,0 +1,113 @@
+
+/**
+ * @file /check/magma/network/admission_check.c
+ *
+ * @brief Check the connection admission control logic.
+ */
+
+#include "magma_check.h"
+
+bool_t check_network_admission_sthread(stringer_t *errmsg) {
+
+	int_t result, counted, both = NET_ADMISSION_HOST | NET_ADMISSION_SUBNET;
+	uint32_t admitted = 0, delayed = 0, limit;
+	ip_t host, neighbor, mapped, other;
+
+	if (!ip_addr_st("198.51.100.7", &host) || !ip_addr_st("198.51.100.8", &neighbor) ||
+		!ip_addr_st("::ffff:198.51.100.7", &mapped) || !ip_addr_st("203.0.113.9", &other)) {
+		st_sprint(errmsg, "Unable to parse the test addresses.");
+		return false;
+	}
+
+	// Addresses in the same /24 share a subnet entry but not a host entry, and mapped addresses are tracked as IPv4.
+	if (net_admission_hash(&host, false) == net_admission_hash(&neighbor, false) ||
+		net_admission_hash(&host, true) != net_admission_hash(&neighbor, true)) {
+		st_sprint(errmsg, "The admission hashes didn't separate hosts from their subnet.");
+		return false;
+	}
+	else if (net_admission_hash(&host, false) != net_admission_hash(&mapped, false) ||
+		net_admission_hash(&host, true) != net_admission_hash(&mapped, true)) {
+		st_sprint(errmsg, "The admission hashes for an IPv4 address and its mapped IPv6 form didn't match.");
+		return false;
+	}
+	else if (net_admission_hash(&host, false) == net_admission_hash(&host, true)) {
+		st_sprint(errmsg, "The admission hash for a host matched the hash for its subnet.");
+		return false;
+	}
+
+	if (!magma.system.admission.enable) {
+		return true;
+	}
+
+	// Fill the connection limit for a single host, which should stay well inside its rate limit.
+	limit = magma.system.admission.host_connections;
+
+	if (limit && limit + 2 <= magma.system.admission.host_rate && limit < magma.system.admission.subnet_connections &&
+		limit + 2 <= magma.system.admission.subnet_rate) {
+
+		for (uint32_t i = 0; i < limit; i++) {
+			if ((result = net_admission_check(&host, &counted)) != NET_ADMISSION_ADMIT || counted != both) {
+				st_sprint(errmsg, "A connection under the host limit wasn't admitted and counted. { connection = %u / result = %i / counted = %i }",
+					i + 1, result, counted);
+				if (result == NET_ADMISSION_ADMIT) net_admission_release(&host, counted);
+				for (uint32_t j = 0; j < i; j++) net_admission_release(&host, both);
+				return false;
+			}
+		}
+
+		if ((result = net_admission_check(&host, &counted)) != NET_ADMISSION_REJECT) {
+			st_sprint(errmsg, "A connection over the host limit wasn't rejected. { result = %i }", result);
+			if (result == NET_ADMISSION_ADMIT || result == NET_ADMISSION_DELAY) net_admission_release(&host, counted);
+			for (uint32_t j = 0; j < limit; j++) net_admission_release(&host, both);
+			return false;
+		}
+		else if (counted) {
+			st_sprint(errmsg, "A rejected connection was left in the admission counts. { counted = %i }", counted);
+			for (uint32_t j = 0; j < limit; j++) net_admission_release(&host, both);
+			return false;
+		}
+
+		// Once a connection closes, the host should be admitted again.
+		net_admission_release(&host, both);
+
+		if ((result = net_admission_check(&host, &counted)) != NET_ADMISSION_ADMIT) {
+			st_sprint(errmsg, "A connection wasn't admitted after another connection from the host was released. { result = %i }", result);
+			for (uint32_t j = 0; j < limit - 1; j++) net_admission_release(&host, both);
+			return false;
+		}
+
+		for (uint32_t j = 0; j < limit; j++) net_admission_release(&host, both);
+	}
+
+	// Connect and disconnect repeatedly, which should exhaust the token bucket and lead to delays, and then the tarpit.
+	limit = magma.system.admission.host_rate;
+
+	if (limit && limit < magma.system.admission.subnet_rate) {
+
+		for (uint32_t i = 0; i < limit * 3; i++) {
+
+			if ((result = net_admission_check(&other, &counted)) == NET_ADMISSION_ADMIT) {
+				net_admission_release(&other, counted);
+				admitted++;
+			}
+			else if (result == NET_ADMISSION_DELAY) {
+				net_admission_release(&other, counted);
+				delayed++;
+			}
+			else {
+				break;
+			}
+		}
+
+		if (admitted < limit || admitted > limit + 1) {
+			st_sprint(errmsg, "The host rate limit didn't admit the expected number of connections. { admitted = %u / limit = %u }", admitted, limit);
+			return false;
+		}
+		else if (!delayed || result != NET_ADMISSION_TARPIT) {
+			st_sprint(errmsg, "A host over the rate limit wasn't delayed and then tarpitted. { delayed = %u / result = %i }", delayed, result);
+			return false;
+		}
+	}
+
+	return true;
+}
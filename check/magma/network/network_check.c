@@ -7,10 +7,25 @@
 
 #include "magma_check.h"
 
+START_TEST (check_network_admission_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) outcome = check_network_admission_sthread(errmsg);
+
+	log_test("NETWORK / ADMISSION / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+
+} END_TEST
+
 Suite * suite_check_network(void) {
 
 	Suite *s = suite_create("\tNetwork");
 
+	suite_check_testcase(s, "NETWORK", "Network Admission/S", check_network_admission_s);
+
 	// The IP address checks were the only thing handled by this suite. Those checks have since moved to
 	// to core. The empty suite remains to remind us what needs doing.
 
@@ -8,6 +8,10 @@
 #ifndef NETWORK_CHECK_H
 #define NETWORK_CHECK_H
 
+/// admission_check.c
+bool_t check_network_admission_sthread(stringer_t *errmsg);
+
+/// network_check.c
 Suite * suite_check_network(void);
 
 #endif
@@ -117,12 +117,104 @@ START_TEST (check_warehouse_domains_s) {
 }
 END_TEST
 
+START_TEST (check_object_views_s) {
+
+	log_disable();
+	multi_t key;
+	meta_view_t *view;
+	meta_user_t *user;
+	bool_t result = true;
+	meta_message_t *message;
+	stringer_t *errmsg = NULL;
+	uint64_t sizes[] = { 300, 100, 200, 100, 500, 400 }, created[] = { 50, 10, 40, 20, 30, 60 };
+
+	if (!(user = meta_alloc()) || !(user->messages = inx_alloc(M_INX_LINKED, &meta_message_free))) {
+		errmsg = NULLER("Unable to allocate the meta user object.");
+		result = false;
+	}
+
+	// Messages 1, 3 and 5 are placed in folder 1, and the others in folder 2.
+	for (uint64_t i = 0; result && i < 6; i++) {
+
+		key.type = M_TYPE_UINT64;
+		key.val.u64 = i + 1;
+
+		if (!(message = mm_alloc(sizeof(meta_message_t)))) {
+			errmsg = NULLER("Unable to allocate a meta message object.");
+			result = false;
+		}
+		else {
+			message->messagenum = i + 1;
+			message->foldernum = (i % 2) + 1;
+			message->size = sizes[i];
+			message->created = created[i];
+
+			if (!inx_append(user->messages, key, message)) {
+				errmsg = NULLER("Unable to append a meta message object.");
+				mm_free(message);
+				result = false;
+			}
+		}
+	}
+
+	// By date, folder 1 holds 5, 3, 1, and the view for the same folder and order should be reused.
+	if (result && (!(view = meta_views_get(user, NULL, 1, META_SORT_DATE)) || view->count != 3 || view->entries[0].message->messagenum != 5 ||
+		view->entries[1].message->messagenum != 3 || view->entries[2].message->messagenum != 1 || view != meta_views_get(user, NULL, 1, META_SORT_DATE))) {
+		errmsg = NULLER("The folder view sorted by date was incorrect.");
+		result = false;
+	}
+
+	// By size, folder 2 holds 2 and 4, which share a size and are ordered by message number, and then 6.
+	if (result && (!(view = meta_views_get(user, NULL, 2, META_SORT_SIZE)) || view->count != 3 || view->entries[0].message->messagenum != 2 ||
+		view->entries[1].message->messagenum != 4 || view->entries[2].message->messagenum != 6 || meta_view_position(view, 4) != 1 ||
+		meta_view_position(view, 6) != 2 || meta_view_position(view, 1) != -1)) {
+		errmsg = NULLER("The folder view sorted by size was incorrect.");
+		result = false;
+	}
+
+	// Removing a message should make the existing views stale.
+	key.val.u64 = 3;
+
+	if (result && (!inx_delete(user->messages, key) || !(view = meta_views_get(user, NULL, 1, META_SORT_DATE)) || view->count != 2 ||
+		meta_view_position(view, 3) != -1 || meta_view_position(view, 5) != 0 || meta_view_position(view, 1) != 1)) {
+		errmsg = NULLER("The folder view wasn't rebuilt after a message was removed.");
+		result = false;
+	}
+
+	// Moving a message doesn't change the collection serial number, so the views must be marked stale, and then reconciled.
+	key.val.u64 = 2;
+
+	if (result && (message = inx_find(user->messages, key))) {
+		message->foldernum = 1;
+		meta_views_reset(user);
+	}
+
+	if (result && (!message || !(view = meta_views_get(user, NULL, 1, META_SORT_DATE)) || view->stale || view->count != 3 || view->entries[0].messagenum != 2 ||
+		meta_view_position(view, 2) != 0 || meta_view_position(view, 5) != 1 || view != meta_views_get(user, NULL, 1, META_SORT_DATE))) {
+		errmsg = NULLER("The folder view wasn't reconciled after a message was moved.");
+		result = false;
+	}
+
+	// And an empty folder should yield an empty view.
+	if (result && (!(view = meta_views_get(user, NULL, 3, META_SORT_DATE)) || view->count || meta_view_position(view, 1) != -1)) {
+		errmsg = NULLER("The view of an empty folder wasn't empty.");
+		result = false;
+	}
+
+	meta_free(user);
+
+	log_test("OBJECTS / VIEWS / SINGLE THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
 Suite * suite_check_objects(void) {
 
 	Suite *s = suite_create("\tObjects");
 
 	suite_check_testcase(s, "OBJECTS", "Object Serials/S", check_object_serials_s);
 	suite_check_testcase(s, "OBJECTS", "Object Warehouse Domains/S", check_warehouse_domains_s);
+	suite_check_testcase(s, "OBJECTS", "Object Views/S", check_object_views_s);
 
 	return s;
 }
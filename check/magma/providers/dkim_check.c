@@ -253,3 +253,57 @@ bool_t check_dkim_sign_mthread(stringer_t *errmsg) {
 	mm_free(threads);
 	return result;
 }
+
+bool_t check_dkim_records_sthread(stringer_t *errmsg) {
+
+	int_t length;
+	HEADER *header;
+	struct __res_state resolver;
+	chr_t *query = "magma._domainkey.example.com";
+	uchr_t packet[NS_PACKETSZ], buffer[NS_PACKETSZ];
+
+	mm_wipe(&resolver, sizeof(struct __res_state));
+
+	if (res_ninit(&resolver)) {
+		st_sprint(errmsg, "Unable to initialize the DNS resolver.");
+		return false;
+	}
+	else if ((length = res_nmkquery(&resolver, ns_o_query, query, ns_c_in, ns_t_txt, NULL, 0, NULL, packet, NS_PACKETSZ)) <= 0) {
+		st_sprint(errmsg, "Unable to build the DKIM key record query.");
+		res_nclose(&resolver);
+		return false;
+	}
+
+	res_nclose(&resolver);
+
+	// Turn the query into an answer, which reports the name doesn't exist, and store it in the cache.
+	header = (HEADER *)packet;
+	header->qr = 1;
+	header->rcode = NXDOMAIN;
+
+	if (dkim_records_ttl(packet, length) != (MAGMA_DKIM_CACHE_NEGATIVE < magma.dkim.cache ? MAGMA_DKIM_CACHE_NEGATIVE : magma.dkim.cache)) {
+		st_sprint(errmsg, "The DKIM key record cache didn't use the negative time to live for a missing key.");
+		return false;
+	}
+
+	dkim_records_set(query, ns_t_txt, packet, length);
+
+	if (magma.dkim.cache && (dkim_records_get(query, ns_t_txt, buffer, NS_PACKETSZ) != length || mm_cmp_cs_eq(buffer, packet, length))) {
+		st_sprint(errmsg, "The DKIM key record answer wasn't returned by the cache.");
+		return false;
+	}
+	else if (dkim_records_get(query, ns_t_a, buffer, NS_PACKETSZ) || dkim_records_get(query, ns_t_txt, buffer, length - 1)) {
+		st_sprint(errmsg, "The DKIM key record cache returned an answer for a different query, or an answer larger than the buffer.");
+		return false;
+	}
+
+	// A server failure should never be cached.
+	header->rcode = SERVFAIL;
+
+	if (dkim_records_ttl(packet, length)) {
+		st_sprint(errmsg, "The DKIM key record cache would have stored a server failure.");
+		return false;
+	}
+
+	return true;
+}
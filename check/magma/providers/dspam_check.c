@@ -105,3 +105,79 @@ bool_t check_dspam_mail_sthread(void) {
 
 	return true;
 }
+
+bool_t check_dspam_training_sthread(void) {
+
+	int_t fd;
+	uint32_t batch;
+	chr_t *journal;
+	bool_t result = true;
+	uint64_t cancelled, processed, waited = 0;
+	stringer_t *hex = NULL, *records = NULL, *path = NULL;
+
+	// The journal holds a duplicated request, two opposite requests which cancel each other out, and a request which was
+	// already trained, so only two of the seven requests should be left for the training thread.
+	if (!(hex = hex_encode_st(PLACER("training signature", 18), NULL)) || !(records = st_aprint("T 1 100 0 %.*s\nT 1 100 0 %.*s\nT 1 101 0 %.*s\n"
+		"T 1 101 1 %.*s\nT 1 102 1 %.*s\nD 102\nT 1 103 0 %.*s\n", st_length_int(hex), st_char_get(hex), st_length_int(hex), st_char_get(hex),
+		st_length_int(hex), st_char_get(hex), st_length_int(hex), st_char_get(hex), st_length_int(hex), st_char_get(hex), st_length_int(hex),
+		st_char_get(hex))) || (fd = file_temp_handle(NULL, &path)) < 0) {
+		log_unit("Unable to build the training journal.");
+		st_cleanup(hex, records);
+		return false;
+	}
+	else if (write(fd, st_data_get(records), st_length_get(records)) != st_length_get(records) || close(fd)) {
+		log_unit("Unable to write the training journal.");
+		unlink(st_char_get(path));
+		st_cleanup(hex, records, path);
+		return false;
+	}
+
+	st_free(hex);
+	st_free(records);
+
+	// Restart the queue using the journal, and the configuration saved here is restored once the check is complete.
+	dspam_training_stop();
+
+	batch = magma.iface.dspam.batch;
+	journal = magma.iface.dspam.journal;
+	magma.iface.dspam.batch = 16;
+	magma.iface.dspam.journal = st_char_get(path);
+
+	cancelled = stats_get_value_by_name("dspam.training.cancelled");
+	processed = stats_get_value_by_name("dspam.training.trained") + stats_get_value_by_name("dspam.training.failed");
+
+	if (!dspam_training_start()) {
+		log_unit("Unable to replay the training journal.");
+		result = false;
+	}
+
+	// The requests are trained in the background, so give the training thread a few seconds to finish.
+	while (result && waited++ < 100 && stats_get_value_by_name("dspam.training.trained") + stats_get_value_by_name("dspam.training.failed") - processed < 2) {
+		usleep(50000);
+	}
+
+	if (result && stats_get_value_by_name("dspam.training.trained") + stats_get_value_by_name("dspam.training.failed") - processed != 2) {
+		log_unit("The replayed journal didn't yield the expected number of training requests. { expected = 2 / processed = %lu }",
+			stats_get_value_by_name("dspam.training.trained") + stats_get_value_by_name("dspam.training.failed") - processed);
+		result = false;
+	}
+	else if (result && stats_get_value_by_name("dspam.training.cancelled") - cancelled != 1) {
+		log_unit("The opposite training requests didn't cancel each other out.");
+		result = false;
+	}
+
+	dspam_training_stop();
+
+	magma.iface.dspam.batch = batch;
+	magma.iface.dspam.journal = journal;
+
+	unlink(st_char_get(path));
+	st_free(path);
+
+	if (!dspam_training_start()) {
+		log_unit("Unable to restart the training queue.");
+		result = false;
+	}
+
+	return result;
+}
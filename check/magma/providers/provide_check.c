@@ -436,17 +436,18 @@ END_TEST
 START_TEST (check_spf_s) {
 
 	log_disable();
-	chr_t *errmsg = NULL;
 	SPF_server_t *object;
+	chr_t *errmsg = NULL, *statistic = NULL;
 	SPF_dns_server_t *spf_dns_zone = NULL;
 	ip_t ip[2] = {
 			{ .family = AF_INET, { .ip4.s_addr = 0x01010101 }},
 			{ .family = AF_INET, { .ip4.s_addr = 0x0100007f }}
 	};
-	SPF_dns_test_data_t spf_test_data[3] = {
+	SPF_dns_test_data_t spf_test_data[4] = {
 			{ "pass.lavabit.com", ns_t_txt, NETDB_SUCCESS, "v=spf1 ip4:1.1.1.1 -all" },
 			{ "fail.lavabit.com", ns_t_txt, NETDB_SUCCESS, "v=spf1 -all" },
-			{ "neutral.lavabit.com", ns_t_txt, NETDB_SUCCESS, "v=spf1 ~all" }
+			{ "neutral.lavabit.com", ns_t_txt, NETDB_SUCCESS, "v=spf1 ~all" },
+			{ "include.lavabit.com", ns_t_txt, NETDB_SUCCESS, "v=spf1 include:pass.lavabit.com -all" }
 	};
 
 	if (status()) {
@@ -488,6 +489,28 @@ START_TEST (check_spf_s) {
 		if (!errmsg && spf_check(&ip[1], NULLER("mx.lavabit.com"), NULLER("support@fail.lavabit.com")) != 1) {
 			errmsg = "The localhost address matched a failure record instead of being whitelisted. { support@fail.lavabit.com / 127.0.0.1 }";
 		}
+
+		// Include
+		if (!errmsg && spf_check(&ip[0], NULLER("mx.lavabit.com"), NULLER("support@include.lavabit.com")) != 1) {
+			errmsg = "Included SPF record check failed. { support@include.lavabit.com / 1.1.1.1 }";
+		}
+
+		// Cached, the outcome should be stored using the lowercase domain, and returned without evaluating the record again.
+		if (!errmsg && magma.iface.spf.cache && (spf_cache_get(&ip[0], NULLER("FAIL.lavabit.com"), &statistic) != -2 ||
+			st_cmp_cs_eq(NULLER(statistic), NULLER("provider.spf.fail")))) {
+			errmsg = "The SPF check outcome wasn't cached. { support@fail.lavabit.com / 1.1.1.1 }";
+		}
+		else if (!errmsg && spf_check(&ip[0], NULLER("mx.lavabit.com"), NULLER("support@fail.lavabit.com")) != -2) {
+			errmsg = "Cached SPF record check failed. { support@fail.lavabit.com / 1.1.1.1 }";
+		}
+
+		// Null sender, which doesn't have a domain, so the outcome shouldn't be cached under the HELO domain.
+		if (!errmsg && spf_check(&ip[0], NULLER("mx.lavabit.com"), NULLER("<>")) != -1) {
+			errmsg = "Null sender SPF record check failed. { <> / 1.1.1.1 }";
+		}
+		else if (!errmsg && magma.iface.spf.cache && spf_cache_get(&ip[0], NULLER("mx.lavabit.com"), &statistic)) {
+			errmsg = "The SPF check outcome for a null sender was cached. { <> / 1.1.1.1 }";
+		}
 	}
 
 	log_test("CHECKERS / SPF / SINGLE THREADED:", NULLER(errmsg));
@@ -511,6 +534,20 @@ START_TEST (check_virus_s) {
 }
 END_TEST
 
+START_TEST (check_virus_engine_s) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	// If the anti-virus engine is disabled we skip this tests.
+	if (status() && magma.iface.virus.available) result = check_virus_engine_sthread(errmsg);
+
+	log_test("CHECKERS / VIRUS / ENGINE / SINGLE THREADED:", (magma.iface.virus.available ? errmsg : NULLER("SKIPPED")));
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
 //! Spam Checker Tests
 START_TEST (check_dspam_mail_s) {
 
@@ -544,6 +581,22 @@ START_TEST (check_dspam_bin_s) {
 }
 END_TEST
 
+START_TEST (check_dspam_training_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status() && !check_dspam_training_sthread()) {
+		outcome = false;
+		st_sprint(errmsg, "The training queue didn't deduplicate, cancel, or replay the journaled requests correctly.");
+	}
+
+	log_test("CHECKERS / DSPAM / TRAINING / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
 //! DKIM Tests
 START_TEST (check_dkim_verify_s) {
 
@@ -588,6 +641,19 @@ START_TEST (check_dkim_sign_m) {
 }
 END_TEST
 
+START_TEST (check_dkim_records_s) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) result = check_dkim_records_sthread(errmsg);
+
+	log_test("CHECKERS / DKIM / RECORDS / SINGLE THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
 //! Encoding/Parser Tests
 START_TEST (check_unicode_s) {
 
@@ -650,6 +716,7 @@ Suite * suite_check_provide(void) {
 
 	if (do_virus_check) {
 		suite_check_testcase(s, "PROVIDERS", "Virus/S", check_virus_s);
+		suite_check_testcase(s, "PROVIDERS", "Virus Engine/S", check_virus_engine_s);
 	}
 	else {
 		log_unit("Skipping the virus scanning checks...\n");
@@ -659,6 +726,7 @@ Suite * suite_check_provide(void) {
 		suite_check_testcase(s, "PROVIDERS", "DKIM Verify/S", check_dkim_verify_s);
 		suite_check_testcase(s, "PROVIDERS", "DKIM Signing/S", check_dkim_sign_s);
 		suite_check_testcase(s, "PROVIDERS", "DKIM Signing/M", check_dkim_sign_m);
+		suite_check_testcase(s, "PROVIDERS", "DKIM Records/S", check_dkim_records_s);
 	}
 	else {
 		log_unit("Skipping the DKIM checks...\n");
@@ -667,6 +735,7 @@ Suite * suite_check_provide(void) {
 	if (do_dspam_check) {
 		suite_check_testcase(s, "PROVIDERS", "DSPAM Mail/S", check_dspam_mail_s);
 		suite_check_testcase(s, "PROVIDERS", "DSPAM Binary/S", check_dspam_bin_s);
+		suite_check_testcase(s, "PROVIDERS", "DSPAM Training/S", check_dspam_training_s);
 	}
 	else {
 		log_unit("Skipping the DSPAM checks...\n");
@@ -24,6 +24,7 @@ typedef struct {
 bool_t   check_dkim_sign_sthread(stringer_t *domain, stringer_t *errmsg);
 bool_t   check_dkim_verify_sthread(stringer_t *errmsg);
 bool_t   check_dkim_sign_mthread(stringer_t *errmsg);
+bool_t   check_dkim_records_sthread(stringer_t *errmsg);
 
 /// symmetric_check.c
 bool_t   check_symmetric_sthread(chr_t *name);
@@ -48,12 +49,14 @@ bool_t   check_scramble_sthread(void);
 /// dspam_check.c
 bool_t   check_dspam_binary_sthread(void);
 bool_t   check_dspam_mail_sthread(void);
+bool_t   check_dspam_training_sthread(void);
 
 /// provide_check.c
 Suite *      suite_check_provide(void);
 
 /// virus_check.c
 bool_t check_virus_sthread(stringer_t *errmsg);
+bool_t check_virus_engine_sthread(stringer_t *errmsg);
 
 /// ecies_check.c
 void     check_ecies_cleanup(EC_KEY *key, cryptex_t *ciphered, stringer_t *hex_pub, stringer_t *hex_priv, unsigned char *text, unsigned char *copy, unsigned char *original);
@@ -30,3 +30,34 @@
 
 	return true;
 }
+
+bool_t check_virus_engine_sthread(stringer_t *errmsg) {
+
+	uint64_t references;
+	virus_engine_t *engine, *again;
+
+	if (!(engine = virus_engine_acquire())) {
+		st_sprint(errmsg, "Unable to acquire a reference to the active virus engine.");
+		return false;
+	}
+
+	// The active engine holds a reference of its own, so ours should never be the last one.
+	references = engine->references;
+
+	if (references < 2 || !(again = virus_engine_acquire()) || again->references != references + 1) {
+		st_sprint(errmsg, "The virus engine reference count is invalid. { references = %lu }", references);
+		virus_engine_release(engine);
+		return false;
+	}
+
+	virus_engine_release(again);
+	virus_engine_release(engine);
+
+	// Scanning should still work after the references are released.
+	if (virus_check(NULLER("From: virus.check@lavabit.com\r\nSubject: Virus Engine Check\r\n\r\nThis message is clean.\r\n")) != 1) {
+		st_sprint(errmsg, "The virus engine failed to scan a clean message after the references were released.");
+		return false;
+	}
+
+	return true;
+}
@@ -140,6 +140,58 @@ bool_t check_http_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_
 	return true;
 }
 
+bool_t check_http_network_cache_sthread(stringer_t *errmsg, uint32_t port, bool_t secure) {
+
+	placer_t value;
+	client_t *client = NULL;
+	stringer_t *etag = MANAGEDBUF(128), *request = MANAGEDBUF(512);
+
+	// Request the index page, and find the entity tag in the response headers.
+	if (!(client = client_connect("localhost", port)) || (secure && (client_secure(client) == -1)) || client_status(client) != 1) {
+		st_sprint(errmsg, "Failed to connect with the HTTP server.");
+		client_close(client);
+		return false;
+	}
+	else if (client_write(client, PLACER("GET / HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\n\r\n", 58)) != 58 ||
+		client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("HTTP/1.1 200"))) {
+		st_sprint(errmsg, "Failed to return a valid GET response.");
+		client_close(client);
+		return false;
+	}
+
+	while (client_read_line(client) > 2) {
+		if (!st_cmp_ci_starts(&(client->line), NULLER("ETag: ")) && pl_length_get(client->line) > 8) {
+			value = pl_init(pl_char_get(client->line) + 6, pl_length_get(client->line) - 8);
+			st_copy_in(etag, pl_data_get(value), pl_length_get(value));
+		}
+	}
+
+	client_close(client);
+
+	if (st_empty(etag)) {
+		st_sprint(errmsg, "The GET response for a static resource didn't include an entity tag.");
+		return false;
+	}
+
+	// Repeat the request with the entity tag, which should tell the server our copy is current.
+	st_sprint(request, "GET / HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: %.*s\r\n\r\n", st_length_int(etag), st_char_get(etag));
+
+	if (!(client = client_connect("localhost", port)) || (secure && (client_secure(client) == -1)) || client_status(client) != 1) {
+		st_sprint(errmsg, "Failed to connect with the HTTP server.");
+		client_close(client);
+		return false;
+	}
+	else if (client_write(client, request) != st_length_get(request) || client_read_line(client) <= 0 ||
+		st_cmp_cs_starts(&(client->line), NULLER("HTTP/1.1 304"))) {
+		st_sprint(errmsg, "A conditional GET request with a matching entity tag didn't return a 304 response.");
+		client_close(client);
+		return false;
+	}
+
+	client_close(client);
+	return true;
+}
+
 bool_t check_http_network_options_sthread(stringer_t *errmsg, uint32_t port, bool_t secure) {
 
 	client_t *client = NULL;
@@ -0,0 +1,112 @@
+
+/**
+ * @file /check/magma/servers/http/http_check_template.c
+ *
+ * @brief HTTP compiled template test functions.
+ */
+
+#include "magma_check.h"
+
+// The last slot doesn't match anything in the template, so it should never be rendered.
+http_slot_t check_http_template_slots[] = {
+	{ .xpath = "//xhtml:title", .attribute = NULL },
+	{ .xpath = "//xhtml:a[@id='nav_contact']", .attribute = "class" },
+	{ .xpath = "//xhtml:a[@id='nav_contact']", .attribute = "href" },
+	{ .xpath = "//xhtml:p[@id='message']", .attribute = NULL },
+	{ .xpath = "//xhtml:p[@id='missing']", .attribute = NULL }
+};
+
+/**
+ * @brief	Render a template the way pages were rendered before templates were compiled, by setting the values on the parsed
+ * 			document and serializing it.
+ * @param	location	the location of the template.
+ * @param	values		the value of each slot, or NULL to leave a slot unchanged.
+ * @return	NULL on failure, or a managed string containing the rendered page.
+ */
+stringer_t * check_http_template_reference(chr_t *location, chr_t **values) {
+
+	http_page_t *page;
+	xmlChar *escaped;
+	stringer_t *result;
+
+	if (!(page = http_page_get(location))) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < sizeof(check_http_template_slots) / sizeof(http_slot_t); i++) {
+
+		if (!values || !values[i]) {
+			continue;
+		}
+		else if (check_http_template_slots[i].attribute) {
+			xml_set_xpath_property(page->xpath_ctx, (xmlChar *)check_http_template_slots[i].xpath, (uchr_t *)check_http_template_slots[i].attribute,
+				(uchr_t *)values[i]);
+		}
+		// Element content is parsed for entity references, so the value has to be encoded to be set literally.
+		else if ((escaped = xml_encode(page->doc_obj, NULLER(values[i])))) {
+			xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)check_http_template_slots[i].xpath, escaped);
+			mm_free(escaped);
+		}
+	}
+
+	result = xml_dump_doc(page->doc_obj);
+	http_page_free(page);
+
+	return result;
+}
+
+bool_t check_http_template_sthread(stringer_t *errmsg) {
+
+	http_template_t *template;
+	stringer_t *rendered = NULL, *reference = NULL;
+	chr_t *values[][5] = {
+		// Defaults only. The title and message hold entity references, and the class attribute isn't present in the template.
+		{ NULL, NULL, NULL, NULL, NULL },
+		// The characters reserved in text and attributes, including quotes, which are only escaped inside attributes.
+		{ "Tom & Jerry's <Contact> \"Page\"", "active \"quoted\" & <tagged>", "https://example.com/?a=1&b=2", "1 < 2 > 0 & \"done\"", "ignored" },
+		// Empty values, which should replace the original values rather than being treated as missing.
+		{ "", "", NULL, "", NULL },
+		// Whitespace, which the serializer escapes inside attributes.
+		{ NULL, "first\tsecond\nthird", NULL, "line\r\nbreak", NULL }
+	};
+
+	if (!(template = http_template_compile("contact/message", check_http_template_slots, sizeof(check_http_template_slots) / sizeof(http_slot_t)))) {
+		st_sprint(errmsg, "Failed to compile the contact message template.");
+		return false;
+	}
+	else if (template->count != 4) {
+		st_sprint(errmsg, "The compiled template held the wrong number of substitutions. { count = %zu }", template->count);
+		http_template_free(template);
+		return false;
+	}
+
+	// A NULL array should render the same page as an array of NULL values.
+	if (!(rendered = http_template_render(template, NULL)) || !(reference = check_http_template_reference("contact/message", NULL)) ||
+		st_cmp_cs_eq(rendered, reference)) {
+		st_sprint(errmsg, "The template rendered without values didn't match the original template.");
+		http_template_free(template);
+		st_cleanup(rendered, reference);
+		return false;
+	}
+
+	st_cleanup(rendered, reference);
+	rendered = reference = NULL;
+
+	for (size_t i = 0; i < sizeof(values) / sizeof(*values); i++) {
+
+		if (!(rendered = http_template_render(template, values[i])) || !(reference = check_http_template_reference("contact/message", values[i])) ||
+			st_cmp_cs_eq(rendered, reference)) {
+			st_sprint(errmsg, "The rendered template didn't match the serialized document. { set = %zu }", i);
+			http_template_free(template);
+			st_cleanup(rendered, reference);
+			return false;
+		}
+
+		st_cleanup(rendered, reference);
+		rendered = reference = NULL;
+	}
+
+	http_template_free(template);
+
+	return true;
+}
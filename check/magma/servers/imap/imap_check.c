@@ -6,6 +6,51 @@
 
 #include "magma_check.h"
 
+START_TEST (check_imap_sequence_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	imap_sequence_t *sequence = NULL;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	// Overlapping, adjacent and reversed ranges should be merged into two intervals, with the asterisk resolving to 200.
+	if (!(sequence = imap_sequence_compile(PLACER("7,1:5,6,100:90,150:*", 20), 200)) || sequence->count != 3 ||
+		sequence->intervals[0].start != 1 || sequence->intervals[0].end != 7 || sequence->intervals[1].start != 90 ||
+		sequence->intervals[1].end != 100 || sequence->intervals[2].start != 150 || sequence->intervals[2].end != 200) {
+		st_sprint(errmsg, "The sequence set was not compiled into the expected intervals.");
+		outcome = false;
+	}
+	else if (!imap_sequence_contains(sequence, 1) || !imap_sequence_contains(sequence, 7) || imap_sequence_contains(sequence, 8) ||
+		!imap_sequence_contains(sequence, 95) || imap_sequence_contains(sequence, 149) || !imap_sequence_contains(sequence, 200) ||
+		imap_sequence_contains(sequence, 201) || imap_sequence_contains(sequence, 0)) {
+		st_sprint(errmsg, "The compiled sequence set returned the wrong membership result.");
+		outcome = false;
+	}
+
+	mm_cleanup(sequence);
+	sequence = NULL;
+
+	// A range starting past the highest message should still select the highest message.
+	if (outcome && (!(sequence = imap_sequence_compile(PLACER("500:*", 5), 42)) || !imap_sequence_contains(sequence, 42) ||
+		imap_sequence_contains(sequence, 41))) {
+		st_sprint(errmsg, "The compiled sequence set did not resolve the asterisk correctly.");
+		outcome = false;
+	}
+
+	mm_cleanup(sequence);
+
+	// Invalid sequence sets should be rejected.
+	if (outcome && ((sequence = imap_sequence_compile(PLACER("1:x", 3), 10)) || (sequence = imap_sequence_compile(PLACER("1,,2", 4), 10)))) {
+		st_sprint(errmsg, "An invalid sequence set was compiled.");
+		mm_free(sequence);
+		outcome = false;
+	}
+
+	log_test("IMAP / SEQUENCE / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
 START_TEST (check_imap_network_basic_tcp_s) {
 
 	log_disable();
@@ -86,6 +131,26 @@ START_TEST (check_imap_network_fetch_s) {
 }
 END_TEST
 
+START_TEST (check_imap_network_append_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	server_t *server = NULL;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (!(server = servers_get_by_protocol(IMAP, false))) {
+		st_sprint(errmsg, "No IMAP servers were configured to support TCP connections.");
+		outcome = false;
+	}
+	else if (status() && !check_imap_network_append_sthread(errmsg, server->network.port, false)) {
+		outcome = false;
+	}
+
+	log_test("IMAP / NETWORK / APPEND / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
 START_TEST (check_imap_network_starttls_s) {
 
 	log_disable();
@@ -112,10 +177,12 @@ Suite * suite_check_imap(void) {
 
 	Suite *s = suite_create("\tIMAP");
 
+	suite_check_testcase(s, "IMAP", "IMAP Sequence/S", check_imap_sequence_s);
 	suite_check_testcase(s, "IMAP", "IMAP Network Basic/ TCP/S", check_imap_network_basic_tcp_s);
 	suite_check_testcase(s, "IMAP", "IMAP Network Basic/ TLS/S", check_imap_network_basic_tls_s);
 	suite_check_testcase(s, "IMAP", "IMAP Network Search/S", check_imap_network_search_s);
 	suite_check_testcase(s, "IMAP", "IMAP Network Fetch/S", check_imap_network_fetch_s);
+	suite_check_testcase(s, "IMAP", "IMAP Network Append/S", check_imap_network_append_s);
 	suite_check_testcase(s, "IMAP", "IMAP Network STARTTLS/S", check_imap_network_starttls_s);
 
 	return s;
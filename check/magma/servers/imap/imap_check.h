@@ -7,8 +7,14 @@
 #ifndef IMAP_CHECK_H
 #define IMAP_CHECK_H
 
+typedef struct {
+	uint64_t messages, unseen, uidnext;
+} check_imap_status_t;
+
 /// imap_check_network.c
 bool_t check_imap_client_read_end(client_t *client, chr_t *tag);
+uint64_t check_imap_client_status_item(stringer_t *line, chr_t *item);
+bool_t check_imap_network_append_sthread(stringer_t *errmsg, uint32_t port, bool_t secure);
 bool_t check_imap_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_t secure);
 bool_t check_imap_network_fetch_sthread(stringer_t *errmsg, uint32_t port, bool_t secure);
 bool_t check_imap_network_search_sthread(stringer_t *errmsg, uint32_t port, bool_t secure);
@@ -16,6 +22,7 @@ bool_t check_imap_client_close_logout(client_t *client, uint32_t tag_num, string
 bool_t check_imap_client_select(client_t *client, chr_t *folder, chr_t *tag, stringer_t *errmsg);
 bool_t check_imap_network_starttls_sthread(stringer_t *errmsg, uint32_t tcp_port, uint32_t tls_port);
 bool_t check_imap_client_login(client_t *client, chr_t *user, chr_t *pass, chr_t *tag, stringer_t *errmsg);
+bool_t check_imap_client_list_status(client_t *client, chr_t *tag, check_imap_status_t *inbox, check_imap_status_t *scratch, stringer_t *errmsg);
 
 Suite * suite_check_imap(void);
 
@@ -140,6 +140,85 @@ bool_t check_imap_client_close_logout(client_t *client, uint32_t tag_num, string
 	return true;
 }
 
+/**
+ * @brief	Read the value of a single counter from an untagged STATUS response.
+ *
+ * @param	line	The untagged STATUS response line.
+ * @param	item	A chr_t* holding the name of the counter, followed by a space.
+ *
+ * @return	The value of the counter, or 0 if it wasn't found.
+ */
+uint64_t check_imap_client_status_item(stringer_t *line, chr_t *item) {
+
+	size_t location = 0;
+	uint64_t result = 0;
+	chr_t *data = st_char_get(line);
+	size_t length = st_length_get(line);
+
+	if (!st_search_cs(line, NULLER(item), &location)) {
+		return 0;
+	}
+
+	for (location += ns_length_get(item); location < length && data[location] >= '0' && data[location] <= '9'; location++) {
+		result = (result * 10) + (data[location] - '0');
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Issue a LIST command with the STATUS return option for the Inbox and the "Check Append" folder, and collect their counters.
+ *
+ * @param	client	The client_t* to print the command to. It should be connected to an IMAP server and authenticated.
+ * @param	tag		A chr_t* holding the tag to place at the beginning of the LIST command.
+ * @param	inbox	A check_imap_status_t* which will receive the Inbox counters.
+ * @param	scratch	A check_imap_status_t* which will receive the "Check Append" folder counters.
+ * @param	errmsg	A stringer_t* into which the error message will be printed in the even of an error.
+ *
+ * @return	True if the LIST command was successful and returned a STATUS line for both folders, otherwise false.
+ */
+bool_t check_imap_client_list_status(client_t *client, chr_t *tag, check_imap_status_t *inbox, check_imap_status_t *scratch, stringer_t *errmsg) {
+
+	int_t found = 0;
+	check_imap_status_t *status;
+	stringer_t *last_line = NULL;
+
+	mm_wipe(inbox, sizeof(check_imap_status_t));
+	mm_wipe(scratch, sizeof(check_imap_status_t));
+
+	if (client_print(client, "%s LIST () \"\" (\"Check Append\" \"Inbox\") RETURN (CHILDREN STATUS (MESSAGES UNSEEN UIDNEXT))\r\n", tag) <= 0 ||
+		!(last_line = st_merge("ns", tag, NULLER(" OK")))) {
+		st_sprint(errmsg, "Failed to send the LIST-STATUS command.");
+		return false;
+	}
+
+	while (client_read_line(client) > 0 && st_cmp_cs_starts(&(client->line), last_line)) {
+
+		if (!st_cmp_cs_starts(&(client->line), NULLER("* STATUS \"Inbox\" ("))) status = inbox;
+		else if (!st_cmp_cs_starts(&(client->line), NULLER("* STATUS \"Check Append\" ("))) status = scratch;
+		else continue;
+
+		status->messages = check_imap_client_status_item(&(client->line), "MESSAGES ");
+		status->unseen = check_imap_client_status_item(&(client->line), "UNSEEN ");
+		status->uidnext = check_imap_client_status_item(&(client->line), "UIDNEXT ");
+		found |= (status == inbox ? 1 : 2);
+	}
+
+	if (client_status(client) != 1 || st_cmp_cs_starts(&(client->line), last_line)) {
+		st_sprint(errmsg, "Failed to return a successful state after LIST-STATUS.");
+		st_free(last_line);
+		return false;
+	}
+	else if (found != 3) {
+		st_sprint(errmsg, "The LIST-STATUS response was missing a STATUS line. { found = %i }", found);
+		st_free(last_line);
+		return false;
+	}
+
+	st_free(last_line);
+	return true;
+}
+
 bool_t check_imap_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_t secure) {
 
 	client_t *client = NULL;
@@ -375,6 +454,105 @@ bool_t check_imap_network_fetch_sthread(stringer_t *errmsg, uint32_t port, bool_
 	return true;
 }
 
+bool_t check_imap_network_append_sthread(stringer_t *errmsg, uint32_t port, bool_t secure) {
+
+	client_t *client = NULL;
+	check_imap_status_t inbox, scratch;
+	chr_t *message = "From: princess@example.com\r\nSubject: APPEND\r\n\r\nAppended.\r\n";
+
+	// Check the initial response.
+	if (!(client = client_connect("localhost", port)) || (secure && (client_secure(client) == -1)) ||
+		!net_set_timeout(client->sockd, 20, 20) || client_read_line(client) <= 0 || (client->status != 1) ||
+		st_cmp_cs_starts(&(client->line), NULLER("* OK"))) {
+
+		st_sprint(errmsg, "Failed to connect with the IMAP server.");
+		client_close(client);
+		return false;
+	}
+	// Test the LOGIN command.
+	else if (!check_imap_client_login(client, "princess", "password", "A0", errmsg)) {
+		client_close(client);
+		return false;
+	}
+	// Create a scratch folder so the appended messages don't disturb the other checks.
+	else if (client_print(client, "A1 CREATE \"Check Append\"\r\n") <= 0 || !check_imap_client_read_end(client, "A1") ||
+		client_status(client) != 1) {
+
+		st_sprint(errmsg, "Failed to return a successful state after CREATE.");
+		client_close(client);
+		return false;
+	}
+	// A new folder is empty, but should already report the next UID shared by the other folders.
+	else if (!check_imap_client_list_status(client, "L0", &inbox, &scratch, errmsg)) {
+		client_close(client);
+		return false;
+	}
+	else if (scratch.messages || scratch.unseen || scratch.uidnext <= 1 || scratch.uidnext != inbox.uidnext) {
+		st_sprint(errmsg, "The LIST-STATUS counters for a new folder were wrong. { messages = %lu / unseen = %lu / uidnext = %lu / inbox = %lu }",
+			scratch.messages, scratch.unseen, scratch.uidnext, inbox.uidnext);
+		client_close(client);
+		return false;
+	}
+	// Append a single message using a non-synchronizing literal.
+	else if (client_print(client, "A2 APPEND \"Check Append\" (\\Seen) {%zu+}\r\n%s\r\n", ns_length_get(message), message) <= 0 ||
+		!check_imap_client_read_end(client, "A2") || client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("A2 OK [APPENDUID"))) {
+
+		st_sprint(errmsg, "Failed to return a successful state after APPEND.");
+		client_close(client);
+		return false;
+	}
+	// Append three messages in a single MULTIAPPEND command.
+	else if (client_print(client, "A3 APPEND \"Check Append\" (\\Seen) {%zu+}\r\n%s {%zu+}\r\n%s (\\Flagged) \"17-Oct-2026 12:00:00 +0000\" {%zu+}\r\n%s\r\n",
+		ns_length_get(message), message, ns_length_get(message), message, ns_length_get(message), message) <= 0 ||
+		!check_imap_client_read_end(client, "A3") || client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("A3 OK [APPENDUID"))) {
+
+		st_sprint(errmsg, "Failed to return a successful state after MULTIAPPEND.");
+		client_close(client);
+		return false;
+	}
+	// A MULTIAPPEND whose literals add up to more than the limit should be rejected before the oversized literal is requested.
+	else if (client_print(client, "A4 APPEND \"Check Append\" {%zu+}\r\n%s {%u}\r\n", ns_length_get(message), message, IMAP_LITERALS_LIMIT) <= 0 ||
+		client_read_line(client) <= 0 || client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("A4 NO [LIMIT]"))) {
+
+		st_sprint(errmsg, "Failed to return a limit error after a MULTIAPPEND that was too large.");
+		client_close(client);
+		return false;
+	}
+	// List the scratch folder along with its status counters.
+	else if (!check_imap_client_list_status(client, "L1", &inbox, &scratch, errmsg)) {
+		client_close(client);
+		return false;
+	}
+	// Four messages were appended, none by the rejected command, and the two without the seen flag should be counted as unseen. Message numbers are global,
+	// so the scratch folder must report the same next UID as the Inbox.
+	else if (scratch.messages != 4 || scratch.unseen != 2 || scratch.uidnext <= 1 || scratch.uidnext != inbox.uidnext) {
+		st_sprint(errmsg, "The LIST-STATUS counters were wrong. { messages = %lu / unseen = %lu / uidnext = %lu / inbox = %lu }",
+			scratch.messages, scratch.unseen, scratch.uidnext, inbox.uidnext);
+		client_close(client);
+		return false;
+	}
+	// Cleanup the scratch folder.
+	else if (client_print(client, "A5 DELETE \"Check Append\"\r\n") <= 0 || !check_imap_client_read_end(client, "A5") ||
+		client_status(client) != 1) {
+
+		st_sprint(errmsg, "Failed to return a successful state after DELETE.");
+		client_close(client);
+		return false;
+	}
+	// Test the LOGOUT command.
+	else if (client_print(client, "A6 LOGOUT\r\n") <= 0 || !check_imap_client_read_end(client, "A6") ||
+		client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("A6 OK"))) {
+
+		st_sprint(errmsg, "Failed to return a successful state after LOGOUT.");
+		client_close(client);
+		return false;
+	}
+
+	client_close(client);
+
+	return true;
+}
+
 bool_t check_imap_network_starttls_sthread(stringer_t *errmsg, uint32_t tcp_port, uint32_t tls_port) {
 
 	size_t location = 0;
@@ -66,6 +66,26 @@ START_TEST (check_pop_network_stls_s) {
 }
 END_TEST
 
+START_TEST (check_pop_network_stuffing_s) {
+
+	log_disable();
+	server_t *tcp = NULL;
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status() && !(tcp = servers_get_by_protocol(POP, false))) {
+		st_sprint(errmsg, "No POP servers were configured to support TCP connections.");
+		outcome = false;
+	}
+	else if (status() && !check_pop_network_stuffing_sthread(errmsg, tcp->network.port, false)) {
+		outcome = false;
+	}
+
+	log_test("POP / NETWORK / STUFFING / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
 Suite * suite_check_pop(void) {
 
 	Suite *s = suite_create("\tPOP");
@@ -73,6 +93,7 @@ Suite * suite_check_pop(void) {
 	suite_check_testcase(s, "POP", "POP Network Basic / TCP/S", check_pop_network_basic_tcp_s);
 	suite_check_testcase(s, "POP", "POP Network Basic / TLS/S", check_pop_network_basic_tls_s);
 	suite_check_testcase(s, "POP", "POP Network STLS/S", check_pop_network_stls_s);
+	suite_check_testcase(s, "POP", "POP Network Stuffing/S", check_pop_network_stuffing_s);
 
 	return s;
 }
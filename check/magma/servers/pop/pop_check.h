@@ -13,6 +13,8 @@ bool_t check_pop_client_read_end(client_t *client, uint64_t* size, chr_t *token)
 bool_t 	check_pop_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_t secure);
 bool_t check_pop_client_auth(client_t *client, chr_t *user, chr_t *pass, stringer_t *errmsg);
 bool_t check_pop_network_stls_sthread(stringer_t *errmsg, uint32_t tcp_port, uint32_t tls_port);
+bool_t check_pop_client_read_stuffed(client_t *client, uint64_t *length, uint64_t *stuffed);
+bool_t check_pop_network_stuffing_sthread(stringer_t *errmsg, uint32_t port, bool_t secure);
 
 /// pop_check.c
 Suite * suite_check_pop(void);
@@ -187,6 +187,15 @@ bool_t check_pop_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_t
 		client_close(client);
 		return false;
 	}
+	// Test pipelining, by sending the UIDL, LIST and NOOP commands in a single write.
+	else if (client_write(client, PLACER("UIDL\r\nLIST\r\nNOOP\r\n", 18)) != 18 || !check_pop_client_read_list(client, errmsg) ||
+		!check_pop_client_read_list(client, errmsg) || client_read_line(client) <= 0 || client_status(client) != 1 ||
+		st_cmp_cs_starts(&(client->line), NULLER("+OK"))) {
+
+		if (st_empty(errmsg)) st_sprint(errmsg, "Failed to return a successful state after pipelining UIDL, LIST and NOOP.");
+		client_close(client);
+		return false;
+	}
 	// Test the TOP command.
 	else if (client_print(client, "TOP %lu 0\r\n", message_num) != (uint16_digits(message_num) + 8) ||
 		client_status(client) != 1 || client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("+OK"))||
@@ -300,3 +309,155 @@ bool_t check_pop_network_stls_sthread(stringer_t *errmsg, uint32_t tcp_port, uin
 	client_close(client);
 	return true;
 }
+
+/**
+ * @brief	Reads a dot-stuffed POP response until the line with a single period, undoing the stuffing as it goes.
+ *
+ * @param	client	The client_t pointer to read from, positioned after the +OK line of a RETR or TOP response.
+ * @param	length	A uint64_t pointer which will be set to the length of the response once the stuffed periods are removed.
+ * @param	stuffed	A uint64_t pointer which will be set to the number of lines that were stuffed with an extra period.
+ * @return	true if the end of the response was found and every line beginning with a period was stuffed, false otherwise.
+ */
+bool_t check_pop_client_read_stuffed(client_t *client, uint64_t *length, uint64_t *stuffed) {
+
+	*length = *stuffed = 0;
+
+	while (client_read_line(client) > 0) {
+
+		if (!st_cmp_cs_eq(&(client->line), NULLER(".\r\n"))) {
+			return true;
+		}
+		// Any other line which begins with a period must have been stuffed with a second one.
+		else if (pl_starts_with_char(client->line, '.')) {
+
+			if (pl_length_get(client->line) < 2 || *(pl_char_get(client->line) + 1) != '.') {
+				return false;
+			}
+
+			*length += pl_length_get(client->line) - 1;
+			(*stuffed)++;
+		}
+		else {
+			*length += pl_length_get(client->line);
+		}
+	}
+
+	return false;
+}
+
+bool_t check_pop_network_stuffing_sthread(stringer_t *errmsg, uint32_t port, bool_t secure) {
+
+	bool_t result = true;
+	client_t *client = NULL;
+	smtp_inbound_prefs_t prefs;
+	placer_t fragment = pl_null();
+	stringer_t *data = NULL;
+	uint64_t message_num = 0, expected = 0, length = 0, stuffed = 0, total = 0;
+
+	mm_wipe(&prefs, sizeof(smtp_inbound_prefs_t));
+
+	prefs.usernum = 2;
+	prefs.foldernum = 2;
+
+	// The body starts with a period, and has a few lines that would be mistaken for the end of the response if they weren't stuffed.
+	if (!(data = st_append_opts(32768, NULL, NULLER("From: <magma@lavabit.com>\r\nTo: <princess@lavabit.com>\r\nSubject: POP Stuffing\r\n\r\n"
+		".leading\r\n..double\r\n.\r\n")))) {
+		st_sprint(errmsg, "Failed to allocate the message data.");
+		return false;
+	}
+
+	expected = 3;
+
+	// The output is staged through an 8 KiB buffer, and each block of single period lines is bigger than the buffer. The line
+	// between the blocks shifts the following block by a byte, so one of them will split a stuffed line across the flush.
+	for (int_t block = 0; result && block < 4; block++) {
+
+		if (block && !(data = st_append(data, NULLER(".x\r\n")))) {
+			result = false;
+		}
+		else if (block) {
+			expected++;
+		}
+
+		for (int_t i = 0; result && i < 2100; i++) {
+			if (!(data = st_append(data, NULLER(".\r\n")))) {
+				result = false;
+			}
+			expected++;
+		}
+	}
+
+	if (!result || !(data = st_append(data, NULLER("The end.\r\n")))) {
+		st_sprint(errmsg, "Failed to build the message data.");
+		st_cleanup(data);
+		return false;
+	}
+	else if (smtp_store_message(&prefs, &data) != 1) {
+		st_sprint(errmsg, "Failed to store the dot stuffing message.");
+		st_free(data);
+		return false;
+	}
+
+	// Connect the client and find the stored message, which is the last one in the mailbox.
+	if (!(client = client_connect("localhost", port)) || (secure && (client_secure(client) == -1)) ||
+		!net_set_timeout(client->sockd, 20, 20) || client_read_line(client) <= 0 || client_status(client) != 1 ||
+		st_cmp_cs_starts(&(client->line), NULLER("+OK"))) {
+
+		st_sprint(errmsg, "Failed to connect with the POP server.");
+		result = false;
+	}
+	else if (!check_pop_client_auth(client, "princess", "password", errmsg)) {
+		result = false;
+	}
+	else if (client_write(client, PLACER("LIST\r\n", 6)) != 6 || !(message_num = check_pop_client_read_list(client, errmsg)) ||
+		client_status(client) != 1) {
+
+		if (st_empty(errmsg)) st_sprint(errmsg, "Failed to return a successful state after LIST.");
+		result = false;
+	}
+	// Retrieve the entire message, and make sure the unstuffed response matches the size of the message.
+	else if (client_print(client, "RETR %lu\r\n", message_num) != (uint64_digits(message_num) + 7) || client_read_line(client) <= 0 ||
+		client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("+OK")) ||
+		tok_get_st(&(client->line), ' ', 1, &fragment) < 0 || !uint64_conv_pl(fragment, &total) ||
+		!check_pop_client_read_stuffed(client, &length, &stuffed)) {
+
+		st_sprint(errmsg, "Failed to return a properly dot stuffed message after RETR.");
+		result = false;
+	}
+	else if (length != total || stuffed != expected) {
+		st_sprint(errmsg, "The message returned by RETR was stuffed incorrectly. { length = %lu / expected = %lu / stuffed = %lu / expected = %lu }",
+			length, total, stuffed, expected);
+		result = false;
+	}
+	// Retrieve the header and the first three lines of the body, each of which should be stuffed.
+	else if (client_print(client, "TOP %lu 3\r\n", message_num) != (uint64_digits(message_num) + 8) || client_read_line(client) <= 0 ||
+		client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("+OK")) ||
+		tok_get_st(&(client->line), ' ', 1, &fragment) < 0 || !uint64_conv_pl(fragment, &total) ||
+		!check_pop_client_read_stuffed(client, &length, &stuffed)) {
+
+		st_sprint(errmsg, "Failed to return a properly dot stuffed message after TOP.");
+		result = false;
+	}
+	else if (length != total || stuffed != 3) {
+		st_sprint(errmsg, "The message returned by TOP was stuffed incorrectly. { length = %lu / expected = %lu / stuffed = %lu / expected = 3 }",
+			length, total, stuffed);
+		result = false;
+	}
+	else if (client_write(client, PLACER("QUIT\r\n", 6)) != 6 || client_read_line(client) <= 0 || client_status(client) != 1 ||
+		st_cmp_cs_starts(&(client->line), NULLER("+OK"))) {
+
+		st_sprint(errmsg, "Failed to receieve a successful status response after sending the QUIT command.");
+		result = false;
+	}
+
+	client_close(client);
+
+	if (!mail_remove_message(prefs.usernum, prefs.messagenum, st_length_get(data), NULL) && result) {
+		st_sprint(errmsg, "Failed to remove the dot stuffing message.");
+		result = false;
+	}
+
+	st_free(data);
+
+	return result;
+}
@@ -116,3 +116,142 @@ bool_t check_smtp_accept_message_sthread(stringer_t *errmsg) {
 
 
 
+
+bool_t check_smtp_accept_prefs_sthread(stringer_t *errmsg) {
+
+	uint64_t total = 0, local = 0;
+	smtp_inbound_prefs_t prefs, *cached;
+	stringer_t *address = PLACER("prefs-cache@example.com", 23), *subnet = PLACER("198.51.100.0", 12);
+
+	if (!magma.smtp.prefs.cache) {
+		return true;
+	}
+
+	mm_wipe(&prefs, sizeof(smtp_inbound_prefs_t));
+
+	prefs.usernum = 1;
+	prefs.inbox = 1;
+	prefs.quota = 4096;
+	prefs.stor_size = 1024;
+	prefs.address = address;
+
+	smtp_prefs_set(address, &prefs, serial_get(OBJECT_USER, 1));
+
+	if (!(cached = smtp_prefs_get(address)) || cached->usernum != 1 || cached->stor_size != 1024 || cached->address) {
+		st_sprint(errmsg, "The inbound preferences cache didn't return a copy of the stored preferences.");
+		smtp_free_inbound(cached);
+		return false;
+	}
+
+	smtp_free_inbound(cached);
+
+	// Storing a message which fills the quota should stop the cached copy from being used.
+	smtp_prefs_account(&prefs, 3072);
+
+	if ((cached = smtp_prefs_get(address))) {
+		st_sprint(errmsg, "The inbound preferences cache returned a copy for an account which reached its quota.");
+		smtp_free_inbound(cached);
+		return false;
+	}
+
+	// And a change to the user serial should invalidate the cached copy.
+	smtp_prefs_set(address, &prefs, serial_get(OBJECT_USER, 1) - 1);
+
+	if ((cached = smtp_prefs_get(address))) {
+		st_sprint(errmsg, "The inbound preferences cache returned a copy loaded under an older user serial.");
+		smtp_free_inbound(cached);
+		return false;
+	}
+
+	// The receive counts should be incremented locally once they've been read from the database.
+	smtp_receiving_set(1, subnet, 10, 2);
+	smtp_receiving_increment(1, subnet);
+
+	if (!smtp_receiving_get(1, subnet, &total, &local) || total != 11 || local != 3) {
+		st_sprint(errmsg, "The cached receive counts weren't incremented. { total = %lu / local = %lu }", total, local);
+		return false;
+	}
+
+	return true;
+}
+
+bool_t check_smtp_accept_rollout_sthread(stringer_t *errmsg) {
+
+	bool_t outcome = true;
+	stringer_t *data = NULL;
+	smtp_inbound_prefs_t prefs;
+	uint64_t messagenums[4], before = 0, after = 0, size = 0, quota = 0, original = 0, removed, remaining = 0;
+
+	mm_wipe(&messagenums, sizeof(messagenums));
+	mm_wipe(&prefs, sizeof(smtp_inbound_prefs_t));
+
+	// The stacie account doesn't receive messages from any other test, so its oldest messages are the ones stored here.
+	prefs.usernum = 4;
+	prefs.foldernum = 4;
+
+	if (!smtp_fetch_rollout_quota(4, &before, &original)) {
+		st_sprint(errmsg, "Failed to fetch the storage usage before the rollout test.");
+		return false;
+	}
+
+	// Store identical messages, so every message accounts for the same amount of storage.
+	for (uint32_t i = 0; outcome && i < 4; i++) {
+
+		if (!(data = check_message_get(0))) {
+			st_sprint(errmsg, "Failed to get the message data.");
+			outcome = false;
+		}
+		else if (smtp_store_message(&prefs, &data) != 1) {
+			st_sprint(errmsg, "Failed to store a rollout message.");
+			outcome = false;
+		}
+		else {
+			messagenums[i] = prefs.messagenum;
+		}
+
+		st_cleanup(data);
+		data = NULL;
+	}
+
+	if (outcome && (!smtp_fetch_rollout_quota(4, &after, &quota) || after <= before)) {
+		st_sprint(errmsg, "The rollout messages weren't added to the storage usage.");
+		outcome = false;
+	}
+
+	size = (after - before) / 4;
+	removed = stats_get_value_by_name("smtp.rollout.removed");
+
+	// An account under its quota shouldn't lose any messages.
+	if (outcome && (sql_query(st_quick(MANAGEDBUF(128), "UPDATE Users SET quota = %lu WHERE usernum = 4;", after + 1)) != 0 ||
+		smtp_rollout_account(4) != 1 || stats_get_value_by_name("smtp.rollout.removed") != removed)) {
+		st_sprint(errmsg, "The rollout removed messages from an account under its quota.");
+		outcome = false;
+	}
+
+	// And an account one byte over its quota should only lose its oldest message.
+	else if (outcome && (sql_query(st_quick(MANAGEDBUF(128), "UPDATE Users SET quota = %lu WHERE usernum = 4;", after - size + 1)) != 0 ||
+		smtp_rollout_account(4) != 1 || stats_get_value_by_name("smtp.rollout.removed") != removed + 1 ||
+		!smtp_fetch_rollout_quota(4, &after, &quota) || after >= quota || after + size < quota)) {
+		st_sprint(errmsg, "The rollout didn't remove exactly enough messages to get back under the quota. { size = %lu / quota = %lu }",
+			after, quota);
+		outcome = false;
+	}
+
+	sql_query(st_quick(MANAGEDBUF(128), "UPDATE Users SET quota = %lu WHERE usernum = 4;", original));
+
+	// The oldest message is the one which should have been rolled out, so it's the only one which can't be removed here.
+	if (messagenums[0] && mail_remove_message(4, messagenums[0], size, NULL)) {
+		remaining = 4;
+	}
+
+	for (uint32_t i = 1; i < 4; i++) {
+		if (messagenums[i] && mail_remove_message(4, messagenums[i], size, NULL)) remaining++;
+	}
+
+	if (outcome && remaining != 3) {
+		st_sprint(errmsg, "The rollout removed the wrong messages. { remaining = %lu }", remaining);
+		outcome = false;
+	}
+
+	return outcome;
+}
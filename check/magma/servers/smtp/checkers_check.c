@@ -80,6 +80,35 @@ bool_t check_smtp_checkers_greylist_sthread(stringer_t *errmsg) {
 	return true;
 }
 
+bool_t check_smtp_checkers_greylist_cache_sthread(stringer_t *errmsg) {
+
+	uint64_t now = time(NULL), stamp = 0, updated = 0, passed = rand_get_uint64(), waiting = passed + 1, stale = passed + 2;
+
+	if (!magma.smtp.greylist.cache) {
+		return true;
+	}
+
+	// A sender who waited long enough, a sender who is still waiting, and a waiting sender who hasn't been synced recently.
+	smtp_greylist_store(passed, now, now - 600, now);
+	smtp_greylist_store(waiting, now, now, now);
+	smtp_greylist_store(stale, now - MAGMA_GREYLIST_RESYNC, now - MAGMA_GREYLIST_RESYNC, now - MAGMA_GREYLIST_RESYNC);
+
+	if (smtp_greylist_lookup(passed, now, &stamp, &updated, 1) != 1 || stamp != now - 600 || updated != now) {
+		st_sprint(errmsg, "The in memory greylist didn't return the entry for a sender who waited long enough.");
+		return false;
+	}
+	else if (smtp_greylist_lookup(waiting, now, &stamp, &updated, 1) != 1 || stamp != now) {
+		st_sprint(errmsg, "The in memory greylist didn't return the entry for a sender who is still waiting.");
+		return false;
+	}
+	else if (smtp_greylist_lookup(stale, now, &stamp, &updated, 1) != 0) {
+		st_sprint(errmsg, "The in memory greylist trusted a waiting sender without checking memcached again.");
+		return false;
+	}
+
+	return true;
+}
+
 bool_t check_smtp_checkers_regex_sthread(stringer_t *errmsg) {
 
 	int_t result = 0;
@@ -284,6 +313,7 @@ bool_t check_smtp_checkers_filters_sthread(stringer_t *errmsg, int_t action, int
 
 bool_t check_smtp_checkers_rbl_sthread(stringer_t *errmsg) {
 
+	uint64_t cached;
 	connection_t con;
 
 	// Create a connection struct with a blacklisted IP.
@@ -317,7 +347,154 @@ bool_t check_smtp_checkers_rbl_sthread(stringer_t *errmsg) {
 		mm_free(con.network.reverse.ip);
 		return false;
 	}
+	// Switch back to the blacklisted IP, which should now be cached.
+	else if (!ip_addr_st("127.0.0.2", con.network.reverse.ip)) {
+		st_sprint(errmsg, "Failed to reset the blacklisted ip.");
+		mm_free(con.network.reverse.ip);
+		return false;
+	}
+
+	cached = stats_get_value_by_name("smtp.rbl.cached");
+
+	// Expect the repeated check to return -2, without issuing any DNS queries.
+	if (smtp_check_rbl(&con) != -2 || stats_get_value_by_name("smtp.rbl.cached") != cached + 1) {
+		st_sprint(errmsg, "Failed to answer a repeated blacklist check using the cache.");
+		mm_free(con.network.reverse.ip);
+		return false;
+	}
+
+	// Entries with a zero time to live shouldn't be cached.
+	smtp_rbl_cache_set(NULLER("check.rbl.example"), -2, 0);
+
+	if (smtp_rbl_cache_get(NULLER("check.rbl.example")) != 0) {
+		st_sprint(errmsg, "The blacklist cache stored an entry that should have been discarded.");
+		mm_free(con.network.reverse.ip);
+		return false;
+	}
 
 	mm_free(con.network.reverse.ip);
 	return true;
 }
+
+bool_t check_smtp_checkers_content_sthread(stringer_t *errmsg) {
+
+	connection_t con;
+	smtp_message_t message;
+	smtp_inbound_prefs_t prefs;
+
+	mm_wipe(&con, sizeof(connection_t));
+	mm_wipe(&prefs, sizeof(smtp_inbound_prefs_t));
+	mm_wipe(&message, sizeof(smtp_message_t));
+
+	// Setup a recipient who wants both the virus scan and the DKIM verification.
+	prefs.virus = 1;
+	prefs.dkim = 1;
+	message.id = NULLER("content.check@lavabit.com");
+	message.text = NULLER("From: content.check@lavabit.com\r\nTo: magma@lavabit.com\r\nSubject: Content Check\r\n\r\n"
+		"This message checks that content checks are run concurrently.\r\n");
+
+	con.smtp.message = &message;
+	con.smtp.in_prefs = &prefs;
+
+	smtp_content_check(&con);
+
+	// When the helper threads are disabled, the checks are left for smtp_accept_message() to run.
+	if (!magma.smtp.content.threads) {
+		if (con.smtp.checked.virus || con.smtp.checked.dkim) {
+			st_sprint(errmsg, "The content checks were run even though the helper threads are disabled.");
+			return false;
+		}
+		return true;
+	}
+
+	// Every verdict, including an error or a timeout, is non-zero, and a clean message can't be decisive.
+	if (!con.smtp.checked.virus || !con.smtp.checked.dkim) {
+		st_sprint(errmsg, "The concurrent content checks didn't record a verdict. { virus = %i / dkim = %i }", con.smtp.checked.virus,
+			con.smtp.checked.dkim);
+		return false;
+	}
+	else if (!smtp_content_decisive(&con, -2) || smtp_content_decisive(&con, -3) || smtp_content_decisive(&con, 1)) {
+		st_sprint(errmsg, "The content checks didn't correctly identify a decisive verdict.");
+		return false;
+	}
+
+	// The verdicts should be reused, rather than computed again.
+	con.smtp.checked.virus = 1;
+	con.smtp.checked.dkim = 1;
+	smtp_content_check(&con);
+
+	if (con.smtp.checked.virus != 1 || con.smtp.checked.dkim != 1) {
+		st_sprint(errmsg, "The content checks replaced an existing verdict.");
+		return false;
+	}
+
+	return true;
+}
+
+bool_t check_smtp_checkers_verdict_sthread(stringer_t *errmsg) {
+
+	uint64_t generation = virus_engine_generation();
+	stringer_t *first = MANAGEDBUF(128), *second = MANAGEDBUF(128),
+		*original = NULLER("Received: from a.example.com\r\nTo: one@lavabit.com\r\nContent-Type: text/plain\r\n\r\nThe same body.\r\n"),
+		*copy = NULLER("Received: from b.example.com\r\nReceived: from c.example.com\r\nTo: two@lavabit.com\r\nContent-Type: text/plain\r\n\r\nThe same body.\r\n"),
+		*encoded = NULLER("Received: from a.example.com\r\nTo: one@lavabit.com\r\nContent-Type: text/html\r\n\r\nThe same body.\r\n"),
+		*signed_original = NULLER("Received: from a.example.com\r\nSubject: One\r\nDKIM-Signature: v=1; a=rsa-sha256; d=lavabit.com; h=From :\r\n\tSubject; b=abc\r\n"
+			"From: one@lavabit.com\r\n\r\nThe same body.\r\n"),
+		*signed_copy = NULLER("Received: from b.example.com\r\nSubject: One\r\nDKIM-Signature: v=1; a=rsa-sha256; d=lavabit.com; h=From :\r\n\tSubject; b=abc\r\n"
+			"From: one@lavabit.com\r\n\r\nThe same body.\r\n"),
+		*signed_forged = NULLER("Received: from a.example.com\r\nSubject: One\r\nDKIM-Signature: v=1; a=rsa-sha256; d=lavabit.com; h=From :\r\n\tSubject; b=abc\r\n"
+			"From: two@lavabit.com\r\n\r\nThe same body.\r\n"),
+		*signed_above = NULLER("Received: from a.example.com\r\nSubject: Two\r\nDKIM-Signature: v=1; a=rsa-sha256; d=lavabit.com; h=From :\r\n\tSubject; b=abc\r\n"
+			"From: one@lavabit.com\r\n\r\nThe same body.\r\n");
+
+	// Copies of a message which only differ in their trace and addressing headers should share a virus verdict.
+	if (!smtp_verdict_key(SMTP_CONTENT_VIRUS, original, first) || !smtp_verdict_key(SMTP_CONTENT_VIRUS, copy, second) ||
+		st_cmp_cs_eq(first, second)) {
+		st_sprint(errmsg, "Copies of the same message body generated different virus verdict keys.");
+		return false;
+	}
+	else if (!smtp_verdict_key(SMTP_CONTENT_VIRUS, encoded, second) || !st_cmp_cs_eq(first, second)) {
+		st_sprint(errmsg, "Message bodies with different content types generated the same virus verdict key.");
+		return false;
+	}
+
+	// Unsigned messages aren't cached, and a change to a header covered by the signature must change the key.
+	else if (smtp_verdict_key(SMTP_CONTENT_DKIM, original, first)) {
+		st_sprint(errmsg, "An unsigned message generated a DKIM verdict key.");
+		return false;
+	}
+	else if (!smtp_verdict_key(SMTP_CONTENT_DKIM, signed_original, first) || !smtp_verdict_key(SMTP_CONTENT_DKIM, signed_copy, second) ||
+		st_cmp_cs_eq(first, second)) {
+		st_sprint(errmsg, "Copies of the same signed message generated different DKIM verdict keys.");
+		return false;
+	}
+	else if (!smtp_verdict_key(SMTP_CONTENT_DKIM, signed_forged, second) || !st_cmp_cs_eq(first, second)) {
+		st_sprint(errmsg, "A signed message with a modified header generated the same DKIM verdict key.");
+		return false;
+	}
+	else if (!smtp_verdict_key(SMTP_CONTENT_DKIM, signed_above, second) || !st_cmp_cs_eq(first, second)) {
+		st_sprint(errmsg, "A signed message with a modified header above the signature generated the same DKIM verdict key.");
+		return false;
+	}
+
+	// When the cache is enabled, a verdict should only be returned for the generation of signatures used to reach it.
+	if (!magma.smtp.content.cache || !smtp_verdict_key(SMTP_CONTENT_VIRUS, original, first)) {
+		return true;
+	}
+
+	smtp_verdict_set(first, -2, generation);
+
+	if (smtp_verdict_get(first, generation) != -2) {
+		st_sprint(errmsg, "The cached virus verdict wasn't returned.");
+		return false;
+	}
+	else if (smtp_verdict_get(first, generation + 1)) {
+		st_sprint(errmsg, "A virus verdict reached with outdated signatures was returned.");
+		return false;
+	}
+
+	// Replace the entry so it can't affect other tests.
+	smtp_verdict_set(first, 1, 0);
+
+	return true;
+}
@@ -0,0 +1,83 @@
+
+/**
+ * @file /check/magma/smtp/relay_check.c
+ *
+ * @brief SMTP relay connection pool test functions.
+ */
+
+#include "magma_check.h"
+
+bool_t check_smtp_relay_pool_sthread(stringer_t *errmsg) {
+
+	uint32_t sent = 0, count = 16;
+	uint64_t start, elapsed, connections = stats_get_value_by_name("smtp.relay.connections"), reused = stats_get_value_by_name("smtp.relay.reused");
+	stringer_t *to = NULLER("magma@lavabit.com"), *from = NULLER("relay.check@lavabit.com"),
+		*message = NULLER("From: relay.check@lavabit.com\r\nTo: magma@lavabit.com\r\nSubject: Relay Pool Check\r\n\r\n"
+			"This message checks that relay connections are reused.\r\n.Lines which start with a dot must be stuffed.\r\n");
+
+	start = time_monotonic_ms();
+
+	// Relay the messages one after another, so each message after the first should be able to reuse the connection.
+	for (uint32_t i = 0; status() && i < count; i++) {
+		if (smtp_send_message(to, from, message) != 1) {
+			st_sprint(errmsg, "Failed to relay a message through the connection pool. { message = %u }", i);
+			return false;
+		}
+		sent++;
+	}
+
+	elapsed = time_monotonic_ms() - start;
+
+	if (!sent) {
+		return true;
+	}
+	else if (magma.relay.pool && stats_get_value_by_name("smtp.relay.connections") - connections >= sent) {
+		st_sprint(errmsg, "The relay pool opened a new connection for every message. { messages = %u / connections = %lu }", sent,
+			stats_get_value_by_name("smtp.relay.connections") - connections);
+		return false;
+	}
+	else if (magma.relay.pool && stats_get_value_by_name("smtp.relay.reused") == reused) {
+		st_sprint(errmsg, "The relay pool never reused an idle connection.");
+		return false;
+	}
+
+	log_unit("Relayed %u messages in %lu milliseconds. { rate = %.1f messages per second }", sent, elapsed,
+		elapsed ? (sent * 1000.0) / elapsed : (double)sent);
+
+	return true;
+}
+
+bool_t check_smtp_relay_queue_sthread(stringer_t *errmsg) {
+
+	uint64_t delivered, queued, start;
+	smtp_recipients_t recipient = { .address = NULLER("magma@lavabit.com"), .next = NULL };
+	stringer_t *from = NULLER("queue.check@lavabit.com"), *message = NULLER("From: queue.check@lavabit.com\r\nTo: magma@lavabit.com\r\n"
+		"Subject: Relay Queue Check\r\n\r\nThis message checks that queued messages are delivered in the background.\r\n");
+
+	// Without a queue directory, messages are relayed synchronously.
+	if (!magma.relay.queue.path) {
+		return true;
+	}
+
+	delivered = stats_get_value_by_name("smtp.queue.delivered");
+	queued = stats_get_value_by_name("smtp.queue.queued");
+
+	if (smtp_queue_message(0, from, 0, &recipient, message, false) != 1 || stats_get_value_by_name("smtp.queue.queued") != queued + 1) {
+		st_sprint(errmsg, "Failed to store a message in the outbound queue.");
+		return false;
+	}
+
+	// Give the delivery threads until the relay timeout to hand the message off.
+	start = time_monotonic_ms();
+
+	while (status() && stats_get_value_by_name("smtp.queue.delivered") == delivered && time_monotonic_ms() - start < (magma.relay.timeout ? magma.relay.timeout : 60) * 1000) {
+		usleep(10000);
+	}
+
+	if (status() && stats_get_value_by_name("smtp.queue.delivered") == delivered) {
+		st_sprint(errmsg, "The queued message wasn't delivered in the background.");
+		return false;
+	}
+
+	return true;
+}
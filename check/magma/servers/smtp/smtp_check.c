@@ -54,6 +54,8 @@ START_TEST (check_smtp_accept_store_message_s) {
 	stringer_t *errmsg = MANAGEDBUF(2048);
 
 	if (status()) outcome = check_smtp_accept_message_sthread(errmsg);
+	if (status() && outcome) outcome = check_smtp_accept_prefs_sthread(errmsg);
+	if (status() && outcome) outcome = check_smtp_accept_rollout_sthread(errmsg);
 
 	log_test("SMTP / ACCEPT / SINGLE THREADED:", errmsg);
 	ck_assert_msg(outcome, st_char_get(errmsg));
@@ -67,12 +69,39 @@ START_TEST (check_smtp_checkers_greylist_s) {
 	stringer_t *errmsg = MANAGEDBUF(1024);
 
 	if (status()) outcome = check_smtp_checkers_greylist_sthread(errmsg);
+	if (status() && outcome) outcome = check_smtp_checkers_greylist_cache_sthread(errmsg);
 
 	log_test("SMTP / CHECKERS / GREYLIST / SINGLE THREADED:", errmsg);
 	ck_assert_msg(outcome, st_char_get(errmsg));
 
 } END_TEST
 
+START_TEST (check_smtp_checkers_content_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) outcome = check_smtp_checkers_content_sthread(errmsg);
+
+	log_test("SMTP / CHECKERS / CONTENT / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+
+} END_TEST
+
+START_TEST (check_smtp_checkers_verdict_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) outcome = check_smtp_checkers_verdict_sthread(errmsg);
+
+	log_test("SMTP / CHECKERS / VERDICT / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+
+} END_TEST
+
 START_TEST (check_smtp_checkers_filters_s) {
 
 	log_disable();
@@ -289,6 +318,26 @@ START_TEST (check_smtp_network_outbound_quota_s) {
 
 } END_TEST
 
+START_TEST (check_smtp_network_bdat_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	server_t *server = NULL;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (!(server = servers_get_by_protocol(SMTP, false))) {
+		st_sprint(errmsg, "No SMTP servers were configured to support TCP connections.");
+		outcome = false;
+	}
+	else if (status() && !check_smtp_network_bdat_sthread(errmsg, server->network.port, false)) {
+		outcome = false;
+	}
+
+	log_test("SMTP / NETWORK / BDAT / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+
+} END_TEST
+
 START_TEST (check_smtp_network_starttls_s) {
 
 	log_disable();
@@ -309,6 +358,32 @@ START_TEST (check_smtp_network_starttls_s) {
 
 } END_TEST
 
+START_TEST (check_smtp_relay_pool_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) outcome = check_smtp_relay_pool_sthread(errmsg);
+
+	log_test("SMTP / RELAY / POOL / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+
+} END_TEST
+
+START_TEST (check_smtp_relay_queue_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) outcome = check_smtp_relay_queue_sthread(errmsg);
+
+	log_test("SMTP / RELAY / QUEUE / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+
+} END_TEST
+
 Suite * suite_check_smtp(void) {
 
 	Suite *s = suite_create("\tSMTP");
@@ -318,9 +393,15 @@ Suite * suite_check_smtp(void) {
 	suite_check_testcase(s, "SMTP", "SMTP Checkers RBL", check_smtp_checkers_rbl_s);
 	suite_check_testcase(s, "SMTP", "SMTP Checkers Filters/S", check_smtp_checkers_filters_s);
 	suite_check_testcase(s, "SMTP", "SMTP Checkers Greylist/S", check_smtp_checkers_greylist_s);
+	suite_check_testcase(s, "SMTP", "SMTP Checkers Content/S", check_smtp_checkers_content_s);
+	suite_check_testcase(s, "SMTP", "SMTP Checkers Verdict/S", check_smtp_checkers_verdict_s);
+
+	suite_check_testcase(s, "SMTP", "SMTP Relay Pool/S", check_smtp_relay_pool_s);
+	suite_check_testcase(s, "SMTP", "SMTP Relay Queue/S", check_smtp_relay_queue_s);
 
 	suite_check_testcase(s, "SMTP", "SMTP Network Basic/ TCP/S", check_smtp_network_basic_tcp_s);
 	suite_check_testcase(s, "SMTP", "SMTP Network Basic/ TLS/S", check_smtp_network_basic_tls_s);
+	suite_check_testcase(s, "SMTP", "SMTP Network BDAT/S", check_smtp_network_bdat_s);
 	suite_check_testcase(s, "SMTP", "SMTP Network STARTTLS/S", check_smtp_network_starttls_s);
 
 	suite_check_testcase(s, "SMTP", "SMTP Network Auth Plain/S", check_smtp_network_auth_plain_s);
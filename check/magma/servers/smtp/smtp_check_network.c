@@ -133,7 +133,10 @@ bool_t check_smtp_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_
     size_t location = 0;
     client_t *client = NULL;
     chr_t *message = "To: magma@lavabit.com\r\nFrom: princess@example.com\r\nSubject: Unit Tests\r\n\r\n"\
-        "Aren't unit tests great?\r\n.\r\n";
+        "Aren't unit tests great?\r\n.\r\n", *chunk_one = "To: magma@lavabit.com\r\nFrom: princess@example.com\r\nSubject: Unit Tests\r\n\r\n",
+        *chunk_two = "Chunked unit tests are even better.\r\n.Lines starting with a period aren't stuffed.\r\n",
+        *stuffed = "To: magma@lavabit.com\r\nFrom: princess@example.com\r\nSubject: Unit Tests\r\n\r\n..Lines starting with a period are stuffed.\n"\
+        "Bare line feeds are accepted too.\n.\r\nNOOP\r\n";
 
     // Test the connect banner.
     if (!(client = client_connect("localhost", port)) || (secure && (client_secure(client) == -1)) ||
@@ -199,6 +202,32 @@ bool_t check_smtp_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_
         client_close(client);
         return false;
     }
+
+    // Pipeline a second transaction, and send the message in two chunks using BDAT.
+    else if (client_print(client, "MAIL FROM: <>\r\nRCPT TO: <princess@example.com>\r\nBDAT %zu\r\n%sBDAT %zu LAST\r\n%s", ns_length_get(chunk_one),
+        chunk_one, ns_length_get(chunk_two), chunk_two) <= 0 || client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("250"))) {
+
+        st_sprint(errmsg, "Failed to get a successful status code after a pipelined BDAT submission.");
+        client_close(client);
+        return false;
+    }
+
+    // Pipeline a third transaction using DATA, with a stuffed line, bare line feeds, and a command queued up behind the terminator.
+    else if (client_print(client, "MAIL FROM: <>\r\nRCPT TO: <princess@example.com>\r\nDATA\r\n") <= 0 ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("354")) ||
+        client_write(client, PLACER(stuffed, ns_length_get(stuffed))) != ns_length_get(stuffed) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("250"))) {
+
+        st_sprint(errmsg, "Failed to get a successful status code after a pipelined DATA submission.");
+        client_close(client);
+        return false;
+    }
     // Submit QUIT and cleanup.
     else if (!check_smtp_client_quit(client, errmsg)) {
 
@@ -210,6 +239,77 @@ bool_t check_smtp_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_
     return true;
 }
 
+bool_t check_smtp_network_bdat_sthread(stringer_t *errmsg, uint32_t port, bool_t secure) {
+
+    client_t *client = NULL;
+    chr_t *message = "To: magma@lavabit.com\r\nFrom: princess@example.com\r\nSubject: Unit Tests\r\n\r\nChunks sent after a failure are accepted.\r\n";
+
+    // Connect and issue EHLO.
+    if (!(client = client_connect("localhost", port)) || (secure && (client_secure(client) == -1)) ||
+        !net_set_timeout(client->sockd, 20, 20) || client_read_line(client) <= 0 || client_status(client) != 1 ||
+        st_cmp_cs_starts(&(client->line), NULLER("220"))) {
+
+        st_sprint(errmsg, "Failed to connect with the SMTP server.");
+        client_close(client);
+        return false;
+    }
+    else if (client_write(client, PLACER("EHLO localhost\r\n", 16)) != 16 || !check_smtp_client_read_end(client) ||
+        client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("250"))) {
+
+        st_sprint(errmsg, "Failed to return successful status after EHLO.");
+        client_close(client);
+        return false;
+    }
+
+    // Chunks sent without a transaction should be consumed and rejected, rather than being interpreted as commands.
+    else if (client_print(client, "BDAT 6\r\nNOOP\r\nBDAT 6 LAST\r\nNOOP\r\n") != 33 ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("503")) ||
+        client_read_line(client) <= 0 || client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("503"))) {
+
+        st_sprint(errmsg, "Failed to reject BDAT chunks sent before MAIL and RCPT.");
+        client_close(client);
+        return false;
+    }
+
+    // An empty last chunk fails the transaction, so the chunk which follows it should be rejected until a new transaction starts.
+    else if (client_print(client, "MAIL FROM: <>\r\nRCPT TO: <princess@example.com>\r\nBDAT 0 LAST\r\nBDAT 6 LAST\r\nNOOP\r\n") != 80 ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("554")) ||
+        client_read_line(client) <= 0 || client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("503"))) {
+
+        st_sprint(errmsg, "Failed to reset the transaction after a rejected BDAT LAST.");
+        client_close(client);
+        return false;
+    }
+
+    // The session should still accept a new transaction.
+    else if (client_print(client, "MAIL FROM: <>\r\nRCPT TO: <princess@example.com>\r\nBDAT %zu LAST\r\n%s", ns_length_get(message), message) <= 0 ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || client_status(client) != 1 || st_cmp_cs_starts(&(client->line), NULLER("250"))) {
+
+        st_sprint(errmsg, "Failed to get a successful status code after a BDAT submission following a failed transaction.");
+        client_close(client);
+        return false;
+    }
+
+    // A chunk size which would wrap around when added to the data already received should be refused, and the connection closed.
+    else if (client_print(client, "MAIL FROM: <>\r\nRCPT TO: <princess@example.com>\r\nBDAT 6\r\nChunk.BDAT 18446744073709551614\r\n") <= 0 ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("250")) ||
+        client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), NULLER("552"))) {
+
+        st_sprint(errmsg, "Failed to refuse an oversized BDAT chunk sent after a valid chunk.");
+        client_close(client);
+        return false;
+    }
+
+    client_close(client);
+    return true;
+}
+
 bool_t check_smtp_network_auth_sthread(stringer_t *errmsg, uint32_t port, bool_t login) {
 
     size_t location = 0;
@@ -62,6 +62,11 @@ int (*dkim_test_dns_put_d)(DKIM *dkim, int class, int type, int prec, u_char *na
 DKIM * (*dkim_verify_d)(DKIM_LIB *libhandle, const unsigned char *id, void *memclosure, DKIM_STAT *statp) = NULL;
 DKIM_LIB * (*dkim_init_d)(void *(*mallocf)(void *closure, size_t nbytes), void (*freef)(void *closure, void *p)) = NULL;
 DKIM * (*dkim_sign_d)(DKIM_LIB *libhandle, const unsigned char *id, void *memclosure, const dkim_sigkey_t secretkey, const unsigned char *selector, const unsigned char *domain, dkim_canon_t hdr_canon_alg, dkim_canon_t body_canon_alg, dkim_alg_t sign_alg,	off_t length, DKIM_STAT *statp) = NULL;
+void (*dkim_dns_set_close_d)(DKIM_LIB *lib, void (*func)(void *srv)) = NULL;
+void (*dkim_dns_set_init_d)(DKIM_LIB *lib, int (*func)(void **srv)) = NULL;
+void (*dkim_dns_set_query_cancel_d)(DKIM_LIB *lib, int (*func)(void *srv, void *qh)) = NULL;
+void (*dkim_dns_set_query_start_d)(DKIM_LIB *lib, int (*func)(void *srv, int type, unsigned char *query, unsigned char *buf, size_t len, void **qh)) = NULL;
+void (*dkim_dns_set_query_waitreply_d)(DKIM_LIB *lib, int (*func)(void *srv, void *qh, struct timeval *timeout, size_t *bytes, int *error, int *dnssec)) = NULL;
 FT_Error (*FT_Done_FreeType_d)(FT_Library library) = NULL;
 FT_Error (*FT_Init_FreeType_d)(FT_Library *alibrary) = NULL;
 void (*FT_Library_Version_d)(FT_Library library, FT_Int *amajor, FT_Int *aminor, FT_Int *apatch) = NULL;
@@ -413,6 +418,10 @@ SPF_errcode_t	(*SPF_request_set_ipv6_d)(SPF_request_t *sr, struct in6_addr addr)
 SPF_dns_server_t * (*SPF_dns_zone_new_d)(SPF_dns_server_t *layer_below, const char *name, int debug) = NULL;
 SPF_errcode_t (*SPF_request_query_mailfrom_d)(SPF_request_t *spf_request, SPF_response_t **spf_responsep) = NULL;
 SPF_errcode_t (*SPF_dns_zone_add_str_d)(SPF_dns_server_t *spf_dns_server, const char *domain, ns_type rr_type, SPF_dns_stat_t herrno, const char *data) = NULL;
+void (*SPF_dns_free_d)(SPF_dns_server_t *spf_dns_server) = NULL;
+SPF_server_t * (*SPF_server_new_dns_d)(SPF_dns_server_t *dns, int debug) = NULL;
+SPF_dns_server_t * (*SPF_dns_resolv_new_d)(SPF_dns_server_t *layer_below, const char *name, int debug) = NULL;
+SPF_dns_server_t * (*SPF_dns_cache_new_d)(SPF_dns_server_t *layer_below, const char *name, int debug, int cache_bits) = NULL;
 char **tcversion_d = NULL;
 TCHDB * (*tchdbnew_d)(void) = NULL;
 void (*tcfree_d)(void *ptr) = NULL;
@@ -613,6 +622,11 @@ if ((*(void **)&(dkim_test_dns_put_d) = dlsym(magma, "dkim_test_dns_put")) == NU
 if ((*(void **)&(dkim_verify_d) = dlsym(magma, "dkim_verify")) == NULL) return "dkim_verify";
 if ((*(void **)&(dkim_init_d) = dlsym(magma, "dkim_init")) == NULL) return "dkim_init";
 if ((*(void **)&(dkim_sign_d) = dlsym(magma, "dkim_sign")) == NULL) return "dkim_sign";
+if ((*(void **)&(dkim_dns_set_close_d) = dlsym(magma, "dkim_dns_set_close")) == NULL) return "dkim_dns_set_close";
+if ((*(void **)&(dkim_dns_set_init_d) = dlsym(magma, "dkim_dns_set_init")) == NULL) return "dkim_dns_set_init";
+if ((*(void **)&(dkim_dns_set_query_cancel_d) = dlsym(magma, "dkim_dns_set_query_cancel")) == NULL) return "dkim_dns_set_query_cancel";
+if ((*(void **)&(dkim_dns_set_query_start_d) = dlsym(magma, "dkim_dns_set_query_start")) == NULL) return "dkim_dns_set_query_start";
+if ((*(void **)&(dkim_dns_set_query_waitreply_d) = dlsym(magma, "dkim_dns_set_query_waitreply")) == NULL) return "dkim_dns_set_query_waitreply";
 if ((*(void **)&(FT_Done_FreeType_d) = dlsym(magma, "FT_Done_FreeType")) == NULL) return "FT_Done_FreeType";
 if ((*(void **)&(FT_Init_FreeType_d) = dlsym(magma, "FT_Init_FreeType")) == NULL) return "FT_Init_FreeType";
 if ((*(void **)&(FT_Library_Version_d) = dlsym(magma, "FT_Library_Version")) == NULL) return "FT_Library_Version";
@@ -963,6 +977,10 @@ if ((*(void **)&(SPF_request_set_ipv6_d) = dlsym(magma, "SPF_request_set_ipv6"))
 if ((*(void **)&(SPF_dns_zone_new_d) = dlsym(magma, "SPF_dns_zone_new")) == NULL) return "SPF_dns_zone_new";
 if ((*(void **)&(SPF_request_query_mailfrom_d) = dlsym(magma, "SPF_request_query_mailfrom")) == NULL) return "SPF_request_query_mailfrom";
 if ((*(void **)&(SPF_dns_zone_add_str_d) = dlsym(magma, "SPF_dns_zone_add_str")) == NULL) return "SPF_dns_zone_add_str";
+if ((*(void **)&(SPF_dns_free_d) = dlsym(magma, "SPF_dns_free")) == NULL) return "SPF_dns_free";
+if ((*(void **)&(SPF_server_new_dns_d) = dlsym(magma, "SPF_server_new_dns")) == NULL) return "SPF_server_new_dns";
+if ((*(void **)&(SPF_dns_resolv_new_d) = dlsym(magma, "SPF_dns_resolv_new")) == NULL) return "SPF_dns_resolv_new";
+if ((*(void **)&(SPF_dns_cache_new_d) = dlsym(magma, "SPF_dns_cache_new")) == NULL) return "SPF_dns_cache_new";
 if ((*(void **)&(tchdbnew_d) = dlsym(magma, "tchdbnew")) == NULL) return "tchdbnew";
 if ((*(void **)&(tcfree_d) = dlsym(magma, "tcfree")) == NULL) return "tcfree";
 if ((*(void **)&(tchdbdel_d) = dlsym(magma, "tchdbdel")) == NULL) return "tchdbdel";
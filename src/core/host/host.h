@@ -82,6 +82,25 @@ typedef struct {
 	ip_t address;
 } subnet_t;
 
+/**
+ * @typedef subnet_node_t
+ */
+typedef struct subnet_node_t {
+	uchr_t key[16]; /* The prefix, in network byte order, with the bits past the prefix length cleared. */
+	uint32_t length; /* The number of bits in the prefix. */
+	bool_t terminal; /* Whether the prefix is a subnet that was added, rather than a branch point. */
+	void *value;
+	struct subnet_node_t *child[2];
+} subnet_node_t;
+
+/**
+ * @typedef subnet_trie_t
+ */
+typedef struct {
+	size_t count;
+	subnet_node_t *ipv4, *ipv6;
+} subnet_trie_t;
+
 // The spool_start function uses a for loop to validate the spool directory tree. If additional
 // spool locations are enumerated, make sure that function is updated.
 enum {
@@ -180,6 +199,18 @@ stringer_t *  spool_path(int_t spool);
 bool_t        spool_start(void);
 void          spool_stop(void);
 
+/// trie.c
+bool_t           subnet_trie_add(subnet_trie_t *trie, subnet_t *subnet, void *value);
+subnet_trie_t *  subnet_trie_alloc(void);
+uint_t           subnet_trie_bit(uchr_t *key, uint32_t bit);
+uint32_t         subnet_trie_common(uchr_t *a, uchr_t *b, uint32_t limit);
+void             subnet_trie_free(subnet_trie_t *trie);
+subnet_trie_t *  subnet_trie_get(subnet_trie_t **active);
+bool_t           subnet_trie_match(subnet_trie_t *trie, ip_t *address, void **value, uint32_t *length);
+subnet_node_t *  subnet_trie_node(uchr_t *key, uint32_t length);
+void             subnet_trie_node_free(subnet_node_t *node);
+subnet_trie_t *  subnet_trie_swap(subnet_trie_t **active, subnet_trie_t *replacement);
+
 /// ip.c
 bool_t        ip_addr_eq(ip_t *ip1, ip_t *ip2);
 ip_t *        ip_copy(ip_t *dst, ip_t *src);
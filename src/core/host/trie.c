@@ -0,0 +1,293 @@
+
+/**
+ * @file /magma/core/host/trie.c
+ *
+ * @brief	A path compressed binary radix trie used to find the longest subnet prefix matching an IPv4 or IPv6 address.
+ *
+ * Lookups visit at most one node per distinct prefix length along the path, so the cost is bounded by the width of the
+ * address (32 or 128 bits) no matter how many subnets are stored. A trie is never modified once it is published, so readers
+ * don't need a lock. A new trie is built on the side, published with subnet_trie_swap(), and the previous one freed once the
+ * readers which might still be using it are finished.
+ */
+
+#include "magma.h"
+
+/**
+ * @brief	Get the value of a single bit inside a network byte order address.
+ * @param	key		a pointer to the address bytes.
+ * @param	bit		the zero based bit position, counting from the most significant bit of the first byte.
+ * @return	the value of the bit, either 0 or 1.
+ */
+uint_t subnet_trie_bit(uchr_t *key, uint32_t bit) {
+	return (key[bit / 8] >> (7 - (bit % 8))) & 1;
+}
+
+/**
+ * @brief	Count the number of leading bits two addresses share.
+ * @param	a		a pointer to the first address.
+ * @param	b		a pointer to the second address.
+ * @param	limit	the maximum number of bits to compare.
+ * @return	the number of leading bits which are identical, up to the limit.
+ */
+uint32_t subnet_trie_common(uchr_t *a, uchr_t *b, uint32_t limit) {
+
+	uint32_t bits = 0;
+	uchr_t difference;
+
+	// Compare whole bytes first, then find the first differing bit.
+	while (bits + 8 <= limit && a[bits / 8] == b[bits / 8]) {
+		bits += 8;
+	}
+
+	if (bits < limit) {
+		difference = a[bits / 8] ^ b[bits / 8];
+		while (bits < limit && !(difference & (0x80 >> (bits % 8)))) {
+			bits++;
+		}
+	}
+
+	return bits;
+}
+
+/**
+ * @brief	Allocate a trie node holding a prefix, with the bits after the prefix cleared.
+ * @param	key		a pointer to the prefix address bytes.
+ * @param	length	the number of bits in the prefix.
+ * @return	NULL on failure, or a pointer to the new node.
+ */
+subnet_node_t * subnet_trie_node(uchr_t *key, uint32_t length) {
+
+	subnet_node_t *node;
+
+	if (!(node = mm_alloc(sizeof(subnet_node_t)))) {
+		return NULL;
+	}
+
+	node->length = length;
+	mm_copy(node->key, key, (length + 7) / 8);
+
+	if (length % 8) {
+		node->key[length / 8] &= (uchr_t)(0xFF << (8 - (length % 8)));
+	}
+
+	return node;
+}
+
+/**
+ * @brief	Free a trie node, and all of its children.
+ * @param	node	a pointer to the node being freed.
+ * @return	This function returns no value.
+ */
+void subnet_trie_node_free(subnet_node_t *node) {
+
+	if (node) {
+		subnet_trie_node_free(node->child[0]);
+		subnet_trie_node_free(node->child[1]);
+		mm_free(node);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Allocate an empty subnet trie.
+ * @return	NULL on failure, or a pointer to the new trie.
+ */
+subnet_trie_t * subnet_trie_alloc(void) {
+
+	subnet_trie_t *trie;
+
+	if (!(trie = mm_alloc(sizeof(subnet_trie_t)))) {
+		log_pedantic("Unable to allocate a subnet trie.");
+		return NULL;
+	}
+
+	return trie;
+}
+
+/**
+ * @brief	Free a subnet trie.
+ * @param	trie	a pointer to the trie being freed.
+ * @return	This function returns no value.
+ */
+void subnet_trie_free(subnet_trie_t *trie) {
+
+	if (trie) {
+		subnet_trie_node_free(trie->ipv4);
+		subnet_trie_node_free(trie->ipv6);
+		mm_free(trie);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Add a subnet to a trie.
+ * @note	Adding a subnet which is already present replaces its value. The trie must not be visible to readers yet.
+ * @param	trie	a pointer to the trie.
+ * @param	subnet	a pointer to the subnet being added.
+ * @param	value	an optional value returned by lookups which match the subnet.
+ * @return	true on success or false on failure.
+ */
+bool_t subnet_trie_add(subnet_trie_t *trie, subnet_t *subnet, void *value) {
+
+	uint32_t common, length;
+	uchr_t *key;
+	subnet_node_t **link, *node, *split, *leaf;
+
+	if (!trie || !subnet) {
+		return false;
+	}
+	else if (subnet->address.family == AF_INET && subnet->mask <= 32) {
+		link = &(trie->ipv4);
+		key = (uchr_t *)&(subnet->address.ip4);
+	}
+	else if (subnet->address.family == AF_INET6 && subnet->mask <= 128) {
+		link = &(trie->ipv6);
+		key = (uchr_t *)&(subnet->address.ip6);
+	}
+	else {
+		log_pedantic("Invalid subnet. { family = %i / mask = %u }", subnet->address.family, subnet->mask);
+		return false;
+	}
+
+	length = subnet->mask;
+
+	while ((node = *link)) {
+
+		common = subnet_trie_common(node->key, key, (node->length < length ? node->length : length));
+
+		// The new prefix diverges from this node, or ends above it, so the node is split at the point they differ.
+		if (common < node->length) {
+
+			if (!(split = subnet_trie_node(key, common))) {
+				return false;
+			}
+
+			split->child[subnet_trie_bit(node->key, common)] = node;
+
+			if (common == length) {
+				split->terminal = true;
+				split->value = value;
+			}
+			else if ((leaf = subnet_trie_node(key, length))) {
+				leaf->terminal = true;
+				leaf->value = value;
+				split->child[subnet_trie_bit(key, common)] = leaf;
+			}
+			else {
+				mm_free(split);
+				return false;
+			}
+
+			*link = split;
+			trie->count++;
+			return true;
+		}
+
+		// The node is the prefix being added.
+		else if (node->length == length) {
+			if (!node->terminal) {
+				trie->count++;
+			}
+			node->terminal = true;
+			node->value = value;
+			return true;
+		}
+
+		link = &(node->child[subnet_trie_bit(key, node->length)]);
+	}
+
+	if (!(leaf = subnet_trie_node(key, length))) {
+		return false;
+	}
+
+	leaf->terminal = true;
+	leaf->value = value;
+	*link = leaf;
+	trie->count++;
+
+	return true;
+}
+
+/**
+ * @brief	Find the longest subnet in a trie which contains an address.
+ * @note	IPv4 addresses mapped into the IPv6 address space are matched against the IPv4 subnets.
+ * @param	trie	a pointer to the trie.
+ * @param	address	a pointer to the address being looked up.
+ * @param	value	an optional pointer which will receive the value of the matching subnet.
+ * @param	length	an optional pointer which will receive the prefix length of the matching subnet.
+ * @return	true if a matching subnet was found, or false if there was no match.
+ */
+bool_t subnet_trie_match(subnet_trie_t *trie, ip_t *address, void **value, uint32_t *length) {
+
+	uint32_t bits;
+	uchr_t *key;
+	subnet_node_t *node, *best = NULL;
+
+	if (!trie || !address) {
+		return false;
+	}
+	else if (address->family == AF_INET) {
+		node = trie->ipv4;
+		key = (uchr_t *)&(address->ip4);
+		bits = 32;
+	}
+	else if (address->family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&(address->ip6))) {
+		node = trie->ipv4;
+		key = ((uchr_t *)&(address->ip6)) + 12;
+		bits = 32;
+	}
+	else if (address->family == AF_INET6) {
+		node = trie->ipv6;
+		key = (uchr_t *)&(address->ip6);
+		bits = 128;
+	}
+	else {
+		return false;
+	}
+
+	while (node && node->length <= bits && subnet_trie_common(node->key, key, node->length) == node->length) {
+
+		if (node->terminal) {
+			best = node;
+		}
+
+		if (node->length == bits) {
+			break;
+		}
+
+		node = node->child[subnet_trie_bit(key, node->length)];
+	}
+
+	if (best && value) {
+		*value = best->value;
+	}
+
+	if (best && length) {
+		*length = best->length;
+	}
+
+	return (best != NULL);
+}
+
+/**
+ * @brief	Get the currently published trie.
+ * @param	active	the address of the pointer used to publish the trie.
+ * @return	a pointer to the currently published trie, which may be NULL.
+ */
+subnet_trie_t * subnet_trie_get(subnet_trie_t **active) {
+	return __atomic_load_n(active, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief	Publish a replacement trie, without blocking the readers using the current trie.
+ * @note	The previous trie is returned rather than freed, because a reader may still be walking it. Callers should hold on
+ * 			to it until the next replacement, or otherwise wait for longer than any lookup could take, before freeing it.
+ * @param	active		the address of the pointer used to publish the trie.
+ * @param	replacement	a pointer to the fully populated replacement trie.
+ * @return	a pointer to the previously published trie, which may be NULL.
+ */
+subnet_trie_t * subnet_trie_swap(subnet_trie_t **active, subnet_trie_t *replacement) {
+	return __atomic_exchange_n(active, replacement, __ATOMIC_ACQ_REL);
+}
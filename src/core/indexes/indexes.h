@@ -89,6 +89,7 @@ bool_t     inx_insert(inx_t *inx, multi_t key, void *data);
 void       inx_lock_read(inx_t *inx);
 void       inx_lock_write(inx_t *inx);
 uint64_t   inx_options(inx_t *inx);
+uint64_t   inx_prune(inx_t *inx, bool_t (*check)(void *data, void *arg), void *arg);
 bool_t     inx_replace(inx_t *inx, multi_t key, void *data);
 uint64_t   inx_serial(inx_t *inx);
 void       inx_truncate(inx_t *inx);
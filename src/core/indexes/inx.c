@@ -233,6 +233,54 @@ bool_t inx_delete(inx_t *inx, multi_t key) {
 	return result;
 }
 
+/**
+ * @brief	Delete every child of an inx object that matches a caller supplied test.
+ * @note	The keys of the matching children are collected in a single pass before any of them are deleted, so the traversal
+ * 			never has to restart after a deletion. If the inx object uses manual locking, the caller must hold the write lock.
+ * @param	inx		a pointer to the inx object to be pruned.
+ * @param	check	a function that is passed each value along with the opaque argument, and returns true if the child should be deleted.
+ * @param	arg		an opaque argument passed through to the check function.
+ * @return	the number of children that were deleted.
+ */
+uint64_t inx_prune(inx_t *inx, bool_t (*check)(void *data, void *arg), void *arg) {
+
+	void *data;
+	multi_t *keys;
+	inx_cursor_t *cursor;
+	uint64_t count, matched = 0, result = 0;
+
+	if (!inx || !check || !(count = inx_count(inx))) {
+		return 0;
+	}
+	else if (!(keys = mm_alloc(sizeof(multi_t) * count))) {
+		log_pedantic("Unable to allocate %zu bytes for the keys being pruned.", sizeof(multi_t) * count);
+		return 0;
+	}
+	else if (!(cursor = inx_cursor_alloc(inx))) {
+		mm_free(keys);
+		return 0;
+	}
+
+	while (matched < count && (data = inx_cursor_value_next(cursor))) {
+		if (check(data, arg)) {
+			keys[matched++] = inx_cursor_key_active(cursor);
+		}
+	}
+
+	inx_cursor_free(cursor);
+
+	// Each key points into the child it identifies, so it stays valid until that child is deleted.
+	for (uint64_t i = 0; i < matched; i++) {
+		if (inx_delete(inx, keys[i])) {
+			result++;
+		}
+	}
+
+	mm_free(keys);
+
+	return result;
+}
+
 /**
  * @brief	Find the value associated with a particular key within the children of an inx object.
  * @param	inx		a pointer to the inx object to be searched.
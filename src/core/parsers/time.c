@@ -29,6 +29,23 @@ uint64_t time_till_midnight(void) {
 	return result;
 }
 
+/**
+ * @brief	Get the value of the monotonic clock in milliseconds.
+ * @note	The value is only meaningful when compared against another value returned by this function, which makes it suitable for
+ * 			measuring elapsed time and enforcing deadlines, since it isn't affected by changes to the system clock.
+ * @return	0 on failure, or the number of milliseconds elapsed since an arbitrary starting point on success.
+ */
+uint64_t time_monotonic_ms(void) {
+
+	struct timespec now;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return 0;
+	}
+
+	return ((uint64_t)now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
 /**
  * @brief	Get the current date as an integer of the form YYYYMMDD.
  * @return	0 on failure or a 64-bit unsigned integer containing the formatted current date on success.
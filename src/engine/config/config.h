@@ -41,6 +41,21 @@
 // The default location database caching policy.
 #define MAGMA_LOCATION_CACHE CONSTANT("disable")
 
+// The default admission control limits on simultaneous connections, and connections per minute, for each host and each /24 or /64 subnet.
+#define MAGMA_ADMISSION_HOST_CONNECTIONS 32
+#define MAGMA_ADMISSION_SUBNET_CONNECTIONS 128
+#define MAGMA_ADMISSION_HOST_RATE 60
+#define MAGMA_ADMISSION_SUBNET_RATE 240
+
+// The default number of milliseconds a delayed connection, and a tarpitted connection, are held, and the maximum number held at once.
+#define MAGMA_ADMISSION_DELAY 2000
+#define MAGMA_ADMISSION_TARPIT 30000
+#define MAGMA_ADMISSION_HOLDING 1024
+
+// The default number of hosts and subnets tracked by admission control, and the number of independently locked shards they are split into.
+#define MAGMA_ADMISSION_ENTRIES 65536
+#define MAGMA_ADMISSION_SHARDS 16
+
 // The maximum number of server instances.
 #define MAGMA_CACHE_INSTANCES 8
 
@@ -53,9 +68,91 @@
 // The maximum number of server instances.
 #define MAGMA_BLACKLIST_INSTANCES 6
 
+// The default number of milliseconds to wait for the realtime blacklists to answer.
+#define MAGMA_BLACKLIST_TIMEOUT 2000
+
+// The default number of seconds an address that isn't listed on any of the realtime blacklists will be cached.
+#define MAGMA_BLACKLIST_CACHE 600
+
+// The default number of greylist entries, and the default number of bytes used by the greylist Bloom filters, held in memory.
+#define MAGMA_GREYLIST_CACHE 65536
+#define MAGMA_GREYLIST_BLOOM 1048576
+
+// The number of independently locked greylist shards, and how many seconds a greylisted sender is trusted before memcached is asked again.
+#define MAGMA_GREYLIST_SHARDS 16
+#define MAGMA_GREYLIST_RESYNC 60
+
+// The default number of helper threads used to run content checks concurrently.
+#define MAGMA_CONTENT_THREADS 8
+
+// The default number of content checks allowed to wait for a helper thread.
+#define MAGMA_CONTENT_QUEUE 256
+
+// The default number of milliseconds to wait for a virus scan, and for a DKIM verification, before moving on without the verdict.
+#define MAGMA_CONTENT_VIRUS_TIMEOUT 30000
+#define MAGMA_CONTENT_DKIM_TIMEOUT 10000
+
+// The default number of seconds a content check verdict will be cached, and the maximum number of verdicts held in the cache.
+#define MAGMA_CONTENT_CACHE 300
+#define MAGMA_CONTENT_CACHE_LIMIT 16384
+
+// The default number of seconds inbound preferences will be cached, the maximum number of recipients held in the cache, and
+// how many seconds the cached daily receive counts are trusted before they are read from the database again.
+#define MAGMA_SMTP_PREFS_CACHE 300
+#define MAGMA_SMTP_PREFS_CACHE_LIMIT 16384
+#define MAGMA_SMTP_RECEIVING_RESYNC 60
+
+// The default number of spam signatures trained for a user at a time, the number of milliseconds to pause between training
+// batches, and the maximum number of training requests waiting in the queue.
+#define MAGMA_DSPAM_TRAINING_BATCH 64
+#define MAGMA_DSPAM_TRAINING_THROTTLE 100
+#define MAGMA_DSPAM_TRAINING_LIMIT 65536
+
+// The default number of seconds an SPF check outcome will be cached, the maximum number of outcomes held in the cache, and the
+// size of the resolver cache shared by the SPF instances, as a power of two.
+#define MAGMA_SPF_CACHE 300
+#define MAGMA_SPF_CACHE_LIMIT 16384
+#define MAGMA_SPF_DNS_CACHE_BITS 12
+
+// The default maximum number of seconds a DKIM selector key record will be cached, the number of seconds an answer without a
+// key will be cached, and the maximum number of key records held in the cache.
+#define MAGMA_DKIM_CACHE 3600
+#define MAGMA_DKIM_CACHE_NEGATIVE 300
+#define MAGMA_DKIM_CACHE_LIMIT 4096
+
+// The default number of seconds a message header summary will be cached, and the maximum number of summaries held in the cache.
+#define MAGMA_SUMMARY_CACHE 86400
+#define MAGMA_SUMMARY_CACHE_LIMIT 65536
+
+// The default number of seconds browsers may use a static web resource before revalidating it, and the smallest static
+// resource that will be compressed.
+#define MAGMA_HTTP_MAX_AGE 0
+#define MAGMA_HTTP_GZIP_MINIMUM 256
+
 // The maximum number of relay instances.
 #define MAGMA_RELAY_INSTANCES 8
 
+// The default number of idle connections kept open to each relay.
+#define MAGMA_RELAY_POOL 4
+
+// The default limit on the number of simultaneous connections to each relay.
+#define MAGMA_RELAY_CONNECTION_LIMIT 32
+
+// The number of seconds a pooled relay connection may sit idle before it is discarded instead of reused.
+#define MAGMA_RELAY_POOL_IDLE 60
+
+// The default number of threads delivering messages from the outbound queue.
+#define MAGMA_RELAY_QUEUE_WORKERS 4
+
+// The default number of seconds before the first retry of a deferred message. The delay doubles with each failed attempt.
+#define MAGMA_RELAY_QUEUE_RETRY 60
+
+// The longest delay, in seconds, between two delivery attempts.
+#define MAGMA_RELAY_QUEUE_BACKOFF 14400
+
+// The default number of seconds a message may remain in the outbound queue before it is moved to the dead letter directory.
+#define MAGMA_RELAY_QUEUE_LIFETIME 432000
+
 // The maximum number of server instances.
 #define MAGMA_SERVER_INSTANCES 32
 
@@ -82,6 +179,16 @@
 // The maximum size of a message accepted via SMTP.
 #define MAGMA_SMTP_MAX_MESSAGE_SIZE 1073741824
 
+// The number of messages considered by each rollout pass, the number removed by each rollout statement, which must match the
+// placeholders in DELETE_MESSAGES_ROLLOUT, and the number of passes the rollout thread makes over a single account before moving
+// on to the next one. An account which can't be rolled out is retried after MAGMA_ROLLOUT_RETRY seconds, with the delay doubling
+// after each failure, until it has failed MAGMA_ROLLOUT_ATTEMPTS times.
+#define MAGMA_ROLLOUT_BATCH 256
+#define MAGMA_ROLLOUT_CHUNK 32
+#define MAGMA_ROLLOUT_PASSES 64
+#define MAGMA_ROLLOUT_RETRY 60
+#define MAGMA_ROLLOUT_ATTEMPTS 8
+
 // Macros because we have a lot of these checks
 #define CONFIG_CHECK_EXISTS(option,ptype) \
 	do { \
@@ -54,6 +54,18 @@ typedef struct {
 		uint32_t worker_threads; /* How many worker threads should we spawn? */
 		uint32_t network_buffer; /* The size of the network buffer? */
 
+		struct {
+			bool_t enable; /* Should inbound connections be subject to admission control. */
+			uint32_t host_connections; /* The maximum number of simultaneous connections from a single host, or zero for no limit. */
+			uint32_t subnet_connections; /* The maximum number of simultaneous connections from a single /24 or /64 subnet, or zero for no limit. */
+			uint32_t host_rate; /* The number of connections per minute allowed from a single host, or zero for no limit. */
+			uint32_t subnet_rate; /* The number of connections per minute allowed from a single /24 or /64 subnet, or zero for no limit. */
+			uint32_t delay; /* The number of milliseconds a connection over the rate limit is held before it is processed. */
+			uint32_t tarpit; /* The number of milliseconds a connection far over the rate limit is held before it is closed. */
+			uint32_t holding; /* The maximum number of delayed and tarpitted connections held at once. */
+			uint32_t entries; /* The maximum number of hosts and subnets tracked. */
+		} admission;
+
 		bool_t enable_core_dumps; /* Should fatal errors leave behind a core dump. */
 		uint64_t core_dump_size_limit; /* If core dumps are enabled, what size should they be limited too. */
 
@@ -95,6 +107,11 @@ typedef struct {
 		chr_t *tank; /* The path of the storage tank. */
 		stringer_t *active; /* The default storage server used by the legacy mail storage logic. */
 		stringer_t *root; /* The root portion of the storage server directory paths. */
+
+		struct {
+			uint32_t cache; /* The number of seconds to cache the header summary of a message, or zero to disable the cache. */
+			uint32_t cache_limit; /* The maximum number of message summaries held in the cache. */
+		} summaries;
 	} storage;
 
 	struct {
@@ -108,11 +125,35 @@ typedef struct {
 		// Store information about the realtime blacklists used to block messages via SMTP.
 		struct {
 			uint32_t count;
+			uint32_t timeout; /* The number of milliseconds to wait for the blacklists to answer. */
+			uint32_t cache; /* The number of seconds to cache an address that isn't listed. */
 			stringer_t *domain[MAGMA_BLACKLIST_INSTANCES];
 		} blacklists;
 
+		// The in memory layer in front of the greylist records stored in memcached.
+		struct {
+			uint32_t cache; /* The maximum number of greylist entries held in memory, or zero to always use memcached. */
+			uint32_t bloom; /* The number of bytes used by the Bloom filters which track the greylist entries seen by this process. */
+		} greylist;
+
+		// The helper threads used to run content checks concurrently.
+		struct {
+			uint32_t threads; /* The number of helper threads, or zero to run the checks one after another. */
+			uint32_t queue; /* The maximum number of checks waiting for a helper thread. */
+			uint32_t virus_timeout; /* The number of milliseconds to wait for a virus scan. */
+			uint32_t dkim_timeout; /* The number of milliseconds to wait for a DKIM verification. */
+			uint32_t cache; /* The number of seconds to cache a verdict, or zero to disable the verdict cache. */
+			uint32_t cache_limit; /* The maximum number of verdicts held in the cache. */
+		} content;
+
+		// The cache of inbound delivery preferences.
+		struct {
+			uint32_t cache; /* The number of seconds to cache the preferences for a recipient, or zero to disable the cache. */
+			uint32_t cache_limit; /* The maximum number of recipients held in the cache. */
+		} prefs;
+
 		stringer_t *bypass_addr; /* Bypass address/subnet string for smtp checks. This value used only by config. */
-		inx_t *bypass_subnets; /* Holder for all the address/subnets to be waived through for bypass */
+		subnet_trie_t *bypass_subnets; /* Holder for all the address/subnets to be waived through for bypass */
 	} smtp;
 
 	struct {
@@ -122,6 +163,7 @@ typedef struct {
 		chr_t *pages; /* The static web pages directory. */
 		chr_t *templates; /* The web application templates. */
 		uint32_t session_timeout; /* Number of seconds before a session cookie expires. */
+		uint32_t max_age; /* The number of seconds browsers may use a static resource before revalidating it. */
 	} http;
 
 	struct {
@@ -131,6 +173,14 @@ typedef struct {
 			uint32_t standard;
 		} count;
 		uint32_t timeout;
+		uint32_t pool; /* The number of idle connections kept open to each relay. */
+		uint32_t connection_limit; /* The maximum number of simultaneous connections to each relay. */
+		struct {
+			chr_t *path; /* The directory holding the outbound queue, or NULL if messages are relayed synchronously. */
+			uint32_t workers; /* The number of queue delivery threads. */
+			uint32_t retry; /* The initial retry delay in seconds. */
+			uint32_t lifetime; /* The number of seconds before an undeliverable message is moved to the dead letter directory. */
+		} queue;
 	} relay;
 
 	struct {
@@ -151,6 +201,8 @@ typedef struct {
 		chr_t *domain;
 		chr_t *selector;
 		stringer_t *key; /* Location of the dkim private key at startup (replaced with contents later). */
+		uint32_t cache; /* The maximum number of seconds a selector key record will be cached. */
+		uint32_t cache_limit; /* The maximum number of selector key records held in the cache. */
 	} dkim;
 
 	struct {
@@ -205,8 +257,17 @@ typedef struct {
 				uint32_t timeout; /* The number of seconds to wait for a free SPF instance. */
 				uint32_t connections; /* The number of SPF instances in the pool. */
 			} pool;
+			uint32_t cache; /* The number of seconds an SPF check outcome will be cached. */
+			uint32_t cache_limit; /* The maximum number of outcomes held in the cache. */
 		} spf;
 
+		struct {
+			chr_t *journal; /* The file used to journal the spam training requests, or NULL to only hold them in memory. */
+			uint32_t batch; /* The number of signatures trained for a user at a time, or zero to train synchronously. */
+			uint32_t throttle; /* The number of milliseconds to pause between training batches. */
+			uint32_t limit; /* The maximum number of training requests waiting in the queue. */
+		} dspam;
+
 	} iface;
 
 	// Global config section
@@ -75,6 +75,30 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = true
 	},
+	{
+		.store = (void *)&(magma.storage.summaries.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_SUMMARY_CACHE,
+		.name = "magma.storage.summary_cache",
+		.description = "The number of seconds to cache the header summary of a message, or zero to disable the cache.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.storage.summaries.cache_limit),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_SUMMARY_CACHE_LIMIT,
+		.name = "magma.storage.summary_cache_limit",
+		.description = "The maximum number of message summaries held in the cache, before the least recently used summary is removed.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.system.daemonize),
 		.norm.type = M_TYPE_BOOLEAN,
@@ -111,6 +135,114 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.system.admission.enable),
+		.norm.type = M_TYPE_BOOLEAN,
+		.norm.val.binary = false,
+		.name = "magma.system.admission.enable",
+		.description = "If enabled, inbound mail protocol connections are limited per host and per subnet before any worker thread or TLS handshake is spent on them.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.admission.host_connections),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_ADMISSION_HOST_CONNECTIONS,
+		.name = "magma.system.admission.host_connections",
+		.description = "The maximum number of simultaneous connections allowed from a single host.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.admission.subnet_connections),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_ADMISSION_SUBNET_CONNECTIONS,
+		.name = "magma.system.admission.subnet_connections",
+		.description = "The maximum number of simultaneous connections allowed from a single /24 IPv4 or /64 IPv6 subnet.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.admission.host_rate),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_ADMISSION_HOST_RATE,
+		.name = "magma.system.admission.host_rate",
+		.description = "The number of connections per minute allowed from a single host.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.admission.subnet_rate),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_ADMISSION_SUBNET_RATE,
+		.name = "magma.system.admission.subnet_rate",
+		.description = "The number of connections per minute allowed from a single /24 IPv4 or /64 IPv6 subnet.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.admission.delay),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_ADMISSION_DELAY,
+		.name = "magma.system.admission.delay",
+		.description = "The number of milliseconds a connection over the rate limit is held before it is processed.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.admission.tarpit),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_ADMISSION_TARPIT,
+		.name = "magma.system.admission.tarpit",
+		.description = "The number of milliseconds a connection far over the rate limit is held before it is closed.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.admission.holding),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_ADMISSION_HOLDING,
+		.name = "magma.system.admission.holding",
+		.description = "The maximum number of delayed and tarpitted connections held at once.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.admission.entries),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_ADMISSION_ENTRIES,
+		.name = "magma.system.admission.entries",
+		.description = "The maximum number of hosts and subnets tracked by admission control.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.system.impersonate_user),
 		.norm.type = M_TYPE_NULLER,
@@ -364,6 +496,18 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.http.max_age),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_HTTP_MAX_AGE,
+		.name = "magma.http.max_age",
+		.description = "The number of seconds browsers may use a static web resource before revalidating it.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.web.portal.indent),
 		.norm.type = M_TYPE_BOOLEAN,
@@ -784,6 +928,150 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.smtp.blacklists.timeout),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_BLACKLIST_TIMEOUT,
+		.name = "magma.smtp.blacklist_timeout",
+		.description = "The number of milliseconds to wait for the realtime blacklists to answer.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.blacklists.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_BLACKLIST_CACHE,
+		.name = "magma.smtp.blacklist_cache",
+		.description = "The number of seconds to remember that an address wasn't listed on any of the realtime blacklists.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.greylist.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_GREYLIST_CACHE,
+		.name = "magma.smtp.greylist_cache",
+		.description = "The maximum number of greylist entries held in memory.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.greylist.bloom),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_GREYLIST_BLOOM,
+		.name = "magma.smtp.greylist_bloom",
+		.description = "The number of bytes used by the Bloom filters which track the greylist entries seen by this process.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.content.threads),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_CONTENT_THREADS,
+		.name = "magma.smtp.content_threads",
+		.description = "The number of helper threads used to run the virus scan and DKIM verification of inbound messages concurrently.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.content.queue),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_CONTENT_QUEUE,
+		.name = "magma.smtp.content_queue",
+		.description = "The maximum number of content checks allowed to wait for a helper thread.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.content.virus_timeout),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_CONTENT_VIRUS_TIMEOUT,
+		.name = "magma.smtp.content_virus_timeout",
+		.description = "The number of milliseconds to wait for the virus scan of an inbound message.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.content.dkim_timeout),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_CONTENT_DKIM_TIMEOUT,
+		.name = "magma.smtp.content_dkim_timeout",
+		.description = "The number of milliseconds to wait for the DKIM verification of an inbound message.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.content.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_CONTENT_CACHE,
+		.name = "magma.smtp.content_cache",
+		.description = "The number of seconds to remember the virus scan and DKIM verdicts for a message body.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.content.cache_limit),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_CONTENT_CACHE_LIMIT,
+		.name = "magma.smtp.content_cache_limit",
+		.description = "The maximum number of content check verdicts held in the cache.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.prefs.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_SMTP_PREFS_CACHE,
+		.name = "magma.smtp.prefs_cache",
+		.description = "The number of seconds to cache the inbound delivery preferences for a recipient.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.prefs.cache_limit),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_SMTP_PREFS_CACHE_LIMIT,
+		.name = "magma.smtp.prefs_cache_limit",
+		.description = "The maximum number of recipients whose inbound delivery preferences are held in the cache.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.smtp.message_length_limit),
 		.norm.type = M_TYPE_UINT64,
@@ -880,6 +1168,30 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.dkim.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_DKIM_CACHE,
+		.name = "magma.dkim.cache",
+		.description = "The maximum number of seconds to cache the selector key records used to verify DKIM signatures.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.dkim.cache_limit),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_DKIM_CACHE_LIMIT,
+		.name = "magma.dkim.cache_limit",
+		.description = "The maximum number of selector key records held in the DKIM cache.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.dime.key),
 		.norm.type = M_TYPE_STRINGER,
@@ -928,6 +1240,78 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.iface.spf.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_SPF_CACHE,
+		.name = "magma.iface.spf.cache",
+		.description = "The number of seconds to cache the outcome of an SPF check for a client address and sender domain.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.iface.spf.cache_limit),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_SPF_CACHE_LIMIT,
+		.name = "magma.iface.spf.cache_limit",
+		.description = "The maximum number of SPF check outcomes held in the cache.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.iface.dspam.journal),
+		.norm.type = M_TYPE_NULLER,
+		.norm.val.ns = NULL,
+		.name = "magma.iface.dspam.journal",
+		.description = "The file used to journal spam training requests, so they survive a restart. If no file is provided, waiting requests are only held in memory.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.iface.dspam.batch),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_DSPAM_TRAINING_BATCH,
+		.name = "magma.iface.dspam.batch",
+		.description = "The number of spam signatures trained for a user at a time. Setting this to zero trains signatures synchronously.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.iface.dspam.throttle),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_DSPAM_TRAINING_THROTTLE,
+		.name = "magma.iface.dspam.throttle",
+		.description = "The number of milliseconds the training thread pauses between batches.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.iface.dspam.limit),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_DSPAM_TRAINING_LIMIT,
+		.name = "magma.iface.dspam.limit",
+		.description = "The maximum number of spam training requests waiting to be processed.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.iface.cache.pool.connections),
 		.norm.type = M_TYPE_UINT32,
@@ -988,6 +1372,78 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.relay.pool),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_RELAY_POOL,
+		.name = "magma.relay.pool",
+		.description = "The number of idle connections kept open to each mail relay for reuse. A value of zero disables connection reuse.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.relay.connection_limit),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_RELAY_CONNECTION_LIMIT,
+		.name = "magma.relay.connection_limit",
+		.description = "The maximum number of simultaneous connections to each mail relay. A value of zero removes the limit.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.relay.queue.path),
+		.norm.type = M_TYPE_NULLER,
+		.norm.val.ns = NULL,
+		.name = "magma.relay.queue.path",
+		.description = "The directory used to hold the outbound delivery queue. If no directory is provided, outbound messages are relayed synchronously.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.relay.queue.workers),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_RELAY_QUEUE_WORKERS,
+		.name = "magma.relay.queue.workers",
+		.description = "The number of threads delivering messages from the outbound queue.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.relay.queue.retry),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_RELAY_QUEUE_RETRY,
+		.name = "magma.relay.queue.retry",
+		.description = "The number of seconds before a deferred message is retried. The delay doubles after each failed attempt.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.relay.queue.lifetime),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_RELAY_QUEUE_LIFETIME,
+		.name = "magma.relay.queue.lifetime",
+		.description = "The number of seconds an undeliverable message is retried before it is moved to the dead letter directory.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 };
 
 #endif
@@ -38,6 +38,12 @@ void process_maint(void) {
 		// Execute these functions every few minutes.
 		virus_engine_refresh();
 		obj_cache_prune();
+		smtp_rbl_prune();
+		smtp_verdict_prune();
+		smtp_prefs_prune();
+		dkim_records_prune();
+		spf_cache_prune();
+		mail_summary_prune();
 
 		// If were close to midnight, sleep until midnight, otherwise sleep a random number of seconds up to ten minutes.
 		if (status()) {
@@ -107,7 +113,7 @@ void process_stop(void) {
 		mail_cache_stop,
 		warehouse_stop,
 		http_content_stop,
-		NULL, /* Protocol handlers. */
+		protocol_stop, /* Protocol handlers. */
 		servers_encryption_stop,
 		queue_shutdown, /* Shutdown the thread pool. */
 		NULL /* Logging */
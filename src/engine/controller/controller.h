@@ -18,6 +18,7 @@ void     requeue(void *function, void *requeue, void *data);
 
 /// protocol.c
 bool_t protocol_init(void);
-void protocol_process(server_t *server, int sockd);
+void protocol_stop(void);
+void protocol_process(server_t *server, int sockd, ip_t *address, int_t admitted);
 
 #endif
@@ -81,7 +81,8 @@ stringer_t * protocol_type(connection_t *con) {
 
 /**
  * @brief	Initialize all protocol modules, and prime their command arrays for binary searching.
- * @return	This function always returns true.
+ * @return	true on success or false if one of the SMTP caches, the message summary cache, the outbound queue or the content check
+ * 			threads couldn't be started.
  */
 bool_t protocol_init(void) {
 	pop_sort();
@@ -90,7 +91,26 @@ bool_t protocol_init(void) {
 	dmtp_sort();
 	molten_sort();
 	portal_endpoint_sort();
-	return true;
+	return net_admission_start() && smtp_rbl_start() && smtp_greylist_start() && smtp_queue_start() && smtp_rollout_start() && smtp_content_start() && smtp_verdict_start() &&
+		smtp_prefs_start() && mail_summary_start();
+}
+
+/**
+ * @brief	Release the resources held by the protocol modules.
+ * @return	This function returns no value.
+ */
+void protocol_stop(void) {
+	net_admission_stop();
+	smtp_content_stop();
+	smtp_rollout_stop();
+	smtp_queue_stop();
+	smtp_pool_stop();
+	smtp_greylist_stop();
+	smtp_rbl_stop();
+	smtp_verdict_stop();
+	smtp_prefs_stop();
+	mail_summary_stop();
+	return;
 }
 
 /**
@@ -197,23 +217,31 @@ void protocol_secure(connection_t *con) {
  * @note	Depending on whether the server specifies a secure transport layer, protocol_secure() or protocol_enqueue() will be dispatched.
  * @param	server	a pointer to the server object of the server handling the connection.
  * @param	sockd	the socket descriptor of the newly accepted connection.
+ * @param	address	the remote address if it is already known, which will be owned by the connection, or NULL to look it up.
+ * @param	admitted	the admission control counts which include the connection, and must be released when it is destroyed.
  */
-void protocol_process(server_t *server, int sockd) {
+void protocol_process(server_t *server, int sockd, ip_t *address, int_t admitted) {
 
 	connection_t *con;
 
 	if (!server || sockd == -1 || !net_set_timeout(sockd, server->network.timeout, server->network.timeout)) {
 		log_pedantic("Invalid parameters were passed into the protocol processor.");
+		net_admission_release(address, admitted);
 		if (sockd != -1)
 			close(sockd);
+		mm_cleanup(address);
 		return;
 	}
 
-	if (!(con = con_init(sockd, server))) {
+	if (!(con = con_init(sockd, server, address))) {
+		net_admission_release(address, admitted);
 		close(sockd);
+		mm_cleanup(address);
 		return;
 	}
 
+	con->network.admitted = admitted;
+
 	server->network.type == TLS_PORT && server->tls.context ? enqueue(&protocol_secure, con) : enqueue(&protocol_enqueue, con);
 	return;
 }
@@ -20,9 +20,55 @@ struct {
 			"core.threads.allocated",
 			"core.threads.working",
 
+			// Network Statistics
+			"network.admission.admitted",
+			"network.admission.delayed",
+			"network.admission.tarpitted",
+			"network.admission.rejected",
+			"network.admission.untracked",
+			"network.admission.held",
+
 			// SMTP Statistics
 			"smtp.connections.total",
 			"smtp.connections.secure",
+			"smtp.rbl.checked",
+			"smtp.rbl.cached",
+			"smtp.rbl.listed",
+			"smtp.rbl.timeouts",
+			"smtp.rbl.errors",
+			"smtp.relay.connections",
+			"smtp.relay.reused",
+			"smtp.relay.messages",
+			"smtp.queue.queued",
+			"smtp.queue.delivered",
+			"smtp.queue.deferred",
+			"smtp.queue.dead",
+			"smtp.queue.bounced",
+			"smtp.rollout.scheduled",
+			"smtp.rollout.removed",
+			"smtp.prefs.cached",
+			"smtp.prefs.loaded",
+			"dspam.training.queued",
+			"dspam.training.trained",
+			"dspam.training.failed",
+			"dspam.training.cancelled",
+			"smtp.greylist.hits",
+			"smtp.greylist.misses",
+			"smtp.greylist.added",
+			"smtp.greylist.evicted",
+			"smtp.content.virus.checked",
+			"smtp.content.virus.rejected",
+			"smtp.content.virus.milliseconds",
+			"smtp.content.virus.timeouts",
+			"smtp.content.virus.cached",
+			"smtp.content.dkim.checked",
+			"smtp.content.dkim.rejected",
+			"smtp.content.dkim.milliseconds",
+			"smtp.content.dkim.timeouts",
+			"smtp.content.dkim.cached",
+			"smtp.content.skipped",
+			"smtp.content.cancelled",
+			"smtp.content.overflow",
 
 			// DMTP Statistics
 			"dmtp.connections.total",
@@ -31,6 +77,8 @@ struct {
 			// HTTP Statistics
 			"http.connections.total",
 			"http.connections.secure",
+			"http.static.compressed",
+			"http.static.unmodified",
 
 			// IMAP Statistics
 			"imap.connections.total",
@@ -60,6 +108,7 @@ struct {
 			"provider.spf.error",
 			"provider.spf.fail",
 			"provider.spf.pass",
+			"provider.spf.cached",
 
 			"provider.dkim.signed",
 			"provider.dkim.checked",
@@ -68,12 +117,17 @@ struct {
 			"provider.dkim.error",
 			"provider.dkim.fail",
 			"provider.dkim.pass",
+			"provider.dkim.keys.cached",
+			"provider.dkim.keys.queried",
 
 			// Objects
 			"objects.meta.total",
 			"objects.meta.expired",
 			"objects.sessions.total",
 			"objects.sessions.expired",
+			"objects.summaries.cached",
+			"objects.summaries.loaded",
+			"objects.summaries.evicted",
 
 			// Patterns
 			"objects.patterns.checked",
@@ -0,0 +1,655 @@
+
+/**
+ * @file /magma/network/admission.c
+ *
+ * @brief	Connection admission control, applied to each connection as it is accepted, before a worker or a TLS handshake is spent on it.
+ *
+ * Every remote host, and the /24 (IPv4) or /64 (IPv6) subnet it belongs to, is tracked by an entry holding the number of
+ * connections currently open and a token bucket refilled at the configured rate. Each bucket holds one minute worth of
+ * connections. A client above its connection limit is rejected. A client which has emptied its bucket is delayed, and a
+ * client which keeps connecting until its bucket is a full minute in debt is tarpitted, meaning the socket is held open
+ * without a greeting and then closed. Delayed and tarpitted sockets wait in a bounded holding area serviced by a single
+ * thread, and are rejected outright once the holding area is full. Loopback clients are never limited.
+ */
+
+#include "magma.h"
+
+// The entries are split into shards, each with its own lock, hash table and least recently used list.
+struct {
+	pthread_mutex_t lock;
+	net_admission_entry_t **buckets, *newest, *oldest;
+	uint64_t buckets_mask;
+	uint32_t count, limit;
+} net_admission[MAGMA_ADMISSION_SHARDS];
+
+// The delayed and tarpitted sockets, each list sorted by release time because every entry on it waits for the same interval.
+struct {
+	bool_t running;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t available;
+	uint32_t count;
+	struct {
+		net_admission_held_t *head, *tail;
+	} held[2];
+} net_admission_holding = {
+	.running = false,
+	.count = 0,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.available = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * @brief	Generate the hash used to track a remote host, or the subnet it belongs to.
+ * @note	IPv4 addresses mapped into the IPv6 address space are tracked as IPv4 addresses.
+ * @param	address	a pointer to the remote address.
+ * @param	subnet	if true, hash the /24 or /64 subnet containing the address, rather than the address itself.
+ * @return	the murmur hash of the address or subnet, or 0 if the address family isn't supported.
+ */
+uint64_t net_admission_hash(ip_t *address, bool_t subnet) {
+
+	size_t length;
+	uchr_t key[17];
+
+	if (!address) {
+		return 0;
+	}
+	else if (address->family == AF_INET) {
+		mm_copy(key + 1, &(address->ip4), 4);
+		length = subnet ? 3 : 4;
+	}
+	else if (address->family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&(address->ip6))) {
+		mm_copy(key + 1, ((uchr_t *)&(address->ip6)) + 12, 4);
+		length = subnet ? 3 : 4;
+	}
+	else if (address->family == AF_INET6) {
+		mm_copy(key + 1, &(address->ip6), 16);
+		length = subnet ? 8 : 16;
+	}
+	else {
+		return 0;
+	}
+
+	// The prefix byte keeps a host entry from ever sharing a hash with the subnet entry of the same bytes.
+	*key = subnet ? 's' : 'h';
+
+	return hash_murmur64(key, length + 1);
+}
+
+/**
+ * @brief	Find the shard responsible for an admission hash.
+ * @param	hash	the admission hash of the host or subnet.
+ * @return	the shard number.
+ */
+uint32_t net_admission_shard(uint64_t hash) {
+	return (hash >> 56) % MAGMA_ADMISSION_SHARDS;
+}
+
+/**
+ * @brief	Move an admission entry to the front of the least recently used list of its shard.
+ * @note	The caller must hold the shard lock, and the entry must not currently be on the list.
+ * @param	shard	the shard number.
+ * @param	entry	a pointer to the admission entry.
+ * @return	This function returns no value.
+ */
+void net_admission_push(uint32_t shard, net_admission_entry_t *entry) {
+
+	entry->newer = NULL;
+	entry->older = net_admission[shard].newest;
+
+	if (net_admission[shard].newest) {
+		net_admission[shard].newest->newer = entry;
+	}
+	else {
+		net_admission[shard].oldest = entry;
+	}
+
+	net_admission[shard].newest = entry;
+	return;
+}
+
+/**
+ * @brief	Remove an admission entry from the least recently used list of its shard.
+ * @note	The caller must hold the shard lock.
+ * @param	shard	the shard number.
+ * @param	entry	a pointer to the admission entry.
+ * @return	This function returns no value.
+ */
+void net_admission_unlink(uint32_t shard, net_admission_entry_t *entry) {
+
+	if (entry->newer) entry->newer->older = entry->older;
+	else net_admission[shard].newest = entry->older;
+
+	if (entry->older) entry->older->newer = entry->newer;
+	else net_admission[shard].oldest = entry->newer;
+
+	entry->newer = entry->older = NULL;
+	return;
+}
+
+/**
+ * @brief	Find the admission entry for a hash, creating it if necessary.
+ * @note	The caller must hold the shard lock. Once a shard is full, the least recently used entry without any open
+ * 			connections is recycled. If every entry still has open connections, no entry is returned.
+ * @param	shard	the shard number.
+ * @param	hash	the admission hash of the host or subnet.
+ * @param	now		the current monotonic time in milliseconds.
+ * @param	rate	the number of connections allowed per minute, which is used to fill the bucket of a new entry.
+ * @return	NULL on failure, or a pointer to the admission entry.
+ */
+net_admission_entry_t * net_admission_entry(uint32_t shard, uint64_t hash, uint64_t now, uint32_t rate) {
+
+	uint32_t scanned = 0;
+	net_admission_entry_t *entry, **holder;
+
+	entry = net_admission[shard].buckets[hash & net_admission[shard].buckets_mask];
+
+	while (entry && entry->hash != hash) {
+		entry = entry->chain;
+	}
+
+	if (entry) {
+		net_admission_unlink(shard, entry);
+		net_admission_push(shard, entry);
+		return entry;
+	}
+
+	if (net_admission[shard].count >= net_admission[shard].limit) {
+
+		// Only look at the oldest few entries, so a shard full of busy hosts doesn't turn every accept into a linear scan.
+		for (entry = net_admission[shard].oldest; entry && entry->active && scanned < 16; entry = entry->newer, scanned++);
+
+		if (!entry || entry->active) {
+			return NULL;
+		}
+
+		net_admission_unlink(shard, entry);
+
+		holder = &(net_admission[shard].buckets[entry->hash & net_admission[shard].buckets_mask]);
+		while (*holder != entry) {
+			holder = &((*holder)->chain);
+		}
+		*holder = entry->chain;
+	}
+	else if ((entry = mm_alloc(sizeof(net_admission_entry_t)))) {
+		net_admission[shard].count++;
+	}
+	else {
+		return NULL;
+	}
+
+	entry->hash = hash;
+	entry->active = 0;
+	entry->tokens = (int64_t)rate * 1000;
+	entry->stamp = now;
+	entry->chain = net_admission[shard].buckets[hash & net_admission[shard].buckets_mask];
+	net_admission[shard].buckets[hash & net_admission[shard].buckets_mask] = entry;
+	net_admission_push(shard, entry);
+
+	return entry;
+}
+
+/**
+ * @brief	Charge a connection attempt against the entry for a host or subnet.
+ * @note	Tokens are stored in thousandths of a connection. A bucket may fall up to one minute of connections into debt,
+ * 			so clients which back off are delayed, while clients which keep hammering the server end up tarpitted.
+ * @param	hash	the admission hash of the host or subnet.
+ * @param	connections	the maximum number of simultaneous connections, or 0 for no limit.
+ * @param	rate	the number of connections allowed per minute, or 0 for no limit.
+ * @param	counted	a pointer to a boolean which will be set if the attempt was added to the number of open connections.
+ * @return	NET_ADMISSION_ADMIT, NET_ADMISSION_DELAY, NET_ADMISSION_TARPIT or NET_ADMISSION_REJECT.
+ */
+int_t net_admission_charge(uint64_t hash, uint32_t connections, uint32_t rate, bool_t *counted) {
+
+	int64_t capacity;
+	int_t result = NET_ADMISSION_ADMIT;
+	net_admission_entry_t *entry;
+	uint64_t now = time_monotonic_ms();
+	uint32_t shard = net_admission_shard(hash);
+
+	*counted = false;
+	capacity = (int64_t)rate * 1000;
+
+	mutex_lock(&(net_admission[shard].lock));
+
+	if (!net_admission[shard].buckets || !(entry = net_admission_entry(shard, hash, now, rate))) {
+		mutex_unlock(&(net_admission[shard].lock));
+		stats_increment_by_name("network.admission.untracked");
+		return NET_ADMISSION_ADMIT;
+	}
+
+	if (rate) {
+
+		// A bucket with a rate of n connections per minute regains n / 60 thousandths of a token every millisecond.
+		entry->tokens += ((int64_t)(now - entry->stamp) * rate) / 60;
+		entry->stamp = now;
+
+		if (entry->tokens > capacity) {
+			entry->tokens = capacity;
+		}
+
+		if (entry->tokens < 1000 - capacity) {
+			result = NET_ADMISSION_TARPIT;
+		}
+		else if (entry->tokens < 1000) {
+			result = NET_ADMISSION_DELAY;
+		}
+
+		if (entry->tokens >= 1000 - capacity) {
+			entry->tokens -= 1000;
+		}
+	}
+
+	if (connections && entry->active >= connections) {
+		result = NET_ADMISSION_REJECT;
+	}
+	else if (result != NET_ADMISSION_TARPIT) {
+		entry->active++;
+		*counted = true;
+	}
+
+	mutex_unlock(&(net_admission[shard].lock));
+
+	return result;
+}
+
+/**
+ * @brief	Remove a connection from the number of open connections recorded for a host or subnet.
+ * @param	hash	the admission hash of the host or subnet.
+ * @return	This function returns no value.
+ */
+void net_admission_uncount(uint64_t hash) {
+
+	net_admission_entry_t *entry;
+	uint32_t shard = net_admission_shard(hash);
+
+	mutex_lock(&(net_admission[shard].lock));
+
+	if (net_admission[shard].buckets) {
+
+		entry = net_admission[shard].buckets[hash & net_admission[shard].buckets_mask];
+
+		while (entry && entry->hash != hash) {
+			entry = entry->chain;
+		}
+
+		// The entry may be missing, or shared with an untracked connection, if its shard was full when the connection was accepted.
+		if (entry && entry->active) {
+			entry->active--;
+		}
+	}
+
+	mutex_unlock(&(net_admission[shard].lock));
+
+	return;
+}
+
+/**
+ * @brief	Determine whether connections from an address are subject to admission control.
+ * @param	address	a pointer to the remote address.
+ * @return	true if the address is tracked, or false if admission control is disabled or the address is exempt.
+ */
+bool_t net_admission_tracked(ip_t *address) {
+	return magma.system.admission.enable && net_admission_hash(address, false) && !ip_localhost(address);
+}
+
+/**
+ * @brief	Decide how a new connection from a remote address should be handled.
+ * @note	If the connection is admitted or delayed, it is usually added to the number of open connections for the host and
+ * 			subnet, and must later be removed with net_admission_release(). A count is skipped if its shard was too busy to track
+ * 			the host or subnet, so the counts which were taken are returned, and only those are released.
+ * @param	address	a pointer to the remote address.
+ * @param	counted	a pointer to an integer which receives the counts the connection was added to, as NET_ADMISSION_HOST and
+ * 					NET_ADMISSION_SUBNET flags.
+ * @return	NET_ADMISSION_ADMIT, NET_ADMISSION_DELAY, NET_ADMISSION_TARPIT or NET_ADMISSION_REJECT.
+ */
+int_t net_admission_check(ip_t *address, int_t *counted) {
+
+	int_t host, subnet, result;
+	bool_t host_counted, subnet_counted;
+
+	*counted = 0;
+
+	if (!net_admission_tracked(address)) {
+		return NET_ADMISSION_ADMIT;
+	}
+
+	host = net_admission_charge(net_admission_hash(address, false), magma.system.admission.host_connections,
+		magma.system.admission.host_rate, &host_counted);
+	subnet = net_admission_charge(net_admission_hash(address, true), magma.system.admission.subnet_connections,
+		magma.system.admission.subnet_rate, &subnet_counted);
+
+	// The decisions are ordered by severity, so the connection gets the harshest treatment either limit calls for.
+	result = host > subnet ? host : subnet;
+
+	if (result == NET_ADMISSION_TARPIT || result == NET_ADMISSION_REJECT) {
+		if (host_counted) net_admission_uncount(net_admission_hash(address, false));
+		if (subnet_counted) net_admission_uncount(net_admission_hash(address, true));
+	}
+	else {
+		*counted = (host_counted ? NET_ADMISSION_HOST : 0) | (subnet_counted ? NET_ADMISSION_SUBNET : 0);
+	}
+
+	switch (result) {
+		case (NET_ADMISSION_ADMIT):
+			stats_increment_by_name("network.admission.admitted");
+			break;
+		case (NET_ADMISSION_DELAY):
+			stats_increment_by_name("network.admission.delayed");
+			break;
+		case (NET_ADMISSION_TARPIT):
+			stats_increment_by_name("network.admission.tarpitted");
+			break;
+		default:
+			stats_increment_by_name("network.admission.rejected");
+			break;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Remove a connection which was admitted, or delayed, from the number of open connections for its host and subnet.
+ * @param	address	a pointer to the remote address that was passed to net_admission_check().
+ * @param	counted	the counts the connection was added to, as returned by net_admission_check().
+ * @return	This function returns no value.
+ */
+void net_admission_release(ip_t *address, int_t counted) {
+
+	if (!address) {
+		return;
+	}
+
+	if (counted & NET_ADMISSION_HOST) {
+		net_admission_uncount(net_admission_hash(address, false));
+	}
+
+	if (counted & NET_ADMISSION_SUBNET) {
+		net_admission_uncount(net_admission_hash(address, true));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Place a delayed or tarpitted socket in the holding area.
+ * @param	server	a pointer to the server object of the server which accepted the connection.
+ * @param	sockd	the socket descriptor of the connection.
+ * @param	address	a pointer to the remote address, which will be owned by the holding area if the call succeeds.
+ * @param	admit	if true, the connection will be processed once it is released, otherwise it will be closed.
+ * @param	counted	the admission control counts which include the connection.
+ * @return	true if the socket is being held, or false if the holding area is full.
+ */
+bool_t net_admission_hold(server_t *server, int sockd, ip_t *address, bool_t admit, int_t counted) {
+
+	net_admission_held_t *held;
+
+	if (!(held = mm_alloc(sizeof(net_admission_held_t)))) {
+		return false;
+	}
+
+	held->admit = admit;
+	held->counted = counted;
+	held->sockd = sockd;
+	held->server = server;
+	held->address = address;
+	held->release = time_monotonic_ms() + (admit ? magma.system.admission.delay : magma.system.admission.tarpit);
+
+	mutex_lock(&(net_admission_holding.lock));
+
+	if (!net_admission_holding.running || net_admission_holding.count >= magma.system.admission.holding) {
+		mutex_unlock(&(net_admission_holding.lock));
+		mm_free(held);
+		return false;
+	}
+
+	if (net_admission_holding.held[admit].tail) {
+		net_admission_holding.held[admit].tail->next = held;
+	}
+	else {
+		net_admission_holding.held[admit].head = held;
+	}
+
+	net_admission_holding.held[admit].tail = held;
+	net_admission_holding.count++;
+
+	pthread_cond_signal(&(net_admission_holding.available));
+	mutex_unlock(&(net_admission_holding.lock));
+
+	stats_increment_by_name("network.admission.held");
+
+	return true;
+}
+
+/**
+ * @brief	Finish with a socket that was held, by either processing or closing it.
+ * @param	held	a pointer to the holding area entry, which will be freed.
+ * @param	process	if true, delayed connections are passed on to the protocol handlers, otherwise every socket is closed.
+ * @return	This function returns no value.
+ */
+void net_admission_finish(net_admission_held_t *held, bool_t process) {
+
+	stats_decrement_by_name("network.admission.held");
+
+	if (held->admit && process) {
+		protocol_process(held->server, held->sockd, held->address, held->counted);
+	}
+	else {
+		net_admission_release(held->address, held->counted);
+		close(held->sockd);
+		mm_free(held->address);
+	}
+
+	mm_free(held);
+	return;
+}
+
+/**
+ * @brief	Release held sockets as they become due.
+ * @note	This is the entry point for the holding thread created by net_admission_start().
+ * @return	This function returns no value.
+ */
+void net_admission_worker(void) {
+
+	uint64_t now, due;
+	net_admission_held_t *held;
+	struct timespec wakeup;
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	mutex_lock(&(net_admission_holding.lock));
+
+	while (net_admission_holding.running) {
+
+		now = time_monotonic_ms();
+		held = NULL;
+		due = 0;
+
+		for (int_t i = 0; i < 2; i++) {
+			if (net_admission_holding.held[i].head && net_admission_holding.held[i].head->release <= now) {
+				held = net_admission_holding.held[i].head;
+				if (!(net_admission_holding.held[i].head = held->next)) {
+					net_admission_holding.held[i].tail = NULL;
+				}
+				net_admission_holding.count--;
+				break;
+			}
+			else if (net_admission_holding.held[i].head && (!due || net_admission_holding.held[i].head->release < due)) {
+				due = net_admission_holding.held[i].head->release;
+			}
+		}
+
+		if (held) {
+			mutex_unlock(&(net_admission_holding.lock));
+			net_admission_finish(held, true);
+			mutex_lock(&(net_admission_holding.lock));
+		}
+
+		// Sleep until a socket is held, or until the first held socket is due.
+		else if (!due) {
+			pthread_cond_wait(&(net_admission_holding.available), &(net_admission_holding.lock));
+		}
+		else {
+			due -= now;
+			clock_gettime(CLOCK_REALTIME, &wakeup);
+			wakeup.tv_sec += (due / 1000) + ((wakeup.tv_nsec + ((due % 1000) * 1000000)) / 1000000000);
+			wakeup.tv_nsec = (wakeup.tv_nsec + ((due % 1000) * 1000000)) % 1000000000;
+			pthread_cond_timedwait(&(net_admission_holding.available), &(net_admission_holding.lock), &wakeup);
+		}
+	}
+
+	mutex_unlock(&(net_admission_holding.lock));
+
+	thread_stop();
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Apply admission control to a newly accepted connection.
+ * @param	server	a pointer to the server object of the server which accepted the connection.
+ * @param	sockd	the socket descriptor of the newly accepted connection.
+ * @return	This function returns no value.
+ */
+void net_admission_accept(server_t *server, int sockd) {
+
+	ip_t *address;
+	int_t counted;
+
+	// Only the mail protocols are limited, since web browsers routinely open a burst of connections to the same server.
+	if (!magma.system.admission.enable || server->protocol == HTTP || server->protocol == GENERIC || server->protocol == MOLTEN) {
+		protocol_process(server, sockd, NULL, 0);
+		return;
+	}
+	else if (!(address = tcp_addr_ip(sockd, NULL))) {
+		close(sockd);
+		return;
+	}
+
+	switch (net_admission_check(address, &counted)) {
+
+		case (NET_ADMISSION_ADMIT):
+			protocol_process(server, sockd, address, counted);
+			return;
+
+		case (NET_ADMISSION_DELAY):
+			if (net_admission_hold(server, sockd, address, true, counted)) {
+				return;
+			}
+			net_admission_release(address, counted);
+			break;
+
+		case (NET_ADMISSION_TARPIT):
+			if (net_admission_hold(server, sockd, address, false, 0)) {
+				return;
+			}
+			break;
+	}
+
+	close(sockd);
+	mm_free(address);
+
+	return;
+}
+
+/**
+ * @brief	Stop the holding thread, close any held sockets, and free the admission entries.
+ * @note	The shard locks are left intact, because connections which are still being torn down may release their counts.
+ * @return	This function returns no value.
+ */
+void net_admission_stop(void) {
+
+	net_admission_held_t *held;
+	net_admission_entry_t *entry;
+
+	mutex_lock(&(net_admission_holding.lock));
+	net_admission_holding.running = false;
+	pthread_cond_broadcast(&(net_admission_holding.available));
+	mutex_unlock(&(net_admission_holding.lock));
+
+	if (net_admission_holding.thread) {
+		thread_join(net_admission_holding.thread);
+		net_admission_holding.thread = 0;
+	}
+
+	for (int_t i = 0; i < 2; i++) {
+		while ((held = net_admission_holding.held[i].head)) {
+			net_admission_holding.held[i].head = held->next;
+			net_admission_finish(held, false);
+		}
+		net_admission_holding.held[i].tail = NULL;
+	}
+
+	net_admission_holding.count = 0;
+
+	for (uint32_t i = 0; i < MAGMA_ADMISSION_SHARDS; i++) {
+
+		mutex_lock(&(net_admission[i].lock));
+
+		while ((entry = net_admission[i].newest)) {
+			net_admission[i].newest = entry->older;
+			mm_free(entry);
+		}
+
+		mm_cleanup(net_admission[i].buckets);
+		net_admission[i].buckets = NULL;
+		net_admission[i].oldest = NULL;
+		net_admission[i].count = 0;
+
+		mutex_unlock(&(net_admission[i].lock));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Allocate the admission entries and launch the holding thread.
+ * @return	true on success or false on failure.
+ */
+bool_t net_admission_start(void) {
+
+	uint64_t buckets = 1;
+
+	mm_wipe(net_admission, sizeof(net_admission));
+
+	for (uint32_t i = 0; i < MAGMA_ADMISSION_SHARDS; i++) {
+		if (mutex_init(&(net_admission[i].lock), NULL)) {
+			log_critical("Unable to initialize the admission control locks.");
+			return false;
+		}
+	}
+
+	if (!magma.system.admission.enable) {
+		return true;
+	}
+
+	// The hash tables are sized to the next power of two, so the bucket can be selected with a mask.
+	while (buckets < (magma.system.admission.entries / MAGMA_ADMISSION_SHARDS) + 1) {
+		buckets <<= 1;
+	}
+
+	for (uint32_t i = 0; i < MAGMA_ADMISSION_SHARDS; i++) {
+
+		net_admission[i].buckets_mask = buckets - 1;
+		net_admission[i].limit = (magma.system.admission.entries / MAGMA_ADMISSION_SHARDS) + 1;
+
+		if (!(net_admission[i].buckets = mm_alloc(sizeof(net_admission_entry_t *) * buckets))) {
+			log_critical("Unable to allocate the admission control entries.");
+			net_admission_stop();
+			return false;
+		}
+	}
+
+	net_admission_holding.running = true;
+
+	if (thread_launch(&(net_admission_holding.thread), &net_admission_worker, NULL)) {
+		log_critical("Unable to launch the admission control holding thread.");
+		net_admission_stop();
+		return false;
+	}
+
+	return true;
+}
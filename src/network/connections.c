@@ -176,6 +176,10 @@ void con_destroy(connection_t *con) {
 			close(con->network.sockd);
 		}
 
+		if (con->network.admitted) {
+			net_admission_release(con->network.reverse.ip, con->network.admitted);
+		}
+
 		st_cleanup(con->network.buffer);
 		mm_cleanup(con->network.reverse.ip);
 		st_cleanup(con->network.reverse.domain);
@@ -246,8 +250,9 @@ bool_t con_init_network_buffer(connection_t *con) {
  * @brief	Create a new connection object for a client connection.
  * @param	cond	the socket descriptor of the inbound client connection that was just accepted.
  * @param	server	the handle of the server that serviced the inbound request.
+ * @param	address	the remote address if it is already known, which will be owned by the connection, or NULL to look it up.
  */
-connection_t * con_init(int cond, server_t *server) {
+connection_t * con_init(int cond, server_t *server, ip_t *address) {
 
 	connection_t *con;
 
@@ -261,7 +266,7 @@ connection_t * con_init(int cond, server_t *server) {
 
 	con->server = server;
 	con->network.sockd = cond;
-	con->network.reverse.ip = tcp_addr_ip(cond, NULL);
+	con->network.reverse.ip = address ? address : tcp_addr_ip(cond, NULL);
 	con_increment_refs(con);
 
 	return con;
@@ -38,8 +38,32 @@ typedef struct {
 	stringer_t *name, *value;
 } http_data_t;
 
+// A value substituted into a compiled template, selected by the xpath of an element and, optionally, one of its attributes.
+typedef struct {
+	chr_t *xpath; /* The xpath of the element whose content, or attribute, is replaced. */
+	chr_t *attribute; /* The name of the attribute being replaced, or NULL to replace the text of the element. */
+} http_slot_t;
+
+// A template serialized once, and split into the literal segments which surround each substitution.
+typedef struct http_template_t {
+	http_slot_t *slots; /* The slots the template was compiled with, which also identify the compilation. */
+	size_t total; /* The number of slots the template was compiled with. */
+	size_t count; /* The number of substitutions found in the serialized template. */
+	uint32_t *order; /* The slot used by each substitution, in the order they appear. */
+	placer_t *segments; /* The count + 1 literal segments, which point into the serialized template. */
+	placer_t *defaults; /* The serialized original value of each substitution, or a NULL placer for an attribute which wasn't present. */
+	stringer_t *output; /* The serialized template, with a marker in place of each substitution. */
+	stringer_t *original; /* The serialized template, as loaded, which holds the original values. */
+	stringer_t *type; /* The MIME type of the template, which belongs to the template content. */
+	struct http_template_t *next; /* The next compilation of the same template, with a different set of slots. */
+} http_template_t;
+
 typedef struct {
 	stringer_t *location, *resource, *type;
+	stringer_t *etag; /* The strong entity tag of a static resource, including the quotes. */
+	stringer_t *gzip; /* The static resource compressed with gzip, or NULL if compression wouldn't make it smaller. */
+	time_t modified; /* The last modification time of the file a static resource was loaded from. */
+	http_template_t *compiled; /* The compiled forms of a template, created the first time each set of slots is rendered. */
 	struct http_content_t *next;
 } http_content_t;
 
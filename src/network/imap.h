@@ -15,6 +15,16 @@ typedef struct {
 	uint64_t foldernum, recent, unseen, uidnext, messages, first;
 } imap_folder_status_t;
 
+// A sequence set compiled into a sorted list of merged, non-overlapping intervals.
+typedef struct {
+	uint64_t start, end;
+} imap_interval_t;
+
+typedef struct {
+	size_t count;
+	imap_interval_t intervals[];
+} imap_sequence_t;
+
 typedef struct {
 	int_t uid, flags, internaldate, envelope, bodystructure, rfc822, rfc822_header, rfc822_size, rfc822_text, body;
 	array_t *peek, *peek_partial, *normal, *normal_partial;
@@ -29,8 +39,8 @@ typedef struct __attribute__ ((packed)) {
 	meta_user_t *user;
 	imap_arguments_t *arguments;
 	stringer_t *tag, *command, *username;
-	int_t read_only, uid, session_state;
-	uint64_t usernum, selected, user_checkpoint, messages_checkpoint, folders_checkpoint, messages_recent, messages_total;
+	int_t read_only, uid, session_state, limited;
+	uint64_t usernum, selected, user_checkpoint, messages_checkpoint, folders_checkpoint, messages_recent, messages_total, literals;
 } imap_session_t;
 
 #endif
@@ -17,7 +17,7 @@ void net_accept(server_t *server) {
 
 		// Keep calling accept until it fails.
 		if ((connection = accept(server->network.sockd, NULL, NULL)) != -1 && status()) {
-			protocol_process(server, connection);
+			net_admission_accept(server, connection);
 		}
 		else if (connection != -1) {
 			close(connection);
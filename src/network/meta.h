@@ -89,6 +89,11 @@ typedef struct __attribute__ ((packed)) {
 	chr_t name[128]; // Even though we limit folder names to 16 characters, with modified UTF-7 escaping, the string could be longer.
 	uint32_t order;
 	uint64_t parent, foldernum;
+
+	// Status counters, rebuilt whenever the folder is resequenced and adjusted in place when message flags change.
+	struct __attribute__ ((packed)) {
+		uint64_t messages, recent, unseen, uidnext;
+	} counts;
 } meta_folder_t;
 
 // All of a user's information is stored using this structure.
@@ -121,6 +126,12 @@ typedef struct __attribute__ ((packed)) {
 		pthread_mutex_t lock;
 	} refs;
 
+	// The sorted folder listings used to page through messages, which are rebuilt once the messages collection changes.
+	struct __attribute__ ((packed)) {
+		inx_t *sorted;
+		pthread_mutex_t lock;
+	} views;
+
 } meta_user_t;
 
 #endif
@@ -23,6 +23,40 @@ enum {
 	REVERSE_COMPLETE = 2
 };
 
+// The possible admission control decisions, ordered by severity.
+enum {
+	NET_ADMISSION_ADMIT = 0,
+	NET_ADMISSION_DELAY = 1,
+	NET_ADMISSION_TARPIT = 2,
+	NET_ADMISSION_REJECT = 3
+};
+
+// The admission control counts a connection was added to, which are the counts it must be removed from once it closes.
+enum {
+	NET_ADMISSION_HOST = 1,
+	NET_ADMISSION_SUBNET = 2
+};
+
+// The open connection count and token bucket for a remote host, or subnet, tracked by admission control.
+typedef struct net_admission_entry_t {
+	uint64_t hash; /* The murmur hash of the host or subnet. */
+	uint32_t active; /* The number of connections currently open. */
+	int64_t tokens; /* The connections remaining in the bucket, in thousandths of a connection. */
+	uint64_t stamp; /* When the bucket was last refilled, in monotonic milliseconds. */
+	struct net_admission_entry_t *newer, *older, *chain;
+} net_admission_entry_t;
+
+// A delayed or tarpitted socket waiting in the admission control holding area.
+typedef struct net_admission_held_t {
+	int sockd; /* The socket connection. */
+	bool_t admit; /* Whether the connection is processed, rather than closed, once it is released. */
+	int_t counted; /* The admission control counts which include the connection. */
+	ip_t *address; /* The remote host address. */
+	server_t *server; /* The server instance that accepted the connection. */
+	uint64_t release; /* When the socket should be released, in monotonic milliseconds. */
+	struct net_admission_held_t *next;
+} net_admission_held_t;
+
 typedef struct __attribute__ ((packed)) {
 	char *string;
 	size_t length;
@@ -30,7 +64,7 @@ typedef struct __attribute__ ((packed)) {
 } command_t;
 
 // Setup the structure of variables used to relay and bounce messages.
-typedef struct __attribute__ ((packed)) {
+typedef struct __attribute__ ((packed)) client_t {
 	ip_t *ip; /* The remote host address information. */
 	uint32_t port; /* The remote host port information. */
 	void *tls; /* The TLS connection object. */
@@ -61,6 +95,8 @@ typedef struct __attribute__ ((packed)) {
 		placer_t line; /* The current line being processed. */
 		stringer_t *buffer; /* The connection buffer. */
 
+		int_t admitted; /* The admission control counts which include the connection, as NET_ADMISSION_HOST and NET_ADMISSION_SUBNET flags. */
+
 		struct __attribute__ ((packed)) {
 			ip_t *ip;
 			int_t status;
@@ -89,13 +125,31 @@ uint64_t        con_decrement_refs(connection_t *con);
 void            con_destroy(connection_t *con);
 void            con_flush(connection_t *con);
 uint64_t        con_increment_refs(connection_t *con);
-connection_t *  con_init(int cond, server_t *server);
+connection_t *  con_init(int cond, server_t *server, ip_t *address);
 bool_t          con_init_network_buffer(connection_t *con);
 bool_t          con_localhost(connection_t *con);
 bool_t          con_private(connection_t *con);
 int_t           con_secure(connection_t *con);
 int_t           con_status(connection_t *con);
 
+/// admission.c
+bool_t                   net_admission_hold(server_t *server, int sockd, ip_t *address, bool_t admit, int_t counted);
+bool_t                   net_admission_start(void);
+bool_t                   net_admission_tracked(ip_t *address);
+int_t                    net_admission_charge(uint64_t hash, uint32_t connections, uint32_t rate, bool_t *counted);
+int_t                    net_admission_check(ip_t *address, int_t *counted);
+net_admission_entry_t *  net_admission_entry(uint32_t shard, uint64_t hash, uint64_t now, uint32_t rate);
+uint32_t                 net_admission_shard(uint64_t hash);
+uint64_t                 net_admission_hash(ip_t *address, bool_t subnet);
+void                     net_admission_accept(server_t *server, int sockd);
+void                     net_admission_finish(net_admission_held_t *held, bool_t process);
+void                     net_admission_push(uint32_t shard, net_admission_entry_t *entry);
+void                     net_admission_release(ip_t *address, int_t counted);
+void                     net_admission_stop(void);
+void                     net_admission_uncount(uint64_t hash);
+void                     net_admission_unlink(uint32_t shard, net_admission_entry_t *entry);
+void                     net_admission_worker(void);
+
 /// clients.c
 void        client_close(client_t *client);
 client_t *  client_connect(chr_t *host, uint32_t port);
@@ -104,6 +158,7 @@ int_t       client_status(client_t *client);
 
 /// options.c
 bool_t   net_set_buffer_length(int sd, int buffer_recv, int buffer_send);
+bool_t   net_set_cork(int sd, bool_t cork);
 bool_t   net_set_keepalive(int sd, bool_t keepalive, int_t idle, int_t interval, int_t tolerance);
 bool_t   net_set_linger(int sd, bool_t linger, int_t timeout);
 bool_t   net_set_nodelay(int sd, bool_t nodelay);
@@ -115,6 +170,9 @@ bool_t   net_set_timeout(int sd, uint32_t timeout_recv, uint32_t timeout_send);
 int64_t   client_read(client_t *client);
 int64_t   client_read_line(client_t *client);
 int64_t   con_read(connection_t *con);
+int64_t   con_read_bl(connection_t *con, void *block, size_t length);
+bool_t    con_read_leftover(connection_t *con);
+bool_t    con_read_pipelined(connection_t *con);
 int64_t   con_read_line(connection_t *con, bool_t block);
 
 /// reverse.c
@@ -138,6 +196,7 @@ int64_t   con_write_bl(connection_t *con, char *block, size_t length);
 int64_t   con_write_ns(connection_t *con, char *string);
 int64_t   con_write_pl(connection_t *con, placer_t string);
 int64_t   con_write_st(connection_t *con, stringer_t *string);
+int64_t   con_write_stuffed(connection_t *con, stringer_t *string);
 
 stringer_t * protocol_type(connection_t *con);
 
@@ -53,6 +53,25 @@ bool_t net_set_nodelay(int sd, bool_t nodelay) {
 	return true;
 }
 
+/**
+ * @brief	Set the cork flag for a socket, which holds back partial frames until the flag is cleared.
+ * @note	Clearing the flag immediately transmits any data being held, which is how a group of pipelined responses gets flushed.
+ * @param	sd		the socket descriptor to be adjusted.
+ * @param	cork	a boolean variable specifying whether output should be held (true) or sent immediately (false).
+ * @return	true if the flag was successfully set or false on failure.
+ */
+bool_t net_set_cork(int sd, bool_t cork) {
+
+	int_t val = (cork ? 1 : 0);
+
+	if (setsockopt(sd, IPPROTO_TCP, TCP_CORK, &val, sizeof(val)))  {
+		log_pedantic("Socket cork configuration failed. {%s}", errno_string(errno, bufptr, buflen));
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * @brief	Set the linger flag for a socket.
  * @param	sd		the socket descriptor to be adjusted.
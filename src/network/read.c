@@ -51,6 +51,15 @@ int64_t con_read_line(connection_t *con, bool_t block) {
 			return pl_length_get(con->network.line);
 		}
 
+	}
+	// Data left at the front of the buffer by con_read_bl() hasn't been processed yet, so check it for a complete line first.
+	else if (con_read_leftover(con)) {
+
+		if (!pl_empty((con->network.line = line_pl_st(con->network.buffer, 0)))) {
+			con->network.status = 1;
+			return pl_length_get(con->network.line);
+		}
+
 	}
 	// Otherwise reset the buffer and line lengths to zero.
 	else {
@@ -140,6 +149,12 @@ int64_t con_read(connection_t *con) {
 		}
 
 	}
+	// Data left at the front of the buffer by con_read_bl() hasn't been processed yet, so return it.
+	else if (con_read_leftover(con)) {
+		con->network.line = pl_null();
+		con->network.status = 1;
+		return st_length_get(con->network.buffer);
+	}
 	// Otherwise reset the buffer and line lengths to zero.
 	else {
 		st_length_set(con->network.buffer, 0);
@@ -184,6 +199,117 @@ int64_t con_read(connection_t *con) {
 	return st_length_get(con->network.buffer);
 }
 
+/**
+ * @brief	Determine whether the connection buffer holds data left over by a block read that hasn't been processed yet.
+ * @param	con		a pointer to the connection object to be checked.
+ * @return	true if unprocessed data is sitting at the front of the connection buffer, or false otherwise.
+ */
+bool_t con_read_leftover(connection_t *con) {
+
+	return !pl_length_get(con->network.line) && pl_char_get(con->network.line) && st_length_get(con->network.buffer) &&
+		pl_char_get(con->network.line) == st_char_get(con->network.buffer);
+}
+
+/**
+ * @brief	Determine whether another complete line of input is already waiting in the connection buffer, as it will be when a client
+ * 			pipelines its commands.
+ * @param	con		a pointer to the connection object to be checked.
+ * @return	true if a complete line follows the current line in the connection buffer, or false otherwise.
+ */
+bool_t con_read_pipelined(connection_t *con) {
+
+	size_t offset;
+
+	if (!con || !con->network.buffer || st_length_get(con->network.buffer) <= (offset = pl_length_get(con->network.line))) {
+		return false;
+	}
+
+	return !pl_empty(line_pl_bl(st_char_get(con->network.buffer) + offset, st_length_get(con->network.buffer) - offset, 0));
+}
+
+/**
+ * @brief	Read a block of data from a network connection directly into a caller supplied buffer.
+ * @note	Any data already sitting in the connection buffer past the current line is consumed first. Once that has been exhausted
+ * 			the read is issued against the socket using the caller's buffer, which avoids staging large payloads, like literals,
+ * 			through the connection buffer. The function never reads more than the requested length off the wire. Any buffered data
+ * 			left over is kept at the front of the connection buffer, marked by an empty line placer, so the next con_read_line() or
+ * 			con_read() call processes it instead of discarding it.
+ * @param	con		a pointer to the connection object from which the data will be read.
+ * @param	block	a pointer to the buffer that will receive the data.
+ * @param	length	the maximum number of bytes to read.
+ * @return	-1 on general failure, or the number of bytes that were stored in the block.
+ */
+int64_t con_read_bl(connection_t *con, void *block, size_t length) {
+
+	ssize_t bytes = 0;
+	int_t counter = 0;
+	size_t available = 0;
+
+	if (!con || !block || !length || con->network.sockd == -1 || con_status(con) < 0) {
+		if (con) con->network.status = -1;
+		return -1;
+	}
+
+	// Check for an existing network buffer. If there isn't one, try creating it.
+	else if (!con->network.buffer && !con_init_network_buffer(con)) {
+		con->network.status = -1;
+		return -1;
+	}
+
+	// Figure out how much unprocessed data is sitting past the current line.
+	if (st_length_get(con->network.buffer) > pl_length_get(con->network.line)) {
+		available = st_length_get(con->network.buffer) - pl_length_get(con->network.line);
+	}
+
+	// Serve the request from the connection buffer first.
+	if (available) {
+
+		if (available > length) {
+			available = length;
+		}
+
+		mm_copy(block, st_char_get(con->network.buffer) + pl_length_get(con->network.line), available);
+
+		// Shift whatever remains to the front of the buffer.
+		mm_move(st_data_get(con->network.buffer), st_char_get(con->network.buffer) + pl_length_get(con->network.line) + available,
+			st_length_get(con->network.buffer) - pl_length_get(con->network.line) - available);
+		st_length_set(con->network.buffer, st_length_get(con->network.buffer) - pl_length_get(con->network.line) - available);
+		con->network.line = pl_init(st_data_get(con->network.buffer), 0);
+		con->network.status = 1;
+
+		return available;
+	}
+
+	// The connection buffer is empty, so read straight into the supplied block.
+	st_length_set(con->network.buffer, 0);
+	con->network.line = pl_null();
+
+	do {
+
+		if (con->network.tls) {
+			bytes = tls_read(con->network.tls, block, length > INT_MAX ? INT_MAX : length, true);
+		}
+		else {
+			bytes = tcp_read(con->network.sockd, block, length > INT_MAX ? INT_MAX : length, true);
+		}
+
+		if (bytes == 0) {
+			usleep(1000);
+		}
+		else if (bytes < 0) {
+			con->network.status = -1;
+			return -1;
+		}
+
+	} while (!bytes && counter++ < 128 && status());
+
+	if (bytes > 0) {
+		con->network.status = 1;
+	}
+
+	return bytes;
+}
+
 /**
  * @brief	Read a line of input from a network client session.
  * @return	-1 on general failure, -2 if the connection was reset, or the length of the current line of input, including the trailing new line character.
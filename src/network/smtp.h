@@ -56,6 +56,93 @@ enum {
 	SMTP_OUTCOME_BOUNCE_RBL = 512
 };
 
+// The line states used while reading DATA.
+enum {
+	SMTP_DATA_LINE_START = 0,
+	SMTP_DATA_LINE_MIDDLE = 1,
+	SMTP_DATA_LINE_DOT = 2,
+	SMTP_DATA_LINE_DOT_CR = 3
+};
+
+// The content checks which can be run concurrently.
+enum {
+	SMTP_CONTENT_VIRUS = 0,
+	SMTP_CONTENT_DKIM = 1,
+	SMTP_CONTENT_CHECKS = 2
+};
+
+// The content checks being run concurrently for a single message. The message is copied, so a check which runs past its time budget
+// can finish after the session has moved on. The structure is freed by whoever drops the last reference.
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t complete;
+	uint32_t references; /* The waiting thread, plus each check that hasn't finished. */
+	stringer_t *id, *text; /* Private copies of the message id and the message. */
+	struct {
+		bool_t done;
+		int_t result;
+	} checks[SMTP_CONTENT_CHECKS];
+} smtp_content_t;
+
+// A content check waiting for a helper thread.
+typedef struct smtp_content_job_t {
+	int_t check; /* The check to run. */
+	smtp_content_t *content; /* The message being checked. */
+	struct smtp_content_job_t *next; /* The next job in the queue. */
+} smtp_content_job_t;
+
+// A greylist entry held in memory. The entry is identified by a hash of the memcached key, so every entry is the same size.
+typedef struct smtp_greylist_entry_t {
+	uint64_t hash; /* The murmur hash of the greylist key. */
+	uint64_t stamp, updated; /* When the sender was first seen, and when the memcached record was last refreshed. */
+	time_t synced; /* When the entry was last read from, or written to, memcached. */
+	struct smtp_greylist_entry_t *newer, *older, *chain;
+} smtp_greylist_entry_t;
+
+// A cached realtime blacklist verdict.
+typedef struct {
+	int_t result;
+	time_t expiration;
+} smtp_rbl_entry_t;
+
+// A cached content check verdict. Virus verdicts also record the generation of the signatures used to reach them.
+typedef struct {
+	int_t result;
+	uint64_t generation;
+	time_t expiration;
+} smtp_verdict_entry_t;
+
+// A connection to an outbound mail relay that can be returned to the pool and reused.
+typedef struct smtp_pooled_t {
+	struct client_t *client; /* The network client, which is NULL if the connection had to be dropped. */
+	uint32_t host; /* The index of the relay in magma.relay.host. */
+	bool_t pipelining; /* Whether the relay advertised support for command pipelining. */
+	time_t stamp; /* When the connection was returned to the pool. */
+	struct smtp_pooled_t *next; /* The next idle connection in the pool. */
+} smtp_pooled_t;
+
+// The relay response to a single recipient of a queued message.
+typedef struct {
+	int_t state; /* 1 if the recipient was accepted, -1 if it was temporarily rejected, -2 if it was permanently rejected, or 0 if unknown. */
+	stringer_t *reply; /* The relay response to the RCPT TO command. */
+} smtp_delivery_t;
+
+// An entry in the outbound delivery queue. The message itself stays on disk until a delivery attempt is made.
+typedef struct smtp_queued_t {
+	chr_t name[32]; /* The file name of the entry inside the queue directory. */
+	uint32_t attempts; /* The number of failed delivery attempts. */
+	time_t scheduled; /* When the next delivery attempt is due. */
+	struct smtp_queued_t *next; /* The next entry, in scheduled order. */
+} smtp_queued_t;
+
+// An account waiting for the rollout thread to bring its storage usage back under its quota.
+typedef struct smtp_rollout_t {
+	uint64_t usernum; /* The numerical id of the user. */
+	uint32_t attempts; /* The number of failed rollout attempts. */
+	time_t scheduled; /* When the next rollout attempt is due. */
+	struct smtp_rollout_t *next; /* The next account, in scheduled order. */
+} smtp_rollout_t;
+
 typedef struct {
 	placer_t to;
 	placer_t date;
@@ -92,6 +179,20 @@ typedef struct {
 	struct smtp_inbound_prefs_t *next;
 } smtp_inbound_prefs_t;
 
+// The cached inbound preferences for a recipient address.
+typedef struct {
+	uint64_t serial; /* The user serial number when the preferences were loaded. */
+	time_t expiration; /* When the cached preferences must be loaded again. */
+	stringer_t *signet; /* The binary form of the user's signet, or NULL if the account doesn't have one. */
+	smtp_inbound_prefs_t *prefs; /* The user specific portion of the preferences. */
+} smtp_prefs_entry_t;
+
+// A cached daily receive count, for a user or for a user and subnet pair.
+typedef struct {
+	uint64_t count; /* The number of messages received during the last day. */
+	time_t expiration; /* When the count must be read from the database again. */
+} smtp_receiving_entry_t;
+
 // The structure for storing recipient preferences on outbound data.
 typedef struct {
 	uint64_t usernum;
@@ -127,7 +228,14 @@ typedef struct {
 	smtp_inbound_prefs_t *in_prefs;
 	smtp_outbound_prefs_t *out_prefs;
 
+	// The message data received so far via BDAT, and whether a chunk of the current transaction has been rejected.
+	struct {
+		bool_t failed;
+		stringer_t *data;
+	} bdat;
+
 	bool_t bypass;
+	bool_t corked;
 
 } smtp_session_t;
 
@@ -101,6 +101,69 @@ int64_t con_write_pl(connection_t *con, placer_t string) {
 	return con_write_bl(con, pl_char_get(string), pl_length_get(string));
 }
 
+/**
+ * @brief	Write a managed string to a network connection, dot-stuffing any line that begins with a period as it goes.
+ * @note	The output is staged through a fixed size buffer, so a message of any size can be sent without allocating a stuffed copy.
+ * 			The caller is responsible for sending the terminating period.
+ * @see		con_write_bl()
+ * @param	con		the connection across which the supplied data will be written.
+ * @param	string	a managed string containing the data to be dot-stuffed and written to the connection's remote client.
+ * @return	-1 on general network failure, or the number of bytes, including any stuffed periods, that were written across the connection.
+ */
+int64_t con_write_stuffed(connection_t *con, stringer_t *string) {
+
+	int64_t written = 0;
+	chr_t buffer[8192], *block, *newline;
+	size_t length, chunk, used = 0;
+	bool_t start = true;
+
+	if (!con || con->network.sockd == -1 || con_status(con) < 0) {
+		return -1;
+	}
+	else if (st_empty(string)) {
+		return 0;
+	}
+
+	block = st_char_get(string);
+	length = st_length_get(string);
+
+	while (length) {
+
+		// Flush the buffer once there isn't enough room for a stuffed period and at least one byte of data.
+		if (sizeof(buffer) - used < 2) {
+			if (con_write_bl(con, buffer, used) != (int64_t)used) {
+				return -1;
+			}
+			written += used;
+			used = 0;
+		}
+
+		// Lines which begin with a period get an extra one.
+		if (start && *block == '.') {
+			buffer[used++] = '.';
+		}
+
+		// Copy through the end of the current line, or as much as will fit.
+		chunk = length < sizeof(buffer) - used ? length : sizeof(buffer) - used;
+
+		if ((newline = memchr(block, '\n', chunk))) {
+			chunk = newline - block + 1;
+		}
+
+		mm_copy(buffer + used, block, chunk);
+		start = (newline != NULL);
+		length -= chunk;
+		block += chunk;
+		used += chunk;
+	}
+
+	if (used && con_write_bl(con, buffer, used) != (int64_t)used) {
+		return -1;
+	}
+
+	return written + used;
+}
+
 /**
  * @brief	Write a formatted string to a network connection.
  * @see		con_write_bl()
@@ -117,6 +117,10 @@ void auth_data_update_lock(uint64_t usernum, auth_lock_status_t lock) {
 	if (stmt_exec_affected(stmts.auth_update_user_lock, parameters) != 1) {
 		log_pedantic("Unable to update the user lock. { usernum = %lu / lock = %hhu }", usernum, tiny);
 	}
+	// Invalidate any cached copies of the user's delivery settings.
+	else {
+		serial_increment(OBJECT_USER, usernum);
+	}
 
 	return;
 }
@@ -25,10 +25,23 @@ void mail_destroy_header(stringer_t *header) {
  * 			New lines are begun whenever the current length of any line reaches the configuration value set in magma.smtp.wrap_line_length.
  * 			The trailing dot at the end of the smtp DATA command is also stripped.
  * @note	If the original message ends with \r, it will have \n appended to it.
+ * @see		mail_message_cleanup_opts()
  * @param	message		a pointer to a managed string that contains the message input, and will also store the cleaned output on success.
  * @return	true on success or false on failure.
  */
 bool_t mail_message_cleanup(stringer_t **message) {
+	return mail_message_cleanup_opts(message, true);
+}
+
+/**
+ * @brief	Clean up the body of a message read in via smtp.
+ * @see		mail_message_cleanup()
+ * @param	message		a pointer to a managed string that contains the message input, and will also store the cleaned output on success.
+ * @param	dotstuffed	if true, the message was received via DATA, so dot-stuffed lines are unstuffed and the trailing dot is stripped;
+ * 						messages received via BDAT aren't dot-stuffed, so their lines are left untouched.
+ * @return	true on success or false on failure.
+ */
+bool_t mail_message_cleanup_opts(stringer_t **message, bool_t dotstuffed) {
 
 	chr_t *new, *orig;
 	stringer_t *output;
@@ -124,10 +137,10 @@ bool_t mail_message_cleanup(stringer_t **message) {
 				if (length - increment >= 12 && mm_cmp_ci_eq(orig, "Return-Path:", 12) == 0) {
 					skip = 1;
 				}
-				else if (length - increment >= 2 && *orig == '.' && (*(orig + 1) == '\r' || *(orig + 1) == '\n')) {
+				else if (dotstuffed && length - increment >= 2 && *orig == '.' && (*(orig + 1) == '\r' || *(orig + 1) == '\n')) {
 					skip = 1;
 				}
-				else if (length - increment >= 2 && *orig == '.' && *(orig + 1) == '.') {
+				else if (dotstuffed && length - increment >= 2 && *orig == '.' && *(orig + 1) == '.') {
 					skip = 2;
 				}
 				else if (skip != 0) {
@@ -146,10 +159,10 @@ bool_t mail_message_cleanup(stringer_t **message) {
 			// Now were just looking for dotstuffs.
 			if (next == 1 && *orig != '\n') {
 
-				if (length - increment >= 2 && *orig == '.' && (*(orig + 1) == '\r' || *(orig + 1) == '\n')) {
+				if (dotstuffed && length - increment >= 2 && *orig == '.' && (*(orig + 1) == '\r' || *(orig + 1) == '\n')) {
 					skip = 1;
 				}
-				else if (length - increment >= 2 && *orig == '.' && *(orig + 1) == '.') {
+				else if (dotstuffed && length - increment >= 2 && *orig == '.' && *(orig + 1) == '.') {
 					skip = 2;
 				}
 				else if (skip != 0) {
@@ -33,6 +33,34 @@ typedef struct {
 	size_t header_length;
 } mail_message_t;
 
+// The header fields held by a message summary, with the first ten in the order used by the IMAP envelope.
+enum {
+	MAIL_SUMMARY_DATE = 0,
+	MAIL_SUMMARY_SUBJECT = 1,
+	MAIL_SUMMARY_FROM = 2,
+	MAIL_SUMMARY_SENDER = 3,
+	MAIL_SUMMARY_REPLY_TO = 4,
+	MAIL_SUMMARY_TO = 5,
+	MAIL_SUMMARY_CC = 6,
+	MAIL_SUMMARY_BCC = 7,
+	MAIL_SUMMARY_IN_REPLY_TO = 8,
+	MAIL_SUMMARY_MESSAGE_ID = 9,
+	MAIL_SUMMARY_RETURN_PATH = 10,
+	MAIL_SUMMARY_FIELDS = 11
+};
+
+// The length recorded for a field which wasn't found in the message header.
+#define MAIL_SUMMARY_MISSING UINT32_MAX
+
+typedef struct mail_summary_t {
+	uint64_t messagenum; /* The numerical id of the message, so the least recently used summary can be removed from the cache. */
+	time_t expiration; /* When the summary will be removed from the cache. */
+	chr_t *label; /* The subject label which was present when the header was loaded, or NULL if the subject wasn't labeled. */
+	struct mail_summary_t *newer, *older; /* The neighbors of the summary on the least recently used list. */
+	uint32_t lengths[MAIL_SUMMARY_FIELDS]; /* The length of each field, or MAIL_SUMMARY_MISSING if the field wasn't found. */
+	chr_t data[]; /* The field values, stored one after another in order. */
+} mail_summary_t;
+
 typedef struct {
 	chr_t *extension;
 	bool_t bin;
@@ -51,6 +79,7 @@ void          mail_cache_thread_stop(void);
 /// cleanup.c
 void          mail_destroy_header(stringer_t *header);
 bool_t        mail_message_cleanup(stringer_t **message);
+bool_t        mail_message_cleanup_opts(stringer_t **message, bool_t dotstuffed);
 
 /// counters.c
 uint32_t      mail_count_received(stringer_t *message);
@@ -138,6 +167,24 @@ void          mail_signature_add(mail_message_t *message, server_t *server, uint
 uint64_t   mail_copy_message(uint64_t usernum, uint64_t original, chr_t *server, uint32_t size, uint64_t foldernum, uint32_t status, uint64_t signum, uint64_t sigkey, uint64_t created);
 int_t      mail_move_message(uint64_t usernum, uint64_t messagenum, uint64_t source, uint64_t target);
 uint64_t   mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernum, uint32_t *status, uint64_t signum, uint64_t sigkey, stringer_t *message);
+uint64_t   mail_store_message_transaction(uint64_t usernum, prime_t *signet, uint64_t foldernum, uint32_t *status, uint64_t signum, uint64_t sigkey, stringer_t *message, int64_t transaction, chr_t **pathptr);
+bool_t     mail_store_messages(uint64_t usernum, prime_t *signet, uint64_t foldernum, size_t count, uint32_t *status, stringer_t **messages, uint64_t *messagenums);
 bool_t     mail_store_message_data(uint64_t messagenum, uint8_t fflags, stringer_t *data, chr_t **pathptr);
 
+/// summary.c
+mail_summary_t *  mail_summary_build(stringer_t *header, chr_t *label);
+bool_t            mail_summary_copy(mail_summary_t *summary, chr_t *label, stringer_t **fields);
+void              mail_summary_duplicate(uint64_t original, uint64_t copy);
+bool_t            mail_summary_expired(mail_summary_t *summary, time_t *now);
+void              mail_summary_free(mail_summary_t *summary);
+bool_t            mail_summary_get(meta_message_t *meta, meta_user_t *user, server_t *server, stringer_t **fields);
+void              mail_summary_insert(uint64_t messagenum, mail_summary_t *summary);
+chr_t *           mail_summary_label(uint32_t status);
+void              mail_summary_prune(void);
+void              mail_summary_push(mail_summary_t *summary);
+void              mail_summary_set(uint64_t messagenum, stringer_t *message);
+bool_t            mail_summary_start(void);
+void              mail_summary_stop(void);
+void              mail_summary_unlink(mail_summary_t *summary);
+
 #endif
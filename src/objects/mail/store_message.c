@@ -89,27 +89,32 @@ bool_t mail_store_message_data(uint64_t messagenum, uint8_t flags, stringer_t *d
 }
 
 /**
- * @brief	Store a mail message, with its meta-information in the database, and the contents persisted to disk.
- * @note	The stored message is always compressed, but only encrypted if the user's public key is suppplied.
+ * @brief	Store a mail message as part of an existing database transaction.
+ * @note	The stored message is always compressed, but only encrypted if the user's public key is suppplied. The caller is responsible
+ * 			for committing or rolling back the transaction, and for removing the message file if the transaction is rolled back.
  * @param	usernum		the numerical id of the user to which the message belongs.
- * @param	pubkey		if not NULL, a public key that will be used to encrypt the message for the intended user.
+ * @param	signet		if not NULL, a public key that will be used to encrypt the message for the intended user.
  * @param	foldernum	the folder # that will contain the message.
  * @param	status		a pointer to the status flags value for the message, which will be updated if the message is to be encrypted.
  * @param	signum		the spam signature for the message.
  * @param	sigkey		the spam key for the message.
  * @param	message		a managed string containing the raw body of the message.
+ * @param	transaction	the id of the transaction the database record should be created in.
+ * @param	pathptr		the address of a pointer that will receive the path of the message file on success.
  * @return	0 on failure, or the newly inserted id of the message in the database on success.
  */
-uint64_t mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernum, uint32_t *status, uint64_t signum, uint64_t sigkey, stringer_t *message) {
+uint64_t mail_store_message_transaction(uint64_t usernum, prime_t *signet, uint64_t foldernum, uint32_t *status, uint64_t signum, uint64_t sigkey,
+	stringer_t *message, int64_t transaction, chr_t **pathptr) {
 
-	chr_t *path;
+	chr_t *path = NULL;
 	uint64_t messagenum;
 	bool_t store_result;
 	compress_t *reduced = NULL;
 	stringer_t *encrypted = NULL;
-	int64_t transaction = -1, result = 0;
 	uint8_t flags = 0;
 
+	*pathptr = NULL;
+
 	// Next, encrypt the message if necessary.
 	if (signet) {
 		if (!(encrypted = prime_message_encrypt(message, NULL, NULL, org_key, signet))) {
@@ -130,19 +135,9 @@ uint64_t mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernu
 		flags |= FMESSAGE_OPT_COMPRESSED;
 	}
 
-
-	// Begin the transaction.
-	if ((transaction = tran_start()) < 0) {
-		log_error("Could not start a transaction. { transaction = %li }", transaction);
-		compress_cleanup(reduced);
-		prime_cleanup(encrypted);
-		return 0;
-	}
-
 	// Insert a record into the database.
 	if ((messagenum = mail_db_insert_message(usernum, foldernum, *status, st_length_int(message), signum, sigkey, transaction)) == 0) {
 		log_pedantic("Could not create a record in the database. { mail_db_insert_message = 0 }");
-		tran_rollback(transaction);
 		compress_cleanup(reduced);
 		prime_cleanup(encrypted);
 		return 0;
@@ -158,7 +153,6 @@ uint64_t mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernu
 	// If the disk operation failed...
 	if (!store_result || !path) {
 		log_pedantic("Failed to store the user's message to disk.");
-		tran_rollback(transaction);
 
 		if (path) {
 			unlink(path);
@@ -168,6 +162,39 @@ uint64_t mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernu
 		return 0;
 	}
 
+	*pathptr = path;
+	return messagenum;
+}
+
+/**
+ * @brief	Store a mail message, with its meta-information in the database, and the contents persisted to disk.
+ * @note	The stored message is always compressed, but only encrypted if the user's public key is suppplied.
+ * @param	usernum		the numerical id of the user to which the message belongs.
+ * @param	pubkey		if not NULL, a public key that will be used to encrypt the message for the intended user.
+ * @param	foldernum	the folder # that will contain the message.
+ * @param	status		a pointer to the status flags value for the message, which will be updated if the message is to be encrypted.
+ * @param	signum		the spam signature for the message.
+ * @param	sigkey		the spam key for the message.
+ * @param	message		a managed string containing the raw body of the message.
+ * @return	0 on failure, or the newly inserted id of the message in the database on success.
+ */
+uint64_t mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernum, uint32_t *status, uint64_t signum, uint64_t sigkey, stringer_t *message) {
+
+	chr_t *path;
+	uint64_t messagenum;
+	int64_t transaction = -1, result = 0;
+
+	// Begin the transaction.
+	if ((transaction = tran_start()) < 0) {
+		log_error("Could not start a transaction. { transaction = %li }", transaction);
+		return 0;
+	}
+
+	if (!(messagenum = mail_store_message_transaction(usernum, signet, foldernum, status, signum, sigkey, message, transaction, &path))) {
+		tran_rollback(transaction);
+		return 0;
+	}
+
 	// Commit the transaction.
 	if ((result = tran_commit(transaction))) {
 		log_error("Could not commit the transaction. { commit = %li }", result);
@@ -177,9 +204,72 @@ uint64_t mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernu
 	}
 
 	ns_free(path);
+
+	// The summary of an encrypted message would hold its headers in plaintext, so it isn't cached.
+	if (!signet) {
+		mail_summary_set(messagenum, message);
+	}
+
 	return messagenum;
 }
 
+/**
+ * @brief	Store a batch of mail messages in a single transaction, so either every message is stored, or none of them are.
+ * @param	usernum		the numerical id of the user to which the messages belong.
+ * @param	signet		if not NULL, a public key that will be used to encrypt the messages for the intended user.
+ * @param	foldernum	the folder # that will contain the messages.
+ * @param	count		the number of messages in the batch.
+ * @param	status		an array of status flag values, one per message, which will be updated if the messages are encrypted.
+ * @param	messages	an array of managed strings holding the raw message bodies.
+ * @param	messagenums	an array that will receive the newly inserted message ids on success.
+ * @return	true if every message in the batch was stored, or false on failure.
+ */
+bool_t mail_store_messages(uint64_t usernum, prime_t *signet, uint64_t foldernum, size_t count, uint32_t *status, stringer_t **messages, uint64_t *messagenums) {
+
+	chr_t **paths;
+	size_t stored = 0;
+	int64_t transaction = -1, result = 0;
+
+	if (!count || !status || !messages || !messagenums) {
+		log_pedantic("An invalid message batch was passed in.");
+		return false;
+	}
+	else if (!(paths = mm_alloc(count * sizeof(chr_t *)))) {
+		log_pedantic("Unable to allocate %zu bytes for the message path list.", count * sizeof(chr_t *));
+		return false;
+	}
+
+	// Begin the transaction.
+	if ((transaction = tran_start()) < 0) {
+		log_error("Could not start a transaction. { transaction = %li }", transaction);
+		mm_free(paths);
+		return false;
+	}
+
+	while (stored < count && (messagenums[stored] = mail_store_message_transaction(usernum, signet, foldernum, &status[stored], 0, 0,
+		messages[stored], transaction, &paths[stored]))) {
+		stored++;
+	}
+
+	// Commit the transaction, but only if the entire batch made it to disk.
+	if (stored != count) {
+		tran_rollback(transaction);
+	}
+	else if ((result = tran_commit(transaction))) {
+		log_error("Could not commit the transaction. { commit = %li }", result);
+	}
+
+	// On failure the message files stored so far are orphans and need to be removed.
+	for (size_t i = 0; i < stored; i++) {
+		if (stored != count || result) unlink(paths[i]);
+		else if (!signet) mail_summary_set(messagenums[i], messages[i]);
+		ns_free(paths[i]);
+	}
+
+	mm_free(paths);
+	return (stored == count && !result);
+}
+
 /**
  * @brief	Create a copy of a mail message, with a new entry in the database and a hard link to the message contents on disk.
  * @param	usernum		the numerical id of the user to whom the mail message belongs.
@@ -266,6 +356,9 @@ uint64_t mail_copy_message(uint64_t usernum, uint64_t original, chr_t *server, u
 	ns_free(origpath);
 	ns_free(copypath);
 
+	// The copy shares the contents of the original, so it can share the summary as well.
+	mail_summary_duplicate(original, messagenum);
+
 	return messagenum;
 }
 
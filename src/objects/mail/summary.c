@@ -0,0 +1,435 @@
+
+/**
+ * @file /magma/objects/mail/summary.c
+ *
+ * @brief	An in memory cache of the header fields used to list messages, so a folder listing doesn't read every message from disk.
+ *
+ * A stored message never changes, so its summary stays valid for as long as the message number exists. Summaries are built when
+ * a message is delivered, or the first time its header is loaded, and hold the cleaned values of the fields needed by the portal
+ * message list and the IMAP envelope in a single allocation. The label added to the subject of a message that was marked as junk,
+ * infected, and so on, depends upon the current status of the message, so it is applied when a summary is read rather than stored.
+ *
+ * Once the cache holds magma.storage.summary_cache_limit summaries, the least recently used summary is removed to make room for
+ * a new one. Summaries of encrypted messages are never cached, so their plaintext headers don't outlive the request that decrypted
+ * them.
+ */
+
+#include "magma.h"
+
+inx_t *mail_summaries = NULL;
+
+// The least recently used list. A cache hit only holds the read lock, so the list has its own lock, which is always taken after
+// the cache lock.
+struct {
+	pthread_mutex_t lock;
+	mail_summary_t *newest, *oldest;
+} mail_summary_lru = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.newest = NULL,
+	.oldest = NULL
+};
+
+/**
+ * @brief	Add a summary to the front of the least recently used list.
+ * @note	The caller must hold the list lock, and the summary must not currently be on the list.
+ * @param	summary		the summary being added.
+ * @return	This function returns no value.
+ */
+void mail_summary_push(mail_summary_t *summary) {
+
+	summary->newer = NULL;
+	summary->older = mail_summary_lru.newest;
+
+	if (mail_summary_lru.newest) {
+		mail_summary_lru.newest->newer = summary;
+	}
+	else {
+		mail_summary_lru.oldest = summary;
+	}
+
+	mail_summary_lru.newest = summary;
+	return;
+}
+
+/**
+ * @brief	Remove a summary from the least recently used list.
+ * @note	The caller must hold the list lock.
+ * @param	summary		the summary being removed.
+ * @return	This function returns no value.
+ */
+void mail_summary_unlink(mail_summary_t *summary) {
+
+	if (summary->newer) summary->newer->older = summary->older;
+	else if (mail_summary_lru.newest == summary) mail_summary_lru.newest = summary->older;
+
+	if (summary->older) summary->older->newer = summary->newer;
+	else if (mail_summary_lru.oldest == summary) mail_summary_lru.oldest = summary->newer;
+
+	summary->newer = summary->older = NULL;
+	return;
+}
+
+/**
+ * @brief	Free a cached summary, after removing it from the least recently used list.
+ * @note	This is the free function of the cache index, so the list stays in sync however a summary leaves the cache.
+ * @param	summary		the summary being freed.
+ * @return	This function returns no value.
+ */
+void mail_summary_free(mail_summary_t *summary) {
+
+	if (summary) {
+		mutex_lock(&(mail_summary_lru.lock));
+		mail_summary_unlink(summary);
+		mutex_unlock(&(mail_summary_lru.lock));
+		mm_free(summary);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Get the label that mail_load_message() adds to the subject of a message with the given status.
+ * @param	status	the status flags of the message.
+ * @return	NULL if the subject isn't labeled, or a pointer to a null-terminated string containing the label.
+ */
+chr_t * mail_summary_label(uint32_t status) {
+
+	chr_t *result = NULL;
+
+	if ((status & MAIL_MARK_JUNK) == MAIL_MARK_JUNK) {
+		result = "JUNK:";
+	}
+	else if ((status & MAIL_MARK_INFECTED) == MAIL_MARK_INFECTED) {
+		result = "INFECTED:";
+	}
+	else if ((status & MAIL_MARK_SPOOFED) == MAIL_MARK_SPOOFED) {
+		result = "SPOOFED:";
+	}
+	else if ((status & MAIL_MARK_BLACKHOLED) == MAIL_MARK_BLACKHOLED) {
+		result = "BLACKHOLED:";
+	}
+	else if ((status & MAIL_MARK_PHISHING) == MAIL_MARK_PHISHING) {
+		result = "PHISHING:";
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Build the summary of a message header.
+ * @param	header	a managed string containing the message header.
+ * @param	label	the subject label already present in the header, or NULL if the header is unlabeled.
+ * @return	NULL on failure, or a pointer to a summary which the caller is responsible for freeing.
+ */
+mail_summary_t * mail_summary_build(stringer_t *header, chr_t *label) {
+
+	size_t total = 0;
+	chr_t *position;
+	mail_summary_t *summary;
+	stringer_t *fields[MAIL_SUMMARY_FIELDS];
+	chr_t *names[MAIL_SUMMARY_FIELDS] = {
+		"Date", "Subject", "From", "Sender", "Reply-To", "To", "Cc", "Bcc", "In-Reply-To", "Message-Id", "Return-Path"
+	};
+
+	for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) {
+		if ((fields[i] = mail_header_fetch_cleaned(header, NULLER(names[i])))) total += st_length_get(fields[i]);
+	}
+
+	if (!(summary = mm_alloc(sizeof(mail_summary_t) + total))) {
+		log_pedantic("Unable to allocate %zu bytes for a message summary.", sizeof(mail_summary_t) + total);
+		for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) st_cleanup(fields[i]);
+		return NULL;
+	}
+
+	summary->label = label;
+	summary->expiration = time(NULL) + magma.storage.summaries.cache;
+	position = summary->data;
+
+	// Missing fields are marked, rather than stored as empty values, since the IMAP envelope returns NIL for them.
+	for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) {
+		if (!st_empty(fields[i])) {
+			summary->lengths[i] = st_length_get(fields[i]);
+			mm_copy(position, st_data_get(fields[i]), st_length_get(fields[i]));
+			position += st_length_get(fields[i]);
+		}
+		else {
+			summary->lengths[i] = MAIL_SUMMARY_MISSING;
+		}
+		st_cleanup(fields[i]);
+	}
+
+	return summary;
+}
+
+/**
+ * @brief	Add a summary to the cache, replacing any existing summary for the same message.
+ * @note	If the cache is full, the least recently used summary is removed to make room.
+ * @param	messagenum	the numerical id of the message.
+ * @param	summary		the summary to be stored, which is freed if it can't be added to the cache.
+ * @return	This function returns no value.
+ */
+void mail_summary_insert(uint64_t messagenum, mail_summary_t *summary) {
+
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = messagenum }, oldest = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	summary->messagenum = messagenum;
+	summary->newer = summary->older = NULL;
+
+	inx_lock_write(mail_summaries);
+
+	while (inx_count(mail_summaries) >= magma.storage.summaries.cache_limit && !inx_find(mail_summaries, key)) {
+
+		mutex_lock(&(mail_summary_lru.lock));
+		oldest.val.u64 = mail_summary_lru.oldest ? mail_summary_lru.oldest->messagenum : 0;
+		mutex_unlock(&(mail_summary_lru.lock));
+
+		if (!oldest.val.u64 || !inx_delete(mail_summaries, oldest)) {
+			break;
+		}
+
+		stats_increment_by_name("objects.summaries.evicted");
+	}
+
+	if (inx_count(mail_summaries) >= magma.storage.summaries.cache_limit && !inx_find(mail_summaries, key)) {
+		mm_free(summary);
+	}
+	else if (!inx_replace(mail_summaries, key, summary)) {
+		mm_free(summary);
+	}
+	else {
+		mutex_lock(&(mail_summary_lru.lock));
+		mail_summary_push(summary);
+		mutex_unlock(&(mail_summary_lru.lock));
+	}
+
+	inx_unlock(mail_summaries);
+
+	return;
+}
+
+/**
+ * @brief	Copy the fields of a summary into managed strings, adding the subject label for the current message status.
+ * @param	summary		the summary being read.
+ * @param	label		the subject label for the current status of the message, or NULL for none.
+ * @param	fields		an array of MAIL_SUMMARY_FIELDS pointers which receive the field values, or NULL for missing fields.
+ * @return	true on success or false on failure.
+ */
+bool_t mail_summary_copy(mail_summary_t *summary, chr_t *label, stringer_t **fields) {
+
+	stringer_t *subject;
+	chr_t *position = summary->data;
+
+	for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) {
+
+		if (summary->lengths[i] == MAIL_SUMMARY_MISSING) {
+			fields[i] = NULL;
+		}
+		else if (!(fields[i] = st_import(position, summary->lengths[i]))) {
+			for (int_t j = 0; j < i; j++) st_cleanup(fields[j]);
+			return false;
+		}
+		else {
+			position += summary->lengths[i];
+		}
+	}
+
+	// Mirror the output of mail_mod_subject(), which inserts the label at the start of the subject, or adds a subject if missing.
+	if (label && label != summary->label) {
+
+		if (!(subject = st_merge("nns", label, !st_empty(fields[MAIL_SUMMARY_SUBJECT]) ? " " : "", fields[MAIL_SUMMARY_SUBJECT]))) {
+			for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) st_cleanup(fields[i]);
+			return false;
+		}
+
+		st_cleanup(fields[MAIL_SUMMARY_SUBJECT]);
+		fields[MAIL_SUMMARY_SUBJECT] = subject;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Get the listing fields of a message, using the cached summary when possible.
+ * @note	When the summary isn't cached, the message header is loaded, and the summary built from it is added to the cache. The
+ * 			summaries of encrypted messages are never cached.
+ * @param	meta	the meta message object of the requested message.
+ * @param	user	the meta user object of the user that owns the message.
+ * @param	server	the server object of the server handling the request.
+ * @param	fields	an array of MAIL_SUMMARY_FIELDS pointers, indexed by the MAIL_SUMMARY_* values, which receive the cleaned field
+ * 					values, or NULL for fields which were missing. The caller is responsible for freeing the values.
+ * @return	true on success or false on failure.
+ */
+bool_t mail_summary_get(meta_message_t *meta, meta_user_t *user, server_t *server, stringer_t **fields) {
+
+	bool_t result = false;
+	stringer_t *header;
+	mail_summary_t *summary;
+	chr_t *label = mail_summary_label(meta->status);
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = meta->messagenum };
+	bool_t cacheable = mail_summaries && (meta->status & MAIL_STATUS_ENCRYPTED) != MAIL_STATUS_ENCRYPTED;
+
+	if (cacheable) {
+
+		inx_lock_read(mail_summaries);
+
+		// A summary built with a different label than the current one can't be used, since the label can't be removed.
+		if ((summary = inx_find(mail_summaries, key)) && (!summary->label || summary->label == label) &&
+			(result = mail_summary_copy(summary, label, fields))) {
+			mutex_lock(&(mail_summary_lru.lock));
+			mail_summary_unlink(summary);
+			mail_summary_push(summary);
+			mutex_unlock(&(mail_summary_lru.lock));
+		}
+
+		inx_unlock(mail_summaries);
+
+		if (result) {
+			stats_increment_by_name("objects.summaries.cached");
+			return true;
+		}
+	}
+
+	if (!(header = mail_load_header(meta, user, server, true))) {
+		return false;
+	}
+	else if (!(summary = mail_summary_build(header, label))) {
+		st_free(header);
+		return false;
+	}
+
+	st_free(header);
+	result = mail_summary_copy(summary, label, fields);
+	stats_increment_by_name("objects.summaries.loaded");
+
+	if (cacheable) {
+		mail_summary_insert(meta->messagenum, summary);
+	}
+	else {
+		mm_free(summary);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Build and cache the summary of a message as it is stored, so it doesn't have to be read from disk when the message is listed.
+ * @note	The caller must not pass encrypted messages, since their summaries would hold plaintext headers.
+ * @param	messagenum	the numerical id of the stored message.
+ * @param	message		a managed string containing the message, exactly as it was stored.
+ * @return	This function returns no value.
+ */
+void mail_summary_set(uint64_t messagenum, stringer_t *message) {
+
+	size_t length;
+	mail_summary_t *summary;
+
+	if (!mail_summaries || !messagenum || !(length = mail_header_end(message))) {
+		return;
+	}
+	else if ((summary = mail_summary_build(PLACER(st_char_get(message), length), NULL))) {
+		mail_summary_insert(messagenum, summary);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Cache the summary of a message copy, using the summary of the original message.
+ * @param	original	the numerical id of the original message.
+ * @param	copy		the numerical id of the message copy.
+ * @return	This function returns no value.
+ */
+void mail_summary_duplicate(uint64_t original, uint64_t copy) {
+
+	size_t total = 0;
+	mail_summary_t *summary, *duplicate = NULL;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = original };
+
+	if (!mail_summaries) {
+		return;
+	}
+
+	inx_lock_read(mail_summaries);
+
+	if ((summary = inx_find(mail_summaries, key))) {
+
+		for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) {
+			if (summary->lengths[i] != MAIL_SUMMARY_MISSING) total += summary->lengths[i];
+		}
+
+		duplicate = mm_dupe(summary, sizeof(mail_summary_t) + total);
+	}
+
+	inx_unlock(mail_summaries);
+
+	if (duplicate) {
+		duplicate->expiration = time(NULL) + magma.storage.summaries.cache;
+		mail_summary_insert(copy, duplicate);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Determine whether a cached message summary has expired.
+ * @param	summary	a pointer to the message summary being examined.
+ * @param	now		a pointer to the current time.
+ * @return	true if the summary has expired, or false if it is still valid.
+ */
+bool_t mail_summary_expired(mail_summary_t *summary, time_t *now) {
+
+	return summary->expiration <= *now;
+}
+
+/**
+ * @brief	Remove the expired entries from the message summary cache.
+ * @note	This function is called periodically by the maintenance thread.
+ * @return	This function returns no value.
+ */
+void mail_summary_prune(void) {
+
+	time_t now;
+
+	if ((now = time(NULL)) == (time_t)(-1)) {
+		return;
+	}
+
+	if (mail_summaries) {
+		inx_lock_write(mail_summaries);
+		inx_prune(mail_summaries, (bool_t (*)(void *, void *))&mail_summary_expired, &now);
+		inx_unlock(mail_summaries);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Free the message summary cache at shutdown.
+ * @return	This function returns no value.
+ */
+void mail_summary_stop(void) {
+
+	if (mail_summaries) {
+		inx_free(mail_summaries);
+		mail_summaries = NULL;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Initialize the message summary cache.
+ * @return	true on success or false on failure.
+ */
+bool_t mail_summary_start(void) {
+
+	if (!magma.storage.summaries.cache) {
+		return true;
+	}
+	else if (!(mail_summaries = inx_alloc(M_INX_TREE | M_INX_LOCK_MANUAL, &mail_summary_free))) {
+		log_critical("Unable to initialize the message summary cache.");
+		return false;
+	}
+
+	return true;
+}
@@ -112,6 +112,34 @@ typedef struct __attribute__ ((packed)) {
 	uint8_t flags;
 } message_header_t;
 
+// The orders a folder listing can be sorted into.
+typedef enum {
+	META_SORT_DATE = 0,
+	META_SORT_SENDER = 1,
+	META_SORT_SUBJECT = 2,
+	META_SORT_SIZE = 3
+} META_SORT;
+
+typedef struct __attribute__ ((packed)) {
+	uint64_t messagenum; /* Kept apart from the message, so a stale view can be searched after its messages have been freed. */
+	uint64_t number; /* The creation date, or size, used to order the message. */
+	stringer_t *text; /* The folded sender, or subject, used to order the message. NULL when sorting by number. */
+	meta_message_t *message;
+	bool_t pending; /* Set while the sender, or subject, still has to be loaded. */
+} meta_view_entry_t;
+
+/***
+ * @struct meta_view_t
+ * @brief	A folder listing sorted into a single order, so a page of messages can be found without walking the whole collection.
+ */
+typedef struct __attribute__ ((packed)) {
+	META_SORT sort;
+	bool_t stale; /* Set when messages have moved between folders, which doesn't change the collection serial number. */
+	uint64_t foldernum, serial, count;
+	meta_view_entry_t *entries; /* The folder messages in sorted order. */
+	meta_view_entry_t **numbers; /* The same entries ordered by message number, so a message can be located using a binary search. */
+} meta_view_t;
+
 /// messages.c
 message_t *  message_alloc(uint64_t messagenum, uint64_t created, uint64_t signature, uint64_t key, uint64_t flags, stringer_t *server, size_t size);
 void         message_free(message_t *message);
@@ -119,14 +147,27 @@ inx_t *      messages_update(uint64_t usernum);
 
 /// meta.c
 meta_message_t *  meta_message_by_number(inx_t *messages, uint64_t number);
+bool_t            meta_message_counts_add(inx_t *folders, meta_message_t *message);
 meta_message_t *  meta_message_dupe(meta_message_t *message);
 void              meta_message_free(meta_message_t *message);
+void              meta_message_status_set(meta_folder_t *folder, meta_message_t *message, uint32_t status);
 bool_t            meta_messages_copier(meta_user_t *user, meta_message_t *message, uint64_t target, uint64_t *outnum, bool_t sequences, META_LOCK_STATUS locked);
 bool_t            meta_messages_login_update(meta_user_t *user, META_LOCK_STATUS locked);
 int_t             meta_messages_mover(meta_user_t *user, meta_message_t *message, uint64_t target, bool_t lookup, bool_t sequences, META_LOCK_STATUS locked);
 int_t             meta_messages_update(meta_user_t *user, META_LOCK_STATUS locked);
 void              meta_messages_update_sequences(inx_t *folders, inx_t *messages);
 
+/// views.c
+meta_view_t *  meta_view_build(meta_user_t *user, uint64_t foldernum, META_SORT sort, meta_view_t *previous);
+int_t          meta_view_compare(const void *compare, const void *entry);
+int_t          meta_view_compare_number(const void *compare, const void *entry);
+void           meta_view_free(meta_view_t *view);
+void           meta_view_load(meta_view_t *view, meta_user_t *user, server_t *server);
+int64_t        meta_view_position(meta_view_t *view, uint64_t messagenum);
+void           meta_view_sort(meta_view_t *view);
+void           meta_views_reset(meta_user_t *user);
+meta_view_t *  meta_views_get(meta_user_t *user, server_t *server, uint64_t foldernum, META_SORT sort);
+
 /// datatier.c
 bool_t   meta_data_fetch_folder_messages(uint64_t usernum, message_folder_t *folder);
 void     meta_data_fetch_message_tags(meta_message_t *message);
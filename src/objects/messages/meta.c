@@ -73,43 +73,164 @@ meta_message_t * meta_message_by_number(inx_t *messages, uint64_t number) {
 	return result;
 }
 
+/**
+ * @brief	Update the status flags of a message, and adjust the counters of its parent folder to match.
+ * @note	Every change to the recent or seen flags of a message that is already part of a user's messages collection should
+ * 			be routed through this function so the folder counters used by STATUS stay accurate without a rescan.
+ * @param	folder		a pointer to the meta folder object containing the message, or NULL if the folder isn't known.
+ * @param	message		a pointer to the meta message object being updated.
+ * @param	status		the new status flags for the message.
+ * @return	This function returns no value.
+ */
+void meta_message_status_set(meta_folder_t *folder, meta_message_t *message, uint32_t status) {
+
+	uint32_t before;
+
+	if (!message) {
+		return;
+	}
+
+	before = message->status;
+	message->status = status;
+
+	if (!folder || folder->foldernum != message->foldernum) {
+		return;
+	}
+
+	if ((before & MAIL_STATUS_RECENT) && !(status & MAIL_STATUS_RECENT) && folder->counts.recent) {
+		folder->counts.recent--;
+	}
+	else if (!(before & MAIL_STATUS_RECENT) && (status & MAIL_STATUS_RECENT)) {
+		folder->counts.recent++;
+	}
+
+	if (!(before & MAIL_STATUS_SEEN) && (status & MAIL_STATUS_SEEN) && folder->counts.unseen) {
+		folder->counts.unseen--;
+	}
+	else if ((before & MAIL_STATUS_SEEN) && !(status & MAIL_STATUS_SEEN)) {
+		folder->counts.unseen++;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Assign a sequence number to a message that was just added to a user's messages collection, and add it to the folder counters.
+ * @note	A message can only be sequenced in place when its number is above every message already held, which is always the case
+ * 			for a new message, since it will sort to the end of its folder. Otherwise nothing is changed, and the caller must
+ * 			resequence the whole collection using meta_messages_update_sequences().
+ * @param	folders		an inx holder containing all of the user's meta folder records.
+ * @param	message		a pointer to the meta message object that was added.
+ * @return	true if the message was sequenced and counted, or false if a full resequence is required.
+ */
+bool_t meta_message_counts_add(inx_t *folders, meta_message_t *message) {
+
+	uint64_t uidnext;
+	meta_folder_t *folder;
+	inx_cursor_t *cursor;
+
+	if (!folders || !message || !(folder = meta_folders_by_number(folders, message->foldernum)) ||
+		!(uidnext = meta_folders_uidnext(folders)) || message->messagenum < uidnext) {
+		return false;
+	}
+
+	message->sequencenum = ++folder->counts.messages;
+
+	if ((message->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
+		folder->counts.recent++;
+	}
+
+	if ((message->status & MAIL_STATUS_SEEN) != MAIL_STATUS_SEEN) {
+		folder->counts.unseen++;
+	}
+
+	// Message numbers are allocated globally, so every folder shares the same next UID.
+	if ((cursor = inx_cursor_alloc(folders))) {
+
+		while ((folder = inx_cursor_value_next(cursor))) {
+			folder->counts.uidnext = message->messagenum + 1;
+		}
+
+		inx_cursor_free(cursor);
+	}
+
+	return true;
+}
+
 /**
  * @brief	Update the sequence numbers of a series of messages, each re-indexed by their containing folder.
- * @note	All messages will be sequenced incrementally per folder, starting with a value of 1.
+ * @note	All messages will be sequenced incrementally per folder, starting with a value of 1. The folder status counters are
+ * 			rebuilt during the same pass, so this function costs a single walk of the messages collection.
  * @param	folders		an inx holder containing all of the user's meta folder records.
  * @param	messages	an inx folder containing all the messages to be re-sequenced.
  * @return	This function returns no value.
  */
 void meta_messages_update_sequences(inx_t *folders, inx_t *messages) {
 
-	uint64_t sequence;
+	inx_t *lookup;
+	uint64_t uidnext = 0;
 	meta_folder_t *folder;
 	meta_message_t *message;
 	inx_cursor_t *cursor_messages, *cursor_folders;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
 
 	if (!folders || !messages || !(cursor_folders = inx_cursor_alloc(folders))) {
 		return;
 	}
 
-	// Iterate through all of the messages for each folder and set their sequence number.
-	while ((folder = inx_cursor_value_next(cursor_folders)) && (sequence = 1)) {
+	// Build a temporary hash of the folders, and reset their counters.
+	else if (!(lookup = inx_alloc(M_INX_HASHED, NULL))) {
+		inx_cursor_free(cursor_folders);
+		return;
+	}
+
+	while ((folder = inx_cursor_value_next(cursor_folders))) {
+		mm_wipe(&(folder->counts), sizeof(folder->counts));
+		key.val.u64 = folder->foldernum;
+		inx_insert(lookup, key, folder);
+	}
+
+	inx_cursor_free(cursor_folders);
+
+	// Iterate through the messages once, setting each sequence number and tallying the folder counters.
+	if ((cursor_messages = inx_cursor_alloc(messages))) {
+
+		while ((message = inx_cursor_value_next(cursor_messages))) {
 
-		if ((cursor_messages = inx_cursor_alloc(messages))) {
+			key.val.u64 = message->foldernum;
 
-			while ((message = inx_cursor_value_next(cursor_messages))) {
+			if ((folder = inx_find(lookup, key))) {
 
-				if (message->foldernum == folder->foldernum) {
-					message->sequencenum = sequence++;
+				message->sequencenum = ++folder->counts.messages;
+
+				if ((message->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
+					folder->counts.recent++;
 				}
 
+				if ((message->status & MAIL_STATUS_SEEN) != MAIL_STATUS_SEEN) {
+					folder->counts.unseen++;
+				}
 			}
 
-			inx_cursor_free(cursor_messages);
+			if (message->messagenum > uidnext) {
+				uidnext = message->messagenum;
+			}
 		}
 
+		inx_cursor_free(cursor_messages);
 	}
 
-	inx_cursor_free(cursor_folders);
+	// Message numbers are allocated globally, so every folder shares the same next UID.
+	if ((cursor_folders = inx_cursor_alloc(folders))) {
+
+		while ((folder = inx_cursor_value_next(cursor_folders))) {
+			folder->counts.uidnext = uidnext + 1;
+		}
+
+		inx_cursor_free(cursor_folders);
+	}
+
+	inx_free(lookup);
 
 	return;
 }
@@ -289,8 +410,9 @@ bool_t meta_messages_copier(meta_user_t *user, meta_message_t *message, uint64_t
 		mm_free(new);
 	}
 
-	// If this operation is part of a much larger one we might want to wait until the end to update the message sequence numbers.
-	if (sequences) {
+	// The copy sorts to the end of its folder, so it can usually be sequenced in place. If this operation is part of a much larger
+	// one we might want to wait until the end to do a full resequence.
+	else if (!meta_message_counts_add(user->folders, new) && sequences) {
 		meta_messages_update_sequences(user->folders, user->messages);
 	}
 
@@ -357,6 +479,9 @@ int_t meta_messages_mover(meta_user_t *user, meta_message_t *message, uint64_t t
 	// New messages in a folder should be distinguished by the recent flag.
 	message->status |= MAIL_STATUS_RECENT;
 
+	// The message changed folders in place, so the sorted folder views won't notice the move on their own.
+	meta_views_reset(user);
+
 	// If this operation is part of a much larger one we might want to wait until the end to update the message sequence numbers.
 	if (sequences) {
 		meta_messages_update_sequences(user->folders, user->messages);
@@ -0,0 +1,361 @@
+
+/**
+ * @file /magma/objects/messages/views.c
+ *
+ * @brief	Sorted folder listings, which allow a page of messages to be found without walking a user's entire message collection.
+ *
+ * A view holds the messages of one folder in a single sort order, along with a second list of the same entries ordered by message
+ * number, so the position of any message can be found using a binary search. Views are built on demand, cached with the meta user
+ * object, and rebuilt the first time they are requested after the messages collection has changed. A rebuild starts from the
+ * previous view of the same folder and order, so only the headers of messages that weren't in the previous view are loaded.
+ */
+
+#include "magma.h"
+
+/**
+ * @brief	Free a sorted folder view.
+ * @param	view	the view to be freed.
+ * @return	This function returns no value.
+ */
+void meta_view_free(meta_view_t *view) {
+
+	if (view) {
+
+		if (view->entries) {
+			for (uint64_t i = 0; i < view->count; i++) {
+				st_cleanup(view->entries[i].text);
+			}
+			mm_free(view->entries);
+		}
+
+		if (view->numbers) {
+			mm_free(view->numbers);
+		}
+
+		mm_free(view);
+	}
+
+	return;
+}
+
+/**
+ * @brief	The qsort() comparison function used to order the entries of a sorted folder view.
+ * @note	Entries are ordered by their folded text, if any, then by their number, and then by message number, so every message
+ * 			has a fixed position, even when its sort value matches the value of another message.
+ * @param	compare		a pointer to the first view entry.
+ * @param	entry		a pointer to the second view entry.
+ * @return	an integer less than, equal to, or greater than zero if the first entry sorts before, with, or after the second entry.
+ */
+int_t meta_view_compare(const void *compare, const void *entry) {
+
+	int_t result;
+	size_t first, second;
+	meta_view_entry_t *cmp = (meta_view_entry_t *)compare, *ent = (meta_view_entry_t *)entry;
+
+	first = cmp->text ? st_length_get(cmp->text) : 0;
+	second = ent->text ? st_length_get(ent->text) : 0;
+
+	if (first && second && (result = memcmp(st_data_get(cmp->text), st_data_get(ent->text), first < second ? first : second))) {
+		return result;
+	}
+	else if (first != second) {
+		return first < second ? -1 : 1;
+	}
+	else if (cmp->number != ent->number) {
+		return cmp->number < ent->number ? -1 : 1;
+	}
+	else if (cmp->messagenum != ent->messagenum) {
+		return cmp->messagenum < ent->messagenum ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	The qsort() comparison function used to order a list of view entry pointers by message number.
+ * @param	compare		a pointer to the first view entry pointer.
+ * @param	entry		a pointer to the second view entry pointer.
+ * @return	an integer less than, equal to, or greater than zero if the first message number is less than, equal to, or greater than the second.
+ */
+int_t meta_view_compare_number(const void *compare, const void *entry) {
+
+	uint64_t first = (*(meta_view_entry_t **)compare)->messagenum, second = (*(meta_view_entry_t **)entry)->messagenum;
+
+	return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+/**
+ * @brief	Find the position of a message in a sorted folder view.
+ * @note	Only the message numbers held by the view are examined, so a stale view can still be searched.
+ * @param	view		the sorted folder view to be searched.
+ * @param	messagenum	the numerical id of the message.
+ * @return	-1 if the message isn't part of the view, or the index of the message in the sorted entries.
+ */
+int64_t meta_view_position(meta_view_t *view, uint64_t messagenum) {
+
+	uint64_t low = 0, high, middle;
+
+	if (!view || !view->numbers) {
+		return -1;
+	}
+
+	high = view->count;
+
+	while (low < high) {
+
+		middle = low + ((high - low) / 2);
+
+		if (view->numbers[middle]->messagenum < messagenum) {
+			low = middle + 1;
+		}
+		else if (view->numbers[middle]->messagenum > messagenum) {
+			high = middle;
+		}
+		else {
+			return view->numbers[middle] - view->entries;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * @brief	Collect the messages of a folder into an unsorted view.
+ * @note	Sorting by sender or subject needs a field from the header of every message. The folded field is copied from the
+ * 			previous view when it held the same message, since a stored message never changes, and any other entry is marked as
+ * 			pending, so its header can be loaded by meta_view_load() without holding the views lock. The caller must hold the
+ * 			views lock, and at least a read lock on the meta user object.
+ * @param	user		the meta user object that owns the messages.
+ * @param	foldernum	the numerical id of the folder.
+ * @param	sort		the order the messages should be sorted into.
+ * @param	previous	the previous view of the same folder and order, or NULL if there isn't one.
+ * @return	NULL on failure, or a pointer to the new view, which the caller is responsible for freeing.
+ */
+meta_view_t * meta_view_build(meta_user_t *user, uint64_t foldernum, META_SORT sort, meta_view_t *previous) {
+
+	int64_t position;
+	uint64_t count = 0;
+	meta_view_t *view;
+	inx_cursor_t *cursor;
+	meta_message_t *active;
+	meta_view_entry_t *entry;
+
+	if (!(view = mm_alloc(sizeof(meta_view_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for a sorted folder view.", sizeof(meta_view_t));
+		return NULL;
+	}
+
+	view->sort = sort;
+	view->foldernum = foldernum;
+	view->serial = inx_serial(user->messages);
+
+	if (!(cursor = inx_cursor_alloc(user->messages))) {
+		meta_view_free(view);
+		return NULL;
+	}
+
+	// Count the folder messages first, so the entries can be held in a single allocation.
+	while ((active = inx_cursor_value_next(cursor))) {
+		if (active->foldernum == foldernum) count++;
+	}
+
+	if (!count) {
+		inx_cursor_free(cursor);
+		return view;
+	}
+	else if (!(view->entries = mm_alloc(sizeof(meta_view_entry_t) * count)) || !(view->numbers = mm_alloc(sizeof(meta_view_entry_t *) * count))) {
+		log_pedantic("Unable to allocate the entries of a sorted folder view. { count = %lu }", count);
+		inx_cursor_free(cursor);
+		meta_view_free(view);
+		return NULL;
+	}
+
+	inx_cursor_reset(cursor);
+
+	while ((active = inx_cursor_value_next(cursor)) && view->count < count) {
+
+		if (active->foldernum != foldernum) {
+			continue;
+		}
+
+		entry = &(view->entries[view->count++]);
+		entry->message = active;
+		entry->messagenum = active->messagenum;
+		entry->number = sort == META_SORT_SIZE ? active->size : active->created;
+
+		if (sort != META_SORT_SENDER && sort != META_SORT_SUBJECT) {
+			continue;
+		}
+		else if ((position = meta_view_position(previous, active->messagenum)) >= 0) {
+			entry->text = previous->entries[position].text ? st_dupe(previous->entries[position].text) : NULL;
+			entry->pending = previous->entries[position].pending;
+		}
+		else {
+			entry->pending = true;
+		}
+	}
+
+	inx_cursor_free(cursor);
+
+	return view;
+}
+
+/**
+ * @brief	Load the sender, or subject, of every pending entry in a view.
+ * @note	The headers are taken from the message summary cache when possible. A message whose header can't be loaded is sorted as
+ * 			though the field were empty. The caller must hold at least a read lock on the meta user object, but not the views lock.
+ * @param	view		the view being loaded.
+ * @param	user		the meta user object that owns the messages.
+ * @param	server		the server object used to load message headers, which may be NULL when sorting by date or size.
+ * @return	This function returns no value.
+ */
+void meta_view_load(meta_view_t *view, meta_user_t *user, server_t *server) {
+
+	meta_view_entry_t *entry;
+	stringer_t *fields[MAIL_SUMMARY_FIELDS];
+
+	for (uint64_t i = 0; i < view->count; i++) {
+
+		if (!(entry = &(view->entries[i]))->pending) {
+			continue;
+		}
+
+		entry->pending = false;
+
+		// The text sorts are case insensitive, so the field is folded once here, instead of every time it gets compared.
+		if (mail_summary_get(entry->message, user, server, fields)) {
+
+			if (view->sort == META_SORT_SENDER && !st_empty(fields[MAIL_SUMMARY_FROM])) {
+				entry->text = lower_st(fields[MAIL_SUMMARY_FROM]);
+				fields[MAIL_SUMMARY_FROM] = NULL;
+			}
+			else if (view->sort == META_SORT_SUBJECT && !st_empty(fields[MAIL_SUMMARY_SUBJECT])) {
+				entry->text = lower_st(fields[MAIL_SUMMARY_SUBJECT]);
+				fields[MAIL_SUMMARY_SUBJECT] = NULL;
+			}
+
+			for (int_t j = 0; j < MAIL_SUMMARY_FIELDS; j++) {
+				st_cleanup(fields[j]);
+			}
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief	Sort the entries of a view, and build the list of entries ordered by message number.
+ * @param	view	the view being sorted.
+ * @return	This function returns no value.
+ */
+void meta_view_sort(meta_view_t *view) {
+
+	if (!view->count) {
+		return;
+	}
+
+	qsort(view->entries, view->count, sizeof(meta_view_entry_t), &meta_view_compare);
+
+	// The message number list is built from the sorted entries, since sorting moves them.
+	for (uint64_t i = 0; i < view->count; i++) {
+		view->numbers[i] = &(view->entries[i]);
+	}
+
+	qsort(view->numbers, view->count, sizeof(meta_view_entry_t *), &meta_view_compare_number);
+
+	return;
+}
+
+/**
+ * @brief	Get a sorted view of the messages in a folder, building it if there isn't a current view cached with the user.
+ * @note	The caller must hold at least a read lock on the meta user object for as long as it uses the view. A view only
+ * 			becomes stale, and is replaced, after its messages have been changed under a write lock. The views lock is released
+ * 			while message headers are loaded, so if another request finishes the same view first, its copy is used instead.
+ * @param	user		the meta user object that owns the messages.
+ * @param	server		the server object used to load message headers, which may be NULL when sorting by date or size.
+ * @param	foldernum	the numerical id of the folder.
+ * @param	sort		the order the messages should be sorted into.
+ * @return	NULL on failure, or a pointer to the sorted view, which remains owned by the meta user object.
+ */
+meta_view_t * meta_views_get(meta_user_t *user, server_t *server, uint64_t foldernum, META_SORT sort) {
+
+	meta_view_t *view = NULL, *cached;
+
+	// The view key combines the folder number with one of the four sort orders.
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = (foldernum << 2) | sort };
+
+	if (!user || !user->messages) {
+		return NULL;
+	}
+
+	mutex_lock(&(user->views.lock));
+
+	if (!user->views.sorted && !(user->views.sorted = inx_alloc(M_INX_TREE | M_INX_LOCK_MANUAL, &meta_view_free))) {
+		log_pedantic("Unable to allocate the sorted folder view cache.");
+		mutex_unlock(&(user->views.lock));
+		return NULL;
+	}
+
+	// Every insert, or removal, increments the serial number of the messages collection, which makes the existing views stale.
+	if ((cached = inx_find(user->views.sorted, key)) && !cached->stale && cached->serial == inx_serial(user->messages)) {
+		mutex_unlock(&(user->views.lock));
+		return cached;
+	}
+	else if (!(view = meta_view_build(user, foldernum, sort, cached))) {
+		mutex_unlock(&(user->views.lock));
+		return NULL;
+	}
+
+	mutex_unlock(&(user->views.lock));
+
+	// Loading headers can mean a disk read per message, so it happens without holding the views lock.
+	meta_view_load(view, user, server);
+	meta_view_sort(view);
+
+	mutex_lock(&(user->views.lock));
+
+	if ((cached = inx_find(user->views.sorted, key)) && !cached->stale && cached->serial == view->serial) {
+		meta_view_free(view);
+		view = cached;
+	}
+	else if (!inx_replace(user->views.sorted, key, view)) {
+		log_pedantic("Unable to cache the sorted folder view. { foldernum = %lu }", foldernum);
+		meta_view_free(view);
+		view = NULL;
+	}
+
+	mutex_unlock(&(user->views.lock));
+
+	return view;
+}
+
+/**
+ * @brief	Mark all of a user's sorted folder views as stale.
+ * @note	This must be called whenever a message moves between folders without being removed from, and added back to, the
+ * 			messages collection, since the move doesn't change the collection serial number. The views are kept, so their
+ * 			sort values can be reused when they are rebuilt.
+ * @param	user	the meta user object whose views will be marked.
+ * @return	This function returns no value.
+ */
+void meta_views_reset(meta_user_t *user) {
+
+	meta_view_t *view;
+	inx_cursor_t *cursor;
+
+	if (user) {
+		mutex_lock(&(user->views.lock));
+
+		if (user->views.sorted && (cursor = inx_cursor_alloc(user->views.sorted))) {
+
+			while ((view = inx_cursor_value_next(cursor))) {
+				view->stale = true;
+			}
+
+			inx_cursor_free(cursor);
+		}
+
+		mutex_unlock(&(user->views.lock));
+	}
+
+	return;
+}
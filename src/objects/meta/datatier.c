@@ -421,6 +421,9 @@ int_t meta_data_insert_keys(uint64_t usernum, stringer_t *username, key_pair_t *
 		return 1;
 	}
 
+	// The signet is part of the user's inbound delivery settings, so any cached copies are invalidated.
+	serial_increment(OBJECT_USER, usernum);
+
 	st_cleanup(public, private);
 	return 0;
 }
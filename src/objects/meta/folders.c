@@ -198,6 +198,36 @@ meta_folder_t * meta_folders_by_number(inx_t *folders, uint64_t number) {
 	return result;
 }
 
+/**
+ * @brief	Get the next UID shared by a user's folders.
+ * @note	Message numbers are allocated globally, so every folder carries the same next UID, and a newly created folder should
+ * 			start with the value already held by its siblings, instead of an empty counter.
+ * @param	folders		a pointer to an inx holder containing the user's folders.
+ * @return	the largest next UID held by any of the folders, or 0 if the folder counters haven't been built.
+ */
+uint64_t meta_folders_uidnext(inx_t *folders) {
+
+	uint64_t result = 0;
+	inx_cursor_t *cursor;
+	meta_folder_t *active;
+
+	if (!folders || !(cursor = inx_cursor_alloc(folders))) {
+		return 0;
+	}
+
+	while ((active = inx_cursor_value_next(cursor))) {
+
+		if (active->counts.uidnext > result) {
+			result = active->counts.uidnext;
+		}
+
+	}
+
+	inx_cursor_free(cursor);
+
+	return result;
+}
+
 /**
  * @brief	Get the number of direct child folders of a specified parent folder.
  * @param	folders		a pointer to an inx holder containing the the collection of folders to be traversed.
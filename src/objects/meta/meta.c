@@ -26,12 +26,14 @@ void meta_free(meta_user_t *user) {
 		inx_cleanup(user->message_folders);
 		inx_cleanup(user->messages);
 		inx_cleanup(user->contacts);
+		inx_cleanup(user->views.sorted);
 
 		st_cleanup(user->username, user->verification, user->realm.mail);
 
 		// When read/write locking issues have been fixed, this line can be used once again.
 		rwlock_destroy(&(user->lock));
 		mutex_destroy(&(user->refs.lock));
+		mutex_destroy(&(user->views.lock));
 
 		mm_free(user);
 	}
@@ -85,6 +87,14 @@ meta_user_t * meta_alloc(void) {
 		mm_free(user);
 		return NULL;
 	}
+	else if (mutex_init(&(user->views.lock), NULL) != 0) {
+		log_pedantic("Unable to initialize the user views lock.");
+		mutex_destroy(&(user->refs.lock));
+		rwlock_destroy(&(user->lock));
+		rwlock_attr_destroy(&attr);
+		mm_free(user);
+		return NULL;
+	}
 
 	rwlock_attr_destroy(&attr);
 
@@ -28,6 +28,7 @@ meta_folder_t *     meta_folders_by_number(inx_t *folders, uint64_t number);
 int_t               meta_folders_children(inx_t *folders, uint64_t number);
 stringer_t *        meta_folders_name(inx_t *list, meta_folder_t *folder);
 inx_t *             meta_folders_stats_tags(inx_t *messages, uint64_t folder);
+uint64_t            meta_folders_uidnext(inx_t *folders);
 
 /// serials.c
 bool_t     meta_user_serial_check(meta_user_t *user, uint64_t object);
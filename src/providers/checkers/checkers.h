@@ -29,6 +29,42 @@ enum {
 	FOREIGN = 1
 };
 
+// A reference counted ClamAV engine context, so a replaced engine is only freed after the scans using it have finished.
+typedef struct {
+	uint64_t references;
+	struct cl_engine *context;
+} virus_engine_t;
+
+// A spam signature waiting to be trained by the background thread.
+typedef struct dspam_training_t {
+	uint64_t usernum; /* The numerical id of the user who owns the signature. */
+	uint64_t signum; /* The numerical id of the signature. */
+	int_t disposition; /* The current classification, where 0 means the signature will be trained as junk. */
+	bool_t cancelled; /* Set when a later request for the opposite correction cancels this one. */
+	stringer_t *signature; /* The signature data. */
+	struct dspam_training_t *next; /* The next request, in the order they were received. */
+} dspam_training_t;
+
+// A selector key record answer held in the DKIM cache. The packet is stored in the same allocation, after the structure.
+typedef struct {
+	time_t expiration; /* When the answer expires, based on the record time to live. */
+	size_t length; /* The length of the answer packet. */
+	uchr_t *packet; /* The answer packet. */
+} dkim_record_t;
+
+// The result of a DKIM key record query, which is complete by the time the dkim library waits for it.
+typedef struct {
+	int_t error; /* The error code, if the query failed. */
+	size_t length; /* The length of the answer packet. */
+} dkim_lookup_t;
+
+// The cached outcome of an SPF check for a client address and sender domain.
+typedef struct {
+	time_t expiration; /* When the outcome expires. */
+	int_t result; /* The value returned by spf_check(). */
+	chr_t *statistic; /* The statistic the outcome was reported under. */
+} spf_entry_t;
+
 /// clamav.c
 bool_t lib_load_clamav(void);
 bool_t virus_start(void);
@@ -36,16 +72,29 @@ const char * lib_version_clamav(void);
 int virus_engine_refresh(void);
 int virus_check(stringer_t *data);
 struct cl_engine * virus_engine_create(uint64_t *signatures);
+uint64_t virus_engine_generation(void);
 uint64_t virus_sigs_loaded(void);
 uint64_t virus_sigs_total(void);
+virus_engine_t * virus_engine_acquire(void);
 void virus_engine_destroy(struct cl_engine **target);
+void virus_engine_release(virus_engine_t *engine);
 void virus_stop(void);
 
 /// dkim.c
+int             dkim_records_cancel(void *service, void *handle);
+int             dkim_records_init(void **service);
+int             dkim_records_start(void *service, int type, uchr_t *query, uchr_t *buffer, size_t size, void **handle);
+int             dkim_records_wait(void *service, void *handle, struct timeval *timeout, size_t *bytes, int *error, int *dnssec);
 int_t           dkim_signature_verify(stringer_t *id, stringer_t *message);
+size_t          dkim_records_get(chr_t *query, int_t type, uchr_t *buffer, size_t size);
 stringer_t *    dkim_signature_create(stringer_t *id, stringer_t *domain, stringer_t *message);
+uint32_t        dkim_records_ttl(uchr_t *packet, size_t length);
 void *          dkim_memory_alloc(void *closure, size_t nbytes);
 void            dkim_memory_free(void *closure, void *ptr);
+bool_t          dkim_records_expired(dkim_record_t *record, time_t *now);
+void            dkim_records_close(void *service);
+void            dkim_records_prune(void);
+void            dkim_records_set(chr_t *query, int_t type, uchr_t *packet, size_t length);
 bool_t          dkim_start(void);
 void            dkim_stop(void);
 bool_t          lib_load_dkim(void);
@@ -56,14 +105,32 @@ int_t    dspam_check(uint64_t usernum, stringer_t *message, stringer_t **signatu
 bool_t   dspam_start(void);
 void     dspam_stop(void);
 bool_t   dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature);
+uint32_t dspam_train_batch(uint64_t usernum, uint32_t count, int_t *dispositions, stringer_t **signatures);
+bool_t   dspam_train_signature(uint32_t connection, chr_t *unum, stringer_t *tmpdir, int_t disposition, stringer_t *signature);
 bool_t   lib_load_dspam(void);
 chr_t *  lib_version_dspam(void);
 
+/// training.c
+bool_t    dspam_training_add(uint64_t usernum, uint64_t signum, int_t disposition, stringer_t *signature);
+void      dspam_training_free(dspam_training_t *request);
+bool_t    dspam_training_journal(dspam_training_t *request, bool_t completed);
+uint32_t  dspam_training_next(dspam_training_t **batch);
+void      dspam_training_push(dspam_training_t *request, bool_t journal);
+bool_t    dspam_training_replay(void);
+bool_t    dspam_training_start(void);
+void      dspam_training_stop(void);
+void      dspam_training_worker(void);
+
 /// spf.c
 bool_t lib_load_spf(void);
 const chr_t * lib_version_spf(void);
 bool_t spf_start(void);
+int_t spf_cache_get(ip_t *addr, stringer_t *domain, chr_t **statistic);
 int_t spf_check(void *ip, stringer_t *helo, stringer_t *mailfrom);
+stringer_t * spf_cache_key(ip_t *addr, stringer_t *domain);
+bool_t spf_cache_expired(spf_entry_t *entry, time_t *now);
+void spf_cache_prune(void);
+void spf_cache_set(ip_t *addr, stringer_t *domain, int_t result, chr_t *statistic);
 void spf_stop(void);
 
 #endif
@@ -23,14 +23,20 @@ struct cl_stat virus_stat;
 unsigned int virus_sigs = 0;
 
 /**
- * The virus engine context pointer.
+ * The generation of the virus engine, which is incremented every time the engine is replaced with one using newer signatures. It
+ * starts at one, so zero can never match a valid generation.
  */
-struct cl_engine *virus_engine = NULL;
+uint64_t virus_generation = 1;
 
 /**
- * The virus engine read/write lock.
+ * The active virus engine. Scans take a reference, so a replaced engine stays valid until the last scan using it finishes.
  */
-pthread_rwlock_t virus_lock =	PTHREAD_RWLOCK_INITIALIZER;
+virus_engine_t *virus_engine = NULL;
+
+/**
+ * The virus engine lock, which protects the active engine pointer and the reference counts. It is never held during a scan.
+ */
+pthread_mutex_t virus_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
  * @brief	Get the number of virus signatures loaded by the ClamAV engine context.
@@ -40,13 +46,29 @@ uint64_t virus_sigs_loaded(void) {
 
 	uint64_t loaded = 0;
 
-	pthread_rwlock_rdlock(&virus_lock);
+	mutex_lock(&virus_lock);
 	loaded = virus_sigs;
-	pthread_rwlock_unlock(&virus_lock);
+	mutex_unlock(&virus_lock);
 
 	return loaded;
 }
 
+/**
+ * @brief	Get the generation of the ClamAV engine context, which changes every time new signatures are loaded.
+ * @note	Callers which remember scan results should discard any result recorded using a different generation.
+ * @return	the generation of the ClamAV engine context.
+ */
+uint64_t virus_engine_generation(void) {
+
+	uint64_t generation = 0;
+
+	mutex_lock(&virus_lock);
+	generation = virus_generation;
+	mutex_unlock(&virus_lock);
+
+	return generation;
+}
+
 /**
  * @brief	Get the number of official signatures available inside the ClamAV signature directory.
  * @see		magma.iface.virus.signatures
@@ -77,6 +99,49 @@ void virus_engine_destroy(struct cl_engine **target) {
 	return;
 }
 
+/**
+ * @brief	Take a reference to the active virus engine, so it can be used for a scan without holding the virus engine lock.
+ * @return	NULL if no engine is available, or a pointer to the active engine, which must be returned using virus_engine_release().
+ */
+virus_engine_t * virus_engine_acquire(void) {
+
+	virus_engine_t *engine;
+
+	mutex_lock(&virus_lock);
+	if ((engine = virus_engine)) {
+		engine->references++;
+	}
+	mutex_unlock(&virus_lock);
+
+	return engine;
+}
+
+/**
+ * @brief	Release a reference to a virus engine, and free the engine if it has been replaced and this was the last reference.
+ * @param	engine	a pointer to the virus engine being released.
+ * @return	This function returns no value.
+ */
+void virus_engine_release(virus_engine_t *engine) {
+
+	bool_t last;
+
+	if (!engine) {
+		return;
+	}
+
+	mutex_lock(&virus_lock);
+	last = (--(engine->references) == 0);
+	mutex_unlock(&virus_lock);
+
+	// The engine is freed outside of the lock, so scans using the active engine aren't held up.
+	if (last) {
+		virus_engine_destroy(&(engine->context));
+		mm_free(engine);
+	}
+
+	return;
+}
+
 /**
  * Generates a new ClamAV engine context.
  *
@@ -221,13 +286,18 @@ bool_t virus_start(void) {
 	mm_wipe(&virus_stat, sizeof(struct cl_stat));
 	cl_statinidir_d(magma.iface.virus.signatures, &virus_stat);
 
-	if ((virus_engine = virus_engine_create(&loaded)) == NULL) {
+	if (!(virus_engine = mm_alloc(sizeof(virus_engine_t))) || !(virus_engine->context = virus_engine_create(&loaded))) {
 		log_critical("Failed to construct a new ClamAV engine context.");
 		stats_increment_by_name("provider.virus.error");
 		cl_statfree_d(&virus_stat);
+		mm_cleanup(virus_engine);
+		virus_engine = NULL;
 		return false;
 	}
 
+	// The active engine holds a reference of its own, which is only released when the engine is replaced.
+	virus_engine->references = 1;
+
 	// Record the number of signatures loaded.
 	virus_sigs = loaded;
 
@@ -251,17 +321,21 @@ bool_t virus_start(void) {
  */
 void virus_stop(void) {
 
+	virus_engine_t *original;
+
 	// If we are not supposed to be scanning messages. So don't free the engine.
 	if (!magma.iface.virus.available) {
 		return;
 	}
 
-	// Frees the engine context.
-	if (virus_engine) {
-		virus_engine_destroy(&virus_engine);
-		virus_engine = NULL;
-		virus_sigs = 0;
-	}
+	// Release the active engine, which will be freed once any scans still using it are finished.
+	mutex_lock(&virus_lock);
+	original = virus_engine;
+	virus_engine = NULL;
+	virus_sigs = 0;
+	mutex_unlock(&virus_lock);
+
+	virus_engine_release(original);
 
 	// Free the memory associated with the virus scanning engine.
 	if (virus_spool) {
@@ -296,8 +370,8 @@ int virus_engine_refresh(void) {
 	int state;
 	time_t utime;
 	struct tm now;
-	uint64_t loaded, total;
-	struct cl_engine *original, *new = NULL;
+	uint64_t loaded, total, start;
+	virus_engine_t *original, *new = NULL;
 
 	// If we are not supposed to be scanning messages. So don't bother refreshing engine.
 	if (!magma.iface.virus.available) {
@@ -306,21 +380,30 @@ int virus_engine_refresh(void) {
 
 	if (cl_statchkdir_d(&virus_stat) == 1) {
 
-		if ((new = virus_engine_create(&loaded)) == NULL) {
+		start = time_monotonic_ms();
+
+		// The new engine is compiled while the original engine continues scanning messages.
+		if (!(new = mm_alloc(sizeof(virus_engine_t))) || !(new->context = virus_engine_create(&loaded))) {
 			log_error("Failed to construct a new ClamAV engine context.");
 			stats_increment_by_name("provider.virus.error");
+			mm_cleanup(new);
 			return -1;
 		}
 
-		// Lock and then swap the pointer.
-		pthread_rwlock_wrlock(&virus_lock);
+		new->references = 1;
+
+		// Swap the pointer. Scans already in progress keep their reference to the original engine.
+		mutex_lock(&virus_lock);
 		original = virus_engine;
 		virus_engine = new;
 		virus_sigs = loaded;
-		pthread_rwlock_unlock(&virus_lock);
+		virus_generation++;
+		mutex_unlock(&virus_lock);
+
+		// Drop the reference held on behalf of the original engine, which is freed by whichever scan finishes with it last.
+		virus_engine_release(original);
 
-		// Free the old engine context.
-		virus_engine_destroy(&original);
+		log_pedantic("The new ClamAV engine context was compiled and activated. { milliseconds = %lu }", time_monotonic_ms() - start);
 
 		// Refresh the statistics, so we can properly log the update.
 		cl_statfree_d(&virus_stat);
@@ -367,6 +450,7 @@ int virus_check(stringer_t *data) {
 	char *virname;
 	ssize_t written;
 	unsigned long int scanned;
+	virus_engine_t *engine;
 
 	// If we are not supposed to be scanning messages.
 	if (!magma.iface.virus.available) {
@@ -394,9 +478,15 @@ int virus_check(stringer_t *data) {
 		return -1;
 	}
 
-	// Scan the message.
-	pthread_rwlock_rdlock(&virus_lock);
-	state = cl_scandesc_d(fd, (const char **)&virname, &scanned, virus_engine, CL_SCAN_STDOPT);
+	// Scan the message. The engine reference also keeps the virus name valid, so it is held until we're done with the name.
+	if (!(engine = virus_engine_acquire())) {
+		log_pedantic("The virus engine isn't available.");
+		stats_increment_by_name("provider.virus.error");
+		close(fd);
+		return -1;
+	}
+
+	state = cl_scandesc_d(fd, (const char **)&virname, &scanned, engine->context, CL_SCAN_STDOPT);
 
 	// If we found something, then spit it back.
 	// http://wiki.clamav.net/Main/MalwareNaming has naming conventions.
@@ -406,7 +496,7 @@ int virus_check(stringer_t *data) {
 
 		// These are signature based phishing matches.
 		if (!st_cmp_ci_starts(PLACER(virname, ns_length_get(virname)), CONSTANT("Email.Phishing")) || !st_cmp_ci_starts(PLACER(virname, ns_length_get(virname)), CONSTANT("HTML.Phishing"))) {
-			pthread_rwlock_unlock(&virus_lock);
+			virus_engine_release(engine);
 			stats_increment_by_name("provider.virus.scan.total");
 			stats_increment_by_name("provider.virus.scan.phishing");
 			close(fd);
@@ -415,7 +505,7 @@ int virus_check(stringer_t *data) {
 		// We ignore email that ClamAV thinks is a phishing based on scanner's internal heuristic checks.
 		else if (!st_cmp_ci_starts(PLACER(virname, ns_length_get(virname)), CONSTANT("Phishing")) ||
 			!st_cmp_ci_starts(PLACER(virname, ns_length_get(virname)), CONSTANT("Joke"))) {
-			pthread_rwlock_unlock(&virus_lock);
+			virus_engine_release(engine);
 			stats_increment_by_name("provider.virus.scan.total");
 			stats_increment_by_name("provider.virus.scan.clean");
 			close(fd);
@@ -423,7 +513,7 @@ int virus_check(stringer_t *data) {
 		}
 		// Its probably a worm, trojan, virus or something similar.
 		else {
-			pthread_rwlock_unlock(&virus_lock);
+			virus_engine_release(engine);
 			stats_increment_by_name("provider.virus.scan.total");
 			stats_increment_by_name("provider.virus.scan.infected");
 			close(fd);
@@ -431,10 +521,10 @@ int virus_check(stringer_t *data) {
 		}
 	}
 
-	pthread_rwlock_unlock(&virus_lock);
+	virus_engine_release(engine);
 	close(fd);
 
-	// Track the number of clean messages. We can do the tracking after the mutex is released.
+	// Track the number of clean messages. We can do the tracking after the engine is released.
 	if (state == CL_CLEAN) {
 		stats_increment_by_name("provider.virus.scan.total");
 		stats_increment_by_name("provider.virus.scan.clean");
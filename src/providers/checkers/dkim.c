@@ -9,6 +9,7 @@
 
 chr_t dkim_version[8];
 DKIM_LIB *dkim_engine = NULL;
+inx_t *dkim_records_cache = NULL;
 
 #define DKIM_PROCESS_ALL -1L
 
@@ -32,6 +33,8 @@ bool_t lib_load_dkim(void) {
 		M_BIND(dkim_body), M_BIND(dkim_chunk), M_BIND(dkim_close), M_BIND(dkim_eoh), M_BIND(dkim_eom), M_BIND(dkim_free),
 		M_BIND(dkim_getresultstr), M_BIND(dkim_header),	M_BIND(dkim_init),	M_BIND(dkim_libversion),
 		M_BIND(dkim_sign), M_BIND(dkim_verify), M_BIND(dkim_geterror), M_BIND(dkim_test_dns_put), M_BIND(dkim_mfree),
+		M_BIND(dkim_dns_set_query_start), M_BIND(dkim_dns_set_query_cancel), M_BIND(dkim_dns_set_query_waitreply),
+		M_BIND(dkim_dns_set_init), M_BIND(dkim_dns_set_close),
 
 		// This value structure is setup manually to avoid singular anomaly in our naming convetntion.
 		{ .name = "dkim_getsighdr", .pointer = (void *)&dkim_getsighdrx_d },
@@ -74,6 +77,278 @@ void dkim_memory_free(void *closure, void *ptr) {
 	return;
 }
 
+/**
+ * @brief	Determine how long a selector key record answer may be cached.
+ * @note	Answers which don't contain a key are cached for a shorter period, and server failures aren't cached at all.
+ * @param	packet	a pointer to the DNS answer packet.
+ * @param	length	the length, in bytes, of the DNS answer packet.
+ * @return	the number of seconds the answer may be cached, or 0 if it shouldn't be cached.
+ */
+uint32_t dkim_records_ttl(uchr_t *packet, size_t length) {
+
+	ns_rr record;
+	ns_msg handle;
+	uint32_t ttl = 0;
+	HEADER *header = (HEADER *)packet;
+
+	if (length < HFIXEDSZ) {
+		return 0;
+	}
+	else if (header->rcode == NXDOMAIN || (header->rcode == NOERROR && !ntohs(header->ancount))) {
+		ttl = MAGMA_DKIM_CACHE_NEGATIVE;
+	}
+	else if (header->rcode != NOERROR || ns_initparse(packet, length, &handle)) {
+		return 0;
+	}
+	else {
+
+		// The answer can only be cached for as long as the shortest lived record it contains.
+		for (int_t i = 0; i < ns_msg_count(handle, ns_s_an); i++) {
+			if (ns_parserr(&handle, ns_s_an, i, &record)) {
+				return 0;
+			}
+			else if (!i || ns_rr_ttl(record) < ttl) {
+				ttl = ns_rr_ttl(record);
+			}
+		}
+	}
+
+	return ttl < magma.dkim.cache ? ttl : magma.dkim.cache;
+}
+
+/**
+ * @brief	Copy a cached selector key record answer into the buffer provided by the dkim library.
+ * @param	query	the name being queried.
+ * @param	type	the DNS record type being queried.
+ * @param	buffer	the buffer which should receive the answer packet.
+ * @param	size	the size, in bytes, of the buffer.
+ * @return	the length of the answer packet, or 0 if the answer isn't cached.
+ */
+size_t dkim_records_get(chr_t *query, int_t type, uchr_t *buffer, size_t size) {
+
+	size_t result = 0;
+	dkim_record_t *record;
+	chr_t key[NS_MAXDNAME + 16];
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = NULL };
+
+	if (!dkim_records_cache || snprintf(key, sizeof(key), "%i/%s", type, query) >= sizeof(key)) {
+		return 0;
+	}
+
+	name.val.st = PLACER(key, ns_length_get(key));
+
+	inx_lock_read(dkim_records_cache);
+
+	if ((record = inx_find(dkim_records_cache, name)) && record->expiration > time(NULL) && record->length <= size) {
+		mm_copy(buffer, record->packet, record->length);
+		result = record->length;
+	}
+
+	inx_unlock(dkim_records_cache);
+
+	return result;
+}
+
+/**
+ * @brief	Store a copy of a selector key record answer in the cache.
+ * @param	query	the name which was queried.
+ * @param	type	the DNS record type which was queried.
+ * @param	packet	a pointer to the DNS answer packet.
+ * @param	length	the length, in bytes, of the DNS answer packet.
+ * @return	This function returns no value.
+ */
+void dkim_records_set(chr_t *query, int_t type, uchr_t *packet, size_t length) {
+
+	uint32_t ttl;
+	dkim_record_t *record;
+	chr_t key[NS_MAXDNAME + 16];
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = NULL };
+
+	if (!dkim_records_cache || !(ttl = dkim_records_ttl(packet, length)) ||
+		snprintf(key, sizeof(key), "%i/%s", type, query) >= sizeof(key)) {
+		return;
+	}
+	// The packet is stored in the same block of memory as the record, so the record can be released with a single free.
+	else if (!(record = mm_alloc(sizeof(dkim_record_t) + length))) {
+		return;
+	}
+
+	name.val.st = PLACER(key, ns_length_get(key));
+
+	record->length = length;
+	record->expiration = time(NULL) + ttl;
+	record->packet = (uchr_t *)record + sizeof(dkim_record_t);
+	mm_copy(record->packet, packet, length);
+
+	inx_lock_write(dkim_records_cache);
+
+	if ((inx_count(dkim_records_cache) >= magma.dkim.cache_limit && !inx_find(dkim_records_cache, name)) ||
+		!inx_replace(dkim_records_cache, name, record)) {
+		mm_free(record);
+	}
+
+	inx_unlock(dkim_records_cache);
+
+	return;
+}
+
+/**
+ * @brief	Start a DNS query on behalf of the dkim library.
+ * @note	The answer is taken from the cache when possible. Otherwise the query is sent using a resolver state private to this
+ * 			query, since the resolver state the library uses by default is shared by every thread. The answer is always
+ * 			complete by the time this function returns, so dkim_records_wait() only has to report the result. An answer larger
+ * 			than the buffer is truncated to the size of the buffer, and isn't cached.
+ * @param	service	the DNS service handle, which isn't used.
+ * @param	type	the DNS record type being queried.
+ * @param	query	the name being queried.
+ * @param	buffer	the buffer which should receive the answer packet.
+ * @param	size	the size, in bytes, of the buffer.
+ * @param	handle	a pointer to receive the query handle.
+ * @return	DKIM_DNS_SUCCESS on success or DKIM_DNS_ERROR on failure.
+ */
+int dkim_records_start(void *service, int type, uchr_t *query, uchr_t *buffer, size_t size, void **handle) {
+
+	int_t length;
+	dkim_lookup_t *result;
+	struct __res_state resolver;
+	uchr_t packet[NS_PACKETSZ];
+
+	if (!(result = mm_alloc(sizeof(dkim_lookup_t)))) {
+		return DKIM_DNS_ERROR;
+	}
+	else if ((result->length = dkim_records_get((chr_t *)query, type, buffer, size))) {
+		stats_increment_by_name("provider.dkim.keys.cached");
+		*handle = result;
+		return DKIM_DNS_SUCCESS;
+	}
+
+	mm_wipe(&resolver, sizeof(struct __res_state));
+
+	if (res_ninit(&resolver)) {
+		log_pedantic("Unable to initialize the DNS resolver.");
+		mm_free(result);
+		return DKIM_DNS_ERROR;
+	}
+
+	stats_increment_by_name("provider.dkim.keys.queried");
+
+	if ((length = res_nmkquery(&resolver, ns_o_query, (chr_t *)query, ns_c_in, type, NULL, 0, NULL, packet, NS_PACKETSZ)) <= 0) {
+		log_pedantic("Unable to build the DKIM key DNS query. { query = %s }", query);
+		result->error = EINVAL;
+	}
+	else if ((length = res_nsend(&resolver, packet, length, buffer, size)) < 0) {
+		result->error = errno;
+	}
+
+	// An answer which didn't fit is reported with its full length, even though only the part which fit was copied, so the
+	// truncated answer is handed to the library as is, but never cached.
+	else if ((size_t)length > size) {
+		result->length = size;
+	}
+	else {
+		result->length = length;
+		dkim_records_set((chr_t *)query, type, buffer, result->length);
+	}
+
+	res_nclose(&resolver);
+
+	*handle = result;
+	return DKIM_DNS_SUCCESS;
+}
+
+/**
+ * @brief	Report the result of a DNS query started by dkim_records_start().
+ * @param	service	the DNS service handle, which isn't used.
+ * @param	handle	the query handle.
+ * @param	timeout	the maximum amount of time to wait for the answer, which isn't used because the answer is already available.
+ * @param	bytes	a pointer to receive the length of the answer packet.
+ * @param	error	a pointer to receive the error code, if the query failed.
+ * @param	dnssec	a pointer to receive the DNSSEC status of the answer.
+ * @return	DKIM_DNS_SUCCESS on success or DKIM_DNS_ERROR on failure.
+ */
+int dkim_records_wait(void *service, void *handle, struct timeval *timeout, size_t *bytes, int *error, int *dnssec) {
+
+	dkim_lookup_t *result = handle;
+
+	if (!result) {
+		return DKIM_DNS_ERROR;
+	}
+
+	if (bytes) *bytes = result->length;
+	if (error) *error = result->error;
+	if (dnssec) *dnssec = DKIM_DNSSEC_UNKNOWN;
+
+	return DKIM_DNS_SUCCESS;
+}
+
+/**
+ * @brief	Release a DNS query handle created by dkim_records_start().
+ * @param	service	the DNS service handle, which isn't used.
+ * @param	handle	the query handle.
+ * @return	DKIM_DNS_SUCCESS.
+ */
+int dkim_records_cancel(void *service, void *handle) {
+
+	mm_cleanup(handle);
+	return DKIM_DNS_SUCCESS;
+}
+
+/**
+ * @brief	Initialize the DNS service used by the dkim library.
+ * @note	Every query uses its own resolver state, so the service handle only needs to be set. If it were left empty, the
+ * 			library would try to initialize the service again before every query.
+ * @param	service	a pointer to receive the DNS service handle.
+ * @return	DKIM_DNS_SUCCESS.
+ */
+int dkim_records_init(void **service) {
+
+	*service = &dkim_records_cache;
+	return DKIM_DNS_SUCCESS;
+}
+
+/**
+ * @brief	Shutdown the DNS service used by the dkim library.
+ * @note	There isn't anything to release, since every query uses its own resolver state.
+ * @param	service	the DNS service handle.
+ * @return	This function returns no value.
+ */
+void dkim_records_close(void *service) {
+
+	return;
+}
+
+/**
+ * @brief	Determine whether a cached DNS record has expired.
+ * @param	record	a pointer to the cached record being examined.
+ * @param	now		a pointer to the current time.
+ * @return	true if the record has expired, or false if it is still valid.
+ */
+bool_t dkim_records_expired(dkim_record_t *record, time_t *now) {
+
+	return record->expiration <= *now;
+}
+
+/**
+ * @brief	Remove expired selector key records from the cache.
+ * @return	This function returns no value.
+ */
+void dkim_records_prune(void) {
+
+	time_t now;
+
+	if ((now = time(NULL)) == (time_t)(-1)) {
+		return;
+	}
+
+	if (dkim_records_cache) {
+		inx_lock_write(dkim_records_cache);
+		inx_prune(dkim_records_cache, (bool_t (*)(void *, void *))&dkim_records_expired, &now);
+		inx_unlock(dkim_records_cache);
+	}
+
+	return;
+}
+
 /**
  * @brief	Start the dkim engine.
  * @return	false on failure or true on success.
@@ -87,6 +362,18 @@ bool_t dkim_start(void) {
 		return false;
 	}
 
+	// Replace the library resolver, so selector key records are cached, and lookups are safe to run from multiple threads.
+	dkim_dns_set_init_d(dkim_engine, &dkim_records_init);
+	dkim_dns_set_close_d(dkim_engine, &dkim_records_close);
+	dkim_dns_set_query_start_d(dkim_engine, &dkim_records_start);
+	dkim_dns_set_query_cancel_d(dkim_engine, &dkim_records_cancel);
+	dkim_dns_set_query_waitreply_d(dkim_engine, &dkim_records_wait);
+
+	if (magma.dkim.cache && !(dkim_records_cache = inx_alloc(M_INX_TREE | M_INX_LOCK_MANUAL, &mm_free))) {
+		log_critical("Unable to initialize the DKIM key record cache.");
+		return false;
+	}
+
 	// This must be done here because we have to wait for OpenSSL to be initialized first.
 	if (magma.dkim.enabled) {
 
@@ -124,6 +411,11 @@ void dkim_stop(void) {
 		dkim_engine = NULL;
 	}
 
+	if (dkim_records_cache) {
+		inx_free(dkim_records_cache);
+		dkim_records_cache = NULL;
+	}
+
 	return;
 }
 
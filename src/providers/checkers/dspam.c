@@ -39,10 +39,11 @@ bool_t dspam_start(void) {
 	if (dspam_init_driver_d(NULL) != 0) {
 		return false;
 	}
-	return true;
+	return dspam_training_start();
 }
 
 void dspam_stop(void) {
+	dspam_training_stop();
 	dspam_shutdown_driver_d(NULL);
 	return;
 }
@@ -163,46 +164,24 @@ int_t dspam_check(uint64_t usernum, stringer_t *message, stringer_t **signature)
 }
 
 /**
- *  @note	The disposition parameter marks whether or not the signature is currently marked as junk.
- *  		So training the signature means that it will toggle its status.
- *  @param	usernum			the numerical id of the user making the spam training request.
- *  @param	disposition		if 0, dspam will mark the signature as junk; otherwise, mark as OK.
- *  @param	signature		a managed string containing the spam signature to be trained.
- *  @return	true on success or false on failure.
+ * @brief	Train a single spam signature using a database connection which has already been pulled from the pool.
+ * @param	connection		the database connection used by the DSPAM storage driver.
+ * @param	unum			a null-terminated string containing the numerical id of the user.
+ * @param	tmpdir			the DSPAM home directory.
+ * @param	disposition		if 0, dspam will mark the signature as junk; otherwise, mark as OK.
+ * @param	signature		a managed string containing the spam signature to be trained.
+ * @return	true on success or false on failure.
  */
-bool_t dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature) {
+bool_t dspam_train_signature(uint32_t connection, chr_t *unum, stringer_t *tmpdir, int_t disposition, stringer_t *signature) {
 
 	int_t ret;
 	DSPAM_CTX *ctx;
-	chr_t unum[20];
-	stringer_t *tmpdir;
-	uint32_t connection;
 	struct _mysql_drv_dbh dbh;
 	struct _ds_spam_signature sig;
 
-	// Generate a string version of the dispatch number.
-	if (snprintf(unum, 20, "%lu", usernum) <= 0 || !(tmpdir = spool_path(MAGMA_SPOOL_DATA))) {
-		log_pedantic("Context setup error.");
-		return false;
-	}
 	// Initialize the DSPAM context.
-	else if (!(ctx = dspam_create_d(unum, NULL, st_char_get(tmpdir), DSM_PROCESS, DSF_SIGNATURE | DSF_NOISE | DSF_WHITELIST))) {
+	if (!(ctx = dspam_create_d(unum, NULL, st_char_get(tmpdir), DSM_PROCESS, DSF_SIGNATURE | DSF_NOISE | DSF_WHITELIST))) {
 		log_pedantic("An error occurred inside the DSPAM library. {dspam_create = NULL}");
-		st_free(tmpdir);
-		return false;
- 	}
-
-	st_free(tmpdir);
-
-	// Get a DB connection.
-	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
-		log_info("Unable to get an available connection for the query.");
-		dspam_destroy_d(ctx);
-		return false;
-	}
-	else if (sql_ping(connection) < 0 || !stmt_rebuild(connection)) {
-		log_info("The database connection has been lost and the reconnection attempt failed.");
-		dspam_destroy_d(ctx);
 		return false;
 	}
 
@@ -216,7 +195,6 @@ bool_t dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature) {
 			log_pedantic("Could not detach the DB connection.");
 		}
 
-		pool_release(sql_pool, connection);
 		log_pedantic("An error occurred while attaching to the statistical database. {dspam_attach = %i}", ret);
 		dspam_destroy_d(ctx);
 		return false;
@@ -241,7 +219,6 @@ bool_t dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature) {
 	ret = dspam_process_d(ctx, NULL);
 	dspam_detach_d(ctx);
 	dspam_destroy_d(ctx);
-	pool_release(sql_pool, connection);
 
 	if (ret) {
 		log_pedantic("An error occurred while training message signature. {dspam_process = %i}", ret);
@@ -250,3 +227,60 @@ bool_t dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature) {
 
 	return true;
 }
+
+/**
+ * @brief	Train a group of spam signatures belonging to a single user, using one database connection.
+ * @param	usernum			the numerical id of the user who owns the signatures.
+ * @param	count			the number of signatures being trained.
+ * @param	dispositions	an array holding the current disposition of each signature, where 0 means the signature will be marked as junk.
+ * @param	signatures		an array of managed strings containing the spam signatures to be trained.
+ * @return	the number of signatures which were trained successfully.
+ */
+uint32_t dspam_train_batch(uint64_t usernum, uint32_t count, int_t *dispositions, stringer_t **signatures) {
+
+	chr_t unum[20];
+	uint32_t connection, trained = 0;
+	stringer_t *tmpdir;
+
+	// Generate a string version of the dispatch number.
+	if (snprintf(unum, 20, "%lu", usernum) <= 0 || !(tmpdir = spool_path(MAGMA_SPOOL_DATA))) {
+		log_pedantic("Context setup error.");
+		return 0;
+	}
+
+	// Get a DB connection.
+	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
+		log_info("Unable to get an available connection for the query.");
+		st_free(tmpdir);
+		return 0;
+	}
+	else if (sql_ping(connection) < 0 || !stmt_rebuild(connection)) {
+		log_info("The database connection has been lost and the reconnection attempt failed.");
+		pool_release(sql_pool, connection);
+		st_free(tmpdir);
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (dspam_train_signature(connection, unum, tmpdir, dispositions[i], signatures[i])) {
+			trained++;
+		}
+	}
+
+	pool_release(sql_pool, connection);
+	st_free(tmpdir);
+
+	return trained;
+}
+
+/**
+ *  @note	The disposition parameter marks whether or not the signature is currently marked as junk.
+ *  		So training the signature means that it will toggle its status.
+ *  @param	usernum			the numerical id of the user making the spam training request.
+ *  @param	disposition		if 0, dspam will mark the signature as junk; otherwise, mark as OK.
+ *  @param	signature		a managed string containing the spam signature to be trained.
+ *  @return	true on success or false on failure.
+ */
+bool_t dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature) {
+	return dspam_train_batch(usernum, 1, &disposition, &signature) == 1;
+}
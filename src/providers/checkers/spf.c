@@ -10,7 +10,9 @@
 // #define MAGMA_SPF_DEBUG
 
 pool_t *spf_pool = NULL;
+inx_t *spf_cache = NULL;
 chr_t spf_version[8];
+SPF_dns_server_t *spf_resolver = NULL;
 
 /**
  * @brief	Return the version string of the spf library.
@@ -32,7 +34,8 @@ bool_t lib_load_spf(void) {
 		M_BIND(SPF_get_lib_version), M_BIND(SPF_request_free), M_BIND(SPF_request_new),	M_BIND(SPF_request_query_mailfrom),
 		M_BIND(SPF_request_set_env_from), M_BIND(SPF_request_set_helo_dom),	M_BIND(SPF_request_set_ipv4), M_BIND(SPF_request_set_ipv6),
 		M_BIND(SPF_response_free), M_BIND(SPF_response_reason), M_BIND(SPF_response_result), M_BIND(SPF_server_free), M_BIND(SPF_server_new),
-		M_BIND(SPF_strerror), M_BIND(SPF_strreason), M_BIND(SPF_strresult), M_BIND(SPF_dns_zone_new),  M_BIND(SPF_dns_zone_add_str)
+		M_BIND(SPF_strerror), M_BIND(SPF_strreason), M_BIND(SPF_strresult), M_BIND(SPF_dns_zone_new),  M_BIND(SPF_dns_zone_add_str),
+		M_BIND(SPF_dns_cache_new), M_BIND(SPF_dns_free), M_BIND(SPF_dns_resolv_new), M_BIND(SPF_server_new_dns)
 	};
 
 	if (lib_symbols(sizeof(spf) / sizeof(symbol_t), spf) != 1) {
@@ -45,6 +48,134 @@ bool_t lib_load_spf(void) {
 	return true;
 }
 
+/**
+ * @brief	Build the key used to cache the outcome of an SPF check.
+ * @note	Checks with an empty MAIL FROM address are evaluated against the HELO domain, so that domain is used instead.
+ * @param	addr	the address of the client being checked.
+ * @param	domain	the domain portion of the MAIL FROM address, or the HELO domain.
+ * @return	NULL on failure, or a managed string containing the cache key, in lowercase, which must be freed by the caller.
+ */
+stringer_t * spf_cache_key(ip_t *addr, stringer_t *domain) {
+
+	stringer_t *ip, *key = NULL;
+
+	if (!(ip = ip_presentation(addr, NULL))) {
+		return NULL;
+	}
+	else if (!(key = st_merge("sns", ip, "/", domain)) || !lower_st(key)) {
+		st_cleanup(ip, key);
+		return NULL;
+	}
+
+	st_free(ip);
+	return key;
+}
+
+/**
+ * @brief	Find the cached outcome of an SPF check for a client address and sender domain.
+ * @param	addr		the address of the client being checked.
+ * @param	domain		the domain portion of the MAIL FROM address, or the HELO domain.
+ * @param	statistic	a pointer to receive the name of the statistic which the outcome was reported under.
+ * @return	0 if the outcome isn't cached, or the value spf_check() returned for the original check.
+ */
+int_t spf_cache_get(ip_t *addr, stringer_t *domain, chr_t **statistic) {
+
+	int_t result = 0;
+	stringer_t *key;
+	spf_entry_t *entry;
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = NULL };
+
+	if (!spf_cache || !(key = spf_cache_key(addr, domain))) {
+		return 0;
+	}
+
+	name.val.st = key;
+
+	inx_lock_read(spf_cache);
+
+	if ((entry = inx_find(spf_cache, name)) && entry->expiration > time(NULL)) {
+		*statistic = entry->statistic;
+		result = entry->result;
+	}
+
+	inx_unlock(spf_cache);
+	st_free(key);
+
+	return result;
+}
+
+/**
+ * @brief	Store the outcome of an SPF check for a client address and sender domain in the cache.
+ * @param	addr		the address of the client which was checked.
+ * @param	domain		the domain portion of the MAIL FROM address, or the HELO domain.
+ * @param	result		the value returned by spf_check().
+ * @param	statistic	the name of the statistic the outcome was reported under, which must be a string constant.
+ * @return	This function returns no value.
+ */
+void spf_cache_set(ip_t *addr, stringer_t *domain, int_t result, chr_t *statistic) {
+
+	stringer_t *key;
+	spf_entry_t *entry;
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = NULL };
+
+	if (!spf_cache || !(key = spf_cache_key(addr, domain))) {
+		return;
+	}
+	else if (!(entry = mm_alloc(sizeof(spf_entry_t)))) {
+		st_free(key);
+		return;
+	}
+
+	name.val.st = key;
+
+	entry->result = result;
+	entry->statistic = statistic;
+	entry->expiration = time(NULL) + magma.iface.spf.cache;
+
+	inx_lock_write(spf_cache);
+
+	if ((inx_count(spf_cache) >= magma.iface.spf.cache_limit && !inx_find(spf_cache, name)) || !inx_replace(spf_cache, name, entry)) {
+		mm_free(entry);
+	}
+
+	inx_unlock(spf_cache);
+	st_free(key);
+
+	return;
+}
+
+/**
+ * @brief	Determine whether an SPF cache entry has expired.
+ * @param	entry		a pointer to the cache entry being examined.
+ * @param	now		a pointer to the current time.
+ * @return	true if the entry has expired, or false if it is still valid.
+ */
+bool_t spf_cache_expired(spf_entry_t *entry, time_t *now) {
+
+	return entry->expiration <= *now;
+}
+
+/**
+ * @brief	Remove the expired SPF outcomes from the cache.
+ * @return	This function returns no value.
+ */
+void spf_cache_prune(void) {
+
+	time_t now;
+
+	if ((now = time(NULL)) == (time_t)(-1)) {
+		return;
+	}
+
+	if (spf_cache) {
+		inx_lock_write(spf_cache);
+		inx_prune(spf_cache, (bool_t (*)(void *, void *))&spf_cache_expired, &now);
+		inx_unlock(spf_cache);
+	}
+
+	return;
+}
+
 /**
  * @brief	Initialize the pool of spf server connections.
  * @return	false on failure or true on success.
@@ -58,6 +189,24 @@ bool_t spf_start(void) {
 #endif
 
 	SPF_server_t *object;
+	SPF_dns_server_t *resolver;
+
+	// The pooled instances share a single caching resolver, so the records fetched while evaluating a policy, including
+	// the policies it includes, are available to every instance. The resolver layer uses thread specific state.
+	if (!(resolver = SPF_dns_resolv_new_d(NULL, NULL, spf_debug))) {
+		log_pedantic("Could not initialize the SPF resolver.");
+		return false;
+	}
+	else if (!(spf_resolver = SPF_dns_cache_new_d(resolver, NULL, spf_debug, MAGMA_SPF_DNS_CACHE_BITS))) {
+		log_pedantic("Could not initialize the SPF resolver cache.");
+		SPF_dns_free_d(resolver);
+		return false;
+	}
+
+	if (magma.iface.spf.cache && !(spf_cache = inx_alloc(M_INX_TREE | M_INX_LOCK_MANUAL, &mm_free))) {
+		log_pedantic("Could not initialize the SPF result cache.");
+		return false;
+	}
 
 	// Create the object pool.
 	if ((spf_pool = pool_alloc(magma.iface.spf.pool.connections, magma.iface.spf.pool.timeout)) == NULL) {
@@ -67,7 +216,7 @@ bool_t spf_start(void) {
 
 	// Initialize the objects in the pool.
 	for (uint32_t i = 0; i < magma.iface.spf.pool.connections; i++) {
-		if ((object = SPF_server_new_d(SPF_DNS_CACHE, spf_debug)) == NULL) {
+		if ((object = SPF_server_new_dns_d(spf_resolver, spf_debug)) == NULL) {
 			log_pedantic("Could not initialize SPF object number %i.", i + 1);
 			return false;
 		}
@@ -84,11 +233,19 @@ bool_t spf_start(void) {
 void spf_stop(void) {
 
 	SPF_server_t *object;
+	SPF_dns_server_t *layer, *below;
 
 	// Destroy the objects.
-	for (uint32_t i = 0; i < magma.iface.spf.pool.connections; i++) {
+	for (uint32_t i = 0; spf_pool && i < magma.iface.spf.pool.connections; i++) {
 
 		if ((object = pool_get_obj(spf_pool, i))) {
+
+			// Layers stacked on top of the shared resolver, like the zones used for testing, belong to the instance.
+			for (layer = object->resolver; layer && layer != spf_resolver; layer = below) {
+				below = layer->layer_below;
+				if (layer->destroy) layer->destroy(layer);
+			}
+
 			SPF_server_free_d(object);
 		}
 
@@ -98,6 +255,16 @@ void spf_stop(void) {
 	pool_free(spf_pool);
 	spf_pool = NULL;
 
+	if (spf_resolver) {
+		SPF_dns_free_d(spf_resolver);
+		spf_resolver = NULL;
+	}
+
+	if (spf_cache) {
+		inx_free(spf_cache);
+		spf_cache = NULL;
+	}
+
 	return;
 }
 
@@ -112,8 +279,11 @@ void spf_stop(void) {
 int_t spf_check(void *ip, stringer_t *helo, stringer_t *mailfrom) {
 
 	uint32_t item;
-	placer_t domain;
+	int_t result = 0;
 	ip_t *addr = ip;
+	bool_t cacheable;
+	placer_t domain = pl_null();
+	chr_t *statistic = NULL;
 #ifdef MAGMA_SPF_DEBUG
 	SPF_reason_t reason = SPF_REASON_NONE;
 #endif
@@ -122,7 +292,6 @@ int_t spf_check(void *ip, stringer_t *helo, stringer_t *mailfrom) {
 	SPF_errcode_t error = SPF_E_SUCCESS;
 	SPF_result_t response = SPF_RESULT_NEUTRAL;
 
-	mail_domain_get(mailfrom, &domain);
 	stats_adjust_by_name("provider.spf.checked", 1);
 
 	if (!ip || st_empty(helo, mailfrom)) {
@@ -131,6 +300,20 @@ int_t spf_check(void *ip, stringer_t *helo, stringer_t *mailfrom) {
 		return -1;
 	}
 
+	// A sender without a domain, like the null sender, is evaluated by the library using the entire MAIL FROM value, so the outcome
+	// isn't tied to a domain and can't be cached. The HELO domain is only used to identify the check in the log.
+	else if (!(cacheable = (mail_domain_get(mailfrom, &domain) != NULL))) {
+		domain = pl_init(st_data_get(helo), st_length_get(helo));
+	}
+
+	// The outcome for this client address and sender domain was cached by a recent check.
+	// LOW: A policy which uses the HELO or local part macros could evaluate differently for another message from the same client.
+	if (cacheable && (result = spf_cache_get(addr, &domain, &statistic))) {
+		stats_adjust_by_name("provider.spf.cached", 1);
+		stats_adjust_by_name(statistic, 1);
+		return result;
+	}
+
 	else if (pool_pull(spf_pool, &item) != PL_RESERVED) {
 		stats_adjust_by_name("provider.spf.error", 1);
 		return -1;
@@ -173,6 +356,7 @@ int_t spf_check(void *ip, stringer_t *helo, stringer_t *mailfrom) {
 		// Indicates the domain being queried did not publish an SPF record.
 		if (error == SPF_E_NOT_SPF) {
 			stats_adjust_by_name("provider.spf.missing", 1);
+			if (cacheable) spf_cache_set(addr, &domain, -1, "provider.spf.missing");
 		}
 		else {
 			log_pedantic("SPF query error. { domain = %.*s / error = %s }", st_length_int(&domain), st_char_get(&domain), SPF_strerror_d(error));
@@ -196,6 +380,7 @@ int_t spf_check(void *ip, stringer_t *helo, stringer_t *mailfrom) {
 		log_pedantic("SPF check passed. { result = PASS / reason = %s }", SPF_strreason_d(reason));
 #endif
 		stats_adjust_by_name("provider.spf.pass", 1);
+		if (cacheable) spf_cache_set(addr, &domain, 1, "provider.spf.pass");
 		return 1;
 	}
 	else if (response == SPF_RESULT_NEUTRAL) {
@@ -203,6 +388,7 @@ int_t spf_check(void *ip, stringer_t *helo, stringer_t *mailfrom) {
 		log_pedantic("SPF check neutral. { result = NEUTRAL / reason = %s }", SPF_strreason_d(reason));
 #endif
 		stats_adjust_by_name("provider.spf.neutral", 1);
+		if (cacheable) spf_cache_set(addr, &domain, -1, "provider.spf.neutral");
 		return -1;
 	}
 	else if (response == SPF_RESULT_FAIL) {
@@ -210,6 +396,7 @@ int_t spf_check(void *ip, stringer_t *helo, stringer_t *mailfrom) {
 		log_pedantic("SPF check failed. { result = FAILED / reason = %s }", SPF_strreason_d(reason));
 #endif
 		stats_adjust_by_name("provider.spf.fail", 1);
+		if (cacheable) spf_cache_set(addr, &domain, -2, "provider.spf.fail");
 		return -2;
 	}
 
@@ -0,0 +1,492 @@
+
+/**
+ * @file /magma/providers/checkers/training.c
+ *
+ * @brief	The asynchronous queue used to train the statistical mail filter.
+ *
+ * Training requests are queued and the caller returns immediately. Requests are deduplicated per signature. A second request
+ * for a signature which is still waiting, with the same disposition, is ignored, and one with the opposite disposition cancels
+ * the first, since the two corrections would undo each other. A background thread trains the waiting signatures in batches,
+ * taking up to magma.iface.dspam.batch requests for the same user at a time, and pausing between batches so bulk
+ * reclassification doesn't monopolize the database.
+ *
+ * If a journal file is configured, every request is appended to it, along with a record once the request has been trained, or
+ * cancelled, so requests survive a restart. Each record is a single line. Training requests are written as
+ * "T <usernum> <signum> <disposition> <hex signature>", and completed requests as "D <signum>". The journal is compacted when
+ * the queue is started, and truncated whenever the queue is empty.
+ */
+
+#include "magma.h"
+
+// The training requests waiting to be processed, in the order they were received, and the thread processing them.
+struct {
+	int_t fd;
+	bool_t running;
+	uint64_t count;
+	pthread_t thread;
+	inx_t *signatures;
+	pthread_mutex_t lock;
+	pthread_cond_t available;
+	dspam_training_t *head, *tail;
+} dspam_training = {
+	.fd = -1,
+	.running = false,
+	.count = 0,
+	.signatures = NULL,
+	.head = NULL,
+	.tail = NULL,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.available = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * @brief	Free a training request.
+ * @param	request		a pointer to the training request.
+ * @return	This function returns no value.
+ */
+void dspam_training_free(dspam_training_t *request) {
+
+	if (request) {
+		st_cleanup(request->signature);
+		mm_free(request);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Append a record to the training journal.
+ * @note	The caller must hold the queue lock. Records aren't flushed individually, so a crash can lose the most recent requests.
+ * @param	request		a pointer to the training request being recorded.
+ * @param	completed	true if the request has been trained or cancelled, or false if the request was just queued.
+ * @return	true on success, or if journaling is disabled, and false on failure.
+ */
+bool_t dspam_training_journal(dspam_training_t *request, bool_t completed) {
+
+	stringer_t *hex = NULL, *record = NULL;
+
+	if (dspam_training.fd < 0) {
+		return true;
+	}
+	else if (completed) {
+		record = st_aprint("D %lu\n", request->signum);
+	}
+	else if ((hex = hex_encode_st(request->signature, NULL))) {
+		record = st_aprint("T %lu %lu %i %.*s\n", request->usernum, request->signum, request->disposition, st_length_int(hex), st_char_get(hex));
+	}
+
+	if (!record || write(dspam_training.fd, st_data_get(record), st_length_get(record)) != st_length_get(record)) {
+		log_pedantic("Unable to update the training journal. { signum = %lu }", request->signum);
+		st_cleanup(hex, record);
+		return false;
+	}
+
+	st_cleanup(hex, record);
+
+	return true;
+}
+
+/**
+ * @brief	Add a request to the training queue, unless it duplicates, or cancels, a request which is already waiting.
+ * @note	The caller must hold the queue lock. The request is either queued or freed.
+ * @param	request		a pointer to the training request.
+ * @param	journal		true if the request should be recorded in the journal.
+ * @return	This function returns no value.
+ */
+void dspam_training_push(dspam_training_t *request, bool_t journal) {
+
+	dspam_training_t *waiting;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = request->signum };
+
+	if ((waiting = inx_find(dspam_training.signatures, key))) {
+
+		// The opposite correction is waiting, so the two requests cancel each other out.
+		if (waiting->disposition != request->disposition) {
+			if (journal) dspam_training_journal(waiting, true);
+			inx_delete(dspam_training.signatures, key);
+			waiting->cancelled = true;
+			dspam_training.count--;
+			stats_increment_by_name("dspam.training.cancelled");
+		}
+
+		dspam_training_free(request);
+		return;
+	}
+	else if (!inx_insert(dspam_training.signatures, key, request)) {
+		log_pedantic("Unable to index a training request. { signum = %lu }", request->signum);
+		dspam_training_free(request);
+		return;
+	}
+
+	if (journal) {
+		dspam_training_journal(request, false);
+	}
+
+	if (dspam_training.tail) {
+		dspam_training.tail->next = request;
+	}
+	else {
+		dspam_training.head = request;
+	}
+
+	dspam_training.tail = request;
+	dspam_training.count++;
+
+	pthread_cond_signal(&(dspam_training.available));
+
+	return;
+}
+
+/**
+ * @brief	Queue a spam signature to be trained by the background thread.
+ * @note	If the training thread isn't running, the signature is trained before this function returns.
+ * @param	usernum			the numerical id of the user making the spam training request.
+ * @param	signum			the numerical id of the spam signature.
+ * @param	disposition		if 0, dspam will mark the signature as junk; otherwise, mark as OK.
+ * @param	signature		a managed string containing the spam signature to be trained.
+ * @return	true if the request was queued, or trained, and false on failure.
+ */
+bool_t dspam_training_add(uint64_t usernum, uint64_t signum, int_t disposition, stringer_t *signature) {
+
+	dspam_training_t *request;
+
+	if (!usernum || !signum || st_empty(signature)) {
+		return false;
+	}
+
+	mutex_lock(&(dspam_training.lock));
+
+	if (!dspam_training.running) {
+		mutex_unlock(&(dspam_training.lock));
+		return dspam_train(usernum, disposition, signature);
+	}
+	else if (dspam_training.count >= magma.iface.dspam.limit) {
+		mutex_unlock(&(dspam_training.lock));
+		log_pedantic("The training queue is full. { usernum = %lu / signum = %lu }", usernum, signum);
+		return false;
+	}
+	else if (!(request = mm_alloc(sizeof(dspam_training_t))) || !(request->signature = st_dupe(signature))) {
+		mutex_unlock(&(dspam_training.lock));
+		mm_cleanup(request);
+		return false;
+	}
+
+	request->usernum = usernum;
+	request->signum = signum;
+	request->disposition = disposition ? 1 : 0;
+
+	dspam_training_push(request, true);
+	mutex_unlock(&(dspam_training.lock));
+
+	stats_increment_by_name("dspam.training.queued");
+
+	return true;
+}
+
+/**
+ * @brief	Remove the next batch of requests from the queue.
+ * @note	The caller must hold the queue lock. The batch holds requests for the same user as the oldest waiting request, which
+ * 			are removed from the queue regardless of their position. Cancelled requests encountered along the way are freed.
+ * @param	batch	an array which will receive the requests, with room for magma.iface.dspam.batch entries.
+ * @return	the number of requests placed in the batch.
+ */
+uint32_t dspam_training_next(dspam_training_t **batch) {
+
+	uint64_t usernum = 0;
+	uint32_t count = 0;
+	dspam_training_t **holder = &(dspam_training.head), *request, *previous = NULL;
+
+	while ((request = *holder) && count < magma.iface.dspam.batch) {
+
+		if (request->cancelled || (!usernum || request->usernum == usernum)) {
+
+			*holder = request->next;
+			request->next = NULL;
+
+			if (request->cancelled) {
+				dspam_training_free(request);
+				continue;
+			}
+
+			usernum = request->usernum;
+			inx_delete(dspam_training.signatures, (multi_t){ .type = M_TYPE_UINT64, .val.u64 = request->signum });
+			dspam_training.count--;
+			batch[count++] = request;
+		}
+		else {
+			previous = request;
+			holder = &(request->next);
+		}
+	}
+
+	// Find the new tail, since the last request may have been removed.
+	if (!dspam_training.head) {
+		dspam_training.tail = NULL;
+	}
+	else if (!request) {
+		dspam_training.tail = previous;
+	}
+
+	return count;
+}
+
+/**
+ * @brief	Train queued signatures as they arrive.
+ * @note	This is the entry point for the training thread created by dspam_training_start().
+ * @return	This function returns no value.
+ */
+void dspam_training_worker(void) {
+
+	uint32_t count, trained;
+	struct timespec until;
+	int_t *dispositions = NULL;
+	stringer_t **signatures = NULL;
+	dspam_training_t **batch = NULL;
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	if (!(batch = mm_alloc(magma.iface.dspam.batch * sizeof(dspam_training_t *))) ||
+		!(dispositions = mm_alloc(magma.iface.dspam.batch * sizeof(int_t))) ||
+		!(signatures = mm_alloc(magma.iface.dspam.batch * sizeof(stringer_t *)))) {
+		log_error("Unable to allocate the training batch.");
+		mm_cleanup(batch, dispositions, signatures);
+
+		// Without the training thread, new requests have to be trained synchronously, instead of waiting in a queue nobody reads.
+		mutex_lock(&(dspam_training.lock));
+		dspam_training.running = false;
+		mutex_unlock(&(dspam_training.lock));
+
+		thread_stop();
+		pthread_exit(NULL);
+	}
+
+	mutex_lock(&(dspam_training.lock));
+
+	while (dspam_training.running) {
+
+		if (!(count = dspam_training_next(batch))) {
+
+			// Everything in the journal has been trained, or cancelled, so it can be emptied.
+			if (dspam_training.fd >= 0 && ftruncate(dspam_training.fd, 0)) {
+				log_pedantic("Unable to truncate the training journal.");
+			}
+
+			pthread_cond_wait(&(dspam_training.available), &(dspam_training.lock));
+			continue;
+		}
+
+		mutex_unlock(&(dspam_training.lock));
+
+		for (uint32_t i = 0; i < count; i++) {
+			dispositions[i] = batch[i]->disposition;
+			signatures[i] = batch[i]->signature;
+		}
+
+		// Requests which fail aren't retried, which matches the behavior of the synchronous training function.
+		if ((trained = dspam_train_batch(batch[0]->usernum, count, dispositions, signatures)) != count) {
+			log_pedantic("Unable to train %u of %u signatures. { usernum = %lu }", count - trained, count, batch[0]->usernum);
+			stats_adjust_by_name("dspam.training.failed", count - trained);
+		}
+
+		stats_adjust_by_name("dspam.training.trained", trained);
+
+		mutex_lock(&(dspam_training.lock));
+
+		for (uint32_t i = 0; i < count; i++) {
+			dspam_training_journal(batch[i], true);
+			dspam_training_free(batch[i]);
+		}
+
+		// Pause between batches, so a bulk reclassification doesn't monopolize the database. Every new request signals the condition,
+		// so the wait is repeated until the pause is over, and only ends early if the queue is being stopped.
+		if (dspam_training.running && magma.iface.dspam.throttle && !clock_gettime(CLOCK_REALTIME, &until)) {
+			until.tv_sec += magma.iface.dspam.throttle / 1000;
+			until.tv_nsec += (magma.iface.dspam.throttle % 1000) * 1000000;
+			if (until.tv_nsec >= 1000000000) {
+				until.tv_sec++;
+				until.tv_nsec -= 1000000000;
+			}
+			while (dspam_training.running && pthread_cond_timedwait(&(dspam_training.available), &(dspam_training.lock), &until) != ETIMEDOUT);
+		}
+	}
+
+	mutex_unlock(&(dspam_training.lock));
+
+	mm_free(batch);
+	mm_free(dispositions);
+	mm_free(signatures);
+
+	thread_stop();
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Reload the requests recorded in the training journal, and rewrite the journal so it only holds the waiting requests.
+ * @return	true on success or false on failure.
+ */
+bool_t dspam_training_replay(void) {
+
+	int_t fd;
+	size_t length;
+	placer_t fields[5];
+	chr_t *line, *end, *next;
+	uint64_t restored = 0, signum;
+	dspam_training_t *request;
+	stringer_t *data = NULL, *compacted = NULL;
+
+	if (!access(magma.iface.dspam.journal, F_OK) && !(data = file_load(magma.iface.dspam.journal))) {
+		log_critical("Unable to read the training journal. { path = %s }", magma.iface.dspam.journal);
+		return false;
+	}
+
+	mutex_lock(&(dspam_training.lock));
+
+	for (line = data ? st_char_get(data) : NULL, end = data ? line + st_length_get(data) : NULL; line && line < end; line = next + 1) {
+
+		if (!(next = memchr(line, '\n', end - line))) {
+			next = end;
+		}
+
+		length = next - line;
+
+		for (uint32_t i = 0; i < 5; i++) {
+			tok_get_pl(pl_init(line, length), ' ', i, &fields[i]);
+		}
+
+		// A record with an unknown type, or a torn final record, is skipped.
+		if (pl_length_get(fields[0]) != 1) {
+			continue;
+		}
+		else if (*pl_char_get(fields[0]) == 'D' && uint64_conv_bl(pl_char_get(fields[1]), pl_length_get(fields[1]), &signum)) {
+			if ((request = inx_find(dspam_training.signatures, (multi_t){ .type = M_TYPE_UINT64, .val.u64 = signum }))) {
+				inx_delete(dspam_training.signatures, (multi_t){ .type = M_TYPE_UINT64, .val.u64 = signum });
+				request->cancelled = true;
+				dspam_training.count--;
+			}
+		}
+		else if (*pl_char_get(fields[0]) == 'T' && !pl_empty(fields[4]) && (request = mm_alloc(sizeof(dspam_training_t)))) {
+
+			if (!uint64_conv_bl(pl_char_get(fields[1]), pl_length_get(fields[1]), &(request->usernum)) ||
+				!uint64_conv_bl(pl_char_get(fields[2]), pl_length_get(fields[2]), &(request->signum)) ||
+				!int32_conv_bl(pl_char_get(fields[3]), pl_length_get(fields[3]), &(request->disposition)) ||
+				!(request->signature = hex_decode_st(&fields[4], NULL))) {
+				dspam_training_free(request);
+				continue;
+			}
+
+			dspam_training_push(request, false);
+		}
+	}
+
+	st_cleanup(data);
+
+	// Rewrite the journal under a temporary name, so a crash during compaction doesn't lose the waiting requests.
+	if (!(compacted = st_aprint("%s.compact", magma.iface.dspam.journal)) ||
+		(fd = open(st_char_get(compacted), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) < 0) {
+		log_critical("Unable to create the training journal. { path = %s }", magma.iface.dspam.journal);
+		mutex_unlock(&(dspam_training.lock));
+		st_cleanup(compacted);
+		return false;
+	}
+
+	dspam_training.fd = fd;
+
+	for (request = dspam_training.head; request; request = request->next) {
+		if (!request->cancelled && dspam_training_journal(request, false)) {
+			restored++;
+		}
+	}
+
+	dspam_training.fd = -1;
+
+	if (fdatasync(fd) || close(fd) || rename(st_char_get(compacted), magma.iface.dspam.journal) ||
+		(dspam_training.fd = open(magma.iface.dspam.journal, O_WRONLY | O_APPEND)) < 0) {
+		log_critical("Unable to compact the training journal. { path = %s }", magma.iface.dspam.journal);
+		mutex_unlock(&(dspam_training.lock));
+		st_free(compacted);
+		return false;
+	}
+
+	mutex_unlock(&(dspam_training.lock));
+	st_free(compacted);
+
+	if (restored) {
+		log_info("Restored %lu spam training requests from the journal.", restored);
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Stop the training thread, and release the requests still waiting.
+ * @note	Waiting requests remain in the journal, if one is configured, and will be reloaded the next time the queue is started.
+ * @return	This function returns no value.
+ */
+void dspam_training_stop(void) {
+
+	dspam_training_t *request;
+
+	mutex_lock(&(dspam_training.lock));
+	dspam_training.running = false;
+	pthread_cond_broadcast(&(dspam_training.available));
+	mutex_unlock(&(dspam_training.lock));
+
+	if (dspam_training.thread) {
+		thread_join(dspam_training.thread);
+		dspam_training.thread = 0;
+	}
+
+	while ((request = dspam_training.head)) {
+		dspam_training.head = request->next;
+		dspam_training_free(request);
+	}
+
+	dspam_training.tail = NULL;
+	dspam_training.count = 0;
+
+	if (dspam_training.signatures) {
+		inx_free(dspam_training.signatures);
+		dspam_training.signatures = NULL;
+	}
+
+	if (dspam_training.fd >= 0) {
+		close(dspam_training.fd);
+		dspam_training.fd = -1;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Reload the training journal, and launch the training thread.
+ * @note	If the batch size is zero, the queue remains disabled and signatures are trained synchronously.
+ * @return	true on success or false on failure.
+ */
+bool_t dspam_training_start(void) {
+
+	if (!magma.iface.dspam.batch) {
+		return true;
+	}
+	else if (!(dspam_training.signatures = inx_alloc(M_INX_HASHED, NULL))) {
+		log_critical("Unable to initialize the training queue.");
+		return false;
+	}
+	else if (magma.iface.dspam.journal && !dspam_training_replay()) {
+		dspam_training_stop();
+		return false;
+	}
+
+	dspam_training.running = true;
+
+	if (thread_launch(&(dspam_training.thread), &dspam_training_worker, NULL)) {
+		log_critical("Unable to launch the training thread.");
+		dspam_training_stop();
+		return false;
+	}
+
+	return true;
+}
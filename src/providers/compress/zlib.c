@@ -36,6 +36,59 @@ bool_t lib_load_zlib(void) {
 	return true;
 }
 
+/**
+ * @brief	Compress a block of data into a gzip stream, suitable for use with the gzip HTTP content encoding.
+ * @note	Unlike compress_zlib(), the result has no magma compression header, since it will be sent to clients as is.
+ * @param	input	a managed string containing the data to be compressed.
+ * @return	NULL on failure, or a managed string containing the gzip stream on success.
+ */
+stringer_t * compress_gzip(stringer_t *input) {
+
+	int_t ret;
+	z_stream zs;
+	uint64_t out;
+	stringer_t *result;
+
+	if (st_empty(input)) {
+		log_pedantic("An empty string was passed in for compression.");
+		return NULL;
+	}
+
+	// The compression bound covers the zlib wrapper, which is 12 bytes smaller than the gzip header and trailer.
+	out = compressBound_d(st_length_get(input)) + 12;
+
+	if (!(result = st_alloc(out))) {
+		log_info("Unable to allocate the compression buffer. { length = %lu }", out);
+		return NULL;
+	}
+
+	mm_wipe(&zs, sizeof(z_stream));
+
+	// Adding 16 to the window bits selects the gzip format.
+	if ((ret = deflateInit2__d(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY, ZLIB_VERSION, sizeof(z_stream))) != Z_OK) {
+		log_info("Unable to initialize the compression stream. { deflateInit2 = %i }", ret);
+		st_free(result);
+		return NULL;
+	}
+
+	zs.next_in = st_data_get(input);
+	zs.avail_in = st_length_get(input);
+	zs.next_out = st_data_get(result);
+	zs.avail_out = out;
+
+	if ((ret = deflate_d(&zs, Z_FINISH)) != Z_STREAM_END) {
+		log_info("Unable to compress the buffer. { deflate = %i }", ret);
+		deflateEnd_d(&zs);
+		st_free(result);
+		return NULL;
+	}
+
+	st_length_set(result, zs.total_out);
+	deflateEnd_d(&zs);
+
+	return result;
+}
+
 /**
  * @brief	Decompress a block of data using the zlib engine.
  * @param	compressed	a pointer to the head of the compressed data.
@@ -16,6 +16,8 @@
 
 // SPF
 #include <spf2/spf.h>
+#include <spf2/spf_dns_cache.h>
+#include <spf2/spf_dns_resolv.h>
 #include <spf2/spf_dns_zone.h>
 
 // ClamAV
@@ -179,6 +181,11 @@ extern int (*dkim_test_dns_put_d)(DKIM *dkim, int class, int type, int prec, u_c
 extern DKIM * (*dkim_verify_d)(DKIM_LIB *libhandle, const unsigned char *id, void *memclosure, DKIM_STAT *statp);
 extern DKIM_LIB * (*dkim_init_d)(void *(*mallocf)(void *closure, size_t nbytes), void (*freef)(void *closure, void *p));
 extern DKIM * (*dkim_sign_d)(DKIM_LIB *libhandle, const unsigned char *id, void *memclosure, const dkim_sigkey_t secretkey, const unsigned char *selector, const unsigned char *domain, dkim_canon_t hdr_canon_alg, dkim_canon_t body_canon_alg, dkim_alg_t sign_alg,	off_t length, DKIM_STAT *statp);
+extern void (*dkim_dns_set_close_d)(DKIM_LIB *lib, void (*func)(void *srv));
+extern void (*dkim_dns_set_init_d)(DKIM_LIB *lib, int (*func)(void **srv));
+extern void (*dkim_dns_set_query_cancel_d)(DKIM_LIB *lib, int (*func)(void *srv, void *qh));
+extern void (*dkim_dns_set_query_start_d)(DKIM_LIB *lib, int (*func)(void *srv, int type, unsigned char *query, unsigned char *buf, size_t len, void **qh));
+extern void (*dkim_dns_set_query_waitreply_d)(DKIM_LIB *lib, int (*func)(void *srv, void *qh, struct timeval *timeout, size_t *bytes, int *error, int *dnssec));
 
 //! FreeType
 extern FT_Error (*FT_Done_FreeType_d)(FT_Library library);
@@ -547,6 +554,10 @@ extern SPF_errcode_t	(*SPF_request_set_ipv6_d)(SPF_request_t *sr, struct in6_add
 extern SPF_dns_server_t * (*SPF_dns_zone_new_d)(SPF_dns_server_t *layer_below, const char *name, int debug);
 extern SPF_errcode_t (*SPF_request_query_mailfrom_d)(SPF_request_t *spf_request, SPF_response_t **spf_responsep);
 extern SPF_errcode_t (*SPF_dns_zone_add_str_d)(SPF_dns_server_t *spf_dns_server, const char *domain, ns_type rr_type, SPF_dns_stat_t herrno, const char *data);
+extern void (*SPF_dns_free_d)(SPF_dns_server_t *spf_dns_server);
+extern SPF_server_t * (*SPF_server_new_dns_d)(SPF_dns_server_t *dns, int debug);
+extern SPF_dns_server_t * (*SPF_dns_resolv_new_d)(SPF_dns_server_t *layer_below, const char *name, int debug);
+extern SPF_dns_server_t * (*SPF_dns_cache_new_d)(SPF_dns_server_t *layer_below, const char *name, int debug, int cache_bits);
 
 //! TOKYO
 extern char **tcversion_d;
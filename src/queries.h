@@ -80,7 +80,12 @@
 #define SELECT_AUTOREPLY "SELECT message FROM Autoreplies WHERE replynum = ? AND usernum = ?"
 #define SELECT_PATTERNS "SELECT pattern FROM Patterns"
 #define SELECT_FILTERS "SELECT rulenum, location, type, action,	foldernum, field, label, expression FROM Filters WHERE usernum = ? ORDER BY rulenum ASC"
-#define SELECT_MESSAGES_ROLLOUT "SELECT messagenum, size, server FROM Messages WHERE usernum = ? ORDER BY created ASC LIMIT 20"
+#define SELECT_MESSAGES_ROLLOUT "SELECT messagenum, size, server FROM Messages WHERE usernum = ? ORDER BY created ASC, messagenum ASC LIMIT ?"
+#define SELECT_USER_ROLLOUT "SELECT size, quota FROM Users WHERE usernum = ?"
+// Unused placeholders are bound to zero, which never matches a message, so a single statement can remove up to MAGMA_ROLLOUT_CHUNK messages.
+#define ROLLOUT_PLACEHOLDERS "?, ?, ?, ?, ?, ?, ?, ?"
+#define DELETE_MESSAGES_ROLLOUT "DELETE FROM Messages WHERE usernum = ? AND messagenum IN (" ROLLOUT_PLACEHOLDERS ", " ROLLOUT_PLACEHOLDERS ", " \
+		ROLLOUT_PLACEHOLDERS ", " ROLLOUT_PLACEHOLDERS ")"
 #define SELECT_TRANSMITTING  "SELECT COUNT(*) FROM Transmitting WHERE usernum = ? AND timestamp >= DATE_SUB(NOW(), INTERVAL 1 DAY)"
 #define SELECT_RECEIVING "SELECT COUNT(*), SUM(subnet = ?) FROM Receiving WHERE usernum = ? AND timestamp >= DATE_SUB(NOW(), INTERVAL 1 DAY)"
 #define SELECT_USERS_AUTH "SELECT Users.usernum, Users.locked, Users.tls, Users.domain, Dispatch.send_size_limit, Dispatch.daily_send_limit, Dispatch.class FROM Users LEFT JOIN Dispatch ON Users.usernum = Dispatch.usernum WHERE userid = ? AND legacy = ? AND email = 1"
@@ -92,6 +97,7 @@
 		"Dispatch.greylist, Dispatch.greytime, Dispatch.spf, Dispatch.spfaction, Dispatch.dkim, Dispatch.dkimaction, Dispatch.rbl, " \
 		"Dispatch.rblaction, Dispatch.filters, `Keys`.signet FROM Mailboxes LEFT JOIN Users ON Mailboxes.usernum = Users.usernum LEFT JOIN Dispatch ON " \
 		"Mailboxes.usernum = Dispatch.usernum LEFT JOIN `Keys` ON Mailboxes.usernum = `Keys`.usernum WHERE Mailboxes.address = ?"
+#define SELECT_USER_LOCK "SELECT locked FROM Users WHERE usernum = ?"
 #define INSERT_TRANSMITTING "INSERT INTO Transmitting (usernum, timestamp) VALUES (?, NOW())"
 #define INSERT_SIGNATURE "INSERT INTO Signatures (usernum, cryptkey, junk, signature, created) VALUES (?, ?, ?, ?, NOW())"
 #define INSERT_RECEIVING "REPLACE INTO Receiving (usernum, subnet, timestamp) VALUES (?, ?, NOW())"
@@ -217,11 +223,14 @@
 											SELECT_PATTERNS, \
 											SELECT_FILTERS, \
 											SELECT_MESSAGES_ROLLOUT, \
+											SELECT_USER_ROLLOUT, \
+											DELETE_MESSAGES_ROLLOUT, \
 											SELECT_TRANSMITTING, \
 											SELECT_RECEIVING, \
 											SELECT_USERS_AUTH, \
 											SMTP_SELECT_USER_AUTH, \
 											SELECT_PREFS_INBOUND, \
+											SELECT_USER_LOCK, \
 											INSERT_TRANSMITTING, \
 											INSERT_SIGNATURE, \
 											INSERT_RECEIVING, \
@@ -321,11 +330,14 @@
 											**select_patterns, \
 											**select_filters, \
 											**select_messages_rollout, \
+											**select_user_rollout, \
+											**delete_messages_rollout, \
 											**select_transmitting, \
 											**select_receiving, \
 											**select_users_auth, \
 											**smtp_select_user_auth, \
 											**select_prefs_inbound, \
+											**select_user_lock, \
 											**insert_transmitting, \
 											**insert_signature, \
 											**insert_receiving, \
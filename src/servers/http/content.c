@@ -8,9 +8,11 @@
 #include "magma.h"
 
 struct {
+	pthread_mutex_t lock;
 	inx_t *fonts, *pages, *templates;
 } content = {
-	.fonts = NULL, .pages = NULL, .templates = NULL
+	.fonts = NULL, .pages = NULL, .templates = NULL,
+	.lock = PTHREAD_MUTEX_INITIALIZER
 };
 
 /// LOW: These functions should all be renamed to http_content_XXXX. The file and directory functions should be updated
@@ -27,9 +29,12 @@ struct {
 void http_free_content(http_content_t *page) {
 
 	if (page) {
+		http_template_free(page->compiled);
 		st_cleanup(page->location);
 		st_cleanup(page->resource);
 		st_cleanup(page->type);
+		st_cleanup(page->etag);
+		st_cleanup(page->gzip);
 		mm_free(page);
 	}
 
@@ -91,6 +96,47 @@ http_content_t * http_get_template(chr_t *location) {
 	return inx_find(content.templates, key);
 }
 
+/**
+ * @brief	Generate the entity tag, and the compressed variant, of a static resource so they don't have to be computed for each request.
+ * @note	The compressed variant is only kept for textual content types, and only when it is meaningfully smaller than the original.
+ * @param	resource	a pointer to the static resource being loaded.
+ * @return	true on success or false on failure.
+ */
+bool_t http_content_encode(http_content_t *resource) {
+
+	stringer_t *compressed;
+
+	// The entity tag is strong, so it combines a hash of the content with its length, which makes collisions implausible.
+	if (!(resource->etag = st_aprint_opts(MANAGED_T | CONTIGUOUS | HEAP, "\"%016lx-%zx\"", hash_murmur64(st_data_get(resource->resource),
+		st_length_get(resource->resource)), st_length_get(resource->resource)))) {
+		log_pedantic("Unable to generate the entity tag for a resource.");
+		return false;
+	}
+
+	// Images in formats other than the icon format are already compressed.
+	if (st_length_get(resource->resource) < MAGMA_HTTP_GZIP_MINIMUM || (st_cmp_ci_starts(resource->type, PLACER("text/", 5)) &&
+		st_cmp_ci_eq(resource->type, PLACER("application/json", 16)) && st_cmp_ci_eq(resource->type, PLACER("application/x-javascript", 24)) &&
+		st_cmp_ci_eq(resource->type, PLACER("image/x-icon", 12)))) {
+		return true;
+	}
+
+	// A compression failure isn't fatal, since the original can still be served.
+	else if (!(compressed = compress_gzip(resource->resource))) {
+		log_pedantic("Unable to compress a resource. { location = %.*s }", st_length_int(resource->location), st_char_get(resource->location));
+		return true;
+	}
+
+	// Compressed content which saves less than an eighth of the original isn't worth the extra header and decompression effort.
+	else if (st_length_get(compressed) >= st_length_get(resource->resource) - (st_length_get(resource->resource) / 8)) {
+		st_free(compressed);
+		return true;
+	}
+
+	resource->gzip = compressed;
+
+	return true;
+}
+
 /**
  * @brief	Get a template page and prepare its xml document root for use.
  * @note	Each page is affixed with an xpath with a namespace after passing through the xml parser.
@@ -136,6 +182,353 @@ http_page_t * http_page_get(chr_t *location) {
 	return page;
 }
 
+/**
+ * @brief	Free a compiled template, along with the other compilations of the same template linked to it.
+ * @param	template	a pointer to the compiled template to be freed.
+ * @return	This function returns no value.
+ */
+void http_template_free(http_template_t *template) {
+
+	http_template_t *next;
+
+	while (template) {
+
+		next = template->next;
+
+		mm_cleanup(template->order, template->segments, template->defaults);
+		st_cleanup(template->output, template->original);
+		mm_free(template);
+
+		template = next;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Find the original value of each substitution in a compiled template.
+ * @note	The template serialized with markers only differs from the template as loaded where the markers were inserted, so the
+ * 			literal segments are matched against the original serialization, and whatever lies between them is the original value
+ * 			of a substitution, exactly as it would have been serialized. An attribute slot may add an attribute which wasn't
+ * 			present, in which case its name, and quotes, are omitted from the matching segments, and its default is left empty.
+ * @param	template	a pointer to the compiled template, which must already have been split into segments.
+ * @return	true on success or false if the segments couldn't be matched against the original serialization.
+ */
+bool_t http_template_defaults(http_template_t *template) {
+
+	chr_t *attribute;
+	placer_t segment, next;
+	size_t cursor = 0, position, prefix;
+	stringer_t *original = template->original;
+
+	for (size_t i = 0; i <= template->count; i++) {
+
+		segment = template->segments[i];
+
+		// The quote which closed an attribute that wasn't present is missing from the original.
+		if (i && !pl_data_get(template->defaults[i - 1])) {
+			segment = pl_init(pl_data_get(segment) + 1, pl_length_get(segment) - 1);
+		}
+
+		attribute = i < template->count ? template->slots[template->order[i]].attribute : NULL;
+		prefix = attribute ? ns_length_get(attribute) + 3 : 0;
+
+		if (i == template->count) {
+			return st_length_get(original) - cursor == pl_length_get(segment) && !st_cmp_cs_eq(PLACER(st_char_get(original) + cursor,
+				st_length_get(original) - cursor), &segment);
+		}
+		else if (st_length_get(original) - cursor >= pl_length_get(segment) && !st_cmp_cs_starts(PLACER(st_char_get(original) + cursor,
+			st_length_get(original) - cursor), &segment)) {
+			cursor += pl_length_get(segment);
+		}
+
+		// Otherwise the segment should end with the name of an attribute which wasn't present, so the default is left empty.
+		else if (attribute && pl_length_get(segment) >= prefix && pl_starts_with_char(template->segments[i + 1], '"') &&
+			st_length_get(original) - cursor >= pl_length_get(segment) - prefix &&
+			!st_cmp_cs_starts(PLACER(st_char_get(original) + cursor, st_length_get(original) - cursor), PLACER(pl_data_get(segment),
+			pl_length_get(segment) - prefix))) {
+			cursor += pl_length_get(segment) - prefix;
+			template->defaults[i] = pl_null();
+			continue;
+		}
+		else {
+			return false;
+		}
+
+		// The default ends where the next segment begins, excluding any attribute name the next segment might add.
+		next = template->segments[i + 1];
+
+		prefix = i + 1 < template->count && template->slots[template->order[i + 1]].attribute ?
+			ns_length_get(template->slots[template->order[i + 1]].attribute) + 3 : 0;
+
+		if (pl_length_get(next) <= prefix) {
+			return false;
+		}
+
+		next = pl_init(pl_data_get(next), pl_length_get(next) - prefix);
+
+		if ( !st_search_cs(PLACER(st_char_get(original) + cursor, st_length_get(original) - cursor), &next, &position)) {
+			return false;
+		}
+
+		// The default needs a non-NULL pointer, even when it's empty, to distinguish it from an attribute which wasn't present.
+		template->defaults[i] = pl_init(st_char_get(original) + cursor, position);
+		cursor += position;
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Compile a template into the literal segments which surround a set of substitution slots.
+ * @note	The template is parsed, and each slot is replaced with a numbered marker, before the document is serialized. The
+ * 			serialized document is then split at the markers, so rendering the template only requires copying the segments
+ * 			and the escaped values into a buffer. The original value of each slot is taken from the template serialized without
+ * 			the markers, so a slot without a value renders exactly as it did before the template was compiled.
+ * @param	location	a pointer to a null-terminated string with the location of the template.
+ * @param	slots		an array of the slots to be replaced when the template is rendered.
+ * @param	total		the number of slots in the array.
+ * @return	NULL on failure, or a pointer to the compiled template, which must be freed by the caller.
+ */
+http_template_t * http_template_compile(chr_t *location, http_slot_t *slots, size_t total) {
+
+	uint32_t slot;
+	chr_t marker[32];
+	http_page_t *page;
+	http_template_t *template;
+	size_t position, length, offset = 0;
+
+	if (!(page = http_page_get(location))) {
+		return NULL;
+	}
+	else if (!(template = mm_alloc(sizeof(http_template_t))) || !(template->defaults = mm_alloc(sizeof(placer_t) * (total + 1))) ||
+		!(template->order = mm_alloc(sizeof(uint32_t) * (total + 1))) || !(template->segments = mm_alloc(sizeof(placer_t) * (total + 1)))) {
+		log_pedantic("Unable to allocate memory for the compiled template. { location = %s }", location);
+		http_template_free(template);
+		http_page_free(page);
+		return NULL;
+	}
+
+	template->slots = slots;
+	template->total = total;
+	template->type = page->content->type;
+
+	if (!(template->original = xml_dump_doc(page->doc_obj))) {
+		log_pedantic("Unable to serialize the template. { location = %s }", location);
+		http_template_free(template);
+		http_page_free(page);
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < total; i++) {
+
+		snprintf(marker, sizeof(marker), "$MAGMA-SLOT-%u$", i);
+
+		if (slots[i].attribute) {
+			xml_set_xpath_property(page->xpath_ctx, (xmlChar *)slots[i].xpath, (uchr_t *)slots[i].attribute, (uchr_t *)marker);
+		}
+		else {
+			xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)slots[i].xpath, (uchr_t *)marker);
+		}
+	}
+
+	if (!(template->output = xml_dump_doc(page->doc_obj))) {
+		log_pedantic("Unable to serialize the template. { location = %s }", location);
+		http_template_free(template);
+		http_page_free(page);
+		return NULL;
+	}
+
+	http_page_free(page);
+	length = st_length_get(template->output);
+
+	// Split the serialized template at each marker. A slot whose xpath didn't match anything simply won't have a marker.
+	while (st_search_cs(PLACER(st_char_get(template->output) + offset, length - offset), PLACER("$MAGMA-SLOT-", 12), &position)) {
+
+		template->segments[template->count] = pl_init(st_char_get(template->output) + offset, position);
+		offset += position + 12;
+
+		if (!st_search_chr(PLACER(st_char_get(template->output) + offset, length - offset), '$', &position) ||
+			!uint32_conv_bl(st_char_get(template->output) + offset, position, &slot) || slot >= total || template->count >= total) {
+			log_pedantic("The template contains an invalid substitution marker. { location = %s }", location);
+			http_template_free(template);
+			return NULL;
+		}
+
+		template->order[template->count++] = slot;
+		offset += position + 1;
+	}
+
+	template->segments[template->count] = pl_init(st_char_get(template->output) + offset, length - offset);
+
+	if (!http_template_defaults(template)) {
+		log_pedantic("Unable to find the original values of the template slots. { location = %s }", location);
+		http_template_free(template);
+		return NULL;
+	}
+
+	return template;
+}
+
+/**
+ * @brief	Copy a value into a rendered template, escaping the characters which are reserved in markup.
+ * @note	The characters escaped are the ones the xml serializer escapes in text and attribute values, so a rendered value is
+ * 			identical to the same value set on the document and serialized.
+ * @param	value		a pointer to the value being copied.
+ * @param	length		the length, in bytes, of the value.
+ * @param	attribute	true if the value is being placed inside an attribute, which also requires escaping quotes and whitespace.
+ * @param	output		a pointer to the output buffer, or NULL to only calculate the length of the escaped value.
+ * @return	the length, in bytes, of the escaped value.
+ */
+size_t http_template_escape(chr_t *value, size_t length, bool_t attribute, chr_t *output) {
+
+	chr_t *entity;
+	size_t result = 0, size;
+
+	for (size_t i = 0; i < length; i++) {
+
+		switch (value[i]) {
+			case '&':
+				entity = "&amp;";
+				break;
+			case '<':
+				entity = "&lt;";
+				break;
+			case '>':
+				entity = "&gt;";
+				break;
+			case '\r':
+				entity = "&#13;";
+				break;
+			case '"':
+				entity = attribute ? "&quot;" : NULL;
+				break;
+			case '\n':
+				entity = attribute ? "&#10;" : NULL;
+				break;
+			case '\t':
+				entity = attribute ? "&#9;" : NULL;
+				break;
+			default:
+				entity = NULL;
+				break;
+		}
+
+		if (!entity) {
+			if (output) output[result] = value[i];
+			result++;
+		}
+		else {
+			size = ns_length_get(entity);
+			if (output) mm_copy(output + result, entity, size);
+			result += size;
+		}
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Render a compiled template.
+ * @note	The length of the page is calculated first, so the page can be assembled in a single buffer.
+ * @param	template	a pointer to the compiled template.
+ * @param	values		an array of null-terminated strings with a value for each slot, in the order the slots were provided when the
+ * 						template was compiled. A NULL value, or a NULL array, leaves the original value of the slot in place.
+ * @return	NULL on failure, or a managed string containing the rendered page, which must be freed by the caller.
+ */
+stringer_t * http_template_render(http_template_t *template, chr_t **values) {
+
+	chr_t *data, *value;
+	placer_t segment;
+	stringer_t *output;
+	bool_t omitted = false;
+	size_t length = 0, used = 0;
+
+	// Both passes walk the segments the same way, the first to calculate the length, and the second to copy the data.
+	for (int_t pass = 0; pass < 2; pass++) {
+
+		if (pass && !(output = st_alloc(length + 1))) {
+			log_pedantic("Unable to allocate %zu bytes for the rendered template.", length + 1);
+			return NULL;
+		}
+
+		data = pass ? st_char_get(output) : NULL;
+		omitted = false;
+
+		for (size_t i = 0; i <= template->count; i++) {
+
+			segment = template->segments[i];
+			value = i < template->count && values ? values[template->order[i]] : NULL;
+
+			// Drop the quote which closes an attribute that was omitted.
+			if (omitted) {
+				segment = pl_init(pl_data_get(segment) + 1, pl_length_get(segment) - 1);
+			}
+
+			// An attribute which wasn't present in the template, and isn't being set, is omitted along with its name.
+			if ((omitted = (i < template->count && !value && !pl_data_get(template->defaults[i])))) {
+				segment = pl_init(pl_data_get(segment), pl_length_get(segment) - ns_length_get(template->slots[template->order[i]].attribute) - 3);
+			}
+
+			if (pass) mm_copy(data + used, pl_data_get(segment), pl_length_get(segment));
+			used += pl_length_get(segment);
+
+			if (i == template->count || omitted) {
+				continue;
+			}
+			else if (value) {
+				used += http_template_escape(value, ns_length_get(value), template->slots[template->order[i]].attribute != NULL, pass ? data + used : NULL);
+			}
+			else {
+				if (pass) mm_copy(data + used, pl_data_get(template->defaults[i]), pl_length_get(template->defaults[i]));
+				used += pl_length_get(template->defaults[i]);
+			}
+		}
+
+		if (!pass) {
+			length = used;
+			used = 0;
+		}
+	}
+
+	st_length_set(output, used);
+
+	return output;
+}
+
+/**
+ * @brief	Get the compiled form of a template, for a specific set of slots.
+ * @note	Each template is compiled the first time it's rendered with a given set of slots, and the result is kept with the
+ * 			template content, so it's discarded, and compiled again, whenever the templates are reloaded.
+ * @param	location	a pointer to a null-terminated string with the location of the template.
+ * @param	slots		an array of the slots to be replaced when the template is rendered.
+ * @param	total		the number of slots in the array.
+ * @return	NULL on failure, or a pointer to the compiled template, which belongs to the template content.
+ */
+http_template_t * http_template_get(chr_t *location, http_slot_t *slots, size_t total) {
+
+	http_content_t *resource;
+	http_template_t *template;
+
+	if (!(resource = http_get_template(location))) {
+		log_pedantic("Unable to find the requested resource. {location = %s}", location);
+		return NULL;
+	}
+
+	mutex_lock(&(content.lock));
+
+	for (template = resource->compiled; template && template->slots != slots; template = template->next);
+
+	if (!template && (template = http_template_compile(location, slots, total))) {
+		template->next = resource->compiled;
+		resource->compiled = template;
+	}
+
+	mutex_unlock(&(content.lock));
+
+	return template;
+}
+
 /**
  * @brief	Load file content into the http server repository.
  * @note	Each file that is loaded will be cached for retrieval by http clients, with its mime type determined automatically.
@@ -197,6 +590,7 @@ bool_t http_load_file(int_t template, chr_t *filename) {
 	}
 	else {
 		resource->resource = data;
+		resource->modified = file_info.st_mtime;
 	}
 
 	// Build the location.
@@ -257,6 +651,12 @@ bool_t http_load_file(int_t template, chr_t *filename) {
 		return false;
 	}
 
+	// Static content is sent as is, so the validators and compressed variant can be prepared ahead of time.
+	else if (template == 0 && !http_content_encode(resource)) {
+		http_free_content(resource);
+		return false;
+	}
+
 	// Trim the extension off the static HTML files and web application templates.
 	if (template == 1 && !st_cmp_ci_ends(NULLER(filename), PLACER(".template", 9))) {
 		st_length_set(resource->location, st_length_get(resource->location) - 9);
@@ -267,12 +667,16 @@ bool_t http_load_file(int_t template, chr_t *filename) {
 
 		// Duplicate the content structure.
 		if ((index = mm_alloc(sizeof(http_content_t))) == NULL || (index->resource = st_dupe(resource->resource)) == NULL ||
-			(index->type = st_dupe(resource->type)) == NULL	|| (index->location = st_dupe(resource->location)) == NULL) {
+			(index->type = st_dupe(resource->type)) == NULL	|| (index->location = st_dupe(resource->location)) == NULL ||
+			(index->etag = st_dupe(resource->etag)) == NULL || (resource->gzip && (index->gzip = st_dupe(resource->gzip)) == NULL)) {
 			log_pedantic("Unable to copy the index page.");
 			http_free_content(resource);
+			http_free_content(index);
 			return false;
 		}
 
+		index->modified = resource->modified;
+
 		// Trim the index.html from the location.
 		st_length_set(index->location, st_length_get(index->location) - 10);
 
@@ -47,6 +47,7 @@ enum {
 };
 
 /// content.c
+bool_t            http_content_encode(http_content_t *resource);
 bool_t            http_content_load_directory(int_t template, chr_t *directory);
 bool_t            http_content_load_fonts(void);
 bool_t            http_content_refresh(void);
@@ -58,6 +59,12 @@ http_content_t *  http_get_template(chr_t *location);
 bool_t             http_load_file(int_t template, chr_t *filename);
 void              http_page_free(http_page_t *page);
 http_page_t *     http_page_get(chr_t *location);
+http_template_t * http_template_compile(chr_t *location, http_slot_t *slots, size_t total);
+bool_t            http_template_defaults(http_template_t *template);
+size_t            http_template_escape(chr_t *value, size_t length, bool_t attribute, chr_t *output);
+void              http_template_free(http_template_t *template);
+http_template_t * http_template_get(chr_t *location, http_slot_t *slots, size_t total);
+stringer_t *      http_template_render(http_template_t *template, chr_t **values);
 
 /// data.c
 void           http_data_free(http_data_t *data);
@@ -100,9 +107,12 @@ void          http_response(connection_t *con);
 stringer_t *  http_response_allow_cross(connection_t *con);
 stringer_t *  http_response_connection(connection_t *con, int_t force);
 stringer_t *  http_response_cookie(connection_t *con);
+bool_t        http_response_gzip(connection_t *con);
 void          http_response_header(connection_t *con, int_t status, stringer_t *type, size_t len);
 void          http_response_options(connection_t *con);
+void          http_response_static(connection_t *con, http_content_t *content);
 chr_t *       http_response_status(int_t status);
+bool_t        http_response_unmodified(connection_t *con, stringer_t *etag);
 
 /// sessions.c
 void   http_session_destroy(connection_t *con);
@@ -406,6 +406,157 @@ void http_response_header(connection_t *con, int_t status, stringer_t *type, siz
 	return;
 }
 
+/**
+ * @brief	Determine whether the client will accept a response compressed using gzip.
+ * @note	Any coding given a quality of zero is treated as unacceptable, and the wildcard coding counts unless gzip is listed explicitly.
+ * @param	con		the client connection which made the request.
+ * @return	true if the Accept-Encoding header allows gzip, or false if it doesn't.
+ */
+bool_t http_response_gzip(connection_t *con) {
+
+	int_t ret = 0, last;
+	bool_t wildcard = false, rejected;
+	http_data_t *field;
+	placer_t item, coding, param;
+
+	if (!(field = http_data_get(con, HTTP_DATA_HEADER, "Accept-Encoding")) || st_empty(field->value)) {
+		return false;
+	}
+
+	for (uint64_t i = 0; ret != 1 && (ret = tok_get_st(field->value, ',', i, &item)) >= 0; i++) {
+
+		last = 0;
+		rejected = false;
+
+		if (tok_get_pl(item, ';', 0, &coding) < 0 || pl_empty(coding = pl_trim(coding))) {
+			continue;
+		}
+
+		// A quality value made up of only zeros and the decimal point means the coding is unacceptable.
+		for (uint64_t j = 1; !last && (last = tok_get_pl(item, ';', j, &param)) >= 0; j++) {
+
+			param = pl_trim(param);
+
+			if (pl_length_get(param) > 2 && !st_cmp_ci_starts(&param, PLACER("q=", 2))) {
+				rejected = true;
+				for (size_t k = 2; rejected && k < pl_length_get(param); k++) {
+					if (*(pl_char_get(param) + k) != '0' && *(pl_char_get(param) + k) != '.') rejected = false;
+				}
+			}
+		}
+
+		if (!st_cmp_ci_eq(&coding, PLACER("gzip", 4)) || !st_cmp_ci_eq(&coding, PLACER("x-gzip", 6))) {
+			return !rejected;
+		}
+		else if (!st_cmp_cs_eq(&coding, PLACER("*", 1))) {
+			wildcard = !rejected;
+		}
+	}
+
+	return wildcard;
+}
+
+/**
+ * @brief	Determine whether the copy of a resource held by the client is still current.
+ * @param	con		the client connection which made the request.
+ * @param	etag	a managed string containing the quoted entity tag of the resource being requested.
+ * @return	true if the If-None-Match header matches the entity tag, or false if the resource should be sent.
+ */
+bool_t http_response_unmodified(connection_t *con, stringer_t *etag) {
+
+	http_data_t *field;
+
+	if (st_empty(etag) || !(field = http_data_get(con, HTTP_DATA_HEADER, "If-None-Match")) || st_empty(field->value)) {
+		return false;
+	}
+
+	// Since the tags are quoted, a search matches a complete tag from the list, including any with a weak prefix.
+	return !st_cmp_cs_eq(field->value, PLACER("*", 1)) || st_search_cs(field->value, etag, NULL);
+}
+
+/**
+ * @brief	Send a static resource, using the compressed variant when the client accepts it, or a 304 if the client copy is current.
+ * @note	If the mode is HTTP_RESPOND it will be changed to HTTP_COMPLETE, to tell the http requeue function to reset the context and enqueue request processor.
+ * @param	con			the client connection which made the request.
+ * @param	content		the static resource being requested.
+ * @return	This function returns no value.
+ */
+void http_response_static(connection_t *con, http_content_t *content) {
+
+	int_t status = 200;
+	stringer_t *body = NULL, *cache, *entity, *cookie = NULL, *allow = NULL, *connection = NULL;
+
+	// Indicate the request has been processed so the requeue method will reset the context and enqueue HTTP processor.
+	if (con->http.mode == HTTP_RESPOND) {
+		con->http.mode = HTTP_COMPLETE;
+	}
+
+	// A 304 response repeats the validators and caching headers, but has no content, so the entity headers are left out.
+	if (http_response_unmodified(con, content->etag)) {
+		entity = PLACER("", 0);
+		stats_increment_by_name("http.static.unmodified");
+		status = 304;
+	}
+	else if (content->gzip && http_response_gzip(con)) {
+		body = content->gzip;
+		entity = st_quick(MANAGEDBUF(256), "Content-Type: %.*s\r\nContent-Encoding: gzip\r\nContent-Length: %zu\r\n", st_length_int(content->type),
+			st_char_get(content->type), st_length_get(body));
+		stats_increment_by_name("http.static.compressed");
+	}
+	else {
+		body = content->resource;
+		entity = st_quick(MANAGEDBUF(256), "Content-Type: %.*s\r\nContent-Length: %zu\r\n", st_length_int(content->type),
+			st_char_get(content->type), st_length_get(body));
+	}
+
+	// Without a max age, browsers are still allowed to keep a copy, but they must revalidate it with the entity tag before using it.
+	if (magma.http.max_age) {
+		cache = st_quick(MANAGEDBUF(64), "max-age=%u", magma.http.max_age);
+	}
+	else {
+		cache = PLACER("no-cache", 8);
+	}
+
+	if (magma.http.allow_cross_domain) {
+		allow = http_response_allow_cross(con);
+	}
+
+	cookie = http_response_cookie(con);
+	connection = http_response_connection(con, HTTP_CONNECTION_NEUTRAL);
+
+	con_print(con, "HTTP/1.1 %i %s\r\n" \
+		"Date: %s\r\n" \
+		"%.*s" \
+		"%.*s" \
+		"Cache-Control: %.*s\r\n" \
+		"ETag: %.*s\r\n" \
+		"Last-Modified: %s\r\n" \
+		"%s" \
+		"%.*s" \
+		"%.*s" \
+		"\r\n",
+		status, http_response_status(status),
+		st_char_get(time_print_gmt(MANAGEDBUF(128), "%a, %d %b %Y %T %Z", time(NULL))),
+		(allow ? st_length_int(allow) : 0),	(allow ? st_char_get(allow) : NULL),
+		(cookie ? st_length_int(cookie) : 0), (cookie ? st_char_get(cookie) : NULL),
+		st_length_int(cache), st_char_get(cache),
+		st_length_int(content->etag), st_char_get(content->etag),
+		st_char_get(time_print_gmt(MANAGEDBUF(128), "%a, %d %b %Y %T %Z", content->modified)),
+		(content->gzip ? "Vary: Accept-Encoding\r\n" : ""),
+		st_length_int(entity), st_char_get(entity),
+		(connection ? st_length_int(connection) : 0), (connection ? st_char_get(connection) : NULL));
+
+	if (body) {
+		con_write_st(con, body);
+	}
+
+	st_cleanup(allow);
+	st_cleanup(cookie);
+	st_cleanup(connection);
+
+	return;
+}
+
 /**
  * @brief	Make a response to an http client request.
  * @note	The following http methods aren't supported: PUT, DELETE, HEAD, TRACE, and CONNECT.
@@ -443,8 +594,7 @@ void http_response(connection_t *con) {
 
 	// We check this list first so that static resources take precedence. This allows for static content to be served using dynamic application paths.
 	else if ((content = http_get_static(con->http.location))) {
-		http_response_header(con, 200, content->type, st_length_get(content->resource));
-		con_write_st(con, content->resource);
+		http_response_static(con, content);
 	}
 	// A special case: upload through the portal.
 	else if (!st_cmp_cs_starts(con->http.location, NULLER("/portal/camel/attach/"))) {
@@ -90,6 +90,10 @@ void imap_process(connection_t *con) {
 		else if (state == -2) {
 			con_print(con, "%.*s BAD Unable to parse the command.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 		}
+		else if (state == -4) {
+			con_print(con, "%.*s NO [LIMIT] The command literals exceeded the maximum combined size of %u bytes.\r\n", st_length_int(con->imap.tag),
+				st_char_get(con->imap.tag), IMAP_LITERALS_LIMIT);
+		}
 		else {
 			con_print(con, "%.*s BAD The command arguments were submitted using an invalid syntax.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 		}
@@ -181,44 +181,25 @@ imap_fetch_dataitems_t * imap_parse_dataitems(imap_arguments_t *arguments) {
 	return output;
 }
 
-stringer_t * imap_fetch_envelope(stringer_t *header) {
+stringer_t * imap_fetch_envelope(stringer_t **fields) {
 
-	placer_t header_pl = pl_null();
-	stringer_t *holder[10], *parsed[6], *output = NULL;
+	stringer_t *parsed[6], *output = NULL;
 
-	if (!header) {
+	if (!fields) {
 		return NULL;
 	}
-	else {
-		header_pl = pl_init(st_char_get(header), st_length_get(header));
-	}
-
-	holder[0] = mail_header_fetch_cleaned(&header_pl, PLACER("Date", 4));
-	holder[1] = mail_header_fetch_cleaned(&header_pl, PLACER("Subject", 7));
-	holder[2] = mail_header_fetch_cleaned(&header_pl, PLACER("From", 4));
-	holder[3] = mail_header_fetch_cleaned(&header_pl, PLACER("Sender", 6));
-	holder[4] = mail_header_fetch_cleaned(&header_pl, PLACER("Reply-To", 8));
-	holder[5] = mail_header_fetch_cleaned(&header_pl, PLACER("To", 2));
-	holder[6] = mail_header_fetch_cleaned(&header_pl, PLACER("Cc", 2));
-	holder[7] = mail_header_fetch_cleaned(&header_pl, PLACER("Bcc", 3));
-	holder[8] = mail_header_fetch_cleaned(&header_pl, PLACER("In-Reply-To", 11));
-	holder[9] = mail_header_fetch_cleaned(&header_pl, PLACER("Message-Id", 10));
-
-	parsed[0] = imap_parse_address(holder[2]);
-	parsed[1] = imap_parse_address(holder[3]);
-	parsed[2] = imap_parse_address(holder[4]);
-	parsed[3] = imap_parse_address(holder[5]);
-	parsed[4] = imap_parse_address(holder[6]);
-	parsed[5] = imap_parse_address(holder[7]);
-
-	output = imap_build_array("ssaaaaaass", holder[0], holder[1], parsed[0], parsed[1] == NULL ? parsed[0] : parsed[1],
-		parsed[2] == NULL ? parsed[0] : parsed[2], parsed[3], parsed[4], parsed[5], holder[8], holder[9]);
 
-	// Cleanup
-	for (int_t i = 0; i < 10; i++) {
-		st_cleanup(holder[i]);
-	}
+	parsed[0] = imap_parse_address(fields[MAIL_SUMMARY_FROM]);
+	parsed[1] = imap_parse_address(fields[MAIL_SUMMARY_SENDER]);
+	parsed[2] = imap_parse_address(fields[MAIL_SUMMARY_REPLY_TO]);
+	parsed[3] = imap_parse_address(fields[MAIL_SUMMARY_TO]);
+	parsed[4] = imap_parse_address(fields[MAIL_SUMMARY_CC]);
+	parsed[5] = imap_parse_address(fields[MAIL_SUMMARY_BCC]);
+
+	output = imap_build_array("ssaaaaaass", fields[MAIL_SUMMARY_DATE], fields[MAIL_SUMMARY_SUBJECT], parsed[0], parsed[1] == NULL ? parsed[0] : parsed[1],
+		parsed[2] == NULL ? parsed[0] : parsed[2], parsed[3], parsed[4], parsed[5], fields[MAIL_SUMMARY_IN_REPLY_TO], fields[MAIL_SUMMARY_MESSAGE_ID]);
 
+	// Cleanup
 	for (int_t i = 0; i < 6; i++) {
 		st_cleanup(parsed[i]);
 	}
@@ -1047,7 +1028,7 @@ imap_fetch_response_t * imap_fetch_message(connection_t *con, meta_message_t *me
 	struct tm ltime;
 	chr_t buffer[128];
 	mail_message_t *message = NULL;
-	stringer_t *value, *header = NULL;
+	stringer_t *value, *header = NULL, *fields[MAIL_SUMMARY_FIELDS];
 	imap_fetch_response_t *output = NULL;
 
 	// Process the UID.
@@ -1177,17 +1158,23 @@ imap_fetch_response_t * imap_fetch_message(connection_t *con, meta_message_t *me
 		}
 	}
 
-	// Process the message envelope.
+	// Process the message envelope. The fields come from the summary cache, so the message usually doesn't have to be loaded.
 	if (items->envelope == 1) {
-		if ((header = imap_fetch_return_header(con, meta, &message, &header, output)) == NULL) {
+		if (!mail_summary_get(meta, con->imap.user, con->server, fields)) {
+			mail_destroy(message);
+			mail_destroy_header(header);
+			imap_fetch_response_free(output);
 			return NULL;
 		}
-		else if ((value = imap_fetch_envelope(header)) == NULL) {
+		else if ((value = imap_fetch_envelope(fields)) == NULL) {
+			for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) st_cleanup(fields[i]);
 			mail_destroy(message);
 			mail_destroy_header(header);
 			imap_fetch_response_free(output);
 			return NULL;
 		}
+
+		for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) st_cleanup(fields[i]);
 		output = imap_fetch_response_add(output, PLACER("ENVELOPE", 8), value);
 	}
 
@@ -1278,36 +1265,37 @@ inx_t * imap_duplicate_messages(inx_t *messages) {
 // Returns a copy of the messages. Make sure you rely on the message numbers and not the sequence numbers.
 inx_t * imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *range, int_t uid) {
 
-	int_t asterisk;
 	inx_t *output = NULL;
 	inx_cursor_t *cursor;
-	uint32_t commas, parts;
 	meta_message_t *active;
-	placer_t sequence, start_token, end_token;
+	uint64_t number = 0;
+	imap_sequence_t *sequence;
 	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
-	uint64_t start, end, number, highest_uid = 0, highest_seq = 0;
 
 	if (!messages || !range) {
 		log_error("Sanity check failed, passed a NULL parameter.");
 		return NULL;
 	}
 
+	// Compile the sequence set once, so each message can be checked against it with a binary search instead of re-parsing the set.
+	if (!(sequence = imap_sequence_compile(range, imap_sequence_highest(messages, selected, uid)))) {
+		return NULL;
+	}
+
 	// Allocate the linked list.
 	if (!(output = inx_alloc(M_INX_LINKED, NULL))) {
+		mm_free(sequence);
 		return NULL;
 	}
 
-	// Find the highest message number.
+	// Loop through and collect the messages. Because the intervals are merged, each message is only added once, in mailbox order.
 	if ((cursor = inx_cursor_alloc(messages))) {
 
 		while ((active = inx_cursor_value_next(cursor))) {
 
-			if (active->foldernum == selected && active->messagenum > highest_uid) {
-				highest_uid = active->messagenum;
-			}
-
-			if (active->foldernum == selected && active->sequencenum > highest_seq) {
-				highest_seq = active->sequencenum;
+			if (active->foldernum == selected && imap_sequence_contains(sequence, uid == 1 ? active->messagenum : ++number)) {
+				key.val.u64 = active->messagenum;
+				inx_append(output, key, active);
 			}
 
 		}
@@ -1315,103 +1303,7 @@ inx_t * imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *ran
 		inx_cursor_free(cursor);
 	}
 
-	// Count the commas.
-	commas = tok_get_count_st(range, ',');
-
-	// Break apart each sequence section.
-	for (uint32_t i = 0; i < commas && tok_get_st(range, ',', i, &sequence) >= 0; i++) {
-
-		// Reset the counters.
-		start = end = asterisk = 0;
-		start_token = end_token = pl_null();
-
-		// How many parts are in this sequence.
-		if (!(parts = tok_get_count_st(&sequence, ':'))) {
-			log_pedantic("range parsing error = %.*s", st_length_int(range), st_char_get(range));
-			inx_cleanup(output);
-			return NULL;
-		}
-
-		// Try and get the first part of the sequence.
-		if (tok_get_st(&sequence, ':', 0, &start_token) < 0) {
-			log_pedantic("range parsing error = %.*s", st_length_int(range), st_char_get(range));
-			inx_cleanup(output);
-			return NULL;
-		}
-
-		if (parts > 1) {
-			tok_get_st(&sequence, ':', 1, &end_token);
-		}
-
-		// Parse the start.
-		if (*(pl_char_get(start_token)) == '*') {
-			asterisk = 1;
-		}
-		else {
-
-			if (!uint64_conv_st(&start_token, &start)) {
-				log_pedantic("range parsing error = %.*s", st_length_int(range), st_char_get(range));
-				inx_cleanup(output);
-				return NULL;
-			}
-
-		}
-
-		// Parse the end.
-		if (!pl_empty(end_token) && *(pl_char_get(end_token)) == '*') {
-			asterisk = 1;
-		}
-		else if (pl_empty(end_token)) {
-			end = start;
-		}
-		else {
-
-			if (!uint64_conv_st(&end_token, &end)) {
-				log_pedantic("range parsing error = %.*s", st_length_int(range), st_char_get(range));
-				inx_cleanup(output);
-				return NULL;
-			}
-
-		}
-
-		// If necessary, swap the values.
-		if (asterisk == 1 && end != 0) {
-			start = end;
-		}
-		else if (asterisk == 0 && start > end) {
-			number = start;
-			start = end;
-			end = number;
-		}
-
-		// If either value is higher than any valid message value, and we have an asterisk, include the highest numbered message. Observed behavior.
-		if (uid == 0 && asterisk == 1 && start > highest_seq) {
-			start = highest_seq;
-		}
-		else if (uid == 1 && asterisk == 1 && start > highest_uid) {
-			start = highest_uid;
-		}
-
-		// Loop through and collect the messages.
-		number = 0;
-
-		//log_pedantic("start = %lu / end = %lu / asterisk = %i / uid = %i { %.*s }", start, end, asterisk, uid, st_length_int(range), st_char_get(range));
-
-		if ((cursor = inx_cursor_alloc(messages))) {
-
-			while ((active = inx_cursor_value_next(cursor))) {
-
-				if (active->foldernum == selected && ((uid == 0 && ++number >= start && (asterisk == 1 || number <= end)) ||
-					(uid == 1 && active->messagenum >= start && (asterisk == 1 || active->messagenum <= end)))) {
-					key.val.u64 = active->messagenum;
-					inx_append(output, key, active);
-				}
-
-			}
-
-			inx_cursor_free(cursor);
-		}
-	}
+	mm_free(sequence);
 
 	// If no nodes were returned.
 	if (!inx_count(output)) {
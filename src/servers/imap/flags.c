@@ -112,6 +112,7 @@ uint32_t imap_flag_parse(void *ptr, int_t type) {
 void imap_update_flags(meta_user_t *user, inx_t *messages, uint64_t foldernum, int_t action, uint32_t flags) {
 
 	inx_cursor_t *cursor;
+	meta_folder_t *folder;
 	meta_message_t *active;
 
 	uint32_t complete = (MAIL_STATUS_EMPTY | MAIL_STATUS_RECENT | MAIL_STATUS_SEEN | MAIL_STATUS_ANSWERED | MAIL_STATUS_FLAGGED | MAIL_STATUS_DELETED | MAIL_STATUS_DRAFT);
@@ -136,18 +137,20 @@ void imap_update_flags(meta_user_t *user, inx_t *messages, uint64_t foldernum, i
 		return;
 	}
 
-	// Update the messages structure.
+	// Update the messages structure, and the folder counters along with it.
+	folder = meta_folders_by_number(user->folders, foldernum);
+
 	if (messages && (cursor = inx_cursor_alloc(messages))) {
 		while ((active = inx_cursor_value_next(cursor))) {
 			if (active->foldernum == foldernum) {
 				if ((action & IMAP_FLAG_ADD) == IMAP_FLAG_ADD) {
-					active->status = active->status | flags;
+					meta_message_status_set(folder, active, active->status | flags);
 				}
 				else if ((action & IMAP_FLAG_REMOVE) == IMAP_FLAG_REMOVE) {
-					active->status = (active->status | flags) ^ flags;
+					meta_message_status_set(folder, active, (active->status | flags) ^ flags);
 				}
 				else if ((action & IMAP_FLAG_REPLACE) == IMAP_FLAG_REPLACE) {
-					active->status = ((active->status | complete) ^ complete) | flags;
+					meta_message_status_set(folder, active, ((active->status | complete) ^ complete) | flags);
 				}
 			}
 		}
@@ -377,6 +377,9 @@ int_t imap_folder_create(uint64_t usernum, inx_t *folders, stringer_t *name) {
 			active->order = order;
 			active->parent = parent;
 
+			// The folder is empty, but it still has to report the next UID shared by the rest of the user's folders.
+			active->counts.uidnext = meta_folders_uidnext(folders);
+
 			// Add the new folder to the structure.
 			if (!inx_insert(folders, key, active)) {
 				mm_free(active);
@@ -607,6 +610,9 @@ int_t imap_folder_rename(uint64_t usernum, inx_t *folders, stringer_t *original,
 			active->order = order;
 			active->parent = parent;
 
+			// The folder is empty, but it still has to report the next UID shared by the rest of the user's folders.
+			active->counts.uidnext = meta_folders_uidnext(folders);
+
 			// Add the new folder to the structure.
 			if (!inx_insert(folders, key, active)) {
 				mm_free(active);
@@ -664,10 +670,11 @@ int_t imap_folder_rename(uint64_t usernum, inx_t *folders, stringer_t *original,
 
 /**
  * @brief	Get the status of a folder.
- * @note	This function will count the number of messages in a folder, as well as the number of messages marked recent or unseen,
- * 			as well as the numerical id of the first message in the folder and the UIDNEXT of the specified folder.
+ * @note	The message, recent, unseen and UIDNEXT values are read from the counters maintained on the folder structure, so the
+ * 			cost doesn't depend on the size of the mailbox. Locating the first unseen message does require a scan, so it is only
+ * 			performed when a messages collection is provided, which is only needed by SELECT and EXAMINE.
  * @param	folders		an inx holder containing a list of folders to be searched for the specified folder.
- * @param	messages	an inx holder containing a complete list of a user's messages to be examined for gathering statistics.
+ * @param	messages	if not NULL, an inx holder containing a complete list of a user's messages, used to find the first unseen message.
  * @param	name		a managed string containing the name of the imap folder to be queried.
  * @param	status		a pointer to an imap folder status object to receive the folder's status information.
  * @return	1 on success or <= 0 on failure.
@@ -678,8 +685,6 @@ int_t imap_folder_rename(uint64_t usernum, inx_t *folders, stringer_t *original,
 int_t imap_folder_status(inx_t *folders, inx_t *messages, stringer_t *name, imap_folder_status_t *status) {
 
 	meta_folder_t *folder;
-	inx_cursor_t *cursor;
-	meta_message_t *message;
 
 	if (!folders || !name || !status) {
 		log_pedantic("We were passed an invalid pointer.");
@@ -699,44 +704,107 @@ int_t imap_folder_status(inx_t *folders, inx_t *messages, stringer_t *name, imap
 		return -2;
 	}
 
-	// Store the folder number.
-	status->foldernum = folder->foldernum;
+	imap_folder_status_counts(folder, status);
 
-	// Iterate through the messages structure and collect status information.
-	if ((cursor = inx_cursor_alloc(messages))) {
+	// Only go looking for the first unseen message if we know there is one.
+	if (messages && status->unseen) {
+		status->first = imap_folder_first_unseen(messages, folder->foldernum);
+	}
 
-		while ((message = inx_cursor_value_next(cursor))) {
+	return 1;
+}
 
-			if (message->foldernum == folder->foldernum) {
-				status->messages++;
+/**
+ * @brief	Copy the status counters for a folder into an imap folder status object.
+ * @param	folder		a pointer to the meta folder object being queried.
+ * @param	status		a pointer to an imap folder status object to receive the folder's status information.
+ * @return	This function returns no value.
+ */
+void imap_folder_status_counts(meta_folder_t *folder, imap_folder_status_t *status) {
 
-				if ((message->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					status->recent++;
-				}
+	status->foldernum = folder->foldernum;
+	status->messages = folder->counts.messages;
+	status->recent = folder->counts.recent;
+	status->unseen = folder->counts.unseen;
+	status->uidnext = folder->counts.uidnext ? folder->counts.uidnext : 1;
 
-				if ((message->status & MAIL_STATUS_SEEN) != MAIL_STATUS_SEEN) {
-					status->unseen++;
+	return;
+}
 
-					if (!status->first) {
-						status->first = status->messages;
-					}
+/**
+ * @brief	Find the sequence number of the first unseen message in a folder.
+ * @param	messages	an inx holder containing a complete list of a user's messages.
+ * @param	foldernum	the numerical id of the folder being queried.
+ * @return	0 if every message has been seen, or the sequence number of the first unseen message.
+ */
+uint64_t imap_folder_first_unseen(inx_t *messages, uint64_t foldernum) {
 
-				}
+	uint64_t result = 0;
+	inx_cursor_t *cursor;
+	meta_message_t *message;
 
-			}
+	if ((cursor = inx_cursor_alloc(messages))) {
 
-			if (message->messagenum > status->uidnext) {
-				status->uidnext = message->messagenum;
+		while (!result && (message = inx_cursor_value_next(cursor))) {
+			if (message->foldernum == foldernum && (message->status & MAIL_STATUS_SEEN) != MAIL_STATUS_SEEN) {
+				result = message->sequencenum;
 			}
-
 		}
 
 		inx_cursor_free(cursor);
 	}
 
-	status->uidnext += 1;
+	return result;
+}
 
-	return 1;
+/**
+ * @brief	Format the parenthetical list of status items requested by a STATUS command, or a LIST command with a STATUS return option.
+ * @param	items	an imap arguments array holding the names of the requested status items.
+ * @param	status	a pointer to the imap folder status object holding the folder's status information.
+ * @return	NULL if no items were requested or an unrecognized item was requested, or a managed string with the formatted items on success.
+ */
+stringer_t * imap_folder_status_items(imap_arguments_t *items, imap_folder_status_t *status) {
+
+	size_t number;
+	chr_t buffer[128];
+	stringer_t *item, *output = NULL;
+
+	if (!items || !status || !(number = ar_length_get(items))) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < number; i++) {
+
+		item = imap_get_st_ar(items, i);
+
+		// Figure out what the client wants to output.
+		if (!st_cmp_ci_eq(item, PLACER("MESSAGES", 8))) {
+			snprintf(buffer, 128, "%sMESSAGES %lu", (output == NULL ? "" : " "), status->messages);
+		}
+		else if (!st_cmp_ci_eq(item, PLACER("RECENT", 6))) {
+			snprintf(buffer, 128, "%sRECENT %lu", (output == NULL ? "" : " "), status->recent);
+		}
+		else if (!st_cmp_ci_eq(item, PLACER("UNSEEN", 6))) {
+			snprintf(buffer, 128, "%sUNSEEN %lu", (output == NULL ? "" : " "), status->unseen);
+		}
+		else if (!st_cmp_ci_eq(item, PLACER("UIDNEXT", 7))) {
+			snprintf(buffer, 128, "%sUIDNEXT %lu", (output == NULL ? "" : " "), status->uidnext);
+		}
+		else if (!st_cmp_ci_eq(item, PLACER("UIDVALIDITY", 11))) {
+			snprintf(buffer, 128, "%sUIDVALIDITY %lu", (output == NULL ? "" : " "), status->foldernum);
+		}
+		// Unrecognized item requested.
+		else {
+			st_cleanup(output);
+			return NULL;
+		}
+
+		if (!(output = st_append_opts(1024, output, NULLER(buffer)))) {
+			return NULL;
+		}
+	}
+
+	return output;
 }
 
 // Will take a reference pattern and return a linked list of the folders it refers to.
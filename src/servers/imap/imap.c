@@ -311,10 +311,16 @@ void imap_check(connection_t *con) {
 
 void imap_list(connection_t *con) {
 
-	inx_t *list;
-	stringer_t *name;
-	inx_cursor_t *cursor;
-	meta_folder_t *active;
+	size_t args, count = 1, offset = 0;
+	chr_t attributes[64];
+	inx_t *list = NULL, *narrowed;
+	inx_cursor_t *cursor, *merge;
+	meta_folder_t *active, *holder;
+	stringer_t *name, *output, *pattern;
+	imap_folder_status_t status;
+	bool_t subscribed = false, children = false;
+	imap_arguments_t *selection = NULL, *patterns = NULL, *returns = NULL, *items = NULL;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
 
 	// Check for the right state.
 	if (con->imap.session_state != 1) {
@@ -322,14 +328,77 @@ void imap_list(connection_t *con) {
 		return;
 	}
 
-	// Input validation. Requires two string arguments, which can both be NULL.
-	if (ar_length_get(con->imap.arguments) != 2 || imap_get_type_ar(con->imap.arguments, 0) == IMAP_ARGUMENT_TYPE_ARRAY || imap_get_type_ar(con->imap.arguments, 1) == IMAP_ARGUMENT_TYPE_ARRAY) {
+	// The extended syntax allows a parenthetical list of selection options before the reference name.
+	if ((args = ar_length_get(con->imap.arguments)) && imap_get_type_ar(con->imap.arguments, 0) == IMAP_ARGUMENT_TYPE_ARRAY) {
+		selection = imap_get_ar_ar(con->imap.arguments, 0);
+		offset = 1;
+	}
+
+	// Input validation. Requires a string reference, followed by a mailbox string or a parenthetical list of mailbox patterns, and an optional RETURN clause.
+	if ((args != offset + 2 && args != offset + 4) || imap_get_type_ar(con->imap.arguments, offset) == IMAP_ARGUMENT_TYPE_ARRAY ||
+		(args == offset + 4 && (imap_get_type_ar(con->imap.arguments, offset + 2) == IMAP_ARGUMENT_TYPE_ARRAY ||
+		st_cmp_ci_eq(imap_get_st_ar(con->imap.arguments, offset + 2), PLACER("RETURN", 6)) ||
+		imap_get_type_ar(con->imap.arguments, offset + 3) != IMAP_ARGUMENT_TYPE_ARRAY))) {
 		con_print(con, "%.*s BAD The list command requires two string arguments.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 		return;
 	}
 
+	if (imap_get_type_ar(con->imap.arguments, offset + 1) == IMAP_ARGUMENT_TYPE_ARRAY) {
+		patterns = imap_get_ar_ar(con->imap.arguments, offset + 1);
+		count = ar_length_get(patterns);
+	}
+
+	if (args == offset + 4) {
+		returns = imap_get_ar_ar(con->imap.arguments, offset + 3);
+	}
+
+	// Check the selection options. We don't track subscriptions separately, so every folder is considered subscribed.
+	for (size_t i = 0; selection && i < ar_length_get(selection); i++) {
+		if (imap_get_type_ar(selection, i) != IMAP_ARGUMENT_TYPE_ARRAY && !st_cmp_ci_eq(imap_get_st_ar(selection, i), PLACER("SUBSCRIBED", 10))) {
+			subscribed = true;
+		}
+		else if (imap_get_type_ar(selection, i) == IMAP_ARGUMENT_TYPE_ARRAY || (st_cmp_ci_eq(imap_get_st_ar(selection, i), PLACER("REMOTE", 6)) &&
+			st_cmp_ci_eq(imap_get_st_ar(selection, i), PLACER("RECURSIVEMATCH", 14)))) {
+			con_print(con, "%.*s BAD Invalid selection option provided to the list command.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+			return;
+		}
+	}
+
+	// Check the return options.
+	for (size_t i = 0; returns && i < ar_length_get(returns); i++) {
+		if (imap_get_type_ar(returns, i) == IMAP_ARGUMENT_TYPE_ARRAY) {
+			con_print(con, "%.*s BAD Invalid return option provided to the list command.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+			return;
+		}
+		else if (!st_cmp_ci_eq(imap_get_st_ar(returns, i), PLACER("SUBSCRIBED", 10))) {
+			subscribed = true;
+		}
+		else if (!st_cmp_ci_eq(imap_get_st_ar(returns, i), PLACER("CHILDREN", 8))) {
+			children = true;
+		}
+		else if (!st_cmp_ci_eq(imap_get_st_ar(returns, i), PLACER("STATUS", 6)) && imap_get_type_ar(returns, i + 1) == IMAP_ARGUMENT_TYPE_ARRAY) {
+			items = imap_get_ar_ar(returns, ++i);
+		}
+		else {
+			con_print(con, "%.*s BAD Invalid return option provided to the list command.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+			return;
+		}
+	}
+
+	// Make sure the requested status items are valid before we start printing.
+	if (items) {
+		mm_wipe(&status, sizeof(imap_folder_status_t));
+
+		if (!(output = imap_folder_status_items(items, &status))) {
+			con_print(con, "%.*s BAD Invalid data item requested via the list command.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+			return;
+		}
+
+		st_free(output);
+	}
+
 	// To handle the special mailbox case.
-	if (imap_get_st_ar(con->imap.arguments, 1) == NULL) {
+	if (!patterns && imap_get_st_ar(con->imap.arguments, offset + 1) == NULL) {
 		con_print(con, "* LIST (\\Noselect) \".\" \"\"\r\n%.*s OK LIST Complete.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 		return;
 	}
@@ -357,15 +426,50 @@ void imap_list(connection_t *con) {
 	}
 	//*************************************************//
 
-	// Because the list index is a shallow copy we need to ensure the original memory buffers aren't freed by another thread.
-	if ((list = imap_narrow_folders(con->imap.user->folders, imap_get_st_ar(con->imap.arguments, 0), imap_get_st_ar(con->imap.arguments, 1))) != NULL) {
+	// Because the list index is a shallow copy we need to ensure the original memory buffers aren't freed by another thread. When
+	// multiple patterns are provided, the matches are merged into a single list so that each folder is only printed once.
+	for (size_t i = 0; i < count; i++) {
+
+		pattern = patterns ? imap_get_st_ar(patterns, i) : imap_get_st_ar(con->imap.arguments, offset + 1);
+
+		if (!pattern || !(narrowed = imap_narrow_folders(con->imap.user->folders, imap_get_st_ar(con->imap.arguments, offset), pattern))) {
+			continue;
+		}
+		else if (!list) {
+			list = narrowed;
+			continue;
+		}
+
+		if ((merge = inx_cursor_alloc(narrowed))) {
+			while ((active = inx_cursor_value_next(merge))) {
+				if ((key.val.u64 = active->foldernum) && !inx_find(list, key) && (holder = mm_dupe(active, sizeof(meta_folder_t))) &&
+					!inx_insert(list, key, holder)) {
+					mm_free(holder);
+				}
+			}
+			inx_cursor_free(merge);
+		}
+
+		inx_free(narrowed);
+	}
+
+	if (list) {
 
 		if ((cursor = inx_cursor_alloc(list))) {
 
 			// Some buggy clients require that the Inbox always come first.
 			while ((active = inx_cursor_value_next(cursor))) {
 				if (active->parent == 0 && !st_cmp_ci_eq(NULLER(active->name), PLACER("Inbox", 5))) {
-					con_print(con, "* LIST (\\Noinferiors) \".\" \"%s\"\r\n", active->name);
+					con_print(con, "* LIST (\\Noinferiors%s) \".\" \"%s\"\r\n", subscribed ? " \\Subscribed" : "", active->name);
+
+					// The status counters are maintained on the folder, so answering a STATUS return option doesn't require a message scan.
+					if (items) {
+						imap_folder_status_counts(active, &status);
+						if ((output = imap_folder_status_items(items, &status))) {
+							con_print(con, "* STATUS \"%s\" (%.*s)\r\n", active->name, st_length_int(output), st_char_get(output));
+							st_free(output);
+						}
+					}
 				}
 			}
 
@@ -376,7 +480,19 @@ void imap_list(connection_t *con) {
 			while ((active = inx_cursor_value_next(cursor))) {
 				if ((active->parent != 0 || st_cmp_ci_eq(NULLER(active->name), PLACER("Inbox", 5))) &&
 					(name = imap_folder_name_escaped(con->imap.user->folders, active))) {
-						con_print(con, "* LIST () \".\" %.*s\r\n", st_length_int(name), st_char_get(name));
+
+						snprintf(attributes, 64, "%s%s%s", children ? (meta_folders_children(con->imap.user->folders, active->foldernum) ? "\\HasChildren" : "\\HasNoChildren") : "",
+							children && subscribed ? " " : "", subscribed ? "\\Subscribed" : "");
+						con_print(con, "* LIST (%s) \".\" %.*s\r\n", attributes, st_length_int(name), st_char_get(name));
+
+						if (items) {
+							imap_folder_status_counts(active, &status);
+							if ((output = imap_folder_status_items(items, &status))) {
+								con_print(con, "* STATUS %.*s (%.*s)\r\n", st_length_int(name), st_char_get(name), st_length_int(output), st_char_get(output));
+								st_free(output);
+							}
+						}
+
 						st_free(name);
 				}
 			}
@@ -656,10 +772,6 @@ void imap_rename(connection_t *con) {
 void imap_status(connection_t *con) {
 
 	int_t state;
-	size_t number;
-	chr_t buffer[128];
-	imap_arguments_t *values;
-
 	stringer_t *output = NULL;
 	imap_folder_status_t status;
 
@@ -678,45 +790,13 @@ void imap_status(connection_t *con) {
 
 	// Get the folder status.
 	meta_user_rlock(con->imap.user);
-	state = imap_folder_status(con->imap.user->folders, con->imap.user->messages, imap_get_st_ar(con->imap.arguments, 0), &status);
+	state = imap_folder_status(con->imap.user->folders, NULL, imap_get_st_ar(con->imap.arguments, 0), &status);
 	meta_user_unlock(con->imap.user);
 
 	// Figure out what to output.
-	if (state == 1) {
-
-		values = imap_get_ar_ar(con->imap.arguments, 1);
-		number = ar_length_get(values);
-
-		for (size_t i = 0; i < number; i++) {
-
-			// Figure out what the client wants to output.
-			if (!st_cmp_ci_eq(imap_get_st_ar(values, i), PLACER("MESSAGES", 8))) {
-				snprintf(buffer, 128, "%sMESSAGES %lu", (output == NULL ? "" : " "), status.messages);
-				output = st_append_opts(1024, output, NULLER(buffer));
-			}
-			else if (!st_cmp_ci_eq(imap_get_st_ar(values, i), PLACER("RECENT", 6))) {
-				snprintf(buffer, 128, "%sRECENT %lu", (output == NULL ? "" : " "), status.recent);
-				output = st_append_opts(1024, output, NULLER(buffer));
-			}
-			else if (!st_cmp_ci_eq(imap_get_st_ar(values, i), PLACER("UNSEEN", 6))) {
-				snprintf(buffer, 128, "%sUNSEEN %lu", (output == NULL ? "" : " "), status.unseen);
-				output = st_append_opts(1024, output, NULLER(buffer));
-			}
-			else if (!st_cmp_ci_eq(imap_get_st_ar(values, i), PLACER("UIDNEXT", 7))) {
-				snprintf(buffer, 128, "%sUIDNEXT %lu", (output == NULL ? "" : " "), status.uidnext);
-				output = st_append_opts(1024, output, NULLER(buffer));
-			}
-			else if (!st_cmp_ci_eq(imap_get_st_ar(values, i), PLACER("UIDVALIDITY", 11))) {
-				snprintf(buffer, 128, "%sUIDVALIDITY %lu", (output == NULL ? "" : " "), status.foldernum);
-				output = st_append_opts(1024, output, NULLER(buffer));
-			}
-			// Unrecognized item requested.
-			else {
-				con_print(con, "%.*s BAD Invalid data item requested via the status command.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
-				if (output) st_free(output);
-				return;
-			}
-		}
+	if (state == 1 && !(output = imap_folder_status_items(imap_get_ar_ar(con->imap.arguments, 1), &status))) {
+		con_print(con, "%.*s BAD Invalid data item requested via the status command.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+		return;
 	}
 
 	if (state == 1 && output) {
@@ -804,6 +884,7 @@ void imap_examine(connection_t *con) {
 	int_t state;
 	chr_t buffer[128];
 	inx_cursor_t *cursor;
+	meta_folder_t *folder;
 	meta_message_t *active;
 	imap_folder_status_t status;
 
@@ -823,9 +904,10 @@ void imap_examine(connection_t *con) {
 	if (con->imap.selected != 0 && con->imap.read_only == 0) {
 		meta_user_wlock(con->imap.user);
 		if ((cursor = inx_cursor_alloc(con->imap.user->messages))) {
+			folder = meta_folders_by_number(con->imap.user->folders, con->imap.selected);
 			while ((active = inx_cursor_value_next(cursor))) {
 				if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					active->status = (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT;
+					meta_message_status_set(folder, active, (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT);
 				}
 			}
 		inx_cursor_free(cursor);
@@ -875,6 +957,7 @@ void imap_select(connection_t *con) {
 	int_t state;
 	chr_t buffer[128];
 	inx_cursor_t *cursor;
+	meta_folder_t *folder;
 	meta_message_t *active;
 	imap_folder_status_t status;
 
@@ -896,9 +979,10 @@ void imap_select(connection_t *con) {
 	if (con->imap.selected != 0 && con->imap.read_only == 0) {
 		meta_user_wlock(con->imap.user);
 		if ((cursor = inx_cursor_alloc(con->imap.user->messages))) {
+			folder = meta_folders_by_number(con->imap.user->folders, con->imap.selected);
 			while ((active = inx_cursor_value_next(cursor))) {
 				if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					active->status = (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT;
+					meta_message_status_set(folder, active, (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT);
 				}
 			}
 			inx_cursor_free(cursor);
@@ -1087,6 +1171,7 @@ void imap_store(connection_t *con) {
 void imap_close(connection_t *con) {
 
 	inx_cursor_t *cursor;
+	meta_folder_t *folder;
 	meta_message_t *active;
 	int_t recent = 0, deleted = 0;
 
@@ -1179,9 +1264,10 @@ void imap_close(connection_t *con) {
 	if (recent == 1) {
 		meta_user_wlock(con->imap.user);
 		if ((cursor = inx_cursor_alloc(con->imap.user->messages))) {
+			folder = meta_folders_by_number(con->imap.user->folders, con->imap.selected);
 			while ((active = inx_cursor_value_next(cursor))) {
 				if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					active->status = (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT;
+					meta_message_status_set(folder, active, (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT);
 				}
 			}
 			inx_cursor_free(cursor);
@@ -1297,7 +1383,7 @@ void imap_copy(connection_t *con) {
 
 	inx_t *messages;
 	inx_cursor_t *cursor;
-	meta_folder_t *folder;
+	meta_folder_t *folder, *selected;
 	meta_message_t *active;
 	size_t nodes, count = 0;
 	stringer_t *source_range = NULL, *dest_range = NULL;
@@ -1415,17 +1501,9 @@ void imap_copy(connection_t *con) {
 	}
 
 	// Build the new status.
-	if ((cursor = inx_cursor_alloc(con->imap.user->messages))) {
-		while ((active = inx_cursor_value_next(cursor))) {
-			if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-				recent++;
-				exists++;
-			}
-			else if (active->foldernum == con->imap.selected) {
-				exists++;
-			}
-		}
-		inx_cursor_free(cursor);
+	if ((selected = meta_folders_by_number(con->imap.user->folders, con->imap.selected))) {
+		exists = selected->counts.messages;
+		recent = selected->counts.recent;
 	}
 
 	con_print(con, "* %lu EXISTS\r\n* %lu RECENT\r\n", exists, recent);
@@ -1462,10 +1540,10 @@ void imap_copy(connection_t *con) {
 void imap_append(connection_t *con) {
 
 	meta_folder_t *folder;
-	inx_cursor_t *cursor;
-	meta_message_t *active;
-	uint32_t flags = MAIL_STATUS_EMPTY;
-	uint64_t recent = 0, exists = 0, outnum = 0;
+	size_t arguments, count = 0;
+	stringer_t **messages = NULL, *range = NULL;
+	uint32_t *flags = NULL;
+	uint64_t recent = 0, exists = 0, *outnums = NULL;
 
 	if (con->imap.session_state != 1) {
 		con_print(con, "%.*s BAD The APPEND command is not available until you are authenticated.\r\n", st_length_int(con->imap.tag),
@@ -1473,11 +1551,11 @@ void imap_append(connection_t *con) {
 		return;
 	}
 
-	// Input validation. Requires at least two arguments, and maximum of four. The first argument must be a string, and the last argument must be a literal.
-	if (ar_length_get(con->imap.arguments) < 2 || ar_length_get(con->imap.arguments) > 4 || imap_get_type_ar(con->imap.arguments, 0) == IMAP_ARGUMENT_TYPE_ARRAY ||
-		imap_get_type_ar(con->imap.arguments, ar_length_get(con->imap.arguments) - 1) != IMAP_ARGUMENT_TYPE_LITERAL) {
+	// Input validation. Requires at least two arguments. The first argument must be a string, and the last argument must be a literal.
+	if ((arguments = ar_length_get(con->imap.arguments)) < 2 || imap_get_type_ar(con->imap.arguments, 0) == IMAP_ARGUMENT_TYPE_ARRAY ||
+		imap_get_type_ar(con->imap.arguments, arguments - 1) != IMAP_ARGUMENT_TYPE_LITERAL) {
 
-		con_print(con, "%.*s NO The APPEND command must have between two and four arguments. The first argument must be a string "
+		con_print(con, "%.*s NO The APPEND command requires a folder name followed by one or more messages. The first argument must be a string "
 			"and the last argument must be a literal.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 		log_pedantic("Invalid APPEND parameters.");
 		return;
@@ -1491,9 +1569,37 @@ void imap_append(connection_t *con) {
 		return;
 	}
 
-	// Parse the list of flags.
-	if (ar_length_get(con->imap.arguments) > 2) {
-		flags = imap_flag_parse(imap_get_ptr(con->imap.arguments, 1), imap_get_type_ar(con->imap.arguments, 1));
+	// There can't be more messages than there are arguments following the folder name.
+	if (!(messages = mm_alloc((arguments - 1) * sizeof(stringer_t *))) || !(flags = mm_alloc((arguments - 1) * sizeof(uint32_t))) ||
+		!(outnums = mm_alloc((arguments - 1) * sizeof(uint64_t)))) {
+		con_print(con, "%.*s NO Internal server error. Please try again later.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+		mm_cleanup(messages, flags, outnums);
+		return;
+	}
+
+	// Split the arguments into messages. Per RFC 3502 each message is an optional flag list, followed by an optional date, and then the literal.
+	for (size_t i = 1, group = 0; i < arguments; i++, group++) {
+
+		flags[count] = MAIL_STATUS_EMPTY;
+
+		if (imap_get_type_ar(con->imap.arguments, i) != IMAP_ARGUMENT_TYPE_LITERAL) {
+			flags[count] = imap_flag_parse(imap_get_ptr(con->imap.arguments, i), imap_get_type_ar(con->imap.arguments, i));
+			i++;
+		}
+
+		// The internal date argument is accepted, but like the single message variant, ignored.
+		if (i < arguments && imap_get_type_ar(con->imap.arguments, i) != IMAP_ARGUMENT_TYPE_LITERAL) {
+			i++;
+		}
+
+		if (i >= arguments || imap_get_type_ar(con->imap.arguments, i) != IMAP_ARGUMENT_TYPE_LITERAL) {
+			con_print(con, "%.*s BAD Message %zu in the APPEND command is missing its literal.\r\n", st_length_int(con->imap.tag),
+				st_char_get(con->imap.tag), group + 1);
+			mm_cleanup(messages, flags, outnums);
+			return;
+		}
+
+		messages[count++] = imap_get_st_ar(con->imap.arguments, i);
 	}
 
 	meta_user_wlock(con->imap.user);
@@ -1503,30 +1609,23 @@ void imap_append(connection_t *con) {
 		meta_user_unlock(con->imap.user);
 		con_print(con, "%.*s NO [TRYCREATE] Unable to find the requested target folder.\r\n", st_length_int(con->imap.tag),
 			st_char_get(con->imap.tag));
+		mm_cleanup(messages, flags, outnums);
 		return;
 	}
 
-	if (imap_append_message(con, folder, flags, imap_get_st_ar(con->imap.arguments, ar_length_get(con->imap.arguments) - 1), &outnum) != 1) {
+	if (imap_append_messages(con, folder, count, flags, messages, outnums) != 1) {
 		meta_user_unlock(con->imap.user);
-		con_print(con, "%.*s NO Unable to APPEND the message provided. Please try again later.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+		con_print(con, "%.*s NO Unable to APPEND the message%s provided. Please try again later.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag),
+			count > 1 ? "s" : "");
+		mm_cleanup(messages, flags, outnums);
 		return;
 	}
 
 	// The message appended to the current folder, so we need to output the current status.
 	if (con->imap.selected == folder->foldernum) {
 
-		if ((cursor = inx_cursor_alloc(con->imap.user->messages))) {
-			while ((active = inx_cursor_value_next(cursor))) {
-				if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					recent++;
-					exists++;
-				}
-				else if (active->foldernum == con->imap.selected) {
-					exists++;
-				}
-			}
-			inx_cursor_free(cursor);
-		}
+		exists = folder->counts.messages;
+		recent = folder->counts.recent;
 
 		con_print(con, "* %lu EXISTS\r\n* %lu RECENT\r\n", exists, recent);
 
@@ -1540,7 +1639,16 @@ void imap_append(connection_t *con) {
 	recent = folder->foldernum;
 	meta_user_unlock(con->imap.user);
 
-	con_print(con, "%.*s OK [APPENDUID %lu %lu] Append complete.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag), recent, outnum);
+	if (count == 1 || !(range = imap_range_build(count, outnums))) {
+		con_print(con, "%.*s OK [APPENDUID %lu %lu] Append complete.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag), recent, outnums[0]);
+	}
+	else {
+		con_print(con, "%.*s OK [APPENDUID %lu %.*s] Append complete.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag), recent,
+			st_length_int(range), st_char_get(range));
+		st_free(range);
+	}
+
+	mm_cleanup(messages, flags, outnums);
 	return;
 }
 
@@ -1548,6 +1656,7 @@ void imap_fetch(connection_t *con) {
 
 	int_t space = 0;
 	inx_cursor_t *cursor;
+	meta_folder_t *folder;
 	meta_message_t *active;
 	inx_t *messages, *duplicate;
 	imap_fetch_dataitems_t *items;
@@ -1600,10 +1709,11 @@ void imap_fetch(connection_t *con) {
 	// If RFC822, RFC822.TEXT or any BODY[] items are requested, add the seen flag.
 	if (con->imap.read_only == 0 && (items->normal != NULL || items->rfc822 == 1 || items->rfc822_text == 1)) {
 		meta_data_flags_add(messages, con->imap.user->usernum, con->imap.selected, MAIL_STATUS_SEEN);
+		folder = meta_folders_by_number(con->imap.user->folders, con->imap.selected);
 		if ((cursor = inx_cursor_alloc(messages))) {
 			while ((active = inx_cursor_value_next(cursor))) {
 				if ((active->status & MAIL_STATUS_SEEN) != MAIL_STATUS_SEEN) {
-					active->status = (active->status | MAIL_STATUS_SEEN);
+					meta_message_status_set(folder, active, active->status | MAIL_STATUS_SEEN);
 					active->updated = 1;
 				}
 			}
@@ -1836,7 +1946,7 @@ void imap_capability(connection_t *con) {
 	}
 
 	// STARTTLS should only appear if the server instance has been configured with an TLS certificate. The connection must also be pre-authentication and unencrypted.
-	con_print(con, "* CAPABILITY IMAP4 IMAP4rev1%sLITERAL+ ID\r\n%.*s OK Completed.\r\n", con_secure(con) == 0 && con->imap.session_state == 0 ?
+	con_print(con, "* CAPABILITY IMAP4 IMAP4rev1%sLITERAL+ MULTIAPPEND LIST-EXTENDED LIST-STATUS ID\r\n%.*s OK Completed.\r\n", con_secure(con) == 0 && con->imap.session_state == 0 ?
 		" STARTTLS " : " ",	st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 
 	return;
@@ -1855,7 +1965,7 @@ void imap_init(connection_t *con) {
 	con_reverse_enqueue(con);
 
 	// Introduce ourselves. Note the string below needs to stay in sync with the capability command.
-	con_print(con, "* OK [CAPABILITY IMAP4 IMAP4rev1%sLITERAL+ ID]%s%.*s%sMagma IMAP server v%s is ready.\r\n",
+	con_print(con, "* OK [CAPABILITY IMAP4 IMAP4rev1%sLITERAL+ MULTIAPPEND LIST-EXTENDED LIST-STATUS ID]%s%.*s%sMagma IMAP server v%s is ready.\r\n",
 		con_secure(con) == 0 ? " STARTTLS " : " ", st_length_get(con->server->domain) ? " " : "", st_length_int(con->server->domain),
 		st_char_get(con->server->domain), st_length_get(con->server->domain) ? " " : "", build_version());
 
@@ -12,6 +12,9 @@
 #define IMAP_SEARCH_RECURSION_LIMIT 16
 #define IMAP_FOLDER_RECURSION_LMIIT 16
 
+// The combined size of the literals a single command may hold in memory, so a MULTIAPPEND can't hold more than the largest APPEND.
+#define IMAP_LITERALS_LIMIT 134217728
+
 // IMAP Argument types.
 #define IMAP_ARGUMENT_TYPE_EMPTY 0
 #define IMAP_ARGUMENT_TYPE_ARRAY 1
@@ -53,7 +56,7 @@ mail_mime_t *             imap_fetch_body_part(mail_message_t *message, placer_t
 placer_t                  imap_fetch_body_portion(stringer_t *part);
 stringer_t *              imap_fetch_body_tag(stringer_t *tag, array_t *items);
 stringer_t *              imap_fetch_bodystructure(mail_mime_t *mime);
-stringer_t *              imap_fetch_envelope(stringer_t *header);
+stringer_t *              imap_fetch_envelope(stringer_t **fields);
 void                      imap_fetch_free_items(imap_fetch_dataitems_t *items);
 imap_fetch_response_t *   imap_fetch_message(connection_t *con, meta_message_t *meta, imap_fetch_dataitems_t *items);
 int_t                     imap_fetch_parse_partial(stringer_t *partial, size_t *start, size_t *length);
@@ -78,7 +81,10 @@ int_t         imap_folder_create(uint64_t usernum, inx_t *folders, stringer_t *n
 stringer_t *  imap_folder_name_escaped(inx_t *folders, meta_folder_t *active);
 int_t         imap_folder_remove(uint64_t usernum, inx_t *folders, inx_t *messages, stringer_t *name);
 int_t         imap_folder_rename(uint64_t usernum, inx_t *folders, stringer_t *original, stringer_t *rename);
+uint64_t      imap_folder_first_unseen(inx_t *messages, uint64_t foldernum);
 int_t         imap_folder_status(inx_t *folders, inx_t *messages, stringer_t *name, imap_folder_status_t *status);
+void          imap_folder_status_counts(meta_folder_t *folder, imap_folder_status_t *status);
+stringer_t *  imap_folder_status_items(imap_arguments_t *items, imap_folder_status_t *status);
 inx_t *       imap_narrow_folders(inx_t *folders, stringer_t *reference, stringer_t *mailbox);
 uint64_t      imap_next_folder_order(inx_t *folders, uint64_t parent);
 bool_t        imap_valid_folder_name(stringer_t *name);
@@ -114,6 +120,7 @@ void   imap_unsubscribe(connection_t *con);
 
 /// messages.c
 int_t   imap_append_message(connection_t *con, meta_folder_t *folder, uint32_t flags, stringer_t *message, uint64_t *outnum);
+int_t   imap_append_messages(connection_t *con, meta_folder_t *folder, size_t count, uint32_t *flags, stringer_t **messages, uint64_t *outnums);
 int_t   imap_message_copier(connection_t *con, meta_message_t *message, uint64_t target, uint64_t *outnum);
 int_t   imap_message_expunge(connection_t *con, meta_message_t *message);
 
@@ -141,7 +148,11 @@ int_t               imap_parse_nstring(stringer_t **output, chr_t **start, size_
 int_t               imap_parse_qstring(stringer_t **output, chr_t **start, size_t *length);
 
 /// range.c
-stringer_t *  imap_range_build(size_t length, uint64_t *numbers);
+stringer_t *         imap_range_build(size_t length, uint64_t *numbers);
+int_t                imap_sequence_compare(const void *one, const void *two);
+imap_sequence_t *    imap_sequence_compile(stringer_t *range, uint64_t highest);
+bool_t               imap_sequence_contains(imap_sequence_t *sequence, uint64_t number);
+uint64_t             imap_sequence_highest(inx_t *messages, uint64_t selected, int_t uid);
 
 /// search.c
 int_t    imap_search_flag(uint32_t status, uint32_t flag, int_t has);
@@ -150,8 +161,8 @@ int_t    imap_search_messages_body(connection_t *con, meta_user_t *user, mail_me
 int_t    imap_search_messages_date(connection_t *con, meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active, stringer_t *date, int_t internal, int_t expected);
 int_t    imap_search_messages_date_compare(stringer_t *one, stringer_t *two);
 int_t    imap_search_messages_header(connection_t *con, meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active, stringer_t *field, stringer_t *value);
-int_t    imap_search_messages_inner(connection_t *con, meta_user_t *user, mail_message_t **message, stringer_t **header, meta_message_t *current, imap_arguments_t *array, unsigned recursion);
-int_t    imap_search_messages_range(meta_message_t *active, stringer_t *range, int_t uid);
+int_t    imap_search_messages_inner(connection_t *con, meta_user_t *user, mail_message_t **message, stringer_t **header, inx_t *sequences, meta_message_t *current, imap_arguments_t *array, unsigned recursion);
+int_t    imap_search_messages_range(connection_t *con, meta_user_t *user, inx_t *sequences, meta_message_t *active, stringer_t *range, int_t uid);
 int_t    imap_search_messages_size(meta_message_t *active, stringer_t *value, int_t expected);
 int_t    imap_search_messages_text(connection_t *con, meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value);
 
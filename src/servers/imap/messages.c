@@ -8,36 +8,63 @@
 #include "magma.h"
 
 int_t imap_append_message(connection_t *con, meta_folder_t *folder, uint32_t flags, stringer_t *message, uint64_t *outnum) {
+	return imap_append_messages(con, folder, 1, &flags, &message, outnum);
+}
+
+/**
+ * @brief	Append a batch of messages to a folder atomically, as required by MULTIAPPEND.
+ * @note	The messages are stored using a single transaction, and the message serial is only bumped once for the entire batch.
+ * @param	con			the IMAP client connection appending the messages.
+ * @param	folder		the folder the messages are being appended to.
+ * @param	count		the number of messages in the batch.
+ * @param	flags		an array holding the status flags for each message.
+ * @param	messages	an array holding the message data.
+ * @param	outnums		an array that will receive the message number assigned to each message.
+ * @return	0 on failure, or 1 if all of the messages were appended.
+ */
+int_t imap_append_messages(connection_t *con, meta_folder_t *folder, size_t count, uint32_t *flags, stringer_t **messages, uint64_t *outnums) {
 
 	meta_message_t *new;
+	bool_t resequence = false;
 	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
 	stringer_t *pubkey = ((con->imap.user->flags & META_USER_ENCRYPT_DATA) == META_USER_ENCRYPT_DATA) ? con->imap.user->prime.signet : NULL;
 
 	// Always add the recent and appended flags to these messages.
-	flags = (flags | MAIL_STATUS_RECENT | MAIL_STATUS_APPENDED);
-
-	if ((key.val.u64 = mail_store_message(con->imap.user->usernum, pubkey, folder->foldernum, &flags, 0, 0, message)) == 0) {
-		log_pedantic("Unable to append a message of %zu bytes.", st_length_get(message));
-		return 0;
+	for (size_t i = 0; i < count; i++) {
+		flags[i] = (flags[i] | MAIL_STATUS_RECENT | MAIL_STATUS_APPENDED);
 	}
 
-	if ((new = mm_alloc(sizeof(meta_message_t))) == NULL) {
-		log_pedantic("Unable to allocate %zu bytes for a message structure.", sizeof(meta_message_t));
+	if (!mail_store_messages(con->imap.user->usernum, pubkey, folder->foldernum, count, flags, messages, outnums)) {
+		log_pedantic("Unable to append a batch of %zu messages.", count);
 		return 0;
 	}
 
-	*outnum = new->messagenum = key.val.u64;
-	new->status = flags;
-	new->foldernum = folder->foldernum;
-	new->created = time(NULL);
-	new->size = st_length_get(message);
-	snprintf(new->server, 33, "%.*s", st_length_int(magma.storage.active), st_char_get(magma.storage.active));
-
-	if (inx_append(con->imap.user->messages, key, new) != true) {
-		mm_free(new);
+	for (size_t i = 0; i < count; i++) {
+
+		if ((new = mm_alloc(sizeof(meta_message_t))) == NULL) {
+			log_pedantic("Unable to allocate %zu bytes for a message structure.", sizeof(meta_message_t));
+			continue;
+		}
+
+		key.val.u64 = new->messagenum = outnums[i];
+		new->status = flags[i];
+		new->foldernum = folder->foldernum;
+		new->created = time(NULL);
+		new->size = st_length_get(messages[i]);
+		snprintf(new->server, 33, "%.*s", st_length_int(magma.storage.active), st_char_get(magma.storage.active));
+
+		if (inx_append(con->imap.user->messages, key, new) != true) {
+			mm_free(new);
+		}
+		// New messages sort to the end of the folder, so they can normally be sequenced as they're added.
+		else if (!meta_message_counts_add(con->imap.user->folders, new)) {
+			resequence = true;
+		}
 	}
 
-	meta_messages_update_sequences(con->imap.user->folders, con->imap.user->messages);
+	if (resequence) {
+		meta_messages_update_sequences(con->imap.user->folders, con->imap.user->messages);
+	}
 
 	// Update the checkpoint, so other connections know things have changed.
 	if (con->imap.user->serials.messages != serial_get(OBJECT_MESSAGES, con->imap.user->usernum)) {
@@ -97,8 +124,9 @@ int_t imap_message_copier(connection_t *con, meta_message_t *message, uint64_t t
 	if (inx_append(con->imap.user->messages, key, new) != true) {
 		mm_free(new);
 	}
-
-	meta_messages_update_sequences(con->imap.user->folders, con->imap.user->messages);
+	else if (!meta_message_counts_add(con->imap.user->folders, new)) {
+		meta_messages_update_sequences(con->imap.user->folders, con->imap.user->messages);
+	}
 
 	// If the serial number indicates no outside changes we can increment the checkpoint and store the value. Otherwise we just increment it
 	// so a full refresh will be triggered.
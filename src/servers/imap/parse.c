@@ -377,15 +377,16 @@ int_t imap_parse_qstring(stringer_t **output, chr_t **start, size_t *length) {
  * @param	length	a pointer to a size_t variable that contains the length of the string to be parsed, and that will be updated to reflect
  * 					the length of the remainder of the input string that follows the parsed literal string.
  * @return	-1 on general or parse error or if an enclosing pair of double quotes was not found, or 1 if the supplied quoted string was valid.
+ * 			If the literals of the command exceed IMAP_LITERALS_LIMIT, the session is flagged as limited and a plus literal is discarded.
  */
 int_t imap_parse_literal(connection_t *con, stringer_t **output, chr_t **start, size_t *length) {
 
-	chr_t *holder;
 	int_t plus = 0;
-	stringer_t *result;
+	int64_t nread;
+	stringer_t *result = NULL;
 	size_t characters, left;
-	ssize_t nread;
 	uint64_t literal, number;
+	chr_t *holder, discard[8192];
 
 	// Get setup.
 	holder = *start;
@@ -475,6 +476,20 @@ int_t imap_parse_literal(connection_t *con, stringer_t **output, chr_t **start,
 		return -1;
 	}
 
+	// Once the literals of a single command exceed the limit, the command will be rejected. A synchronizing literal hasn't been sent yet,
+	// so we can stop here, but a plus literal is already on its way, so it gets read and thrown away to keep the rest of the command intact.
+	if (con->imap.limited || con->imap.literals + literal > IMAP_LITERALS_LIMIT) {
+
+		con->imap.limited = 1;
+
+		if (!plus) {
+			return -1;
+		}
+	}
+	else {
+		con->imap.literals += literal;
+	}
+
 	// If this is not a plus literal, output the proceed statement.
 	if (!plus) {
 		con_write_bl(con, "+ GO\r\n", 6);
@@ -502,7 +517,7 @@ int_t imap_parse_literal(connection_t *con, stringer_t **output, chr_t **start,
 	}
 
 	// Allocate a stringer for the buffer.
-	if (!(result = st_alloc(literal))) {
+	if (!con->imap.limited && !(result = st_alloc(literal))) {
 		log_pedantic("Unable to allocate a buffer of %lu bytes for the literal argument.", literal);
 		return -1;
 	}
@@ -511,49 +526,37 @@ int_t imap_parse_literal(connection_t *con, stringer_t **output, chr_t **start,
 	left = literal;
 
 	// Where we put the data.
-	holder = st_char_get(result);
+	holder = result ? st_char_get(result) : discard;
 
-	// Keep looping until we run out of data.
+	// Stream the literal straight into the result buffer. Only data that already arrived with the command line is staged through
+	// the connection buffer, everything else is read off the socket directly into its final location.
 	while (left) {
 
-		// Read the data.
-		if ((nread = con_read(con)) <= 0) {
+		if ((nread = con_read_bl(con, holder, result || left < sizeof(discard) ? left : sizeof(discard))) <= 0) {
 			log_pedantic("The connection was dropped while reading the literal.");
-			st_free(result);
+			st_cleanup(result);
 			return -1;
 		}
 
-		characters = nread;
-
-		// If we have a buffer, copy the data into the buffer.
-		mm_copy(holder, st_char_get(con->network.buffer), (left > characters) ? characters : left);
+		holder += result ? nread : 0;
+		left -= nread;
+	}
 
-		if (left > characters) {
-			holder += characters;
-			left -= characters;
-		}
-		else {
-		 	st_length_set(result, literal);
+	if (result) {
+		st_length_set(result, literal);
+	}
 
-			// If we have any extra characters in the buffer, move them to the beginning.
-			if (characters > left) {
-				mm_move(st_char_get(con->network.buffer), st_char_get(con->network.buffer) + left, characters - left);
-				st_length_set(con->network.buffer, characters - left);
-				con->network.line = line_pl_st(con->network.buffer, 0);
-			}
-			else {
-					st_length_set(con->network.buffer, 0);
-					con->network.line = pl_null();
-			}
+	// Anything left in the connection buffer belongs to the remainder of the command line. If the rest of the line hasn't fully
+	// arrived yet, the leftover data is left in place for con_read_line() to complete.
+	if (st_length_get(con->network.buffer) && !pl_empty(line_pl_st(con->network.buffer, 0))) {
+		con->network.line = line_pl_st(con->network.buffer, 0);
+	}
 
-			// Make sure we have a full line.
-			if (pl_empty(con->network.line) && con_read_line(con, true) <= 0) {
-				log_pedantic("The connection was dropped while reading the literal.");
-				st_free(result);
-				return -1;
-			}
-			left = 0;
-		}
+	// Make sure we have a full line.
+	if (pl_empty(con->network.line) && con_read_line(con, true) <= 0) {
+		log_pedantic("The connection was dropped while reading the literal.");
+		st_cleanup(result);
+		return -1;
 	}
 
 	*start = st_char_get(con->network.buffer);
@@ -565,10 +568,11 @@ int_t imap_parse_literal(connection_t *con, stringer_t **output, chr_t **start,
 		(*length)--;
 	}
 
+	// A discarded literal leaves the output empty.
 	if (result != NULL) {
 		*output = result;
 	}
-	else {
+	else if (!con->imap.limited) {
 		return -1;
 	}
 
@@ -882,9 +886,11 @@ void imap_command_log_safe(stringer_t *line) {
  *         -1: the tag could not be read.
  *         -2: the IMAP command could not be read.
  *         -3: the arguments to the IMAP command could not be read.
+ *         -4: the literals supplied with the IMAP command exceeded the limit.
  */
 int_t imap_command_parser(connection_t *con) {
 
+	int_t state;
 	chr_t *holder;
 	size_t length;
 
@@ -907,6 +913,9 @@ int_t imap_command_parser(connection_t *con) {
 		con->imap.arguments = NULL;
 	}
 
+	con->imap.literals = 0;
+	con->imap.limited = 0;
+
 	// Debug info.
 	if (magma.log.imap) {
 		imap_command_log_safe(&con->network.line);
@@ -942,7 +951,19 @@ int_t imap_command_parser(connection_t *con) {
 	}
 
 	// Now append the arguments to the array.
-	if (imap_parse_arguments(con, &holder, &length) != 1) {
+	state = imap_parse_arguments(con, &holder, &length);
+
+	// A command which exceeded the literal limit won't be executed, so release the literals it already holds.
+	if (con->imap.limited) {
+
+		if (con->imap.arguments) {
+			ar_free(con->imap.arguments);
+			con->imap.arguments = NULL;
+		}
+
+		return -4;
+	}
+	else if (state != 1) {
 		return -3;
 	}
 
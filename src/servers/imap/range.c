@@ -66,3 +66,177 @@ stringer_t * imap_range_build(size_t length, uint64_t *numbers) {
 
 	return result;
 }
+
+/**
+ * @brief	Find the highest message number, or sequence number, in use by a folder. This is the value an asterisk refers to in a sequence set.
+ * @param	messages	an inx holder containing a complete list of a user's messages.
+ * @param	selected	the numerical id of the folder being queried.
+ * @param	uid			if set, return the highest message number, otherwise return the highest sequence number.
+ * @return	0 if the folder is empty, or the highest number in use.
+ */
+uint64_t imap_sequence_highest(inx_t *messages, uint64_t selected, int_t uid) {
+
+	uint64_t highest = 0;
+	inx_cursor_t *cursor;
+	meta_message_t *active;
+
+	if (messages && (cursor = inx_cursor_alloc(messages))) {
+
+		while ((active = inx_cursor_value_next(cursor))) {
+			if (active->foldernum == selected && uid == 1 && active->messagenum > highest) {
+				highest = active->messagenum;
+			}
+			else if (active->foldernum == selected && uid == 0 && active->sequencenum > highest) {
+				highest = active->sequencenum;
+			}
+		}
+
+		inx_cursor_free(cursor);
+	}
+
+	return highest;
+}
+
+/**
+ * @brief	Compare the starting points of two sequence set intervals.
+ * @note	This is an internal function used to sort the intervals of a compiled sequence set.
+ * @param	one		a pointer to the first interval to be compared.
+ * @param	two		a pointer to the second interval to be compared.
+ * @return	-1 if one starts before two, 1 if two starts before one, or 0 if they start at the same number.
+ */
+int_t imap_sequence_compare(const void *one, const void *two) {
+
+	imap_interval_t *a = (imap_interval_t *)one, *b = (imap_interval_t *)two;
+
+	if (a->start < b->start) {
+		return -1;
+	}
+	else if (a->start > b->start) {
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Compile a sequence set into a sorted list of merged intervals, so that membership can be tested without re-parsing the set.
+ * @note	An asterisk resolves to the highest number in use, which means n:* selects the highest numbered message even when n is larger.
+ * @param	range		a managed string containing the sequence set, for example "1:100,105:*".
+ * @param	highest		the number an asterisk should resolve to.
+ * @return	NULL on failure, or a pointer to the compiled sequence set, which should be freed by the caller with mm_free().
+ */
+imap_sequence_t * imap_sequence_compile(stringer_t *range, uint64_t highest) {
+
+	uint32_t commas;
+	uint64_t holder;
+	size_t count = 0, merged = 0;
+	imap_interval_t *interval;
+	imap_sequence_t *sequence;
+	placer_t section, start_token, end_token;
+
+	if (st_empty(range) || !(commas = tok_get_count_st(range, ','))) {
+		log_pedantic("Sanity check failed, passed an empty sequence set.");
+		return NULL;
+	}
+	else if (!(sequence = mm_alloc(sizeof(imap_sequence_t) + (commas * sizeof(imap_interval_t))))) {
+		log_pedantic("Unable to allocate %zu bytes for the compiled sequence set.", sizeof(imap_sequence_t) + (commas * sizeof(imap_interval_t)));
+		return NULL;
+	}
+
+	// Break apart each sequence section.
+	for (uint32_t i = 0; i < commas && tok_get_st(range, ',', i, &section) >= 0; i++) {
+
+		interval = &(sequence->intervals[count]);
+		start_token = end_token = pl_null();
+
+		if (tok_get_st(&section, ':', 0, &start_token) < 0 || pl_empty(start_token) ||
+			(tok_get_count_st(&section, ':') > 1 && (tok_get_st(&section, ':', 1, &end_token) < 0 || pl_empty(end_token)))) {
+			log_pedantic("Sequence set parsing error. { set = %.*s }", st_length_int(range), st_char_get(range));
+			mm_free(sequence);
+			return NULL;
+		}
+
+		// Parse the start.
+		if (*(pl_char_get(start_token)) == '*') {
+			interval->start = highest;
+		}
+		else if (!uint64_conv_st(&start_token, &(interval->start))) {
+			log_pedantic("Sequence set parsing error. { set = %.*s }", st_length_int(range), st_char_get(range));
+			mm_free(sequence);
+			return NULL;
+		}
+
+		// Parse the end.
+		if (pl_empty(end_token)) {
+			interval->end = interval->start;
+		}
+		else if (*(pl_char_get(end_token)) == '*') {
+			interval->end = highest;
+		}
+		else if (!uint64_conv_st(&end_token, &(interval->end))) {
+			log_pedantic("Sequence set parsing error. { set = %.*s }", st_length_int(range), st_char_get(range));
+			mm_free(sequence);
+			return NULL;
+		}
+
+		// If necessary, swap the values.
+		if (interval->start > interval->end) {
+			holder = interval->start;
+			interval->start = interval->end;
+			interval->end = holder;
+		}
+
+		count++;
+	}
+
+	// Sort the intervals, then merge any which overlap or are adjacent.
+	qsort(sequence->intervals, count, sizeof(imap_interval_t), &imap_sequence_compare);
+
+	for (size_t i = 1; i < count; i++) {
+
+		interval = &(sequence->intervals[merged]);
+
+		if (interval->end == UINT64_MAX || sequence->intervals[i].start <= interval->end + 1) {
+			interval->end = sequence->intervals[i].end > interval->end ? sequence->intervals[i].end : interval->end;
+		}
+		else {
+			sequence->intervals[++merged] = sequence->intervals[i];
+		}
+	}
+
+	sequence->count = count ? merged + 1 : 0;
+
+	return sequence;
+}
+
+/**
+ * @brief	Determine whether a number is a member of a compiled sequence set using a binary search.
+ * @param	sequence	a pointer to the compiled sequence set.
+ * @param	number		the message number, or sequence number, being checked.
+ * @return	true if the number falls within the sequence set, or false if it does not.
+ */
+bool_t imap_sequence_contains(imap_sequence_t *sequence, uint64_t number) {
+
+	size_t low = 0, high, middle;
+
+	if (!sequence || !(high = sequence->count)) {
+		return false;
+	}
+
+	while (low < high) {
+
+		middle = low + ((high - low) / 2);
+
+		if (number < sequence->intervals[middle].start) {
+			high = middle;
+		}
+		else if (number > sequence->intervals[middle].end) {
+			low = middle + 1;
+		}
+		else {
+			return true;
+		}
+	}
+
+	return false;
+}
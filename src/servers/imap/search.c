@@ -273,78 +273,47 @@ int_t imap_search_flag(uint32_t status, uint32_t flag, int_t has) {
 	return -1;
 }
 
-int_t imap_search_messages_range(meta_message_t *active, stringer_t *range, int_t uid) {
+/**
+ * @brief	Check whether a message falls within a sequence set search key.
+ * @note	Each sequence set is compiled the first time it is evaluated, and the compiled form is stored in the sequences index,
+ * 			keyed by the address of the argument, so the remaining messages can be checked without parsing the set again.
+ * @param	con			the connection of the client performing the search.
+ * @param	user		the meta user object of the user performing the search.
+ * @param	sequences	an inx holder used to cache the compiled sequence sets for the duration of the search.
+ * @param	active		a pointer to the meta message object being checked.
+ * @param	range		a managed string containing the sequence set.
+ * @param	uid			if set, the sequence set contains message numbers, otherwise it contains sequence numbers.
+ * @return	1 if the message is within the sequence set, or -1 if it isn't.
+ */
+int_t imap_search_messages_range(connection_t *con, meta_user_t *user, inx_t *sequences, meta_message_t *active, stringer_t *range, int_t uid) {
 
-	int_t asterisk;
-	uint64_t start, end, number;
-	uint32_t commas, parts;
-	placer_t sequence, start_token, end_token;
+	imap_sequence_t *sequence;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = (uint64_t)range };
 
-	if (!active || !range) {
+	if (!active || !range || !sequences) {
 		return -1;
 	}
 
-	// Count the commas.
-	commas = tok_get_count_st(range, ',');
-
-	// Break apart each sequence section.
-	for (uint32_t i = 0; i < commas && tok_get_st(range, ',', i, &sequence) >= 0; i++) {
-
-		start = end = asterisk = 0;
-		start_token = end_token = pl_null();
-		parts = tok_get_count_st(&sequence, ':');
-		tok_get_st(&sequence, ':', 0, &start_token);
-
-		if (parts > 1) {
-			tok_get_st(&sequence, ':', 1, &end_token);
-		}
+	if (!(sequence = inx_find(sequences, key))) {
 
-		// Parse the start.
-		if (pl_empty(start_token)) {
+		if (!(sequence = imap_sequence_compile(range, imap_sequence_highest(user->messages, con->imap.selected, uid)))) {
 			return -1;
 		}
-		else if (*(pl_char_get(start_token)) == '*') {
-			asterisk = 1;
-		}
-		else if (!uint64_conv_st(&start_token, &start)) {
-				return -1;
-		}
-
-		// Parse the end.
-		if (!pl_empty(end_token) && *(pl_char_get(end_token)) == '*') {
-			asterisk = 1;
-		}
-		else if (pl_empty(end_token)) {
-			end = start;
-		}
-		else if (!uint64_conv_st(&end_token, &end)) {
+		else if (!inx_insert(sequences, key, sequence)) {
+			mm_free(sequence);
 			return -1;
 		}
 
-		// If necessary, swap the values.
-		if (asterisk == 1 && end != 0) {
-			start = end;
-		}
-		else if (asterisk == 0 && start > end) {
-			number = start;
-			start = end;
-			end = number;
-		}
-
-		// Loop through and collect the messages.
-		if (uid == 0 && active->sequencenum >= start && (asterisk == 1 || active->sequencenum <= end)) {
-			return 1;
-		}
-		else if (uid == 1 && active->messagenum >= start && (asterisk == 1 || active->messagenum <= end)) {
-			return 1;
-		}
+	}
 
+	if (imap_sequence_contains(sequence, uid == 1 ? active->messagenum : active->sequencenum)) {
+		return 1;
 	}
 
 	return -1;
 }
 
-int_t imap_search_messages_inner(connection_t *con, meta_user_t *user, mail_message_t **message, stringer_t **header, meta_message_t *current, imap_arguments_t *array, unsigned recursion) {
+int_t imap_search_messages_inner(connection_t *con, meta_user_t *user, mail_message_t **message, stringer_t **header, inx_t *sequences, meta_message_t *current, imap_arguments_t *array, unsigned recursion) {
 
 	stringer_t *item;
 	unsigned number, increment = 0;
@@ -365,7 +334,7 @@ int_t imap_search_messages_inner(connection_t *con, meta_user_t *user, mail_mess
 
 		// Handle nested arrays.
 		if (imap_get_type_ar(array, increment) == IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_inner(con, user, message, header, current, imap_get_ar_ar(array, increment++), recursion + 1);
+			eval = imap_search_messages_inner(con, user, message, header, sequences, current, imap_get_ar_ar(array, increment++), recursion + 1);
 		}
 		else if ((item = imap_get_st_ar(array, increment++)) == NULL) {
 			eval = -1;
@@ -481,11 +450,11 @@ int_t imap_search_messages_inner(connection_t *con, meta_user_t *user, mail_mess
 		// Range checks.
 		else if (increment < number && !st_cmp_ci_eq(item, PLACER("UID", 3)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY
 			&& imap_valid_sequence(imap_get_st_ar(array, increment)) == 1) {
-			eval = imap_search_messages_range(current, imap_get_st_ar(array, increment++), 1);
+			eval = imap_search_messages_range(con, user, sequences, current, imap_get_st_ar(array, increment++), 1);
 		}
 		// If the characters make up a valid sequence, try parsing it.
 		else if (imap_valid_sequence(item) == 1) {
-			eval = imap_search_messages_range(current, item, 0);
+			eval = imap_search_messages_range(con, user, sequences, current, item, 0);
 		}
 
 		// All messages matches everything.
@@ -563,9 +532,9 @@ int_t imap_search_messages_inner(connection_t *con, meta_user_t *user, mail_mess
 inx_t * imap_search_messages(connection_t *con) {
 
 	time_t start;
-	inx_t *output = NULL;
 	inx_cursor_t *cursor = NULL;
 	stringer_t *header = NULL;
+	inx_t *output = NULL, *sequences = NULL;
 	mail_message_t *message = NULL;
 	uint64_t finished = 0, uid = 0, count = 0;
 	meta_message_t *duplicate = NULL, *active = NULL;
@@ -575,6 +544,12 @@ inx_t * imap_search_messages(connection_t *con) {
 		return NULL;
 	}
 
+	// Sequence sets are compiled the first time they're evaluated, and then shared by every message checked during this search.
+	else if (!(sequences = inx_alloc(M_INX_LINKED, &mm_free))) {
+		inx_free(output);
+		return NULL;
+	}
+
 	while (status() && !finished) {
 
 		/// LOW: Is a read lock necessary now that were using index reference counters and thread safe iteration cursors?
@@ -592,7 +567,7 @@ inx_t * imap_search_messages(connection_t *con) {
 
 			// Check for a match.
 			if (active->foldernum == con->imap.selected &&
-					imap_search_messages_inner(con, con->imap.user, &message, &header, active, con->imap.arguments, 0) == 1 &&
+					imap_search_messages_inner(con, con->imap.user, &message, &header, sequences, active, con->imap.arguments, 0) == 1 &&
 					(key.val.u64 = active->messagenum) && (duplicate = meta_message_dupe(active)) &&
 					inx_append(output, key, duplicate) != true) {
 				meta_message_free(duplicate);
@@ -655,6 +630,8 @@ inx_t * imap_search_messages(connection_t *con) {
 		inx_cursor_free(cursor);
 	}
 
+	inx_free(sequences);
+
 	return output;
 }
 
@@ -93,6 +93,7 @@ int_t imap_session_update(connection_t *con) {
 void imap_session_destroy(connection_t *con) {
 
 	inx_cursor_t *cursor;
+	meta_folder_t *folder;
 	meta_message_t *active;
 
 	meta_user_wlock(con->imap.user);
@@ -101,10 +102,12 @@ void imap_session_destroy(connection_t *con) {
 	if (con->imap.session_state == 1 && con->imap.user && con->imap.selected && !con->imap.read_only &&
 		(cursor = inx_cursor_alloc(con->imap.user->messages))) {
 
+		folder = meta_folders_by_number(con->imap.user->folders, con->imap.selected);
+
 		while ((active = inx_cursor_value_next(cursor))) {
 
 			if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-				active->status = (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT;
+				meta_message_status_set(folder, active, (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT);
 			}
 
 		}
@@ -138,3 +138,66 @@ meta_message_t * pop_get_message(inx_t *messages, uint64_t get) {
 
 	return NULL;
 }
+
+/**
+ * @brief	Write the multi-line response to a LIST or UIDL command that was issued without an argument.
+ * @note	The listing is formatted into a fixed size buffer and only written to the network when the buffer fills, so a large mailbox
+ * 			is sent using a handful of writes instead of one per message.
+ * @param	con			the connection of the client requesting the listing.
+ * @param	messages	an inx holder containing the user's messages.
+ * @param	unique		if true, output the unique id of each message (UIDL), otherwise output the message size (LIST).
+ * @return	-1 on network failure, or the number of bytes written to the connection.
+ */
+int64_t pop_write_listing(connection_t *con, inx_t *messages, bool_t unique) {
+
+	int_t length;
+	inx_cursor_t *cursor;
+	meta_message_t *active;
+	uint64_t number = 1;
+	int64_t written = 0;
+	size_t used = 0;
+	chr_t buffer[8192];
+
+	if ((length = snprintf(buffer, sizeof(buffer), "+OK %lu messages total.\r\n", pop_total_messages(messages))) > 0) {
+		used = length;
+	}
+
+	if (messages && (cursor = inx_cursor_alloc(messages))) {
+
+		while ((active = inx_cursor_value_next(cursor))) {
+
+			// Output all of the messages that aren't deleted or appended.
+			if ((active->status & (MAIL_STATUS_APPENDED | MAIL_STATUS_HIDDEN)) == 0) {
+
+				// Flush the buffer before it gets too full to hold another line.
+				if (sizeof(buffer) - used < 64) {
+					if (con_write_bl(con, buffer, used) != (int64_t)used) {
+						inx_cursor_free(cursor);
+						return -1;
+					}
+					written += used;
+					used = 0;
+				}
+
+				if ((length = snprintf(buffer + used, sizeof(buffer) - used, "%lu %lu\r\n", number++, unique ? active->messagenum : active->size)) > 0) {
+					used += length;
+				}
+			}
+			else if ((active->status & MAIL_STATUS_APPENDED) == 0) {
+				number++;
+			}
+
+		}
+
+		inx_cursor_free(cursor);
+	}
+
+	mm_copy(buffer + used, ".\r\n", 3);
+	used += 3;
+
+	if (con_write_bl(con, buffer, used) != (int64_t)used) {
+		return -1;
+	}
+
+	return written + used;
+}
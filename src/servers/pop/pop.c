@@ -414,10 +414,9 @@ void pop_last(connection_t *con) {
  */
 void pop_list(connection_t *con) {
 
+	bool_t result;
 	uint64_t number;
-	inx_cursor_t *cursor;
 	meta_message_t *active;
-	bool_t result;
 
 	if (con->pop.session_state != 1) {
 		pop_invalid(con);
@@ -431,26 +430,7 @@ void pop_list(connection_t *con) {
 
 	// Output all of the messages that aren't deleted or appended.
 	if (!result) {
-		number = 1;
-		con_print(con, "+OK %llu messages total.\r\n", pop_total_messages(con->pop.user->messages));
-
-		if (con->pop.user->messages && (cursor = inx_cursor_alloc(con->pop.user->messages))) {
-
-			while ((active = inx_cursor_value_next(cursor))) {
-
-				if ((active->status & (MAIL_STATUS_APPENDED | MAIL_STATUS_HIDDEN)) == 0) {
-					con_print(con, "%llu %u\r\n", number++, active->size);
-				}
-				else if ((active->status & MAIL_STATUS_APPENDED) == 0) {
-					number++;
-				}
-
-			}
-
-			inx_cursor_free(cursor);
-		}
-
-		con_write_bl(con, ".\r\n", 3);
+		pop_write_listing(con, con->pop.user->messages, false);
 	}
 	// Output a specific message.
 	else {
@@ -516,10 +496,9 @@ void pop_dele(connection_t *con) {
  */
 void pop_uidl(connection_t *con) {
 
+	bool_t result;
 	uint64_t number;
-	inx_cursor_t *cursor;
 	meta_message_t *active;
-	bool_t result;
 
 	if (con->pop.session_state != 1) {
 		pop_invalid(con);
@@ -533,25 +512,7 @@ void pop_uidl(connection_t *con) {
 
 	// Output all of the messages that aren't deleted or appended.
 	if (!result) {
-		number = 1;
-		con_print(con, "+OK %llu messages total.\r\n", pop_total_messages(con->pop.user->messages));
-
-		if (con->pop.user->messages && (cursor = inx_cursor_alloc(con->pop.user->messages))) {
-
-			while ((active = inx_cursor_value_next(cursor))) {
-
-				if ((active->status & (MAIL_STATUS_APPENDED | MAIL_STATUS_HIDDEN)) == 0) {
-					con_print(con, "%llu %llu\r\n", number++, active->messagenum);
-				} else if ((active->status & MAIL_STATUS_APPENDED) == 0) {
-					number++;
-				}
-
-			}
-
-			inx_cursor_free(cursor);
-		}
-
-		con_write_bl(con, ".\r\n", 3);
+		pop_write_listing(con, con->pop.user->messages, true);
 	}
 	// Output a specific message.
 	else {
@@ -622,17 +583,14 @@ void pop_top(connection_t *con) {
 
 	meta_user_unlock(con->pop.user);
 
-	// Dot stuff the message.
-	st_replace(&(message->text), PLACER("\n.", 2), PLACER("\n..", 3));
-
 	// Tell the client to prepare for a message. The size is strictly informational.
-	con_print(con, "+OK %u characters follow.\r\n", st_length_get(message->text));
+	con_print(con, "+OK %zu characters follow.\r\n", st_length_get(message->text));
 
-	// We use raw socket IO because it is much faster when writing large amounts of data.
-	con_write_st(con, message->text);
+	// The message is dot stuffed as it's written, so we don't need to hold a second, stuffed copy of it in memory.
+	con_write_stuffed(con, message->text);
 
 	// If the message didn't end with a line break, spit two.
-	if (*(st_char_get(message->text) + st_length_get(message->text) - 1) == '\n') {
+	if (!st_empty(message->text) && *(st_char_get(message->text) + st_length_get(message->text) - 1) == '\n') {
 		con_write_bl(con, ".\r\n", 3);
 	}
 	else {
@@ -693,17 +651,14 @@ void pop_retr(connection_t *con) {
 
 	meta_user_unlock(con->pop.user);
 
-	// Dot stuff the message.
-	st_replace(&(message->text), PLACER("\n.", 2), PLACER("\n..", 3));
-
 	// Tell the client to prepare for a message. The size is strictly informational.
-	con_print(con, "+OK %u characters follow.\r\n", st_length_get(message->text));
+	con_print(con, "+OK %zu characters follow.\r\n", st_length_get(message->text));
 
-	// We use raw socket IO because it is much faster when writing large amounts of data.
-	con_write_st(con, message->text);
+	// The message is dot stuffed as it's written, so we don't need to hold a second, stuffed copy of it in memory.
+	con_write_stuffed(con, message->text);
 
 	// If the message didn't end with a line break, spit two.
-	if (*(st_char_get(message->text) + st_length_get(message->text) - 1) == '\n') {
+	if (!st_empty(message->text) && *(st_char_get(message->text) + st_length_get(message->text) - 1) == '\n') {
 		con_write_bl(con, ".\r\n", 3);
 	}
 	else {
@@ -19,6 +19,7 @@ uint64_t          pop_get_last(inx_t *messages);
 meta_message_t *  pop_get_message(inx_t *messages, uint64_t get);
 uint64_t          pop_total_messages(inx_t *messages);
 uint64_t          pop_total_size(inx_t *messages);
+int64_t           pop_write_listing(connection_t *con, inx_t *messages, bool_t unique);
 
 /// parse.c
 bool_t        pop_num_parse(connection_t *con, uint64_t *outnum, bool_t required);
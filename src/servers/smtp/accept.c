@@ -64,13 +64,19 @@ int_t smtp_store_message(smtp_inbound_prefs_t *prefs, stringer_t **local) {
 	// Increment the messages checkpoint_t so connected clients know there are new messages waiting.
 	serial_increment(OBJECT_MESSAGES, prefs->usernum);
 
+	// Keep the storage usage recorded by the cached preferences in step with the database.
+	smtp_prefs_account(prefs, st_length_get(*local));
+
 	// Set the output values.
 	prefs->messagenum = messagenum;
 	return 1;
 }
 
 /**
- * @brief Delete the oldest mail message owned by a user until their storage usage falls below their storage quota.
+ * @brief	Bring a user's storage usage back under their storage quota by deleting their oldest messages.
+ * @note	The rollout normally happens in the background, so delivery doesn't wait for it. If the rollout thread isn't
+ * 			available the messages are removed before returning, and an account which is still over its quota after the
+ * 			maximum number of passes is accepted, since its oldest messages are being removed.
  * @param	prefs	a pointer to the specified user's inbound mail preferences data.
  * @return	1 on success or < 0 on failure, where
  *         -1: An error occurred retrieving the rollout message list from the database.
@@ -79,77 +85,12 @@ int_t smtp_store_message(smtp_inbound_prefs_t *prefs, stringer_t **local) {
 int_t smtp_rollout(smtp_inbound_prefs_t *prefs) {
 
 	int_t state;
-	unsigned size;
-	row_t *row;
-	stringer_t *server;
-	table_t *messages;
-
-	// Lock the account.
-	state = user_lock(prefs->usernum);
-
-	if (state != 1) {
-		log_pedantic("Could not lock the user account %lu.", prefs->usernum);
-		return -2;
-	}
-
-	// Get a list of messages ready to be deleted.
-	if (!(messages = smtp_fetch_rollmessages(prefs->usernum))) {
-		user_unlock(prefs->usernum);
-		return -1;
-	}
-
-	// Loop until the storage size is under the quota.
-	while (prefs->stor_size >= prefs->quota) {
-
-		// Fetch a row. If no more rows exist, free the result set and try fetching another 20 messages.
-		if (!(row = res_row_next(messages))) {
-			res_table_free(messages);
-
-			if (!(messages = smtp_fetch_rollmessages(prefs->usernum))) {
-				user_unlock(prefs->usernum);
-				return -1;
-			}
-
-			if (!(row = res_row_next(messages))) {
-				user_unlock(prefs->usernum);
-				res_table_free(messages);
-				return -1;
-			}
 
-		}
-
-		// Store the message size.
-		size = res_field_uint32(row, 1);
-
-		// Store the server.
-		if (!(server = res_field_string(row, 2))) {
-			user_unlock(prefs->usernum);
-			res_table_free(messages);
-			return -1;
-		}
-
-		// Delete the message.
-		if (!mail_remove_message(prefs->usernum, res_field_uint64(row, 0), size, st_char_get(server))) {
-			user_unlock(prefs->usernum);
-			res_table_free(messages);
-			st_free(server);
-			return -1;
-		}
-
-		// We don't need the server anymore.
-		st_free(server);
-
-		// Update the storage size.
-		prefs->stor_size -= size;
+	if (smtp_rollout_schedule(prefs->usernum)) {
+		return 1;
 	}
 
-	user_unlock(prefs->usernum);
-	res_table_free(messages);
-
-	// Increment the messages checkpoint_t so connected clients know there are new messages waiting.
-	serial_increment(OBJECT_MESSAGES, prefs->usernum);
-
-	return 1;
+	return (state = smtp_rollout_account(prefs->usernum)) < 0 ? state : 1;
 }
 
 /**
@@ -228,9 +169,9 @@ int_t smtp_accept_message(connection_t *con, smtp_inbound_prefs_t *prefs) {
 	// Check the message for a virus. If vscanned is equal to ten, then the message is virus free.
 	if ((prefs->virus == 1 || prefs->phish == 1) && con->smtp.checked.virus != 1) {
 
-		// The message hasn't been scanned, or encountered an error during the last attempt, so rescan it now.
-		if (con->smtp.checked.virus == 0 || con->smtp.checked.virus == -1) {
-			con->smtp.checked.virus = state = virus_check(con->smtp.message->text);
+		// The message hasn't been scanned yet. A scan which failed, or ran out of time, isn't repeated for every recipient.
+		if (con->smtp.checked.virus == 0) {
+			con->smtp.checked.virus = state = smtp_verdict_virus(con->smtp.message->text);
 		}
 		else {
 			state = con->smtp.checked.virus;
@@ -298,7 +239,7 @@ int_t smtp_accept_message(connection_t *con, smtp_inbound_prefs_t *prefs) {
 
 		// This message hasn't been checked yet.
 		if (con->smtp.checked.dkim == 0) {
-			con->smtp.checked.dkim = dkim_signature_verify(con->smtp.message->id, con->smtp.message->text);
+			con->smtp.checked.dkim = smtp_verdict_dkim(con->smtp.message->id, con->smtp.message->text);
 		}
 
 		// What action.
@@ -7,18 +7,28 @@
 
 #include "magma.h"
 
+inx_t *smtp_rbl_cache = NULL;
+inx_t *smtp_verdict_cache = NULL;
+pthread_mutex_t smtp_rbl_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// The per blacklist counters, which are logged by the maintenance thread.
+struct {
+	uint64_t queries, answers, listed, timeouts, errors, latency;
+} smtp_rbl_stats[MAGMA_BLACKLIST_INSTANCES];
+
 /**
  * @brief	Check to see if a transmitting address is in a user's greylist.
  * @note	The greylist is configured in the Dispatch table and specifies the minimum time, in minutes, that a transmitting smtp
- * 			relay server must wait in order to be able to send more messages to the same recipient address again.
+ * 			relay server must wait in order to be able to send more messages to the same recipient address again. Records are
+ * 			kept in memcached, so every server in the cluster shares them, with an in memory copy used to avoid the round trip.
  * @param	con		the connection to have its remote address checked against the user's greylist.
  * @param	prefs	the smtp inbound preferences of the user
  * @return 	-1 on an internal server error, 0 if the sender must wait longer, and 1 if the check was passed.
  */
 int_t smtp_check_greylist(connection_t *con, smtp_inbound_prefs_t *prefs) {
 
-	int_t result = 0;
-	uint64_t now, stamp, updated;
+	int_t result = 0, local;
+	uint64_t now, stamp, updated, hash;
 	stringer_t *value = NULL, *addr = MANAGEDBUF(128), *key = MANAGEDBUF(256);
 
 	// Being on the bypass list skips all of this
@@ -40,6 +50,50 @@ int_t smtp_check_greylist(connection_t *con, smtp_inbound_prefs_t *prefs) {
 		return -1;
 	}
 
+	hash = hash_murmur64(st_data_get(key), st_length_get(key));
+
+	// Senders found in memory are decided without a network round trip, unless the memcached record is due to be refreshed.
+	if ((local = smtp_greylist_lookup(hash, now, &stamp, &updated, prefs->greytime)) == 1) {
+
+		stats_increment_by_name("smtp.greylist.hits");
+
+		if (((now - stamp) / 60) > prefs->greytime) {
+			result = 1;
+		}
+
+		if ((now - 86400) > updated && (value = st_alloc_opts(BLOCK_T | CONTIGUOUS | HEAP, 16))) {
+			*((uint64_t *)st_data_get(value)) = stamp;
+			*(((uint64_t *)st_data_get(value)) + 1) = now;
+			if (cache_set(key, value, 2592000) == 1) {
+				smtp_greylist_store(hash, now, stamp, now);
+			}
+			st_free(value);
+		}
+
+		return result;
+	}
+
+	stats_increment_by_name("smtp.greylist.misses");
+
+	if (!(value = st_alloc_opts(BLOCK_T | CONTIGUOUS | HEAP, 16))) {
+		log_pedantic("Unable to allocate the greylist attempt record.");
+		return -1;
+	}
+
+	*((uint64_t *)st_data_get(value)) = now;
+	*(((uint64_t *)st_data_get(value)) + 1) = now;
+
+	// A sender this process has never recorded is most likely new, so try adding the record before looking for it. If another
+	// server already added it, we fall through to the lookup below.
+	if (local == -1 && cache_silent_add(key, value, 2592000) == 1) {
+		stats_increment_by_name("smtp.greylist.added");
+		smtp_greylist_store(hash, now, now, now);
+		st_free(value);
+		return 0;
+	}
+
+	st_free(value);
+
 	// Pull the cache value and see if its old enough.
 	if ((value = cache_get(key)) && st_length_get(value) == 16) {
 		stamp = *((uint64_t *)st_data_get(value));
@@ -52,68 +106,723 @@ int_t smtp_check_greylist(connection_t *con, smtp_inbound_prefs_t *prefs) {
 
 		// If the updated time is more than 1 day old, set the value in cache again so it won't be expired.
 		if ((now - 86400) > updated) {
-			*(((uint64_t *)st_data_get(value)) + 1) = now;
+			*(((uint64_t *)st_data_get(value)) + 1) = updated = now;
 			cache_set(key, value, 2592000);
 		}
+
+		smtp_greylist_store(hash, now, stamp, updated);
 	}
 
 	// If no value was found in the database, store the current time. Errors result in a neutral return code.
-	else if (!(value = st_alloc_opts(BLOCK_T | CONTIGUOUS | HEAP, 16)) || !(*((uint64_t *)st_data_get(value)) = now) ||
-		!(*(((uint64_t *)st_data_get(value)) + 1) = now) || cache_set(key, value, 2592000) != 1) {
-		log_pedantic("Unable to set greylist attempt record.");
-		result = -1;
+	else {
+
+		st_cleanup(value);
+
+		if (!(value = st_alloc_opts(BLOCK_T | CONTIGUOUS | HEAP, 16)) || !(*((uint64_t *)st_data_get(value)) = now) ||
+			!(*(((uint64_t *)st_data_get(value)) + 1) = now) || cache_set(key, value, 2592000) != 1) {
+			log_pedantic("Unable to set greylist attempt record.");
+			result = -1;
+		}
+		else {
+			smtp_greylist_store(hash, now, now, now);
+		}
 	}
 
 	st_cleanup(value);
 	return result;
 }
 
+/**
+ * @brief	Allocate the realtime blacklist cache.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_rbl_start(void) {
+
+	if (!(smtp_rbl_cache = inx_alloc(M_INX_TREE | M_INX_LOCK_MANUAL, &mm_free))) {
+		log_critical("Unable to initialize the realtime blacklist cache.");
+		return false;
+	}
+
+	mm_wipe(smtp_rbl_stats, sizeof(smtp_rbl_stats));
+	return true;
+}
+
+/**
+ * @brief	Free the realtime blacklist cache at shutdown.
+ * @return	This function returns no value.
+ */
+void smtp_rbl_stop(void) {
+
+	if (smtp_rbl_cache) {
+		inx_free(smtp_rbl_cache);
+		smtp_rbl_cache = NULL;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Determine whether a realtime blacklist cache entry has expired.
+ * @param	entry	a pointer to the cache entry being examined.
+ * @param	now		a pointer to the current time.
+ * @return	true if the entry has expired, or false if it is still valid.
+ */
+bool_t smtp_rbl_expired(smtp_rbl_entry_t *entry, time_t *now) {
+
+	return entry->expiration <= *now;
+}
+
+/**
+ * @brief	Remove the expired entries from the realtime blacklist cache, and log the statistics for each blacklist.
+ * @note	This function is called periodically by the maintenance thread.
+ * @return	This function returns no value.
+ */
+void smtp_rbl_prune(void) {
+
+	time_t now;
+	uint64_t queries, answers, listed, timeouts, errors, latency;
+
+	if ((now = time(NULL)) != (time_t)(-1) && smtp_rbl_cache) {
+		inx_lock_write(smtp_rbl_cache);
+		inx_prune(smtp_rbl_cache, (bool_t (*)(void *, void *))&smtp_rbl_expired, &now);
+		inx_unlock(smtp_rbl_cache);
+	}
+
+	for (uint32_t i = 0; i < magma.smtp.blacklists.count; i++) {
+
+		mutex_lock(&smtp_rbl_lock);
+		queries = smtp_rbl_stats[i].queries;
+		answers = smtp_rbl_stats[i].answers;
+		listed = smtp_rbl_stats[i].listed;
+		timeouts = smtp_rbl_stats[i].timeouts;
+		errors = smtp_rbl_stats[i].errors;
+		latency = smtp_rbl_stats[i].latency;
+		mutex_unlock(&smtp_rbl_lock);
+
+		if (queries) {
+			log_info("Realtime blacklist statistics. { domain = %.*s / queries = %lu / listed = %lu / hit rate = %.2f%% / timeouts = %lu / errors = %lu / " \
+				"average latency = %lums }", st_length_int(magma.smtp.blacklists.domain[i]), st_char_get(magma.smtp.blacklists.domain[i]), queries, listed,
+				((double_t)listed * 100) / queries, timeouts, errors, answers ? latency / answers : 0);
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief	Look up a remote address in the realtime blacklist cache.
+ * @param	addr	the reversed form of the remote address.
+ * @return	0 if the address wasn't found or the entry has expired, -2 if the address was blacklisted, or 1 if it passed the check.
+ */
+int_t smtp_rbl_cache_get(stringer_t *addr) {
+
+	int_t result = 0;
+	smtp_rbl_entry_t *entry;
+	multi_t key = { .type = M_TYPE_STRINGER, .val.st = addr };
+
+	if (!smtp_rbl_cache) {
+		return 0;
+	}
+
+	inx_lock_read(smtp_rbl_cache);
+
+	if ((entry = inx_find(smtp_rbl_cache, key)) && entry->expiration > time(NULL)) {
+		result = entry->result;
+	}
+
+	inx_unlock(smtp_rbl_cache);
+
+	return result;
+}
+
+/**
+ * @brief	Store the outcome of a realtime blacklist check in the cache.
+ * @param	addr	the reversed form of the remote address.
+ * @param	result	the outcome of the check, either -2 if the address was blacklisted, or 1 if it passed the check.
+ * @param	ttl		the number of seconds the outcome should be cached.
+ * @return	This function returns no value.
+ */
+void smtp_rbl_cache_set(stringer_t *addr, int_t result, uint32_t ttl) {
+
+	smtp_rbl_entry_t *entry;
+	multi_t key = { .type = M_TYPE_STRINGER, .val.st = addr };
+
+	if (!smtp_rbl_cache || !ttl || !(entry = mm_alloc(sizeof(smtp_rbl_entry_t)))) {
+		return;
+	}
+
+	entry->result = result;
+	entry->expiration = time(NULL) + ttl;
+
+	inx_lock_write(smtp_rbl_cache);
+
+	// Entries are only replaced once they expire, and the maintenance thread removes them, so we avoid growing without bound.
+	if (inx_count(smtp_rbl_cache) >= 65536 || !inx_replace(smtp_rbl_cache, key, entry)) {
+		mm_free(entry);
+	}
+
+	inx_unlock(smtp_rbl_cache);
+
+	return;
+}
+
+/**
+ * @brief	Allocate the content check verdict cache.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_verdict_start(void) {
+
+	if (!magma.smtp.content.cache) {
+		return true;
+	}
+	else if (!(smtp_verdict_cache = inx_alloc(M_INX_TREE | M_INX_LOCK_MANUAL, &mm_free))) {
+		log_critical("Unable to initialize the content check verdict cache.");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Free the content check verdict cache at shutdown.
+ * @return	This function returns no value.
+ */
+void smtp_verdict_stop(void) {
+
+	if (smtp_verdict_cache) {
+		inx_free(smtp_verdict_cache);
+		smtp_verdict_cache = NULL;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Determine whether a content check verdict has expired, or was reached using outdated virus signatures.
+ * @param	entry	a pointer to the cache entry being examined.
+ * @param	current	a pointer to a verdict entry holding the current time and the current virus signature generation.
+ * @return	true if the entry should be removed, or false if it is still valid.
+ */
+bool_t smtp_verdict_expired(smtp_verdict_entry_t *entry, smtp_verdict_entry_t *current) {
+
+	return entry->expiration <= current->expiration || (entry->generation && entry->generation != current->generation);
+}
+
+/**
+ * @brief	Remove the expired entries, and the virus verdicts reached with outdated signatures, from the content check verdict cache.
+ * @note	This function is called periodically by the maintenance thread.
+ * @return	This function returns no value.
+ */
+void smtp_verdict_prune(void) {
+
+	smtp_verdict_entry_t current;
+
+	if ((current.expiration = time(NULL)) == (time_t)(-1) || !smtp_verdict_cache) {
+		return;
+	}
+
+	current.generation = virus_engine_generation();
+
+	inx_lock_write(smtp_verdict_cache);
+	inx_prune(smtp_verdict_cache, (bool_t (*)(void *, void *))&smtp_verdict_expired, &current);
+	inx_unlock(smtp_verdict_cache);
+
+	return;
+}
+
+/**
+ * @brief	Collect the DKIM-Signature headers of a message, along with every instance of each header they sign.
+ * @note	The signed headers are found using the h= tag of each signature, and are collected wherever they appear in the header,
+ * 			so a header added above a signature still changes the result.
+ * @param	header	a managed string containing the message header.
+ * @return	NULL if the message isn't signed or on failure, or a managed string containing the headers, which the caller must free.
+ */
+stringer_t * smtp_verdict_signed(stringer_t *header) {
+
+	size_t position = 0;
+	placer_t signature, tag, name;
+	stringer_t *signatures, *result, *values, *holder;
+
+	if (!(signatures = mail_header_fetch_all(header, PLACER("DKIM-Signature", 14))) || !(result = st_dupe(signatures))) {
+		st_cleanup(signatures);
+		return NULL;
+	}
+
+	while (result && !pl_empty((signature = mail_header_pop(signatures, &position)))) {
+
+		for (uint64_t i = 0; result && i < tok_get_count_bl(pl_data_get(signature), pl_length_get(signature), ';'); i++) {
+
+			// Tag names are case sensitive, while the header names in the list aren't.
+			if (tok_get_pl(signature, ';', i, &tag) < 0 || pl_length_get((tag = pl_trim(tag))) < 2 || mm_cmp_cs_eq(pl_char_get(tag), "h=", 2)) {
+				continue;
+			}
+
+			tag = pl_init(pl_char_get(tag) + 2, pl_length_get(tag) - 2);
+
+			for (uint64_t j = 0; result && j < tok_get_count_bl(pl_data_get(tag), pl_length_get(tag), ':'); j++) {
+
+				if (tok_get_pl(tag, ':', j, &name) < 0 || pl_empty((name = pl_trim(name))) ||
+					!(values = mail_header_fetch_all(header, (stringer_t *)&name))) {
+					continue;
+				}
+
+				holder = st_merge("ss", result, values);
+				st_free(result);
+				st_free(values);
+				result = holder;
+			}
+		}
+	}
+
+	st_free(signatures);
+
+	return result;
+}
+
+/**
+ * @brief	Generate the verdict cache key for a message.
+ * @note	Virus verdicts are keyed using the message body, along with the top level Content-Type and Content-Transfer-Encoding
+ * 			headers, since those control how the body is decoded. The trace and addressing headers which differ between copies of
+ * 			the same message are ignored. DKIM verdicts are keyed using the message body, the DKIM-Signature headers, and every
+ * 			instance of each header named by a signature, wherever it appears.
+ * @param	check		either SMTP_CONTENT_VIRUS or SMTP_CONTENT_DKIM.
+ * @param	message		a managed string containing the message.
+ * @param	output		a managed string that will receive the key, which must be able to hold at least 70 bytes.
+ * @return	NULL if the message can't be cached, or a pointer to the output string on success.
+ */
+stringer_t * smtp_verdict_key(int_t check, stringer_t *message, stringer_t *output) {
+
+	size_t header;
+	stringer_t *digest = MANAGEDBUF(64), *hex = MANAGEDBUF(129), *type = NULL, *encoding = NULL, *combined = NULL, *signed_headers = NULL;
+
+	if (st_empty(message) || !(header = mail_header_end(message)) || header >= st_length_get(message)) {
+		return NULL;
+	}
+
+	if (check == SMTP_CONTENT_DKIM) {
+
+		// Messages without a signature are never verified, so there is nothing worth caching.
+		if (!(signed_headers = smtp_verdict_signed(PLACER(st_char_get(message), header)))) {
+			return NULL;
+		}
+
+		if (!hash_sha256(PLACER(st_char_get(message) + header, st_length_get(message) - header), digest) || !hex_encode_st(digest, hex) ||
+			!(combined = st_merge("ss", signed_headers, hex)) || !hash_sha256(combined, digest)) {
+			st_cleanup(signed_headers, combined);
+			return NULL;
+		}
+
+		st_cleanup(signed_headers, combined);
+	}
+	else {
+
+		type = mail_header_fetch_cleaned(PLACER(st_char_get(message), header), PLACER("Content-Type", 12));
+		encoding = mail_header_fetch_cleaned(PLACER(st_char_get(message), header), PLACER("Content-Transfer-Encoding", 25));
+
+		// The body hash is combined with the headers, so the body never has to be copied.
+		if (!hash_sha256(PLACER(st_char_get(message) + header, st_length_get(message) - header), digest) || !hex_encode_st(digest, hex) ||
+			!(combined = st_aprint("%.*s\n%.*s\n%.*s", st_length_int(type), type ? st_char_get(type) : "", st_length_int(encoding),
+				encoding ? st_char_get(encoding) : "", st_length_int(hex), st_char_get(hex))) || !hash_sha256(combined, digest)) {
+			st_cleanup(type, encoding, combined);
+			return NULL;
+		}
+
+		st_cleanup(type, encoding, combined);
+	}
+
+	if (!hex_encode_st(digest, hex) || st_sprint(output, "%s.%.*s", (check == SMTP_CONTENT_DKIM ? "dkim" : "virus"), st_length_int(hex),
+		st_char_get(hex)) <= 0) {
+		return NULL;
+	}
+
+	return output;
+}
+
+/**
+ * @brief	Look up a content check verdict in the cache.
+ * @param	key			the verdict cache key generated by smtp_verdict_key().
+ * @param	generation	the current virus engine generation, or zero for verdicts which don't depend on the virus signatures.
+ * @return	0 if the verdict wasn't found, has expired, or was reached using outdated signatures, otherwise the cached verdict.
+ */
+int_t smtp_verdict_get(stringer_t *key, uint64_t generation) {
+
+	int_t result = 0;
+	smtp_verdict_entry_t *entry;
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = key };
+
+	if (!smtp_verdict_cache) {
+		return 0;
+	}
+
+	inx_lock_read(smtp_verdict_cache);
+
+	if ((entry = inx_find(smtp_verdict_cache, name)) && entry->expiration > time(NULL) && entry->generation == generation) {
+		result = entry->result;
+	}
+
+	inx_unlock(smtp_verdict_cache);
+
+	return result;
+}
+
+/**
+ * @brief	Store a content check verdict in the cache.
+ * @param	key			the verdict cache key generated by smtp_verdict_key().
+ * @param	result		the verdict being cached.
+ * @param	generation	the virus engine generation used to reach the verdict, or zero for verdicts which don't depend on the virus signatures.
+ * @return	This function returns no value.
+ */
+void smtp_verdict_set(stringer_t *key, int_t result, uint64_t generation) {
+
+	smtp_verdict_entry_t *entry;
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = key };
+
+	if (!smtp_verdict_cache || !(entry = mm_alloc(sizeof(smtp_verdict_entry_t)))) {
+		return;
+	}
+
+	entry->result = result;
+	entry->generation = generation;
+	entry->expiration = time(NULL) + magma.smtp.content.cache;
+
+	inx_lock_write(smtp_verdict_cache);
+
+	if (inx_count(smtp_verdict_cache) >= magma.smtp.content.cache_limit || !inx_replace(smtp_verdict_cache, name, entry)) {
+		mm_free(entry);
+	}
+
+	inx_unlock(smtp_verdict_cache);
+
+	return;
+}
+
+/**
+ * @brief	Virus scan a message, reusing the verdict for an identical message body if one was recently scanned.
+ * @note	Failures aren't cached, and neither are verdicts reached while the virus signatures were being replaced.
+ * @param	message		a managed string containing the message to be scanned.
+ * @return	the same values as virus_check().
+ */
+int_t smtp_verdict_virus(stringer_t *message) {
+
+	int_t result;
+	uint64_t generation;
+	stringer_t *key = MANAGEDBUF(128);
+
+	if (!smtp_verdict_cache || !magma.iface.virus.available || !smtp_verdict_key(SMTP_CONTENT_VIRUS, message, key)) {
+		return virus_check(message);
+	}
+
+	// The generation is recorded before the scan, so a verdict reached with signatures that are replaced mid scan is never reused.
+	generation = virus_engine_generation();
+
+	if ((result = smtp_verdict_get(key, generation))) {
+		stats_increment_by_name("smtp.content.virus.cached");
+		return result;
+	}
+	else if ((result = virus_check(message)) == 1 || result == -2 || result == -3) {
+		smtp_verdict_set(key, result, generation);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Verify the DKIM signature of a message, reusing the verdict for an identically signed message if one was recently verified.
+ * @note	Only valid signatures are cached, since a failed verification may be caused by a key that couldn't be retrieved.
+ * @param	id			a managed string containing a printable string id for this message.
+ * @param	message		a managed string containing the message to be verified.
+ * @return	the same values as dkim_signature_verify().
+ */
+int_t smtp_verdict_dkim(stringer_t *id, stringer_t *message) {
+
+	int_t result;
+	stringer_t *key = MANAGEDBUF(128);
+
+	if (!smtp_verdict_cache || !smtp_verdict_key(SMTP_CONTENT_DKIM, message, key)) {
+		return dkim_signature_verify(id, message);
+	}
+	else if ((result = smtp_verdict_get(key, 0))) {
+		stats_increment_by_name("smtp.content.dkim.cached");
+		return result;
+	}
+	else if ((result = dkim_signature_verify(id, message)) == 1) {
+		smtp_verdict_set(key, result, 0);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Send a blacklist query to a name server.
+ * @note	The socket is connected to the name server, so a server that refuses the query is reported by the socket, and answers
+ * 			from anywhere else are discarded by the kernel. Connecting the socket again switches it to a different name server.
+ * @param	sockd		the datagram socket used for the query.
+ * @param	server		a pointer to the address of the name server, which must match the address family of the socket.
+ * @param	packet		the DNS query packet.
+ * @param	length		the length, in bytes, of the DNS query packet.
+ * @return	true if the query was sent, or false on failure.
+ */
+bool_t smtp_check_rbl_send(int_t sockd, struct sockaddr_storage *server, uchr_t *packet, int_t length) {
+
+	socklen_t size = server->ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+
+	if (connect(sockd, (struct sockaddr *)server, size) || send(sockd, packet, length, 0) != length) {
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * @brief	Check the SMTP connection's remote address against a collection of real-time blacklists.
- * @note	The connection's IP address will be checked against each of the servers configured in magma.smtp.blacklists.domain.
+ * @note	The connection's IP address will be checked against each of the servers configured in magma.smtp.blacklists.domain. The
+ * 			queries are sent in parallel, and the function waits up to magma.smtp.blacklist_timeout milliseconds for the answers, so
+ * 			a slow or dead blacklist only costs us the deadline. The deadline is split into rounds, one per configured name server
+ * 			(with a minimum of two), and unanswered queries are retransmitted to the next name server at the start of every round. A
+ * 			query refused by a name server moves on to the next one right away. A listing is cached for the time to live provided by
+ * 			the blacklist, while a clean result is only cached when every blacklist answered, and then for magma.smtp.blacklist_cache
+ * 			seconds.
+ * @note	If the resolver configuration includes an IPv6 name server, the queries are sent from IPv6 sockets, and any IPv4 name
+ * 			servers are addressed using IPv4 mapped addresses.
  * @param	con		the connection to have its address examined against the RBLs.
  * @return	-1 on general error, -2 if the address was blacklisted, or 1 if it passed the check.
  */
 int_t smtp_check_rbl(connection_t *con) {
 
-	int_t ret, result = -1;
+	ns_rr record;
+	ns_msg handle;
+	HEADER *header;
+	ssize_t length;
+	struct __res_state resolver;
 	chr_t query[NI_MAXHOST];
-	struct addrinfo *lookup, hints;
+	struct sockaddr_in6 *mapped;
+	int_t family = AF_INET, off = 0;
+	struct sockaddr_storage servers[MAXNS];
 	stringer_t *addr = MANAGEDBUF(128);
+	struct pollfd fds[MAGMA_BLACKLIST_INSTANCES];
+	uint64_t started, elapsed, boundary, timeout = magma.smtp.blacklists.timeout;
+	int_t lengths[MAGMA_BLACKLIST_INSTANCES], result = -1, answered = 0, ret;
+	uchr_t packets[MAGMA_BLACKLIST_INSTANCES][NS_PACKETSZ], response[NS_PACKETSZ];
+	uint32_t count = magma.smtp.blacklists.count, pending = 0, ttl = 0, nameservers = 0, rounds, round = 0, current[MAGMA_BLACKLIST_INSTANCES];
 
-	mm_wipe(&hints, sizeof(struct addrinfo));
-	hints.ai_family = AF_UNSPEC;
-	hints.ai_socktype = 0;
-	hints.ai_flags = 0;
-	hints.ai_protocol = 0;
-
-	if (!(addr = con_addr_reversed(con, addr))) {
+	if (!count) {
+		return result;
+	}
+	else if (!(addr = con_addr_reversed(con, addr))) {
 		log_pedantic("Address string creation failed.");
 		return result;
 	}
 
-	for (uint32_t i = 0; i < magma.smtp.blacklists.count; i++) {
+	// If we've seen this address recently, the DNS lookups can be skipped entirely.
+	if ((ret = smtp_rbl_cache_get(addr))) {
+		stats_increment_by_name("smtp.rbl.cached");
+		return ret;
+	}
 
-		// Build the DNS query.
-		if ((snprintf(query, NI_MAXHOST, "%.*s.%*s", st_length_int(addr), st_char_get(addr),
-			st_length_int(magma.smtp.blacklists.domain[i]),	st_char_get(magma.smtp.blacklists.domain[i]))) == 0) {
-				log_pedantic("Address string creation failed.");
+	mm_wipe(&resolver, sizeof(struct __res_state));
+
+	if (res_ninit(&resolver)) {
+		log_pedantic("Unable to initialize the DNS resolver.");
+		return result;
+	}
+
+	// The resolver stores IPv6 name servers separately, and leaves the family of the matching IPv4 slot unset.
+	for (int_t i = 0; i < resolver.nscount && i < MAXNS; i++) {
+		if (resolver.nsaddr_list[i].sin_family != AF_INET && resolver._u._ext.nsaddrs[i] && resolver._u._ext.nsaddrs[i]->sin6_family == AF_INET6) {
+			family = AF_INET6;
 		}
+	}
+
+	// Collect the usable name servers, so a query can fall back to the next one when a server doesn't answer. A socket can only
+	// be connected to an address in its own family, so when IPv6 is in use, the IPv4 name servers are mapped into IPv6 addresses.
+	for (int_t i = 0; i < resolver.nscount && i < MAXNS; i++) {
+
+		mm_wipe(&(servers[nameservers]), sizeof(struct sockaddr_storage));
+		mapped = (struct sockaddr_in6 *)&(servers[nameservers]);
+
+		if (resolver.nsaddr_list[i].sin_family == AF_INET && family == AF_INET) {
+			mm_copy(&(servers[nameservers++]), &(resolver.nsaddr_list[i]), sizeof(struct sockaddr_in));
+		}
+		else if (resolver.nsaddr_list[i].sin_family == AF_INET) {
+			mapped->sin6_family = AF_INET6;
+			mapped->sin6_port = resolver.nsaddr_list[i].sin_port;
+			mapped->sin6_addr.s6_addr[10] = mapped->sin6_addr.s6_addr[11] = 0xff;
+			mm_copy(&(mapped->sin6_addr.s6_addr[12]), &(resolver.nsaddr_list[i].sin_addr), sizeof(struct in_addr));
+			nameservers++;
+		}
+		else if (resolver._u._ext.nsaddrs[i] && resolver._u._ext.nsaddrs[i]->sin6_family == AF_INET6) {
+			mm_copy(&(servers[nameservers++]), resolver._u._ext.nsaddrs[i], sizeof(struct sockaddr_in6));
+		}
+	}
+
+	if (!nameservers) {
+		log_pedantic("Unable to find a name server for the realtime blacklist queries.");
+		res_nclose(&resolver);
+		return result;
+	}
+
+	rounds = nameservers > 1 ? nameservers : 2;
+
+	stats_increment_by_name("smtp.rbl.checked");
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		fds[i].fd = -1;
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+		current[i] = 0;
 
-		// A zero means we found a blacklist entry, so we need to free the entry.
-		else if (!(ret = getaddrinfo(query, NULL, &hints, &lookup))) {
-			freeaddrinfo(lookup);
-			return -2;
+		// Build the DNS query.
+		if (snprintf(query, NI_MAXHOST, "%.*s.%.*s", st_length_int(addr), st_char_get(addr), st_length_int(magma.smtp.blacklists.domain[i]),
+			st_char_get(magma.smtp.blacklists.domain[i])) <= 0) {
+			log_pedantic("Address string creation failed.");
+		}
+		else if ((lengths[i] = res_nmkquery(&resolver, ns_o_query, query, ns_c_in, ns_t_a, NULL, 0, NULL, packets[i], NS_PACKETSZ)) <= 0) {
+			log_pedantic("Unable to build the blacklist DNS query. { query = %s }", query);
+		}
+		else if ((fds[i].fd = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+			log_pedantic("Unable to create a socket for the blacklist DNS query. { error = %s }", errno_string(errno, bufptr, buflen));
 		}
-		// If the return code code indicates an error, rather than simply not finding a matching entry.
-		// Do we also want to exclude EAI_ADDRFAMILY or EAI_NODATA
-		else if (ret != EAI_NONAME) {
-			log_pedantic("Blacklist DNS attempt resulted in an error. { getaddrinfo = %s }", gai_strerror(ret));
+		// The IPv4 mapped name server addresses are only reachable if the socket accepts both address families.
+		else if (family == AF_INET6 && setsockopt(fds[i].fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(int_t))) {
+			log_pedantic("Unable to configure the blacklist DNS query socket. { error = %s }", errno_string(errno, bufptr, buflen));
+			close(fds[i].fd);
+			fds[i].fd = -1;
 		}
+		else if (!smtp_check_rbl_send(fds[i].fd, &(servers[0]), packets[i], lengths[i]) && nameservers == 1) {
+			log_pedantic("Unable to send the blacklist DNS query. { query = %s / error = %s }", query, errno_string(errno, bufptr, buflen));
+			close(fds[i].fd);
+			fds[i].fd = -1;
+		}
+		// If the first name server couldn't be reached, the query is sent to the next one at the start of the next round.
 		else {
-			result = 1;
+			pending++;
+		}
+
+		mutex_lock(&smtp_rbl_lock);
+		smtp_rbl_stats[i].queries++;
+		if (fds[i].fd == -1) smtp_rbl_stats[i].errors++;
+		mutex_unlock(&smtp_rbl_lock);
+
+		if (fds[i].fd == -1) stats_increment_by_name("smtp.rbl.errors");
+	}
+
+	started = time_monotonic_ms();
+
+	while (pending && result != -2 && status() && (elapsed = time_monotonic_ms() - started) < timeout) {
+
+		// At the start of every round, the unanswered queries are retransmitted to the next name server, in case a datagram was
+		// lost or the server is down.
+		while (round + 1 < rounds && elapsed >= (timeout * (round + 1)) / rounds) {
+			round++;
+			for (uint32_t i = 0; i < count; i++) {
+				if (fds[i].fd != -1) {
+					current[i] = (current[i] + 1) % nameservers;
+					smtp_check_rbl_send(fds[i].fd, &(servers[current[i]]), packets[i], lengths[i]);
+				}
+			}
+		}
+
+		boundary = round + 1 < rounds ? (timeout * (round + 1)) / rounds : timeout;
+
+		if ((ret = poll(fds, count, boundary - elapsed)) < 0 && errno != EINTR) {
+			log_pedantic("Unable to wait for the blacklist DNS answers. { error = %s }", errno_string(errno, bufptr, buflen));
+			break;
+		}
+
+		for (uint32_t i = 0; ret > 0 && i < count; i++) {
+
+			if (fds[i].fd == -1 || !fds[i].revents) {
+				continue;
+			}
+
+			// Ignore anything that isn't an answer to the query we sent, unless the socket reported an error.
+			else if (((length = recv(fds[i].fd, response, NS_PACKETSZ, 0)) < HFIXEDSZ || ((HEADER *)response)->id != ((HEADER *)packets[i])->id ||
+				!((HEADER *)response)->qr) && !(fds[i].revents & (POLLERR | POLLHUP))) {
+				continue;
+			}
+
+			// A name server that refused the query is skipped, so the query moves on to the next server without waiting for the round to end.
+			else if (length < 0 && current[i] + 1 < nameservers) {
+				current[i]++;
+				smtp_check_rbl_send(fds[i].fd, &(servers[current[i]]), packets[i], lengths[i]);
+				continue;
+			}
+
+			header = (HEADER *)response;
+			elapsed = time_monotonic_ms() - started;
+
+			// A name error means the address isn't listed.
+			if (length >= HFIXEDSZ && header->id == ((HEADER *)packets[i])->id && header->rcode == NXDOMAIN) {
+				if (result == -1) result = 1;
+				answered++;
+			}
+
+			// An address record means it is. The time to live tells us how long the listing can be cached.
+			else if (length >= HFIXEDSZ && header->id == ((HEADER *)packets[i])->id && header->rcode == NOERROR && ntohs(header->ancount)) {
+
+				if (!ns_initparse(response, length, &handle) && !ns_parserr(&handle, ns_s_an, 0, &record)) {
+					ttl = ns_rr_ttl(record);
+				}
+
+				result = -2;
+				answered++;
+
+				mutex_lock(&smtp_rbl_lock);
+				smtp_rbl_stats[i].listed++;
+				mutex_unlock(&smtp_rbl_lock);
+			}
+
+			// The name exists, but doesn't have an address record, so the address isn't listed.
+			else if (length >= HFIXEDSZ && header->id == ((HEADER *)packets[i])->id && header->rcode == NOERROR) {
+				if (result == -1) result = 1;
+				answered++;
+			}
+
+			else {
+				log_pedantic("Blacklist DNS attempt resulted in an error. { domain = %.*s / rcode = %i }", st_length_int(magma.smtp.blacklists.domain[i]),
+					st_char_get(magma.smtp.blacklists.domain[i]), length >= HFIXEDSZ ? header->rcode : -1);
+				stats_increment_by_name("smtp.rbl.errors");
+
+				mutex_lock(&smtp_rbl_lock);
+				smtp_rbl_stats[i].errors++;
+				mutex_unlock(&smtp_rbl_lock);
+			}
+
+			mutex_lock(&smtp_rbl_lock);
+			smtp_rbl_stats[i].answers++;
+			smtp_rbl_stats[i].latency += elapsed;
+			mutex_unlock(&smtp_rbl_lock);
+
+			close(fds[i].fd);
+			fds[i].fd = -1;
+			pending--;
+		}
+	}
+
+	// Anything still outstanding either timed out, or was abandoned because another list already found a match.
+	for (uint32_t i = 0; i < count; i++) {
+		if (fds[i].fd != -1) {
+
+			if (result != -2) {
+				stats_increment_by_name("smtp.rbl.timeouts");
+				mutex_lock(&smtp_rbl_lock);
+				smtp_rbl_stats[i].timeouts++;
+				mutex_unlock(&smtp_rbl_lock);
+			}
+
+			close(fds[i].fd);
 		}
+	}
 
+	res_nclose(&resolver);
+
+	if (result == -2) {
+		stats_increment_by_name("smtp.rbl.listed");
+		smtp_rbl_cache_set(addr, result, ttl ? ttl : magma.smtp.blacklists.cache);
+	}
+	else if (result == 1 && answered == count) {
+		smtp_rbl_cache_set(addr, result, magma.smtp.blacklists.cache);
 	}
 
 	return result;
@@ -248,86 +957,54 @@ int_t smtp_check_filters(smtp_inbound_prefs_t *prefs, stringer_t **local) {
  */
 bool_t smtp_bypass_add(stringer_t *subnet) {
 
-	subnet_t *sn;
-	multi_t key;
-	static size_t kval = 1;
+	subnet_t sn;
 
-	if (!magma.smtp.bypass_subnets && !(magma.smtp.bypass_subnets = inx_alloc(M_INX_LINKED, &mm_free))) {
+	if (!magma.smtp.bypass_subnets && !(magma.smtp.bypass_subnets = subnet_trie_alloc())) {
 		log_pedantic("Could not allocate space for smtp bypass list.");
 		return false;
 	}
 
-	if (!(sn = mm_alloc(sizeof(subnet_t)))) {
-		log_error("Could not allocate space for smtp bypass entry.");
-		return false;
-	}
-
-	if (!ip_subnet_st(st_char_get(subnet), sn)) {
+	if (!ip_subnet_st(st_char_get(subnet), &sn)) {
 		log_pedantic("SMTP bypass subnet was invalid { subnet = %s }", st_char_get(subnet));
-		mm_free(sn);
 		return false;
 	}
 
-	key.type = M_TYPE_UINT64;
-	key.val.u64 = kval++;
-
-	if (!inx_insert(magma.smtp.bypass_subnets, key, sn)) {
+	if (!subnet_trie_add(magma.smtp.bypass_subnets, &sn, NULL)) {
 		log_pedantic("Unable to create smtp bypass entry.");
-		mm_free(sn);
 		return false;
 	}
 
 	return true;
 }
 
-
-
 /**
  * @brief Free the SMTP bypass list at shutdown.
  * @return  This function returns no value.
  */
 void smtp_bypass_free(void) {
 
-  if (magma.smtp.bypass_subnets) {
-    inx_free(magma.smtp.bypass_subnets);
-    magma.smtp.bypass_subnets = NULL;
-  }
+	if (magma.smtp.bypass_subnets) {
+		subnet_trie_free(subnet_trie_swap(&(magma.smtp.bypass_subnets), NULL));
+	}
 
+	return;
 }
 
 /**
  * @brief	Check if a connection should bypass certain SMTP checks.
- * @note	This check is run against host and/or subnet masks configured in the magma.smtp.bypass_addr option.
+ * @note	This check is run against host and/or subnet masks configured in the magma.smtp.bypass_addr option. The subnets are
+ * 			held in a radix trie, so the cost of the check doesn't grow with the number of subnets.
  * @param	con		a pointer to the connection object to be checked.
  * @return	true if the specified connection meets the SMTP bypass check or false on failure or if it does not.
  */
 bool_t smtp_bypass_check(connection_t *con) {
 
 	ip_t remote;
-	bool_t result = false;
-	subnet_t *subnet = NULL;
-	inx_cursor_t *cursor = NULL;
+	subnet_trie_t *subnets;
 
-	if (!magma.smtp.bypass_subnets || !con_addr(con, &remote)) {
+	if (!(subnets = subnet_trie_get(&(magma.smtp.bypass_subnets))) || !con_addr(con, &remote)) {
 		return false;
 	}
-	else if (!(cursor = inx_cursor_alloc(magma.smtp.bypass_subnets))) {
-		return false;
-	}
-
-	while (!result && (subnet = inx_cursor_value_next(cursor))) {
-
-		// If the subnet mask is 32 for a v4 address, or 128 for v6 address, do a straight comparison.
-		if (((subnet->address.family == AF_INET && subnet->mask == 32) ||
-			(subnet->address.family == AF_INET6 && subnet->mask == 128)) &&
-			ip_addr_eq(&(subnet->address), &remote)) result = true;
-
-		// Otherwise do a subnet comparison.
-		else if (((subnet->address.family == AF_INET && subnet->mask != 32) ||
-			(subnet->address.family == AF_INET6 && subnet->mask != 128)) &&
-			ip_matches_subnet(subnet, &remote)) result = true;
-	}
 
-	inx_cursor_free(cursor);
-	return result;
+	return subnet_trie_match(subnets, &remote, NULL, NULL);
 }
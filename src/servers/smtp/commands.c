@@ -49,6 +49,12 @@ void smtp_process(connection_t *con) {
 
 	command_t *command, client = { .function = NULL };
 
+	// Release any responses held back for a pipelined group of commands before waiting on the client for more input.
+	if (con->smtp.corked && !con_read_pipelined(con)) {
+		con->smtp.corked = false;
+		net_set_cork(con->network.sockd, false);
+	}
+
 	if (con_read_line(con, true) < 0) {
 		con->command = NULL;
 		enqueue(&smtp_quit, con);
@@ -65,6 +71,11 @@ void smtp_process(connection_t *con) {
 		return;
 	}
 
+	// If the client has pipelined more commands behind this one, hold our responses so the group goes back together (RFC 2920).
+	if (!con->smtp.corked && con_read_pipelined(con)) {
+		con->smtp.corked = net_set_cork(con->network.sockd, true);
+	}
+
 	client.string = pl_char_get(con->network.line);
 	client.length = pl_length_get(con->network.line);
 
@@ -72,10 +83,10 @@ void smtp_process(connection_t *con) {
 		con->command = command;
 		con->protocol.spins = 0;
 
-		// If the DATA and QUIT commands need control over the requeue process. If the DATA command is successful it will enqueue the
-		// inbound or outbound processor instead the command processor, and the QUIT command destroys a connection thereby eliminating the need
-		// to enqueue it.
-		if (command->function == &smtp_data || command->function == &smtp_quit) {
+		// If the DATA, BDAT and QUIT commands need control over the requeue process. If the DATA command, or a BDAT command carrying the
+		// last chunk, is successful it will enqueue the inbound or outbound processor instead the command processor, and the QUIT command
+		// destroys a connection thereby eliminating the need to enqueue it.
+		if (command->function == &smtp_data || command->function == &smtp_bdat || command->function == &smtp_quit) {
 			enqueue(command->function, con);
 		}
 		else {
@@ -33,6 +33,10 @@ command_t smtp_commands[] = {
 		.string = "DATA",
 		.length = 4,
 		.function = &smtp_data
+	}, {
+		.string = "BDAT",
+		.length = 4,
+		.function = &smtp_bdat
 	}, {
 		.string = "RCPT TO",
 		.length = 7,
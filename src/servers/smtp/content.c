@@ -0,0 +1,417 @@
+
+/**
+ * @file /magma/servers/smtp/content.c
+ *
+ * @brief	Run the content checks for an inbound message concurrently on a pool of helper threads.
+ */
+
+#include "magma.h"
+
+// The helper threads, and the checks waiting for one.
+struct {
+	bool_t running;
+	pthread_t *threads;
+	pthread_mutex_t lock;
+	pthread_cond_t available;
+	uint32_t queued;
+	smtp_content_job_t *jobs, *last;
+} smtp_content = {
+	.running = false,
+	.queued = 0,
+	.threads = NULL,
+	.jobs = NULL,
+	.last = NULL,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.available = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * @brief	Drop a reference to a set of content checks, and free it if that was the last reference.
+ * @note	The caller must hold the content lock, which is released by this function.
+ * @param	content		a pointer to the content checks.
+ * @return	This function returns no value.
+ */
+void smtp_content_release(smtp_content_t *content) {
+
+	bool_t last = (--(content->references) == 0);
+
+	mutex_unlock(&(content->lock));
+
+	if (last) {
+		mutex_destroy(&(content->lock));
+		pthread_cond_destroy(&(content->complete));
+		st_cleanup(content->id);
+		st_cleanup(content->text);
+		mm_free(content);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Run a single content check, and record its latency.
+ * @param	job		a pointer to the content check job, which is freed by this function.
+ * @return	This function returns no value.
+ */
+void smtp_content_run(smtp_content_job_t *job) {
+
+	int_t result;
+	uint64_t start = time_monotonic_ms();
+	smtp_content_t *content = job->content;
+
+	if (job->check == SMTP_CONTENT_VIRUS) {
+		result = smtp_verdict_virus(content->text);
+		stats_increment_by_name("smtp.content.virus.checked");
+		stats_adjust_by_name("smtp.content.virus.milliseconds", time_monotonic_ms() - start);
+		if (result == -2 || result == -3) stats_increment_by_name("smtp.content.virus.rejected");
+	}
+	else {
+		result = smtp_verdict_dkim(content->id, content->text);
+		stats_increment_by_name("smtp.content.dkim.checked");
+		stats_adjust_by_name("smtp.content.dkim.milliseconds", time_monotonic_ms() - start);
+		if (result == -2) stats_increment_by_name("smtp.content.dkim.rejected");
+	}
+
+	mutex_lock(&(content->lock));
+	content->checks[job->check].result = result;
+	content->checks[job->check].done = true;
+	pthread_cond_broadcast(&(content->complete));
+	smtp_content_release(content);
+
+	mm_free(job);
+	return;
+}
+
+/**
+ * @brief	Run content checks as they are queued.
+ * @note	This is the entry point for the helper threads created by smtp_content_start().
+ * @return	This function returns no value.
+ */
+void smtp_content_worker(void) {
+
+	smtp_content_job_t *job;
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	mutex_lock(&(smtp_content.lock));
+
+	while (smtp_content.running) {
+
+		if (!(job = smtp_content.jobs)) {
+			pthread_cond_wait(&(smtp_content.available), &(smtp_content.lock));
+		}
+		else {
+			if (!(smtp_content.jobs = job->next)) {
+				smtp_content.last = NULL;
+			}
+
+			smtp_content.queued--;
+			mutex_unlock(&(smtp_content.lock));
+			smtp_content_run(job);
+			mutex_lock(&(smtp_content.lock));
+		}
+	}
+
+	mutex_unlock(&(smtp_content.lock));
+
+	thread_stop();
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Remove the checks for a message which are still waiting for a helper thread.
+ * @note	This is used once the session stops waiting for the verdicts, so the helpers don't spend time on checks nobody will read.
+ * 			The caller must not hold the content lock, and remains responsible for dropping the references held by the removed jobs.
+ * @param	content		a pointer to the content checks.
+ * @return	the number of jobs which were removed from the queue.
+ */
+uint32_t smtp_content_cancel(smtp_content_t *content) {
+
+	uint32_t removed = 0;
+	smtp_content_job_t **holder, *job;
+
+	mutex_lock(&(smtp_content.lock));
+
+	for (holder = &(smtp_content.jobs), smtp_content.last = NULL; (job = *holder);) {
+
+		if (job->content == content) {
+			*holder = job->next;
+			smtp_content.queued--;
+			mm_free(job);
+			removed++;
+		}
+		else {
+			smtp_content.last = job;
+			holder = &(job->next);
+		}
+	}
+
+	mutex_unlock(&(smtp_content.lock));
+
+	if (removed) {
+		stats_adjust_by_name("smtp.content.cancelled", removed);
+	}
+
+	return removed;
+}
+
+/**
+ * @brief	Determine whether a verdict makes the other content checks irrelevant for every recipient.
+ * @note	Once the virus scan finds a virus or phishing attempt, recipients who filter that verdict either bounce, delete or mark
+ * 			the message, and a marked message is never checked for a DKIM signature.
+ * @param	con		a pointer to the connection object of the SMTP session.
+ * @param	virus	the result of the virus scan.
+ * @return	true if none of the recipients need the result of the DKIM verification.
+ */
+bool_t smtp_content_decisive(connection_t *con, int_t virus) {
+
+	smtp_inbound_prefs_t *prefs = con->smtp.in_prefs;
+
+	if (virus != -2 && virus != -3) {
+		return false;
+	}
+
+	for (; prefs; prefs = (smtp_inbound_prefs_t *)prefs->next) {
+		if ((virus == -2 && prefs->virus != 1) || (virus == -3 && prefs->phish != 1)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Run the content checks needed by an inbound message concurrently, and store the verdicts in the session.
+ * @note	Each check has its own time budget, which starts when the check is queued, and its helper thread finishes in the background
+ * 			if the budget is exceeded. A DKIM verification which runs out of time is treated as a failure, but a virus scan is left
+ * 			for smtp_accept_message() to run synchronously, so a slow scanner can't let a message through unscanned. A check which becomes irrelevant because another check has
+ * 			already reached a decisive verdict is abandoned, and is left for smtp_accept_message() to run if any recipient still needs it.
+ * 			If the helper threads are disabled, this function does nothing and the checks are run one after another as each
+ * 			recipient is accepted.
+ * @param	con		a pointer to the connection object of the SMTP session.
+ * @return	This function returns no value.
+ */
+void smtp_content_check(connection_t *con) {
+
+	int_t *verdicts[SMTP_CONTENT_CHECKS];
+	smtp_content_job_t *job;
+	smtp_content_t *content;
+	uint32_t cancelled;
+	struct timespec wakeup;
+	smtp_inbound_prefs_t *prefs;
+	bool_t needed[SMTP_CONTENT_CHECKS] = { false, false }, pending = true;
+	uint64_t now, deadlines[SMTP_CONTENT_CHECKS], budgets[SMTP_CONTENT_CHECKS] = { magma.smtp.content.virus_timeout, magma.smtp.content.dkim_timeout };
+	chr_t *timeouts[SMTP_CONTENT_CHECKS] = { "smtp.content.virus.timeouts", "smtp.content.dkim.timeouts" };
+
+	if (!smtp_content.running || !con->smtp.message || st_empty(con->smtp.message->text)) {
+		return;
+	}
+
+	verdicts[SMTP_CONTENT_VIRUS] = &(con->smtp.checked.virus);
+	verdicts[SMTP_CONTENT_DKIM] = &(con->smtp.checked.dkim);
+
+	// Figure out which checks the recipients need, using the same conditions as smtp_accept_message().
+	for (prefs = con->smtp.in_prefs; prefs; prefs = (smtp_inbound_prefs_t *)prefs->next) {
+		needed[SMTP_CONTENT_VIRUS] |= ((prefs->virus == 1 || prefs->phish == 1) && con->smtp.checked.virus == 0);
+		needed[SMTP_CONTENT_DKIM] |= (!con->smtp.bypass && prefs->dkim == 1 && con->smtp.checked.dkim == 0 && !st_empty(con->smtp.message->id));
+	}
+
+	// Running a single check on a helper would only add a context switch.
+	if (!needed[SMTP_CONTENT_VIRUS] || !needed[SMTP_CONTENT_DKIM]) {
+		return;
+	}
+	else if (!(content = mm_alloc(sizeof(smtp_content_t))) || !(content->text = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, con->smtp.message->text)) ||
+		!(content->id = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, con->smtp.message->id)) || mutex_init(&(content->lock), NULL)) {
+		log_pedantic("Unable to allocate the content checks.");
+		if (content) {
+			st_cleanup(content->text);
+			st_cleanup(content->id);
+			mm_free(content);
+		}
+		return;
+	}
+	else if (pthread_cond_init(&(content->complete), NULL)) {
+		log_pedantic("Unable to allocate the content checks.");
+		mutex_destroy(&(content->lock));
+		st_free(content->text);
+		st_free(content->id);
+		mm_free(content);
+		return;
+	}
+
+	content->references = 1;
+	now = time_monotonic_ms();
+
+	for (int_t i = 0; i < SMTP_CONTENT_CHECKS; i++) {
+
+		if (!(job = mm_alloc(sizeof(smtp_content_job_t)))) {
+			log_pedantic("Unable to allocate a content check.");
+			needed[i] = false;
+			continue;
+		}
+
+		job->check = i;
+		job->content = content;
+		deadlines[i] = now + (budgets[i] ? budgets[i] : 1000);
+
+		// The reference has to be taken before the job is visible to the helpers.
+		mutex_lock(&(content->lock));
+		content->references++;
+		mutex_unlock(&(content->lock));
+
+		mutex_lock(&(smtp_content.lock));
+
+		// When the helpers are this far behind, the check is left for smtp_accept_message() to run on the session thread.
+		if (smtp_content.queued >= (magma.smtp.content.queue ? magma.smtp.content.queue : MAGMA_CONTENT_QUEUE)) {
+			mutex_unlock(&(smtp_content.lock));
+			log_pedantic("The content check queue is full. { queued = %u }", smtp_content.queued);
+			stats_increment_by_name("smtp.content.overflow");
+			mutex_lock(&(content->lock));
+			content->references--;
+			mutex_unlock(&(content->lock));
+			needed[i] = false;
+			mm_free(job);
+			continue;
+		}
+
+		smtp_content.queued++;
+
+		if (smtp_content.last) {
+			smtp_content.last->next = job;
+		}
+		else {
+			smtp_content.jobs = job;
+		}
+		smtp_content.last = job;
+		pthread_cond_signal(&(smtp_content.available));
+		mutex_unlock(&(smtp_content.lock));
+	}
+
+	mutex_lock(&(content->lock));
+
+	while (pending) {
+
+		pending = false;
+		now = time_monotonic_ms();
+
+		// Stop waiting once the virus scan makes the DKIM verification irrelevant.
+		if (content->checks[SMTP_CONTENT_VIRUS].done && smtp_content_decisive(con, content->checks[SMTP_CONTENT_VIRUS].result)) {
+			if (needed[SMTP_CONTENT_DKIM] && !content->checks[SMTP_CONTENT_DKIM].done) {
+				stats_increment_by_name("smtp.content.skipped");
+				needed[SMTP_CONTENT_DKIM] = false;
+			}
+		}
+
+		for (int_t i = 0; i < SMTP_CONTENT_CHECKS; i++) {
+
+			if (!needed[i]) {
+				continue;
+			}
+			else if (content->checks[i].done) {
+				*(verdicts[i]) = content->checks[i].result;
+				needed[i] = false;
+			}
+			// The check ran out of time. A DKIM failure is recorded, which also keeps it from being run again for each recipient, but
+			// the virus verdict stays unknown, so the message is scanned synchronously before it's accepted by anyone who wants it scanned.
+			else if (now >= deadlines[i]) {
+				log_pedantic("A content check ran out of time. { check = %s / budget = %lums }", (i == SMTP_CONTENT_VIRUS ? "virus" : "dkim"),
+					(budgets[i] ? budgets[i] : 1000));
+				stats_increment_by_name(timeouts[i]);
+				*(verdicts[i]) = (i == SMTP_CONTENT_VIRUS ? 0 : -1);
+				needed[i] = false;
+			}
+			else if (!pending || deadlines[i] < now + ((wakeup.tv_sec * 1000) + (wakeup.tv_nsec / 1000000))) {
+				wakeup.tv_sec = (deadlines[i] - now) / 1000;
+				wakeup.tv_nsec = ((deadlines[i] - now) % 1000) * 1000000;
+				pending = true;
+			}
+		}
+
+		if (pending) {
+			time_t seconds = wakeup.tv_sec;
+			long nanoseconds = wakeup.tv_nsec;
+
+			// Condition variables wait until an absolute time, so convert the remaining budget.
+			clock_gettime(CLOCK_REALTIME, &wakeup);
+			wakeup.tv_sec += seconds + ((wakeup.tv_nsec + nanoseconds) / 1000000000);
+			wakeup.tv_nsec = (wakeup.tv_nsec + nanoseconds) % 1000000000;
+
+			pthread_cond_timedwait(&(content->complete), &(content->lock), &wakeup);
+		}
+	}
+
+	// Checks which are still queued won't be read by anyone, so they're removed before a helper thread picks them up.
+	mutex_unlock(&(content->lock));
+	cancelled = smtp_content_cancel(content);
+	mutex_lock(&(content->lock));
+	content->references -= cancelled;
+
+	smtp_content_release(content);
+	return;
+}
+
+/**
+ * @brief	Stop the content check helper threads.
+ * @note	Any checks still waiting for a helper thread are discarded, along with their references.
+ * @return	This function returns no value.
+ */
+void smtp_content_stop(void) {
+
+	smtp_content_job_t *job;
+
+	mutex_lock(&(smtp_content.lock));
+	smtp_content.running = false;
+	pthread_cond_broadcast(&(smtp_content.available));
+	mutex_unlock(&(smtp_content.lock));
+
+	for (uint32_t i = 0; smtp_content.threads && i < magma.smtp.content.threads; i++) {
+		if (*(smtp_content.threads + i)) {
+			thread_join(*(smtp_content.threads + i));
+		}
+	}
+
+	mm_cleanup(smtp_content.threads);
+	smtp_content.threads = NULL;
+
+	while ((job = smtp_content.jobs)) {
+		smtp_content.jobs = job->next;
+		mutex_lock(&(job->content->lock));
+		smtp_content_release(job->content);
+		mm_free(job);
+	}
+
+	smtp_content.last = NULL;
+	smtp_content.queued = 0;
+	return;
+}
+
+/**
+ * @brief	Launch the content check helper threads.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_content_start(void) {
+
+	if (!magma.smtp.content.threads) {
+		return true;
+	}
+	else if (!(smtp_content.threads = mm_alloc(sizeof(pthread_t) * magma.smtp.content.threads))) {
+		log_critical("Unable to allocate the content check threads.");
+		return false;
+	}
+
+	smtp_content.running = true;
+
+	for (uint32_t i = 0; i < magma.smtp.content.threads; i++) {
+		if (thread_launch(smtp_content.threads + i, &smtp_content_worker, NULL)) {
+			log_critical("Unable to launch the content check threads. { threads = %u / configured = %u }", i, magma.smtp.content.threads);
+			smtp_content_stop();
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -99,10 +99,10 @@ stringer_t * smtp_fetch_autoreply(uint64_t autoreply, uint64_t usernum) {
 }
 
 /**
- * @brief	Fetch a user's SMTP preferences for inbound mail.
+ * @brief	Load a user's SMTP preferences for inbound mail from the database.
  *
- * @param	cred a pointer to the credential object of a user with
- * @param	address
+ * @param	address		the recipient address.
+ * @param	output		the address of a pointer which will receive the inbound preferences.
  *
  * @return 0 for success or < 0 for failures, and > 0 for account locks.
  *
@@ -116,7 +116,7 @@ stringer_t * smtp_fetch_autoreply(uint64_t autoreply, uint64_t usernum) {
  * @retval  4: the account is locked due to suspicion of abuse violations. @see AUTH_LOCK_ABUSE
  * @retval  5: the account has been locked at the request of the user. @see AUTH_LOCK_USER
  */
-int_t smtp_fetch_inbound(stringer_t *address, smtp_inbound_prefs_t **output) {
+int_t smtp_load_inbound(stringer_t *address, smtp_inbound_prefs_t **output) {
 
 	row_t *row;
 	table_t *result;
@@ -338,14 +338,99 @@ int_t smtp_fetch_inbound(stringer_t *address, smtp_inbound_prefs_t **output) {
 }
 
 /**
- * @brief	Retrieve a list, at a maximum of 20 entries, of the oldest messages owned by a user.
+ * @brief	Fetch the current lock status of a user account.
+ * @param	usernum		the numerical id of the user.
+ * @return	-1 on error or if the user wasn't found, or the value of the user's lock.
+ */
+int_t smtp_fetch_lock(uint64_t usernum) {
+
+	row_t *row;
+	int_t locked;
+	table_t *result;
+	MYSQL_BIND parameters[1];
+
+	mm_wipe(parameters, sizeof(parameters));
+
+	// Usernum
+	parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[0].buffer_length = sizeof(uint64_t);
+	parameters[0].buffer = &usernum;
+	parameters[0].is_unsigned = true;
+
+	if (!(result = stmt_get_result(stmts.select_user_lock, parameters))) {
+		log_pedantic("Could not fetch the user lock. { usernum = %lu }", usernum);
+		return -1;
+	}
+	else if (!(row = res_row_next(result))) {
+		res_table_free(result);
+		return -1;
+	}
+
+	locked = res_field_int8(row, 0);
+	res_table_free(result);
+
+	return locked;
+}
+
+/**
+ * @brief	Fetch a user's SMTP preferences for inbound mail, using the cached copy when possible.
+ * @note	Accounts which are at, or over, their quota are always loaded from the database, since the cached storage usage can't
+ * 			reflect messages removed by other processes. Locks are usually applied outside of magma, without touching the user
+ * 			serial, so the lock status is read again for every cached copy. The return values are the same as smtp_load_inbound().
+ * @see		smtp_load_inbound()
+ * @param	address		the recipient address.
+ * @param	output		the address of a pointer which will receive the inbound preferences.
+ * @return 0 for success or < 0 for failures, and > 0 for account locks.
+ */
+int_t smtp_fetch_inbound(stringer_t *address, smtp_inbound_prefs_t **output) {
+
+	int_t result, locked;
+	smtp_inbound_prefs_t *inbound;
+
+	if (st_empty(address) || !output) {
+		return -3;
+	}
+
+	*output = NULL;
+
+	// If the lock can't be read, the cached copy is discarded and the preferences are loaded from the database instead.
+	if ((inbound = smtp_prefs_get(address)) && (locked = smtp_fetch_lock(inbound->usernum)) != AUTH_LOCK_NONE && locked != AUTH_LOCK_EXPIRED) {
+		smtp_free_inbound(inbound);
+		if (locked > 0) return locked;
+	}
+	else if (inbound) {
+
+		if (!(inbound->rcptto = st_dupe(address)) || !(inbound->address = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, address))) {
+			log_pedantic("Could not duplicate the recipient address. { address = %.*s }", st_length_int(address), st_char_get(address));
+			smtp_free_inbound(inbound);
+			return -3;
+		}
+
+		stats_increment_by_name("smtp.prefs.cached");
+		*output = inbound;
+		return 0;
+	}
+
+	// LOW: The serial is read after the preferences are loaded, so a change which lands in between is only picked up once the
+	// cached copy expires.
+	if ((result = smtp_load_inbound(address, output)) == 0) {
+		stats_increment_by_name("smtp.prefs.loaded");
+		smtp_prefs_set(address, *output, serial_get(OBJECT_USER, (*output)->usernum));
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Retrieve a list, at a maximum of MAGMA_ROLLOUT_BATCH entries, of the oldest messages owned by a user.
  * @param	usernum		the numerical id of the user whose messages are to be queried.
  * @return	NULL on failure, or a pointer to a sql results set containing the user's oldest messages on success.
  */
 table_t * smtp_fetch_rollmessages(uint64_t usernum) {
 
 	table_t *result;
-	MYSQL_BIND parameters[1];
+	MYSQL_BIND parameters[2];
+	uint32_t limit = MAGMA_ROLLOUT_BATCH;
 
 	mm_wipe(parameters, sizeof(parameters));
 
@@ -355,6 +440,12 @@ table_t * smtp_fetch_rollmessages(uint64_t usernum) {
 	parameters[0].buffer = &usernum;
 	parameters[0].is_unsigned = true;
 
+	// Limit
+	parameters[1].buffer_type = MYSQL_TYPE_LONG;
+	parameters[1].buffer_length = sizeof(uint32_t);
+	parameters[1].buffer = &limit;
+	parameters[1].is_unsigned = true;
+
 	if (!(result = stmt_get_result(stmts.select_messages_rollout, parameters))) {
 		log_pedantic("No messages are eligible for rollout.");
 		return NULL;
@@ -363,6 +454,111 @@ table_t * smtp_fetch_rollmessages(uint64_t usernum) {
 	return result;
 }
 
+/**
+ * @brief	Retrieve the current storage usage and storage quota of a user.
+ * @param	usernum		the numerical id of the user.
+ * @param	size		a pointer to a 64-bit integer that will receive the number of bytes used by the user's messages.
+ * @param	quota		a pointer to a 64-bit integer that will receive the user's storage quota.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_fetch_rollout_quota(uint64_t usernum, uint64_t *size, uint64_t *quota) {
+
+	row_t *row;
+	table_t *result;
+	MYSQL_BIND parameters[1];
+
+	mm_wipe(parameters, sizeof(parameters));
+
+	// Usernum
+	parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[0].buffer_length = sizeof(uint64_t);
+	parameters[0].buffer = &usernum;
+	parameters[0].is_unsigned = true;
+
+	if (!(result = stmt_get_result(stmts.select_user_rollout, parameters))) {
+		log_pedantic("Unable to fetch the storage quota for a user. { usernum = %lu }", usernum);
+		return false;
+	}
+	else if (!(row = res_row_next(result))) {
+		log_pedantic("Unable to fetch the storage quota for a user. { usernum = %lu }", usernum);
+		res_table_free(result);
+		return false;
+	}
+
+	*size = res_field_uint64(row, 0);
+	*quota = res_field_uint64(row, 1);
+
+	res_table_free(result);
+	return true;
+}
+
+/**
+ * @brief	Remove a set of messages, and subtract their combined size from the storage used by a user, as part of a transaction.
+ * @note	Messages are removed MAGMA_ROLLOUT_CHUNK at a time. If any of the messages has already been removed the function fails,
+ * 			because the storage usage would otherwise be reduced twice, and the caller should roll back the transaction.
+ * @param	usernum		the numerical id of the user who owns the messages.
+ * @param	messages	an array of the numerical ids of the messages being removed.
+ * @param	count		the number of messages in the array.
+ * @param	size		the combined size of the messages, in bytes.
+ * @param	transaction	the transaction used for the removal.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_delete_rollmessages(uint64_t usernum, uint64_t *messages, uint32_t count, uint64_t size, int64_t transaction) {
+
+	uint32_t chunk;
+	uint64_t numbers[MAGMA_ROLLOUT_CHUNK];
+	MYSQL_BIND parameters[MAGMA_ROLLOUT_CHUNK + 1];
+
+	for (uint32_t offset = 0; offset < count; offset += chunk) {
+
+		chunk = (count - offset) < MAGMA_ROLLOUT_CHUNK ? (count - offset) : MAGMA_ROLLOUT_CHUNK;
+
+		mm_wipe(numbers, sizeof(numbers));
+		mm_wipe(parameters, sizeof(parameters));
+		mm_copy(numbers, messages + offset, sizeof(uint64_t) * chunk);
+
+		// Usernum
+		parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
+		parameters[0].buffer_length = sizeof(uint64_t);
+		parameters[0].buffer = &usernum;
+		parameters[0].is_unsigned = true;
+
+		// Messagenums, with the unused placeholders left as zero.
+		for (uint32_t i = 0; i < MAGMA_ROLLOUT_CHUNK; i++) {
+			parameters[i + 1].buffer_type = MYSQL_TYPE_LONGLONG;
+			parameters[i + 1].buffer_length = sizeof(uint64_t);
+			parameters[i + 1].buffer = &(numbers[i]);
+			parameters[i + 1].is_unsigned = true;
+		}
+
+		if (stmt_exec_affected_conn(stmts.delete_messages_rollout, parameters, transaction) != chunk) {
+			log_pedantic("Unable to remove a set of messages during rollout. { usernum = %lu / messages = %u }", usernum, chunk);
+			return false;
+		}
+	}
+
+	mm_wipe(parameters, sizeof(parameters));
+
+	// Message Size
+	parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[0].buffer_length = sizeof(uint64_t);
+	parameters[0].buffer = &size;
+	parameters[0].is_unsigned = true;
+
+	// Usernum
+	parameters[1].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[1].buffer_length = sizeof(uint64_t);
+	parameters[1].buffer = &usernum;
+	parameters[1].is_unsigned = true;
+
+	if (stmt_exec_affected_conn(stmts.update_user_quota_subtract, parameters, transaction) != 1) {
+		log_pedantic("Unable to update the storage usage after rollout. { usernum = %lu / size = %lu }", usernum, size);
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * @brief	Update the receiving statistics and per-user log tables in the database for a successfully received smtp message.
  * @note	The Receiving table is updated with the subnet address from which the message was received;
@@ -398,6 +594,9 @@ void smtp_update_receive_stats(connection_t *con, smtp_inbound_prefs_t *prefs) {
 	if (!stmt_exec(stmts.insert_receiving, parameters)) {
 		log_pedantic("Unable to insert a record into the receiving table.");
 	}
+	else {
+		smtp_receiving_increment(prefs->usernum, substr);
+	}
 
 	st_free(substr);
 
@@ -697,15 +896,21 @@ int_t smtp_check_receive_quota(connection_t *con, smtp_inbound_prefs_t *prefs) {
 
 	row_t *row;
 	table_t *result;
-	uint64_t number;
 	stringer_t *substr;
 	MYSQL_BIND parameters[2];
+	uint64_t number, total, local;
 
 	if (!(substr = con_addr_subnet(con, NULL))) {
 		log_pedantic("Unable to perform subnet lookup of connection's remote address.");
 		return -1;
 	}
 
+	// Use the cached counts if they were read from the database recently.
+	if (smtp_receiving_get(prefs->usernum, substr, &total, &local)) {
+		st_free(substr);
+		return total >= prefs->daily_recv_limit ? 1 : (local >= prefs->daily_recv_limit_ip ? 2 : 0);
+	}
+
 	mm_wipe(parameters, sizeof(parameters));
 
 	// Subnet
@@ -725,15 +930,22 @@ int_t smtp_check_receive_quota(connection_t *con, smtp_inbound_prefs_t *prefs) {
 		return 0;
 	}
 
-	st_free(substr);
-
 	// Get the first row.
 	if (!(row = res_row_next(result))) {
 		log_pedantic("Could not fetch the first SQL result row.");
 		res_table_free(result);
+		st_free(substr);
 		return -1;
 	}
 
+	// A subnet without any messages returns a NULL sum, which is the same as a count of zero.
+	total = res_field_uint64(row, 0);
+	if (!res_field_block(row, 1) || uint64_conv_bl(res_field_block(row, 1), res_field_length(row, 1), &local)) {
+		smtp_receiving_set(prefs->usernum, substr, total, res_field_block(row, 1) ? local : 0);
+	}
+
+	st_free(substr);
+
 	// If the user has exceeded their limit, return one so we don't accept the message.
 	if (res_field_uint64(row, 0) >= prefs->daily_recv_limit) {
 		res_table_free(result);
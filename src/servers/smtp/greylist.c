@@ -0,0 +1,301 @@
+
+/**
+ * @file /magma/servers/smtp/greylist.c
+ *
+ * @brief	An in memory layer in front of the greylist records stored in memcached.
+ */
+
+#include "magma.h"
+
+// The greylist entries are split into shards, each with its own lock, hash table, least recently used list and Bloom filter.
+struct {
+	pthread_mutex_t lock;
+	smtp_greylist_entry_t **buckets, *newest, *oldest;
+	uint64_t *bloom, buckets_mask, bloom_bits, inserted;
+	uint32_t count, limit;
+} smtp_greylist[MAGMA_GREYLIST_SHARDS];
+
+bool_t smtp_greylist_enabled = false;
+
+/**
+ * @brief	Find the shard responsible for a greylist key hash.
+ * @param	hash	the murmur hash of the greylist key.
+ * @return	the shard number.
+ */
+uint32_t smtp_greylist_shard(uint64_t hash) {
+	return (hash >> 56) % MAGMA_GREYLIST_SHARDS;
+}
+
+/**
+ * @brief	Check whether a greylist key hash may have been added to the Bloom filter of its shard.
+ * @note	The caller must hold the shard lock.
+ * @param	shard	the shard number.
+ * @param	hash	the murmur hash of the greylist key.
+ * @return	false if the hash was definitely never added, or true if it may have been.
+ */
+bool_t smtp_greylist_bloom_check(uint32_t shard, uint64_t hash) {
+
+	uint64_t bit, step = (hash >> 32) | 1;
+
+	for (uint64_t i = 0; i < 4; i++) {
+		bit = (hash + (i * step)) % smtp_greylist[shard].bloom_bits;
+		if (!(smtp_greylist[shard].bloom[bit / 64] & (1UL << (bit % 64)))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Add a greylist key hash to the Bloom filter of its shard, clearing the filter first if it has become saturated.
+ * @note	The caller must hold the shard lock.
+ * @param	shard	the shard number.
+ * @param	hash	the murmur hash of the greylist key.
+ * @return	This function returns no value.
+ */
+void smtp_greylist_bloom_add(uint32_t shard, uint64_t hash) {
+
+	uint64_t bit, step = (hash >> 32) | 1;
+
+	// With four probes, ten bits per entry keeps the false positive rate near one percent.
+	if (++(smtp_greylist[shard].inserted) > smtp_greylist[shard].bloom_bits / 10) {
+		mm_wipe(smtp_greylist[shard].bloom, smtp_greylist[shard].bloom_bits / 8);
+		smtp_greylist[shard].inserted = 1;
+	}
+
+	for (uint64_t i = 0; i < 4; i++) {
+		bit = (hash + (i * step)) % smtp_greylist[shard].bloom_bits;
+		smtp_greylist[shard].bloom[bit / 64] |= (1UL << (bit % 64));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Move a greylist entry to the front of the least recently used list of its shard.
+ * @note	The caller must hold the shard lock, and the entry must not currently be on the list.
+ * @param	shard	the shard number.
+ * @param	entry	a pointer to the greylist entry.
+ * @return	This function returns no value.
+ */
+void smtp_greylist_push(uint32_t shard, smtp_greylist_entry_t *entry) {
+
+	entry->newer = NULL;
+	entry->older = smtp_greylist[shard].newest;
+
+	if (smtp_greylist[shard].newest) {
+		smtp_greylist[shard].newest->newer = entry;
+	}
+	else {
+		smtp_greylist[shard].oldest = entry;
+	}
+
+	smtp_greylist[shard].newest = entry;
+	return;
+}
+
+/**
+ * @brief	Remove a greylist entry from the least recently used list of its shard.
+ * @note	The caller must hold the shard lock.
+ * @param	shard	the shard number.
+ * @param	entry	a pointer to the greylist entry.
+ * @return	This function returns no value.
+ */
+void smtp_greylist_unlink(uint32_t shard, smtp_greylist_entry_t *entry) {
+
+	if (entry->newer) entry->newer->older = entry->older;
+	else smtp_greylist[shard].newest = entry->older;
+
+	if (entry->older) entry->older->newer = entry->newer;
+	else smtp_greylist[shard].oldest = entry->newer;
+
+	entry->newer = entry->older = NULL;
+	return;
+}
+
+/**
+ * @brief	Look up a greylist entry in memory.
+ * @note	An entry for a sender who is still waiting is only trusted for a short time, so a record written by another
+ * 			server in the cluster is eventually seen.
+ * @param	hash	the murmur hash of the greylist key.
+ * @param	now		the current time.
+ * @param	stamp	a pointer to a 64-bit integer that will receive the time the sender was first seen.
+ * @param	updated	a pointer to a 64-bit integer that will receive the time the memcached record was last refreshed.
+ * @param	greytime	the number of minutes the sender must wait.
+ * @return	1 if the entry was found, 0 if it wasn't, or -1 if this process has never recorded the entry.
+ */
+int_t smtp_greylist_lookup(uint64_t hash, uint64_t now, uint64_t *stamp, uint64_t *updated, uint64_t greytime) {
+
+	int_t result = 0;
+	smtp_greylist_entry_t *entry;
+	uint32_t shard = smtp_greylist_shard(hash);
+
+	if (!smtp_greylist_enabled) {
+		return 0;
+	}
+
+	mutex_lock(&(smtp_greylist[shard].lock));
+
+	entry = smtp_greylist[shard].buckets[hash & smtp_greylist[shard].buckets_mask];
+
+	while (entry && entry->hash != hash) {
+		entry = entry->chain;
+	}
+
+	if (entry && (((now - entry->stamp) / 60) > greytime || (now - entry->synced) < MAGMA_GREYLIST_RESYNC)) {
+		*stamp = entry->stamp;
+		*updated = entry->updated;
+		smtp_greylist_unlink(shard, entry);
+		smtp_greylist_push(shard, entry);
+		result = 1;
+	}
+	else if (!entry && !smtp_greylist_bloom_check(shard, hash)) {
+		result = -1;
+	}
+
+	mutex_unlock(&(smtp_greylist[shard].lock));
+
+	return result;
+}
+
+/**
+ * @brief	Store a greylist entry in memory, after it has been read from, or written to, memcached.
+ * @param	hash	the murmur hash of the greylist key.
+ * @param	now		the current time.
+ * @param	stamp	the time the sender was first seen.
+ * @param	updated	the time the memcached record was last refreshed.
+ * @return	This function returns no value.
+ */
+void smtp_greylist_store(uint64_t hash, uint64_t now, uint64_t stamp, uint64_t updated) {
+
+	smtp_greylist_entry_t *entry, **holder;
+	uint32_t shard = smtp_greylist_shard(hash);
+
+	if (!smtp_greylist_enabled) {
+		return;
+	}
+
+	mutex_lock(&(smtp_greylist[shard].lock));
+
+	entry = smtp_greylist[shard].buckets[hash & smtp_greylist[shard].buckets_mask];
+
+	while (entry && entry->hash != hash) {
+		entry = entry->chain;
+	}
+
+	if (entry) {
+		smtp_greylist_unlink(shard, entry);
+	}
+
+	// Once the shard is full, the least recently used entry is recycled.
+	else if (smtp_greylist[shard].count >= smtp_greylist[shard].limit && (entry = smtp_greylist[shard].oldest)) {
+
+		smtp_greylist_unlink(shard, entry);
+
+		holder = &(smtp_greylist[shard].buckets[entry->hash & smtp_greylist[shard].buckets_mask]);
+		while (*holder != entry) {
+			holder = &((*holder)->chain);
+		}
+		*holder = entry->chain;
+
+		entry->hash = hash;
+		entry->chain = smtp_greylist[shard].buckets[hash & smtp_greylist[shard].buckets_mask];
+		smtp_greylist[shard].buckets[hash & smtp_greylist[shard].buckets_mask] = entry;
+		stats_increment_by_name("smtp.greylist.evicted");
+	}
+	else if ((entry = mm_alloc(sizeof(smtp_greylist_entry_t)))) {
+		entry->hash = hash;
+		entry->chain = smtp_greylist[shard].buckets[hash & smtp_greylist[shard].buckets_mask];
+		smtp_greylist[shard].buckets[hash & smtp_greylist[shard].buckets_mask] = entry;
+		smtp_greylist[shard].count++;
+	}
+
+	if (entry) {
+		entry->stamp = stamp;
+		entry->updated = updated;
+		entry->synced = now;
+		smtp_greylist_push(shard, entry);
+		smtp_greylist_bloom_add(shard, hash);
+	}
+
+	mutex_unlock(&(smtp_greylist[shard].lock));
+
+	return;
+}
+
+/**
+ * @brief	Free the in memory greylist at shutdown.
+ * @return	This function returns no value.
+ */
+void smtp_greylist_stop(void) {
+
+	smtp_greylist_entry_t *entry;
+
+	smtp_greylist_enabled = false;
+
+	for (uint32_t i = 0; i < MAGMA_GREYLIST_SHARDS; i++) {
+
+		mutex_lock(&(smtp_greylist[i].lock));
+
+		while ((entry = smtp_greylist[i].newest)) {
+			smtp_greylist[i].newest = entry->older;
+			mm_free(entry);
+		}
+
+		mm_cleanup(smtp_greylist[i].buckets, smtp_greylist[i].bloom);
+		smtp_greylist[i].buckets = NULL;
+		smtp_greylist[i].bloom = NULL;
+		smtp_greylist[i].oldest = NULL;
+		smtp_greylist[i].count = 0;
+
+		mutex_unlock(&(smtp_greylist[i].lock));
+		mutex_destroy(&(smtp_greylist[i].lock));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Allocate the in memory greylist.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_greylist_start(void) {
+
+	uint64_t buckets = 1;
+
+	mm_wipe(smtp_greylist, sizeof(smtp_greylist));
+
+	for (uint32_t i = 0; i < MAGMA_GREYLIST_SHARDS; i++) {
+		if (mutex_init(&(smtp_greylist[i].lock), NULL)) {
+			log_critical("Unable to initialize the greylist locks.");
+			return false;
+		}
+	}
+
+	if (!magma.smtp.greylist.cache) {
+		return true;
+	}
+
+	// The hash tables are sized to the next power of two, so the bucket can be selected with a mask.
+	while (buckets < (magma.smtp.greylist.cache / MAGMA_GREYLIST_SHARDS) + 1) {
+		buckets <<= 1;
+	}
+
+	for (uint32_t i = 0; i < MAGMA_GREYLIST_SHARDS; i++) {
+
+		smtp_greylist[i].buckets_mask = buckets - 1;
+		smtp_greylist[i].limit = (magma.smtp.greylist.cache / MAGMA_GREYLIST_SHARDS) + 1;
+		smtp_greylist[i].bloom_bits = (((magma.smtp.greylist.bloom / MAGMA_GREYLIST_SHARDS) / sizeof(uint64_t)) + 1) * 64;
+
+		if (!(smtp_greylist[i].buckets = mm_alloc(sizeof(smtp_greylist_entry_t *) * buckets)) ||
+			!(smtp_greylist[i].bloom = mm_alloc(smtp_greylist[i].bloom_bits / 8))) {
+			log_critical("Unable to allocate the in memory greylist.");
+			smtp_greylist_stop();
+			return false;
+		}
+	}
+
+	smtp_greylist_enabled = true;
+	return true;
+}
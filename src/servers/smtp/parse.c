@@ -374,3 +374,39 @@ stringer_t * smtp_parse_helo_domain(connection_t *con) {
 	return result;
 }
 
+
+/**
+ * @brief	Parse the chunk size, and the optional LAST keyword, from a BDAT command line.
+ * @param	con		a pointer to the connection object holding the BDAT command in its line buffer.
+ * @param	length	a pointer to receive the size of the chunk, in bytes.
+ * @param	last	a pointer to a boolean set to true if this is the final chunk of the message.
+ * @return	true if the command line was valid, or false if it was not.
+ */
+bool_t smtp_parse_bdat(connection_t *con, uint64_t *length, bool_t *last) {
+
+	uint64_t count;
+	placer_t line, token = pl_null();
+
+	if (!con || !length || !last || pl_empty(con->network.line)) {
+		log_pedantic("Invalid data was passed in for parsing.");
+		return false;
+	}
+
+	*length = 0;
+	*last = false;
+	line = pl_trim(con->network.line);
+
+	// The command should be followed by a chunk size, and then optionally the LAST keyword.
+	if ((count = tok_get_count_st(&line, ' ')) < 2 || count > 3 || tok_get_pl(line, ' ', 1, &token) < 0 || !uint64_conv_pl(token, length)) {
+		log_pedantic("The BDAT line is invalid. {%s = %.*s}", con->command->string, pl_length_int(line), pl_char_get(line));
+		return false;
+	}
+	else if (count == 3 && (tok_get_pl(line, ' ', 2, &token) < 0 || st_cmp_ci_eq(&token, PLACER("LAST", 4)))) {
+		log_pedantic("The BDAT line is invalid. {%s = %.*s}", con->command->string, pl_length_int(line), pl_char_get(line));
+		return false;
+	}
+
+	*last = (count == 3);
+
+	return true;
+}
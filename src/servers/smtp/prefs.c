@@ -0,0 +1,404 @@
+
+/**
+ * @file /magma/servers/smtp/prefs.c
+ *
+ * @brief	An in memory cache of the inbound delivery preferences, and daily receive counts, for recently seen recipients.
+ *
+ * Preferences are cached by recipient address, along with the user serial number that was current when they were loaded. A
+ * cached copy is only used while that serial is unchanged; magma increments the OBJECT_USER serial when it stores a user's keys
+ * or resets a lock. Settings changed outside of magma take effect once the cached copy expires, after magma.smtp.prefs_cache
+ * seconds, except for the account lock, which smtp_fetch_inbound() reads again for every cached copy. Storage usage is tracked
+ * incrementally as messages are stored. A copy which shows the account at, or over, its quota is never trusted, since messages
+ * may have been removed elsewhere, and the caller goes back to the database instead. The receive counts are read from the
+ * database at most once a minute per user and subnet, and incremented locally in between, so messages accepted by other
+ * servers in the cluster are eventually counted.
+ */
+
+#include "magma.h"
+
+inx_t *smtp_prefs_cache = NULL, *smtp_receiving_cache = NULL;
+
+/**
+ * @brief	Free a cached inbound preferences entry.
+ * @param	entry	a pointer to the cache entry.
+ * @return	This function returns no value.
+ */
+void smtp_prefs_entry_free(smtp_prefs_entry_t *entry) {
+
+	if (entry) {
+		smtp_free_inbound(entry->prefs);
+		st_cleanup(entry->signet);
+		mm_free(entry);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Duplicate the user specific portion of an inbound preferences object.
+ * @note	The fields which describe a single delivery attempt, like the recipient address or the spam signature, are cleared.
+ * @param	prefs	a pointer to the inbound preferences being copied.
+ * @param	signet	a binary copy of the user's signet, or NULL if the account doesn't have one.
+ * @return	NULL on failure, or a pointer to the new inbound preferences object.
+ */
+smtp_inbound_prefs_t * smtp_prefs_copy(smtp_inbound_prefs_t *prefs, stringer_t *signet) {
+
+	inx_cursor_t *cursor;
+	smtp_inbound_prefs_t *copy;
+	smtp_inbound_filter_t *filter, *duplicate;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	if (!(copy = mm_alloc(sizeof(smtp_inbound_prefs_t)))) {
+		log_pedantic("Could not allocate %zu bytes for the inbound preferences.", sizeof(smtp_inbound_prefs_t));
+		return NULL;
+	}
+
+	mm_copy(copy, prefs, sizeof(smtp_inbound_prefs_t));
+
+	copy->next = NULL;
+	copy->filters = NULL;
+	copy->signet = NULL;
+	copy->rcptto = copy->address = copy->spamsig = copy->domain = copy->forwarded = NULL;
+	copy->outcome = copy->mark = copy->spam_checked = 0;
+	copy->signum = copy->spamkey = copy->messagenum = copy->foldernum = copy->local_size = 0;
+
+	if ((prefs->domain && !(copy->domain = st_dupe(prefs->domain))) || (prefs->forwarded && !(copy->forwarded = st_dupe(prefs->forwarded))) ||
+		(signet && !(copy->signet = prime_set(signet, BINARY, NONE)))) {
+		smtp_free_inbound(copy);
+		return NULL;
+	}
+
+	if (!prefs->filters) {
+		return copy;
+	}
+	else if (!(copy->filters = inx_alloc(M_INX_LINKED, &smtp_list_free_filter)) || !(cursor = inx_cursor_alloc(prefs->filters))) {
+		smtp_free_inbound(copy);
+		return NULL;
+	}
+
+	while ((filter = inx_cursor_value_next(cursor))) {
+
+		if (!(duplicate = mm_alloc(sizeof(smtp_inbound_filter_t)))) {
+			inx_cursor_free(cursor);
+			smtp_free_inbound(copy);
+			return NULL;
+		}
+
+		mm_copy(duplicate, filter, sizeof(smtp_inbound_filter_t));
+		duplicate->field = duplicate->label = duplicate->expression = NULL;
+		key.val.u64 = filter->rulenum;
+
+		if ((filter->field && !(duplicate->field = st_dupe(filter->field))) || (filter->label && !(duplicate->label = st_dupe(filter->label))) ||
+			(filter->expression && !(duplicate->expression = st_dupe(filter->expression))) || !inx_insert(copy->filters, key, duplicate)) {
+			smtp_list_free_filter(duplicate);
+			inx_cursor_free(cursor);
+			smtp_free_inbound(copy);
+			return NULL;
+		}
+	}
+
+	inx_cursor_free(cursor);
+
+	return copy;
+}
+
+/**
+ * @brief	Retrieve a copy of the cached inbound preferences for a recipient address.
+ * @param	address		the recipient address.
+ * @return	NULL if the preferences aren't cached, are out of date, or can't be trusted, or a new inbound preferences object
+ * 			which the caller is responsible for freeing.
+ */
+smtp_inbound_prefs_t * smtp_prefs_get(stringer_t *address) {
+
+	uint64_t serial = 0;
+	smtp_prefs_entry_t *entry;
+	smtp_inbound_prefs_t *result = NULL;
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = address };
+
+	if (!smtp_prefs_cache) {
+		return NULL;
+	}
+
+	inx_lock_read(smtp_prefs_cache);
+
+	if ((entry = inx_find(smtp_prefs_cache, name)) && entry->expiration > time(NULL) && entry->prefs->stor_size < entry->prefs->quota &&
+		!entry->prefs->overquota && (result = smtp_prefs_copy(entry->prefs, entry->signet))) {
+		serial = entry->serial;
+	}
+
+	inx_unlock(smtp_prefs_cache);
+
+	// The serial is checked after the lock has been released, since it requires a trip to memcached.
+	if (result && serial_get(OBJECT_USER, result->usernum) != serial) {
+		smtp_free_inbound(result);
+		result = NULL;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Store a copy of the inbound preferences for a recipient address in the cache.
+ * @param	address		the recipient address.
+ * @param	prefs		a pointer to the inbound preferences that were just loaded from the database.
+ * @param	serial		the user serial number that was current when the preferences were loaded.
+ * @return	This function returns no value.
+ */
+void smtp_prefs_set(stringer_t *address, smtp_inbound_prefs_t *prefs, uint64_t serial) {
+
+	stringer_t *signet = NULL;
+	smtp_prefs_entry_t *entry;
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = address };
+
+	if (!smtp_prefs_cache || (prefs->signet && !(signet = prime_get(prefs->signet, BINARY, NULL)))) {
+		return;
+	}
+	else if (!(entry = mm_alloc(sizeof(smtp_prefs_entry_t)))) {
+		st_cleanup(signet);
+		return;
+	}
+
+	entry->signet = signet;
+	entry->serial = serial;
+	entry->expiration = time(NULL) + magma.smtp.prefs.cache;
+
+	if (!(entry->prefs = smtp_prefs_copy(prefs, NULL))) {
+		smtp_prefs_entry_free(entry);
+		return;
+	}
+
+	inx_lock_write(smtp_prefs_cache);
+
+	if ((inx_count(smtp_prefs_cache) >= magma.smtp.prefs.cache_limit && !inx_find(smtp_prefs_cache, name)) ||
+		!inx_replace(smtp_prefs_cache, name, entry)) {
+		smtp_prefs_entry_free(entry);
+	}
+
+	inx_unlock(smtp_prefs_cache);
+
+	return;
+}
+
+/**
+ * @brief	Add a stored message to the storage usage recorded by the cached preferences for its recipient.
+ * @param	prefs	a pointer to the inbound preferences used to deliver the message.
+ * @param	size	the number of bytes added to the user's storage usage.
+ * @return	This function returns no value.
+ */
+void smtp_prefs_account(smtp_inbound_prefs_t *prefs, uint64_t size) {
+
+	smtp_prefs_entry_t *entry;
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = prefs->address };
+
+	if (!smtp_prefs_cache || st_empty(prefs->address)) {
+		return;
+	}
+
+	inx_lock_write(smtp_prefs_cache);
+
+	if ((entry = inx_find(smtp_prefs_cache, name)) && entry->prefs->usernum == prefs->usernum) {
+		entry->prefs->stor_size += size;
+		entry->prefs->overquota = (entry->prefs->stor_size < entry->prefs->quota) ? 0 : 1;
+	}
+
+	inx_unlock(smtp_prefs_cache);
+
+	return;
+}
+
+/**
+ * @brief	Retrieve the cached number of messages a user received during the last day, and the number sent from a subnet.
+ * @param	usernum		the numerical id of the user.
+ * @param	subnet		the subnet the message is being received from.
+ * @param	total		a pointer to a 64-bit integer that will receive the number of messages received by the user.
+ * @param	local		a pointer to a 64-bit integer that will receive the number of messages received from the subnet.
+ * @return	true if both counts were found in the cache, or false if the database must be checked.
+ */
+bool_t smtp_receiving_get(uint64_t usernum, stringer_t *subnet, uint64_t *total, uint64_t *local) {
+
+	time_t now = time(NULL);
+	bool_t result = false;
+	smtp_receiving_entry_t *entry, *nested;
+	stringer_t *user = MANAGEDBUF(32), *pair = MANAGEDBUF(128);
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = user }, key = { .type = M_TYPE_STRINGER, .val.st = pair };
+
+	if (!smtp_receiving_cache || st_sprint(user, "%lu", usernum) <= 0 ||
+		st_sprint(pair, "%lu/%.*s", usernum, st_length_int(subnet), st_char_get(subnet)) <= 0) {
+		return false;
+	}
+
+	inx_lock_read(smtp_receiving_cache);
+
+	if ((entry = inx_find(smtp_receiving_cache, name)) && entry->expiration > now && (nested = inx_find(smtp_receiving_cache, key)) &&
+		nested->expiration > now) {
+		*total = entry->count;
+		*local = nested->count;
+		result = true;
+	}
+
+	inx_unlock(smtp_receiving_cache);
+
+	return result;
+}
+
+/**
+ * @brief	Store the daily receive counts for a user, and for a subnet, which were just read from the database.
+ * @param	usernum		the numerical id of the user.
+ * @param	subnet		the subnet the message is being received from.
+ * @param	total		the number of messages received by the user.
+ * @param	local		the number of messages received by the user from the subnet.
+ * @return	This function returns no value.
+ */
+void smtp_receiving_set(uint64_t usernum, stringer_t *subnet, uint64_t total, uint64_t local) {
+
+	smtp_receiving_entry_t *entry, *nested;
+	stringer_t *user = MANAGEDBUF(32), *pair = MANAGEDBUF(128);
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = user }, key = { .type = M_TYPE_STRINGER, .val.st = pair };
+
+	if (!smtp_receiving_cache || st_sprint(user, "%lu", usernum) <= 0 ||
+		st_sprint(pair, "%lu/%.*s", usernum, st_length_int(subnet), st_char_get(subnet)) <= 0) {
+		return;
+	}
+	else if (!(entry = mm_alloc(sizeof(smtp_receiving_entry_t))) || !(nested = mm_alloc(sizeof(smtp_receiving_entry_t)))) {
+		mm_cleanup(entry);
+		return;
+	}
+
+	entry->count = total;
+	nested->count = local;
+	entry->expiration = nested->expiration = time(NULL) + MAGMA_SMTP_RECEIVING_RESYNC;
+
+	inx_lock_write(smtp_receiving_cache);
+
+	if (inx_count(smtp_receiving_cache) + 2 > magma.smtp.prefs.cache_limit * 2 || !inx_replace(smtp_receiving_cache, name, entry)) {
+		mm_free(entry);
+	}
+
+	if (inx_count(smtp_receiving_cache) + 1 > magma.smtp.prefs.cache_limit * 2 || !inx_replace(smtp_receiving_cache, key, nested)) {
+		mm_free(nested);
+	}
+
+	inx_unlock(smtp_receiving_cache);
+
+	return;
+}
+
+/**
+ * @brief	Count a received message against the cached daily receive counts for a user, and for a subnet.
+ * @param	usernum		the numerical id of the user.
+ * @param	subnet		the subnet the message was received from.
+ * @return	This function returns no value.
+ */
+void smtp_receiving_increment(uint64_t usernum, stringer_t *subnet) {
+
+	smtp_receiving_entry_t *entry;
+	stringer_t *user = MANAGEDBUF(32), *pair = MANAGEDBUF(128);
+	multi_t name = { .type = M_TYPE_STRINGER, .val.st = user }, key = { .type = M_TYPE_STRINGER, .val.st = pair };
+
+	if (!smtp_receiving_cache || st_sprint(user, "%lu", usernum) <= 0 ||
+		st_sprint(pair, "%lu/%.*s", usernum, st_length_int(subnet), st_char_get(subnet)) <= 0) {
+		return;
+	}
+
+	inx_lock_write(smtp_receiving_cache);
+
+	if ((entry = inx_find(smtp_receiving_cache, name))) {
+		entry->count++;
+	}
+
+	if ((entry = inx_find(smtp_receiving_cache, key))) {
+		entry->count++;
+	}
+
+	inx_unlock(smtp_receiving_cache);
+
+	return;
+}
+
+/**
+ * @brief	Determine whether a cached inbound preferences entry has expired.
+ * @param	entry		a pointer to the cache entry being examined.
+ * @param	now		a pointer to the current time.
+ * @return	true if the entry has expired, or false if it is still valid.
+ */
+bool_t smtp_prefs_expired(smtp_prefs_entry_t *entry, time_t *now) {
+
+	return entry->expiration <= *now;
+}
+
+/**
+ * @brief	Determine whether a cached receive count has expired.
+ * @param	entry		a pointer to the cache entry being examined.
+ * @param	now		a pointer to the current time.
+ * @return	true if the entry has expired, or false if it is still valid.
+ */
+bool_t smtp_receiving_expired(smtp_receiving_entry_t *entry, time_t *now) {
+
+	return entry->expiration <= *now;
+}
+
+/**
+ * @brief	Remove the expired entries from the inbound preferences and receive count caches.
+ * @note	This function is called periodically by the maintenance thread.
+ * @return	This function returns no value.
+ */
+void smtp_prefs_prune(void) {
+
+	time_t now;
+
+	if ((now = time(NULL)) == (time_t)(-1)) {
+		return;
+	}
+
+	if (smtp_prefs_cache) {
+		inx_lock_write(smtp_prefs_cache);
+		inx_prune(smtp_prefs_cache, (bool_t (*)(void *, void *))&smtp_prefs_expired, &now);
+		inx_unlock(smtp_prefs_cache);
+	}
+
+	if (smtp_receiving_cache) {
+		inx_lock_write(smtp_receiving_cache);
+		inx_prune(smtp_receiving_cache, (bool_t (*)(void *, void *))&smtp_receiving_expired, &now);
+		inx_unlock(smtp_receiving_cache);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Free the inbound preferences and receive count caches at shutdown.
+ * @return	This function returns no value.
+ */
+void smtp_prefs_stop(void) {
+
+	if (smtp_prefs_cache) {
+		inx_free(smtp_prefs_cache);
+		smtp_prefs_cache = NULL;
+	}
+
+	if (smtp_receiving_cache) {
+		inx_free(smtp_receiving_cache);
+		smtp_receiving_cache = NULL;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Initialize the inbound preferences and receive count caches.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_prefs_start(void) {
+
+	if (!magma.smtp.prefs.cache) {
+		return true;
+	}
+	else if (!(smtp_prefs_cache = inx_alloc(M_INX_TREE | M_INX_LOCK_MANUAL, &smtp_prefs_entry_free)) ||
+		!(smtp_receiving_cache = inx_alloc(M_INX_TREE | M_INX_LOCK_MANUAL, &mm_free))) {
+		log_critical("Unable to initialize the inbound preferences cache.");
+		smtp_prefs_stop();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,757 @@
+
+/**
+ * @file /magma/servers/smtp/queue.c
+ *
+ * @brief	The persistent outbound delivery queue.
+ * @note	Each queued message is stored as a single file inside the queue directory. The file begins with a fixed width schedule line,
+ * 			which holds the number of failed attempts and the time of the next attempt, so it can be updated in place. The schedule
+ * 			line is followed by the creation time and delivery options, the return path, one line per recipient, an empty line, and
+ * 			then the message itself. Files are written under a hidden name and renamed once they have been flushed to disk, so a
+ * 			visible file is always complete. Messages which can't be delivered are moved to the dead letter directory.
+ */
+
+#include "magma.h"
+
+// The entries waiting for delivery, sorted by when they are due, and the threads delivering them.
+struct {
+	int_t dirfd;
+	bool_t running;
+	pthread_t *workers;
+	pthread_mutex_t lock;
+	pthread_cond_t available;
+	smtp_queued_t *entries;
+} smtp_queue = {
+	.dirfd = -1,
+	.running = false,
+	.workers = NULL,
+	.entries = NULL,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.available = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * @brief	Insert an entry into the queue according to when it is due, and wake a delivery thread.
+ * @param	entry	a pointer to the queue entry.
+ * @return	This function returns no value.
+ */
+void smtp_queue_schedule(smtp_queued_t *entry) {
+
+	smtp_queued_t **holder;
+
+	mutex_lock(&(smtp_queue.lock));
+
+	// LOW: The queue is a sorted list, so a large backlog makes each insertion linear.
+	for (holder = &(smtp_queue.entries); *holder && (*holder)->scheduled <= entry->scheduled; holder = &((*holder)->next));
+
+	entry->next = *holder;
+	*holder = entry;
+
+	pthread_cond_signal(&(smtp_queue.available));
+	mutex_unlock(&(smtp_queue.lock));
+
+	return;
+}
+
+/**
+ * @brief	Move a queued message to the dead letter directory, and release the queue entry.
+ * @param	entry	a pointer to the queue entry.
+ * @param	reason	a description of why the message could not be delivered, which is logged.
+ * @return	This function returns no value.
+ */
+void smtp_queue_dead(smtp_queued_t *entry, chr_t *reason) {
+
+	int_t error;
+	chr_t dead[64];
+
+	// If the message can't be moved, it stays scheduled, so the move is tried again, instead of the file being forgotten until a restart.
+	if (snprintf(dead, 64, "dead/%s", entry->name) <= 0 || renameat(smtp_queue.dirfd, entry->name, smtp_queue.dirfd, dead)) {
+		error = errno;
+		log_error("Unable to move an undeliverable message to the dead letter directory. { name = %s / error = %s }", entry->name,
+			errno_string(error, MEMORYBUF(1024), 1024));
+
+		// A file that's already gone has nothing left to move.
+		if (error == ENOENT) {
+			mm_free(entry);
+		}
+		else {
+			smtp_queue_defer(entry);
+		}
+
+		return;
+	}
+
+	log_info("Moved an undeliverable message to the dead letter directory. { name = %s / attempts = %u / reason = %s }", entry->name,
+		entry->attempts, reason);
+
+	stats_increment_by_name("smtp.queue.dead");
+	mm_free(entry);
+
+	return;
+}
+
+/**
+ * @brief	Load a queued message from disk.
+ * @param	name	the file name of the queued message.
+ * @return	NULL on failure, or a managed string containing the queue file on success.
+ */
+stringer_t * smtp_queue_load(chr_t *name) {
+
+	int_t fd;
+	struct stat info;
+	stringer_t *result = NULL;
+
+	if ((fd = openat(smtp_queue.dirfd, name, O_RDONLY | O_NOATIME)) < 0 || fstat(fd, &info) || !info.st_size ||
+		!(result = st_alloc(info.st_size)) || read(fd, st_data_get(result), info.st_size) != info.st_size) {
+		log_pedantic("Unable to read the queued message. { name = %s / error = %s }", name, errno_string(errno, MEMORYBUF(1024), 1024));
+		st_cleanup(result);
+		result = NULL;
+	}
+	else {
+		st_length_set(result, info.st_size);
+	}
+
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Reschedule a queued message after a failed delivery attempt.
+ * @param	entry	a pointer to the queue entry.
+ * @return	This function returns no value.
+ */
+void smtp_queue_defer(smtp_queued_t *entry) {
+
+	int_t fd;
+	chr_t schedule[32];
+	uint64_t delay;
+
+	// The delay doubles after each failure, up to the maximum, and is spread out so messages deferred together aren't retried together.
+	delay = (uint64_t)(magma.relay.queue.retry ? magma.relay.queue.retry : MAGMA_RELAY_QUEUE_RETRY) << (entry->attempts < 16 ? entry->attempts : 16);
+	delay = (delay > MAGMA_RELAY_QUEUE_BACKOFF ? MAGMA_RELAY_QUEUE_BACKOFF : delay);
+	delay += rand_get_uint32() % (delay / 10 + 1);
+
+	entry->attempts++;
+	entry->scheduled = time(NULL) + delay;
+
+	// Update the schedule line in place, so the retry state survives a restart.
+	if (snprintf(schedule, 32, "%010u %012lu\r\n", entry->attempts, entry->scheduled) != 25 ||
+		(fd = openat(smtp_queue.dirfd, entry->name, O_WRONLY | O_NOATIME)) < 0) {
+		log_pedantic("Unable to update the queued message schedule. { name = %s }", entry->name);
+	}
+	else {
+		if (pwrite(fd, schedule, 25, 0) != 25 || fdatasync(fd)) {
+			log_pedantic("Unable to update the queued message schedule. { name = %s / error = %s }", entry->name,
+				errno_string(errno, MEMORYBUF(1024), 1024));
+		}
+		close(fd);
+	}
+
+	stats_increment_by_name("smtp.queue.deferred");
+	smtp_queue_schedule(entry);
+
+	return;
+}
+
+/**
+ * @brief	Notify the sender of a queued message about the recipients it couldn't be delivered to.
+ * @note	The notification is queued using a null return path, so it can never generate a bounce of its own, and only includes the
+ * 			header of the original message.
+ * @param	mailfrom	the return path of the undeliverable message.
+ * @param	failures	a managed string listing the undeliverable recipients, along with the relay response for each of them.
+ * @param	body		the undeliverable message.
+ * @param	dotstuffed	whether the undeliverable message has been dot stuffed.
+ * @return	This function returns no value.
+ */
+void smtp_queue_bounce(placer_t mailfrom, stringer_t *failures, placer_t body, bool_t dotstuffed) {
+
+	time_t utime;
+	size_t header;
+	struct tm ltime;
+	chr_t date_buffer[1024];
+	static const chr_t *date_format = "Date: %a, %d %b %Y %H:%M:%S %z\r\n";
+	stringer_t *message = NULL, *holder = NULL, *signature = NULL, *id = MANAGEDBUF(16);
+	smtp_recipients_t recipient = { .address = (stringer_t *)&mailfrom, .next = NULL };
+
+	// Only the original header is returned, since the message it belongs to may be large, and is what the relay refused.
+	if (!st_search_cs((stringer_t *)&body, PLACER("\r\n\r\n", 4), &header)) {
+		header = pl_length_get(body);
+	}
+
+	body = pl_init(pl_char_get(body), header);
+
+	// Build the date string. Otherwise null the buffer so it doesn't get appended to the header.
+	if ((utime = time(&utime)) == -1 || !localtime_r(&utime, &ltime) || strftime(date_buffer, 1024, date_format, &ltime) <= 0) {
+		log_pedantic("Unable to retrieve the current time.");
+		date_buffer[0] = '\0';
+	}
+
+	// Generate the ID string. If the random method fails, use a hash of the current time.
+	if ((holder = rand_choices("ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", 12, NULL))) {
+		st_sprint(id, "%.*s", st_length_int(holder), st_char_get(holder));
+		st_free(holder);
+		holder = NULL;
+	}
+	else {
+		st_sprint(id, "%lu", crc64_checksum(&utime, sizeof(time_t)));
+	}
+
+	message = st_merge("nsnnnsnsnsnsn", "From: Magma Mail Daemon <daemon@", magma.system.domain, ">\r\nSubject: Delivery Failure Notification\r\n", date_buffer,
+		"To: <", &mailfrom, ">\r\n\r\nThis is the Magma Mail Daemon faithfully reporting a bounced message. A message sent by you (<", &mailfrom, ">) could not "
+		"be delivered to all of its recipients. The servers responsible for those recipients either refused the message, or couldn't be reached before the "
+		"message expired. Please direct any questions or comments you may have to the support address, thank you.\r\n\r\n\r\n          ------- Summary -------"
+		"\r\n\r\n\r\n", failures, "\r\n\r\n          ------- Original Message Header -------\r\n\r\n\r\n", &body, "\r\n\r\n");
+
+	// The original header has to be dot stuffed again along with the rest of the notification, so any stuffing is removed here.
+	if (message && dotstuffed) {
+		st_replace(&message, PLACER("\r\n..", 4), PLACER("\r\n.", 3));
+	}
+
+	// Add a DKIM signature.
+	if (!message) {
+		log_pedantic("Unable to build the delivery failure notification.");
+		return;
+	}
+	else if ((signature = dkim_signature_create(id, NULL, message)) && (holder = st_merge("ss", signature, message))) {
+		st_free(message);
+		message = holder;
+	}
+
+	if (smtp_queue_message(0, NULL, 0, &recipient, message, false) != 1) {
+		log_error("Unable to queue a delivery failure notification. { mailfrom = %.*s }", pl_length_int(mailfrom), pl_char_get(mailfrom));
+	}
+	else {
+		stats_increment_by_name("smtp.queue.bounced");
+	}
+
+	st_cleanup(signature);
+	st_free(message);
+
+	return;
+}
+
+/**
+ * @brief	Replace the recipients of a queued message.
+ * @note	This is used after a delivery attempt which reached some of the recipients, so the next attempt only goes to the others.
+ * @param	entry		a pointer to the queue entry.
+ * @param	prefix		the schedule line, delivery options, and return path of the queued message.
+ * @param	recipients	a linked list of the recipients which are still waiting for the message.
+ * @param	body		the queued message.
+ * @return	true if the queue file was replaced, or false on failure.
+ */
+bool_t smtp_queue_rewrite(smtp_queued_t *entry, stringer_t *prefix, smtp_recipients_t *recipients, placer_t body) {
+
+	bool_t result;
+	smtp_recipients_t *holder;
+	stringer_t *header, *line = MANAGEDBUF(1024);
+
+	if (!(header = st_dupe_opts(MANAGED_T | JOINTED | HEAP, prefix))) {
+		log_pedantic("Unable to build the queued message header.");
+		return false;
+	}
+
+	for (holder = recipients; header && holder; holder = (smtp_recipients_t *)holder->next) {
+
+		if (st_sprint(line, "<%.*s>\r\n", st_length_int(holder->address), st_char_get(holder->address)) <= 0) {
+			st_free(header);
+			header = NULL;
+		}
+		else {
+			header = st_append(header, line);
+		}
+	}
+
+	if (!header || !(header = st_append(header, PLACER("\r\n", 2)))) {
+		log_pedantic("Unable to build the queued message header.");
+		st_cleanup(header);
+		return false;
+	}
+
+	result = smtp_queue_write(entry->name, header, (stringer_t *)&body);
+	st_free(header);
+
+	return result;
+}
+
+/**
+ * @brief	Attempt to deliver a queued message through the relay connection pool.
+ * @note	The entry is consumed by this function. The sender is notified about any recipient which permanently rejected the message,
+ * 			or which couldn't be reached before the message expired. Once every recipient is finished, the message is removed, unless
+ * 			none of them received it, in which case it's moved to the dead letter directory. Otherwise the message is rescheduled for
+ * 			the remaining recipients.
+ * @param	entry	a pointer to the queue entry.
+ * @return	This function returns no value.
+ */
+void smtp_queue_deliver(smtp_queued_t *entry) {
+
+	chr_t *cursor, *eol;
+	size_t header, line = 0;
+	int_t state = -1;
+	bool_t expired;
+	smtp_pooled_t *pooled;
+	smtp_delivery_t *results = NULL;
+	placer_t body, field, options, *addresses = NULL;
+	smtp_recipients_t *recipients = NULL;
+	uint64_t delivered = 0, rejected = 0, deferred = 0;
+	stringer_t *data = NULL, *response = NULL, *failures = NULL, *holder, *reply, *expiration = PLACER("The message expired before it could be delivered.", 50);
+	uint64_t created = 0, premium = 0, stuffed = 0, size = 0, count, *values[] = { &created, &premium, &stuffed, &size };
+
+	// Load the message, and locate the empty line separating the delivery instructions from the message.
+	if (!(data = smtp_queue_load(entry->name)) || !st_search_cs(data, PLACER("\r\n\r\n", 4), &header) ||
+		(count = tok_get_count_bl(st_data_get(data), header + 2, '\n')) < 5) {
+		smtp_queue_dead(entry, "the queue file could not be read");
+		st_cleanup(data);
+		return;
+	}
+
+	// The token count includes the empty fragment after the final line break. The lines after the schedule, the options and the
+	// return path hold the recipients.
+	count -= 4;
+
+	if (!(addresses = mm_alloc(sizeof(placer_t) * (count + 1))) || !(recipients = mm_alloc(sizeof(smtp_recipients_t) * count))) {
+		log_pedantic("Unable to allocate the recipient list for a queued message.");
+		mm_cleanup(addresses);
+		smtp_queue_defer(entry);
+		st_free(data);
+		return;
+	}
+
+	cursor = st_char_get(data);
+
+	while (line < count + 3 && (eol = memchr(cursor, '\n', st_char_get(data) + header + 2 - cursor)) && eol != cursor && *(eol - 1) == '\r') {
+
+		options = pl_init(cursor, eol - cursor - 1);
+
+		// The creation time, whether to use a premium relay, whether the message is already dot stuffed, and the SIZE parameter.
+		for (int_t i = 0; line == 1 && i < 4; i++) {
+			if (tok_get_pl(options, ' ', i, &field) < 0 || !uint64_conv_bl(pl_data_get(field), pl_length_get(field), values[i])) {
+				created = 0;
+			}
+		}
+
+		// The return path, followed by the recipients, with their angle brackets removed.
+		if (line >= 2 && pl_length_get(options) < 2) {
+			break;
+		}
+		else if (line >= 2) {
+			*(addresses + line - 2) = pl_init(pl_char_get(options) + 1, pl_length_get(options) - 2);
+		}
+
+		cursor = eol + 1;
+		line++;
+	}
+
+	if (line != count + 3 || !created) {
+		smtp_queue_dead(entry, "the delivery instructions are malformed");
+		mm_free(recipients);
+		mm_free(addresses);
+		st_free(data);
+		return;
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		(recipients + i)->address = (stringer_t *)(addresses + i + 1);
+		(recipients + i)->next = (struct smtp_recipients_t *)(i + 1 < count ? recipients + i + 1 : NULL);
+	}
+
+	body = pl_init(st_char_get(data) + header + 4, st_length_get(data) - header - 4);
+
+	if (!(results = mm_alloc(sizeof(smtp_delivery_t) * count))) {
+		log_pedantic("Unable to allocate the recipient results for a queued message.");
+		smtp_queue_defer(entry);
+		mm_free(recipients);
+		mm_free(addresses);
+		st_free(data);
+		return;
+	}
+
+	// An empty return path means the message is a bounce, or an automated reply.
+	if ((pooled = smtp_pool_checkout(premium))) {
+		state = smtp_pool_transmit(pooled, (pl_empty(*addresses) ? NULL : (stringer_t *)addresses), size, recipients, (stringer_t *)&body, stuffed ? true : false,
+			&response, results);
+		smtp_pool_release(pooled, state == 1 || state == -2);
+	}
+
+	expired = (time(NULL) - created >= (magma.relay.queue.lifetime ? magma.relay.queue.lifetime : MAGMA_RELAY_QUEUE_LIFETIME));
+
+	// Sort the recipients into those which got the message, those which never will, and those which are worth another attempt. A
+	// permanent rejection of the message itself applies to every recipient that wasn't already turned away on its own.
+	for (uint64_t i = 0; i < count; i++) {
+
+		if (state == 1 && (results + i)->state == 1) {
+			delivered++;
+			continue;
+		}
+		else if ((results + i)->state == -2) {
+			reply = (results + i)->reply;
+		}
+		else if ((results + i)->state != -1 && state == -2 && response && *st_char_get(response) == '5') {
+			reply = response;
+		}
+		else if (expired) {
+			reply = expiration;
+		}
+		else {
+			(recipients + deferred++)->address = (stringer_t *)(addresses + i + 1);
+			continue;
+		}
+
+		rejected++;
+
+		// The summary lists each address along with the response which explains why it failed.
+		options = pl_trim_end(pl_init(st_char_get(reply), st_length_get(reply)));
+
+		if (!pl_empty(*addresses) && (holder = st_merge("snsnsn", failures, "    <", addresses + i + 1, "> - ", &options, "\r\n"))) {
+			st_cleanup(failures);
+			failures = holder;
+		}
+	}
+
+	// Only a message with a return path can be bounced, which also keeps bounces from generating bounces of their own.
+	if (rejected && !pl_empty(*addresses)) {
+
+		if (failures) {
+			smtp_queue_bounce(*addresses, failures, body, stuffed ? true : false);
+		}
+		else {
+			log_pedantic("Unable to build the delivery failure summary. { name = %s }", entry->name);
+		}
+	}
+
+	// A message that nobody received is kept in the dead letter directory, while a message which reached some of its recipients
+	// is finished, once the others have been notified.
+	if (!deferred && !delivered) {
+		smtp_queue_dead(entry, (expired ? "the message expired before it could be delivered" : "the relay permanently rejected the message"));
+	}
+	else if (!deferred) {
+
+		if (unlinkat(smtp_queue.dirfd, entry->name, 0)) {
+			log_error("Unable to remove a delivered message from the queue. { name = %s / error = %s }", entry->name, errno_string(errno, MEMORYBUF(1024), 1024));
+		}
+
+		stats_increment_by_name("smtp.queue.delivered");
+		mm_free(entry);
+	}
+
+	// When only some of the recipients are finished, the queue file is rewritten to hold the others, so a retry doesn't send the
+	// message to anyone twice. If that fails, the whole message is retried, since a duplicate is better than a lost message.
+	else {
+
+		if (delivered || rejected) {
+			(recipients + deferred - 1)->next = NULL;
+			smtp_queue_rewrite(entry, PLACER(st_char_get(data), pl_char_get(*addresses) + pl_length_get(*addresses) + 3 - st_char_get(data)), recipients,
+				body);
+		}
+
+		smtp_queue_defer(entry);
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		st_cleanup((results + i)->reply);
+	}
+
+	st_cleanup(failures);
+	st_cleanup(response);
+	mm_free(results);
+	mm_free(recipients);
+	mm_free(addresses);
+	st_free(data);
+
+	return;
+}
+
+/**
+ * @brief	Deliver queued messages as they become due.
+ * @note	This is the entry point for the queue delivery threads created by smtp_queue_start().
+ * @return	This function returns no value.
+ */
+void smtp_queue_worker(void) {
+
+	smtp_queued_t *entry;
+	struct timespec wakeup = { .tv_nsec = 0 };
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	mutex_lock(&(smtp_queue.lock));
+
+	while (smtp_queue.running) {
+
+		// Sleep until a message is queued, or until the first message is due.
+		if (!(entry = smtp_queue.entries)) {
+			pthread_cond_wait(&(smtp_queue.available), &(smtp_queue.lock));
+		}
+		else if (entry->scheduled > time(NULL)) {
+			wakeup.tv_sec = entry->scheduled;
+			pthread_cond_timedwait(&(smtp_queue.available), &(smtp_queue.lock), &wakeup);
+		}
+		else {
+			smtp_queue.entries = entry->next;
+			mutex_unlock(&(smtp_queue.lock));
+
+			smtp_queue_deliver(entry);
+
+			mutex_lock(&(smtp_queue.lock));
+		}
+	}
+
+	mutex_unlock(&(smtp_queue.lock));
+
+	thread_stop();
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Write a queue file to disk.
+ * @note	The file is written and flushed under a hidden name, and then given its visible name, so a crash can never expose a
+ * 			partial message. If a file with the same name already exists, it is replaced.
+ * @param	name		the file name of the queued message.
+ * @param	header		a managed string containing the delivery instructions, including the empty line which follows them.
+ * @param	message		a managed string containing the message.
+ * @return	true if the file was safely stored on disk, or false on failure.
+ */
+bool_t smtp_queue_write(chr_t *name, stringer_t *header, stringer_t *message) {
+
+	int_t fd;
+	bool_t stored = true;
+	chr_t temporary[33];
+
+	snprintf(temporary, 33, ".%s", name);
+
+	if ((fd = openat(smtp_queue.dirfd, temporary, O_WRONLY | O_CREAT | O_EXCL | O_NOATIME, S_IRUSR | S_IWUSR)) < 0 ||
+		write(fd, st_data_get(header), st_length_get(header)) != st_length_get(header) ||
+		write(fd, st_data_get(message), st_length_get(message)) != st_length_get(message) || fdatasync(fd)) {
+		stored = false;
+	}
+
+	// The descriptor is released by close() even when it fails, so it must never be closed a second time, since by then the number
+	// may belong to a descriptor opened by another thread.
+	if (fd >= 0 && close(fd)) {
+		stored = false;
+	}
+
+	if (!stored || renameat(smtp_queue.dirfd, temporary, smtp_queue.dirfd, name) || fsync(smtp_queue.dirfd)) {
+		log_error("Unable to store the message in the outbound queue. { name = %s / error = %s }", name, errno_string(errno, MEMORYBUF(1024), 1024));
+		unlinkat(smtp_queue.dirfd, temporary, 0);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Store a message in the outbound queue, so it can be delivered in the background.
+ * @param	premium		if set, the message will be delivered using a premium relay.
+ * @param	mailfrom	a managed string containing the return path, or NULL for an empty return path.
+ * @param	send_size	if non-zero, the message size advertised in the MAIL FROM command.
+ * @param	recipients	a linked list of recipient addresses.
+ * @param	message		a managed string containing the message.
+ * @param	dotstuffed	whether the message has already been dot stuffed.
+ * @return	0 if the queue is disabled, -1 if the message could not be queued, or 1 if the message has been safely stored on disk.
+ */
+int_t smtp_queue_message(int_t premium, stringer_t *mailfrom, size_t send_size, smtp_recipients_t *recipients, stringer_t *message, bool_t dotstuffed) {
+
+	time_t now;
+	smtp_queued_t *entry;
+	smtp_recipients_t *holder;
+	stringer_t *header, *line = MANAGEDBUF(1024);
+
+	if (!smtp_queue.running) {
+		return 0;
+	}
+	else if (!recipients || st_empty(message)) {
+		log_pedantic("Passed an invalid message or recipient list.");
+		return -1;
+	}
+	else if (!(entry = mm_alloc(sizeof(smtp_queued_t)))) {
+		log_pedantic("Unable to allocate a queue entry.");
+		return -1;
+	}
+
+	now = time(NULL);
+
+	// The creation time keeps the directory listing in rough arrival order, and the random suffix keeps names unique across restarts.
+	snprintf(entry->name, sizeof(entry->name), "%012lu.%016lx", now, rand_get_uint64());
+
+	if (!(header = st_aprint_opts(MANAGED_T | JOINTED | HEAP, "%010u %012lu\r\n%012lu %i %i %zu\r\n<%.*s>\r\n", 0, now, now, (premium ? 1 : 0),
+		(dotstuffed ? 1 : 0), send_size, (mailfrom ? st_length_int(mailfrom) : 0), (mailfrom ? st_char_get(mailfrom) : "")))) {
+		log_pedantic("Unable to build the queued message header.");
+		mm_free(entry);
+		return -1;
+	}
+
+	for (holder = recipients; header && holder; holder = (smtp_recipients_t *)holder->next) {
+
+		if (st_sprint(line, "<%.*s>\r\n", st_length_int(holder->address), st_char_get(holder->address)) <= 0) {
+			st_free(header);
+			header = NULL;
+		}
+		else {
+			header = st_append(header, line);
+		}
+	}
+
+	if (!header || !(header = st_append(header, PLACER("\r\n", 2)))) {
+		log_pedantic("Unable to build the queued message header.");
+		st_cleanup(header);
+		mm_free(entry);
+		return -1;
+	}
+
+	if (!smtp_queue_write(entry->name, header, message)) {
+		st_free(header);
+		mm_free(entry);
+		return -1;
+	}
+
+	st_free(header);
+
+	entry->attempts = 0;
+	entry->scheduled = now;
+	smtp_queue_schedule(entry);
+
+	stats_increment_by_name("smtp.queue.queued");
+	return 1;
+}
+
+/**
+ * @brief	Stop the queue delivery threads, and release the queue entries.
+ * @note	Queued messages remain on disk, and will be reloaded the next time the queue is started.
+ * @return	This function returns no value.
+ */
+void smtp_queue_stop(void) {
+
+	smtp_queued_t *entry;
+
+	mutex_lock(&(smtp_queue.lock));
+	smtp_queue.running = false;
+	pthread_cond_broadcast(&(smtp_queue.available));
+	mutex_unlock(&(smtp_queue.lock));
+
+	for (uint32_t i = 0; smtp_queue.workers && i < magma.relay.queue.workers; i++) {
+		if (*(smtp_queue.workers + i)) {
+			thread_join(*(smtp_queue.workers + i));
+		}
+	}
+
+	mm_cleanup(smtp_queue.workers);
+	smtp_queue.workers = NULL;
+
+	while ((entry = smtp_queue.entries)) {
+		smtp_queue.entries = entry->next;
+		mm_free(entry);
+	}
+
+	if (smtp_queue.dirfd >= 0) {
+		close(smtp_queue.dirfd);
+		smtp_queue.dirfd = -1;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Open the outbound queue, reload any messages left over from a previous run, and launch the delivery threads.
+ * @note	If no queue directory is configured, the queue remains disabled and outbound messages are relayed synchronously.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_queue_start(void) {
+
+	DIR *dir;
+	int_t fd;
+	chr_t schedule[25];
+	uint64_t restored = 0;
+	smtp_queued_t *entry;
+	struct dirent *node;
+	stringer_t *dead;
+
+	if (!magma.relay.queue.path) {
+		return true;
+	}
+	else if (!magma.relay.queue.workers) {
+		log_critical("The outbound queue requires at least one delivery thread.");
+		return false;
+	}
+
+	// Make sure the queue directory, and the dead letter directory inside it, both exist.
+	if (folder_exists(NULLER(magma.relay.queue.path), true) < 0 || !(dead = st_merge("nnn", magma.relay.queue.path,
+		(*(magma.relay.queue.path + ns_length_get(magma.relay.queue.path) - 1) == '/' ? "" : "/"), "dead")) || folder_exists(dead, true) < 0) {
+		log_critical("Unable to access the outbound queue directory. { path = %s }", magma.relay.queue.path);
+		st_cleanup(dead);
+		return false;
+	}
+
+	st_free(dead);
+
+	if ((smtp_queue.dirfd = open(magma.relay.queue.path, O_RDONLY | O_DIRECTORY)) < 0 || (fd = dup(smtp_queue.dirfd)) < 0 || !(dir = fdopendir(fd))) {
+		log_critical("Unable to open the outbound queue directory. { path = %s / error = %s }", magma.relay.queue.path, errno_string(errno, MEMORYBUF(1024), 1024));
+		smtp_queue_stop();
+		return false;
+	}
+
+	// Reload the messages which were still waiting for delivery when the daemon last stopped.
+	while ((node = readdir(dir))) {
+
+		// Hidden queue files are messages that were still being written when the daemon stopped, so they are incomplete.
+		if (*(node->d_name) == '.') {
+			if (ns_length_get(node->d_name) == 30) {
+				unlinkat(smtp_queue.dirfd, node->d_name, 0);
+			}
+			continue;
+		}
+		else if ((node->d_type != DT_REG && node->d_type != DT_UNKNOWN) || ns_length_get(node->d_name) >= sizeof(entry->name) ||
+			!st_cmp_cs_eq(NULLER(node->d_name), PLACER("dead", 4))) {
+			continue;
+		}
+		else if (!(entry = mm_alloc(sizeof(smtp_queued_t)))) {
+			log_critical("Unable to allocate a queue entry.");
+			closedir(dir);
+			smtp_queue_stop();
+			return false;
+		}
+
+		snprintf(entry->name, sizeof(entry->name), "%s", node->d_name);
+
+		if ((fd = openat(smtp_queue.dirfd, entry->name, O_RDONLY | O_NOATIME)) < 0 || read(fd, schedule, 25) != 25 ||
+			!uint32_conv_bl(schedule, 10, &(entry->attempts)) || !uint64_conv_bl(schedule + 11, 12, (uint64_t *)&(entry->scheduled))) {
+			smtp_queue_dead(entry, "the queue schedule could not be read");
+		}
+		else {
+			smtp_queue_schedule(entry);
+			restored++;
+		}
+
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	closedir(dir);
+
+	if (restored) {
+		log_info("Restored %lu messages to the outbound queue.", restored);
+	}
+
+	smtp_queue.running = true;
+
+	if (!(smtp_queue.workers = mm_alloc(sizeof(pthread_t) * magma.relay.queue.workers))) {
+		log_critical("Unable to allocate the outbound queue threads.");
+		smtp_queue_stop();
+		return false;
+	}
+
+	for (uint32_t i = 0; i < magma.relay.queue.workers; i++) {
+		if (thread_launch(smtp_queue.workers + i, &smtp_queue_worker, NULL)) {
+			log_critical("Unable to launch the outbound queue threads. { threads = %u / configured = %u }", i, magma.relay.queue.workers);
+			smtp_queue_stop();
+			return false;
+		}
+	}
+
+	return true;
+}
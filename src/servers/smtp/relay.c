@@ -7,6 +7,19 @@
 
 #include "magma.h"
 
+// The idle relay connections, and the number of connections currently open to each relay.
+struct {
+	pthread_mutex_t lock;
+	pthread_cond_t available;
+	struct {
+		uint32_t open, idling;
+		smtp_pooled_t *idle;
+	} hosts[MAGMA_RELAY_INSTANCES];
+} smtp_pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.available = PTHREAD_COND_INITIALIZER
+};
+
 /**
  * @brief	Issue an smtp client QUIT command.
  * @param	client	 a pointer to the smtp client session to be closed.
@@ -24,24 +37,22 @@ void smtp_client_close(client_t *client) {
 }
 
 /**
- * @brief	Connect to a randomly selected mail relay server, and wait for a successful banner message.
+ * @brief	Randomly select one of the configured mail relay servers.
  * @param	premium		if set, a premium relay will be selected instead of a standard one.
- * @return	NULL on failure or a pointer to the newly established network client object connected to a mail relay on success.
+ * @return	-1 if no suitable relay is configured, or the index of the selected relay in magma.relay.host on success.
  */
-client_t * smtp_client_connect(int_t premium) {
+int_t smtp_client_select(int_t premium) {
 
 	uint32_t num = 0;
-	client_t *client;
-	relay_t *relay = NULL;
 
 	// If the premium flag is set, pick a random premium relay.
 	if (premium && magma.relay.count.premium) {
 		num = (rand_get_uint32() % magma.relay.count.premium);
 
-		for (uint32_t i = 0; !relay && i < MAGMA_RELAY_INSTANCES; i++) {
+		for (uint32_t i = 0; i < MAGMA_RELAY_INSTANCES; i++) {
 
 			if (magma.relay.host[i] && magma.relay.host[i]->premium && !num) {
-					relay = magma.relay.host[i];
+				return i;
 			}
 			else if (magma.relay.host[i] && magma.relay.host[i]->premium) {
 				num--;
@@ -52,13 +63,13 @@ client_t * smtp_client_connect(int_t premium) {
 	}
 
 	// Otherwise, if no premium relays are defined, or premium is zero, pick a standard relay.
-	else {
+	else if (magma.relay.count.standard) {
 		num = (rand_get_uint32() % magma.relay.count.standard);
 
-		for (uint32_t i = 0; !relay && i < MAGMA_RELAY_INSTANCES; i++) {
+		for (uint32_t i = 0; i < MAGMA_RELAY_INSTANCES; i++) {
 
 			if (magma.relay.host[i] && !magma.relay.host[i]->premium && !num) {
-					relay = magma.relay.host[i];
+				return i;
 			}
 			else if (magma.relay.host[i] && !magma.relay.host[i]->premium) {
 				num--;
@@ -68,10 +79,18 @@ client_t * smtp_client_connect(int_t premium) {
 
 	}
 
-	if (!relay) {
-		log_pedantic("Unable to find a suitable mail relay to connect to.");
-		return NULL;
-	}
+	log_pedantic("Unable to find a suitable mail relay to connect to.");
+	return -1;
+}
+
+/**
+ * @brief	Connect to a specific mail relay server, and wait for a successful banner message.
+ * @param	relay	a pointer to the relay configuration of the server to connect to.
+ * @return	NULL on failure or a pointer to the newly established network client object connected to the mail relay on success.
+ */
+client_t * smtp_client_connect_relay(relay_t *relay) {
+
+	client_t *client;
 
 	// Connect
 	if (!(client = client_connect(relay->name, relay->port))) {
@@ -80,7 +99,7 @@ client_t * smtp_client_connect(int_t premium) {
 	}
 
 	// If a valid timeout was provided.
-	if (!magma.relay.timeout) {
+	if (magma.relay.timeout) {
 		net_set_timeout(client->sockd, magma.relay.timeout, magma.relay.timeout);
 	}
 
@@ -99,9 +118,27 @@ client_t * smtp_client_connect(int_t premium) {
 		return NULL;
 	}
 
+	stats_increment_by_name("smtp.relay.connections");
+
 	return client;
 }
 
+/**
+ * @brief	Connect to a randomly selected mail relay server, and wait for a successful banner message.
+ * @param	premium		if set, a premium relay will be selected instead of a standard one.
+ * @return	NULL on failure or a pointer to the newly established network client object connected to a mail relay on success.
+ */
+client_t * smtp_client_connect(int_t premium) {
+
+	int_t number;
+
+	if ((number = smtp_client_select(premium)) < 0) {
+		return NULL;
+	}
+
+	return smtp_client_connect_relay(magma.relay.host[number]);
+}
+
 /**
  * @brief	Issue a EHLO command to an smtp server, or fall back to HELO, and wait for a successful response.
  * @param	client	a pointer to the network client to issue the remote command.
@@ -109,9 +146,24 @@ client_t * smtp_client_connect(int_t premium) {
  */
 int_t smtp_client_send_helo(client_t *client) {
 
+	return smtp_client_send_ehlo(client, NULL);
+}
+
+/**
+ * @brief	Issue a EHLO command to an smtp server, or fall back to HELO, and record whether the server supports pipelining.
+ * @param	client		a pointer to the network client to issue the remote command.
+ * @param	pipelining	if not NULL, receives true if the EHLO response advertised the PIPELINING extension (RFC 2920).
+ * @return	-1 on failure or 1 on success.
+ */
+int_t smtp_client_send_ehlo(client_t *client, bool_t *pipelining) {
+
 	int_t state;
 	placer_t name = pl_null();
 
+	if (pipelining) {
+		*pipelining = false;
+	}
+
 	if (st_empty(magma.system.domain)) {
 		name = pl_init(magma.host.name, ns_length_get(magma.host.name));
 	}
@@ -142,6 +194,11 @@ int_t smtp_client_send_helo(client_t *client) {
 
 		do {
 
+			// Look for the extensions we know how to use.
+			if (pipelining && st_length_get(&(client->line)) >= 14 && !mm_cmp_ci_eq(st_char_get(&(client->line)) + 4, "PIPELINING", 10)) {
+				*pipelining = true;
+			}
+
 			if (st_length_get(&(client->line)) < 4 || *(st_char_get(client->buffer) + 3) == ' ') {
 				state = 0;
 			}
@@ -242,6 +299,35 @@ int_t smtp_client_send_rcptto(client_t *client, stringer_t *rcptto) {
  */
 int_t smtp_client_send_data(client_t *client, stringer_t *message, bool_t dotstuffed) {
 
+	int64_t sent = 0, line = 0;
+
+	if (st_empty(message)) {
+		log_pedantic("The naked mail relay was asked to send an empty message buffer.");
+		return -3;
+	}
+
+	// Send the DATA command and confirm the proceed response was recieved in response.
+	if ((sent = client_write(client, PLACER("DATA\r\n", 6))) != 6 || (line = client_read_line(client)) <= 0 || !pl_starts_with_char(client->line, '3')) {
+
+		log_pedantic("A%serror occurred while trying to send the DATA command.%s", (sent != 6 || line <= 0 ? " network " : "n "),
+			(sent == 6 && line > 0 ? st_char_get(st_quick(MANAGEDBUF(1024), " { response = %.*s }", st_length_int(&(client->line)),
+			st_char_get(&(client->line)))) : ""));
+
+		return (sent != 6 || line <= 0 ? -1 : -2);
+	}
+
+	return smtp_client_send_body(client, message, dotstuffed);
+}
+
+/**
+ * @brief	Send the body of a message, after the relay has accepted the DATA command, and wait for a successful response.
+ * @param	client		a pointer to the network client the message should be sent across.
+ * @param	message		a pointer to a managed string containing the body of the message to be sent.
+ * @param	dotstuffed	a boolean to where true indicates the supplied message has already been dotstuffed.
+ * @return	-3 for internal errors, -2 if the remote server rejected the message, -1 on general network failure, or 1 on success.
+ */
+int_t smtp_client_send_body(client_t *client, stringer_t *message, bool_t dotstuffed) {
+
 	int64_t sent = 0, line = 0;
 	stringer_t *duplicate = NULL;
 
@@ -259,25 +345,15 @@ int_t smtp_client_send_data(client_t *client, stringer_t *message, bool_t dotstu
 		// easy resizing.
 		if (!(duplicate = st_dupe_opts(MAPPED_T | JOINTED | HEAP, message)) || st_replace(&duplicate, PLACER("\n.", 2), PLACER("\n..", 3)) < 0) {
 			log_pedantic("The naked mail message could not be properly dot stuffed in preparation for sending.");
+			st_cleanup(duplicate);
 			return -3;
 		}
 
 		message = duplicate;
 	}
 
-	// Send the DATA command and confirm the proceed response was recieved in response.
-	if ((sent = client_write(client, PLACER("DATA\r\n", 6))) != 6 || (line = client_read_line(client)) <= 0 || !pl_starts_with_char(client->line, '3')) {
-
-		log_pedantic("A%serror occurred while trying to send the DATA command.%s", (sent != 6 || line <= 0 ? " network " : "n "),
-			(sent == 6 && line > 0 ? st_char_get(st_quick(MANAGEDBUF(1024), " { response = %.*s }", st_length_int(&(client->line)),
-			st_char_get(&(client->line)))) : ""));
-
-		st_cleanup(duplicate);
-		return (sent != 6 || line <= 0 ? -1 : -2);
-	}
-
 	// Send the message and confirm all of the bytes were sent.
-	else if ((sent = client_write(client, message)) != st_length_get(message)) {
+	if ((sent = client_write(client, message)) != st_length_get(message)) {
 		log_pedantic("Message relay failed. { sent = %li / total = %zu }", sent, st_length_get(message));
 		st_cleanup(duplicate);
 		return -1;
@@ -304,3 +380,360 @@ int_t smtp_client_send_data(client_t *client, stringer_t *message, bool_t dotstu
 
 	return 1;
 }
+
+/**
+ * @brief	Close a pooled relay connection and release its slot, waking any thread waiting for a connection to the same relay.
+ * @param	pooled	the pooled relay connection to be closed.
+ * @return	This function returns no value.
+ */
+void smtp_pool_close(smtp_pooled_t *pooled) {
+
+	if (!pooled) {
+		return;
+	}
+
+	if (pooled->client) {
+		smtp_client_close(pooled->client);
+	}
+
+	mutex_lock(&(smtp_pool.lock));
+	smtp_pool.hosts[pooled->host].open--;
+	pthread_cond_broadcast(&(smtp_pool.available));
+	mutex_unlock(&(smtp_pool.lock));
+
+	mm_free(pooled);
+	return;
+}
+
+/**
+ * @brief	Check out a connection to a mail relay, reusing an idle pooled connection when one is available.
+ * @note	Idle connections are reset with RSET before they are handed out, which also confirms the relay is still listening. If the
+ * 			relay already has magma.relay.connection_limit connections open, the caller waits for one to be released, up to the
+ * 			relay timeout. New connections are greeted with EHLO, and the response is checked for PIPELINING support.
+ * @param	premium		if set, a premium relay will be selected instead of a standard one.
+ * @return	NULL on failure, or a pointer to a pooled relay connection, ready for a new mail transaction, on success.
+ */
+smtp_pooled_t * smtp_pool_checkout(int_t premium) {
+
+	int_t number;
+	time_t now;
+	client_t *client;
+	struct timespec deadline;
+	smtp_pooled_t *pooled = NULL;
+
+	if ((number = smtp_client_select(premium)) < 0) {
+		return NULL;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += (magma.relay.timeout ? magma.relay.timeout : 60);
+
+	mutex_lock(&(smtp_pool.lock));
+
+	while (status()) {
+
+		// Take the most recently used idle connection.
+		if ((pooled = smtp_pool.hosts[number].idle)) {
+			smtp_pool.hosts[number].idle = pooled->next;
+			smtp_pool.hosts[number].idling--;
+			mutex_unlock(&(smtp_pool.lock));
+
+			now = time(NULL);
+
+			// Connections that sat idle too long are likely to have been dropped by the relay. Otherwise we reset the
+			// session, which doubles as a health check.
+			if (now - pooled->stamp > MAGMA_RELAY_POOL_IDLE || client_write(pooled->client, PLACER("RSET\r\n", 6)) != 6 ||
+				client_read_line(pooled->client) <= 0 || !pl_starts_with_char(pooled->client->line, '2')) {
+				smtp_pool_close(pooled);
+				mutex_lock(&(smtp_pool.lock));
+				continue;
+			}
+
+			stats_increment_by_name("smtp.relay.reused");
+			pooled->next = NULL;
+			return pooled;
+		}
+
+		// Reserve a slot, and open a new connection.
+		else if (!magma.relay.connection_limit || smtp_pool.hosts[number].open < magma.relay.connection_limit) {
+			smtp_pool.hosts[number].open++;
+			mutex_unlock(&(smtp_pool.lock));
+
+			if (!(pooled = mm_alloc(sizeof(smtp_pooled_t))) || !(client = smtp_client_connect_relay(magma.relay.host[number]))) {
+				log_pedantic("Could not connect to the mail relay.");
+				mm_cleanup(pooled);
+				pooled = NULL;
+			}
+			else if (smtp_client_send_ehlo(client, &(pooled->pipelining)) != 1) {
+				log_pedantic("An error occurred while trying to say hello.");
+				smtp_client_close(client);
+				mm_free(pooled);
+				pooled = NULL;
+			}
+			else {
+				pooled->host = number;
+				pooled->client = client;
+				return pooled;
+			}
+
+			mutex_lock(&(smtp_pool.lock));
+			smtp_pool.hosts[number].open--;
+			pthread_cond_broadcast(&(smtp_pool.available));
+			mutex_unlock(&(smtp_pool.lock));
+			return NULL;
+		}
+
+		// Wait for another thread to release a connection.
+		else if (pthread_cond_timedwait(&(smtp_pool.available), &(smtp_pool.lock), &deadline) == ETIMEDOUT) {
+			log_pedantic("Timed out waiting for a connection to the mail relay. { host = %s:%u / limit = %u }", magma.relay.host[number]->name,
+				magma.relay.host[number]->port, magma.relay.connection_limit);
+			break;
+		}
+	}
+
+	mutex_unlock(&(smtp_pool.lock));
+	return NULL;
+}
+
+/**
+ * @brief	Return a relay connection to the pool once a transaction is finished.
+ * @note	Connections are only kept if the caller indicates the session is still in a known state, and the pool for the relay
+ * 			holds fewer than magma.relay.pool idle connections. Anything else is closed with QUIT. A transaction which succeeded,
+ * 			or was rejected, by smtp_pool_transmit() always leaves the session between transactions, so those are safe to reuse.
+ * @param	pooled	the pooled relay connection being released.
+ * @param	reuse	true if the connection can be used for another transaction.
+ * @return	This function returns no value.
+ */
+void smtp_pool_release(smtp_pooled_t *pooled, bool_t reuse) {
+
+	if (!pooled) {
+		return;
+	}
+
+	mutex_lock(&(smtp_pool.lock));
+
+	if (reuse && status() && pooled->client && pooled->client->status >= 0 && smtp_pool.hosts[pooled->host].idling < magma.relay.pool) {
+		pooled->stamp = time(NULL);
+		pooled->next = smtp_pool.hosts[pooled->host].idle;
+		smtp_pool.hosts[pooled->host].idle = pooled;
+		smtp_pool.hosts[pooled->host].idling++;
+		pthread_cond_broadcast(&(smtp_pool.available));
+		mutex_unlock(&(smtp_pool.lock));
+		return;
+	}
+
+	mutex_unlock(&(smtp_pool.lock));
+	smtp_pool_close(pooled);
+
+	return;
+}
+
+/**
+ * @brief	Close all of the idle relay connections at shutdown.
+ * @return	This function returns no value.
+ */
+void smtp_pool_stop(void) {
+
+	smtp_pooled_t *pooled;
+
+	for (uint32_t i = 0; i < MAGMA_RELAY_INSTANCES; i++) {
+
+		mutex_lock(&(smtp_pool.lock));
+
+		while ((pooled = smtp_pool.hosts[i].idle)) {
+			smtp_pool.hosts[i].idle = pooled->next;
+			smtp_pool.hosts[i].idling--;
+			mutex_unlock(&(smtp_pool.lock));
+			smtp_pool_close(pooled);
+			mutex_lock(&(smtp_pool.lock));
+		}
+
+		mutex_unlock(&(smtp_pool.lock));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Record the relay response to a recipient.
+ * @param	client	the network client holding the relay response.
+ * @param	result	the recipient result to be updated.
+ * @param	state	1 if the recipient was accepted, or -2 if it was rejected.
+ * @return	This function returns no value.
+ */
+void smtp_pool_result(client_t *client, smtp_delivery_t *result, int_t state) {
+
+	// Only a 5xx response is permanent, anything else which isn't an acceptance is treated as temporary.
+	if (state == 1) {
+		result->state = 1;
+	}
+	else {
+		result->state = (pl_starts_with_char(client->line, '5') ? -2 : -1);
+	}
+
+	st_cleanup(result->reply);
+	result->reply = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, &(client->line));
+
+	return;
+}
+
+/**
+ * @brief	Send a message using a pooled relay connection.
+ * @note	If the relay advertised PIPELINING, the MAIL FROM, RCPT TO and DATA commands are written as a single group, and the
+ * 			responses are read back in order (RFC 2920). Otherwise each command waits for its response before the next is sent.
+ * 			If the relay rejects part of the envelope but still accepts the DATA command, the transaction can only be aborted by
+ * 			dropping the connection, so the client is closed, and the connection won't be returned to the pool.
+ * @param	pooled		the pooled relay connection to send the message across.
+ * @param	mailfrom	a managed string containing the return path, or NULL to use a null sender.
+ * @param	send_size	if greater than 0, the value of the SIZE parameter to pass with the MAIL FROM command.
+ * @param	recipients	a linked list of the recipient addresses.
+ * @param	message		a managed string containing the message to be sent.
+ * @param	dotstuffed	true if the message has already been dot stuffed.
+ * @param	response	if not NULL, receives a copy of the relay response that ended the transaction, which is the first rejection
+ * 						if anything was rejected. The caller is responsible for freeing the copy.
+ * @param	results		if not NULL, an array with an element for each recipient, which receives the relay response to that recipient.
+ * 						A rejected recipient then no longer aborts the transaction, and the message is sent to the recipients which
+ * 						were accepted. The transaction is only rejected if every recipient was. The caller is responsible for freeing
+ * 						the replies.
+ * @return	-3 for internal errors, -2 if the relay rejected the transaction, -1 on network failure, or 1 on success. The connection
+ * 			is dropped if the session is left in the middle of DATA, so it can be returned to the pool after a success or a rejection.
+ */
+int_t smtp_pool_transmit(smtp_pooled_t *pooled, stringer_t *mailfrom, size_t send_size, smtp_recipients_t *recipients, stringer_t *message,
+	bool_t dotstuffed, stringer_t **response, smtp_delivery_t *results) {
+
+	int_t state = 1;
+	size_t responses = 2, accepted = 0, index = 0;
+	smtp_recipients_t *holder;
+	stringer_t *commands = NULL, *line = MANAGEDBUF(512);
+
+	if (response) {
+		*response = NULL;
+	}
+
+	if (!pooled || !pooled->client || !recipients || st_empty(message)) {
+		log_pedantic("Passed an invalid message or recipient list.");
+		return -3;
+	}
+
+	// Without pipelining, we fall back to sending the commands one at a time.
+	else if (!pooled->pipelining) {
+
+		state = (mailfrom ? smtp_client_send_mailfrom(pooled->client, mailfrom, send_size) : smtp_client_send_nullfrom(pooled->client));
+
+		for (holder = recipients; state == 1 && holder; holder = (smtp_recipients_t *)holder->next) {
+
+			state = smtp_client_send_rcptto(pooled->client, holder->address);
+
+			// When the caller tracks each recipient, a rejection is recorded, and the rest of the envelope is still sent.
+			if (results && state != -1) {
+				smtp_pool_result(pooled->client, results + index++, state);
+				accepted += (state == 1 ? 1 : 0);
+				state = 1;
+			}
+		}
+
+		if (state == 1 && results && !accepted) {
+			state = -2;
+		}
+		else if (state == 1) {
+			state = smtp_client_send_data(pooled->client, message, dotstuffed);
+		}
+	}
+
+	else {
+
+		// Build the command group.
+		if (mailfrom && send_size) {
+			commands = st_aprint_opts(MANAGED_T | JOINTED | HEAP, "MAIL FROM: <%.*s> SIZE=%zu\r\n", st_length_int(mailfrom), st_char_get(mailfrom), send_size);
+		}
+		else if (mailfrom) {
+			commands = st_aprint_opts(MANAGED_T | JOINTED | HEAP, "MAIL FROM: <%.*s>\r\n", st_length_int(mailfrom), st_char_get(mailfrom));
+		}
+		else {
+			commands = st_aprint_opts(MANAGED_T | JOINTED | HEAP, "MAIL FROM: <>\r\n");
+		}
+
+		for (holder = recipients; commands && holder; holder = (smtp_recipients_t *)holder->next) {
+
+			if (st_sprint(line, "RCPT TO: <%.*s>\r\n", st_length_int(holder->address), st_char_get(holder->address)) <= 0) {
+				st_free(commands);
+				commands = NULL;
+			}
+			else {
+				commands = st_append(commands, line);
+				responses++;
+			}
+		}
+
+		if (!commands || !(commands = st_append(commands, PLACER("DATA\r\n", 6)))) {
+			log_pedantic("Unable to build the pipelined relay command group.");
+			st_cleanup(commands);
+			return -3;
+		}
+		else if (client_write(pooled->client, commands) != st_length_get(commands)) {
+			log_pedantic("Unable to send the pipelined relay command group.");
+			st_free(commands);
+			return -1;
+		}
+
+		st_free(commands);
+
+		// Read the MAIL FROM response, one response for each recipient, and then the DATA response, which should ask us to proceed.
+		for (size_t i = 0; state != -1 && i < responses; i++) {
+
+			if (client_read_line(pooled->client) <= 0) {
+				log_pedantic("An error occurred while reading the pipelined relay responses.");
+				state = -1;
+			}
+			// The recipient responses fall between the MAIL FROM and DATA responses.
+			else if (state == 1 && results && i && i < responses - 1) {
+				smtp_pool_result(pooled->client, results + index++, (pl_starts_with_char(pooled->client->line, '2') ? 1 : -2));
+				accepted += (pl_starts_with_char(pooled->client->line, '2') ? 1 : 0);
+
+				if (!pl_starts_with_char(pooled->client->line, '2') && response && !*response) {
+					*response = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, &(pooled->client->line));
+				}
+			}
+			else if (state == 1 && !pl_starts_with_char(pooled->client->line, (i == responses - 1 ? '3' : '2'))) {
+				log_pedantic("The relay rejected a pipelined command. { response = %.*s }", pl_length_int(pooled->client->line),
+					pl_char_get(pooled->client->line));
+				state = -2;
+
+				if (response && !*response) {
+					*response = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, &(pooled->client->line));
+				}
+			}
+		}
+
+		// If every recipient was rejected, the relay shouldn't have accepted the DATA command, and if it did, we can't send it a message.
+		if (state == 1 && results && !accepted) {
+			state = -2;
+		}
+
+		// The envelope was rejected, but the relay is waiting for the message, so the only safe way out is to drop the connection.
+		if (state == -2 && pl_starts_with_char(pooled->client->line, '3')) {
+			client_close(pooled->client);
+			pooled->client = NULL;
+		}
+		else if (state == 1) {
+			state = smtp_client_send_body(pooled->client, message, dotstuffed);
+		}
+	}
+
+	// A message which couldn't be sent after the relay agreed to accept it leaves the session in the middle of DATA, so the
+	// connection is dropped, rather than risk having the relay treat the next transaction as part of the message.
+	if (state == -3 && pooled->client) {
+		client_close(pooled->client);
+		pooled->client = NULL;
+	}
+
+	if (state == 1) {
+		stats_increment_by_name("smtp.relay.messages");
+	}
+
+	if (response && !*response && pooled->client && state != -1) {
+		*response = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, &(pooled->client->line));
+	}
+
+	return state;
+}
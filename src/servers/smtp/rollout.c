@@ -0,0 +1,323 @@
+
+/**
+ * @file /magma/servers/smtp/rollout.c
+ *
+ * @brief	Enforce the storage quota of accounts with rollout enabled, by removing their oldest messages in the background.
+ * @note	Delivery only schedules an account, it never waits for the rollout. Each pass holds the user lock just long enough to
+ * 			select a batch of messages and remove the ones needed in a single transaction. The message files are unlinked
+ * 			after the lock has been released. An account which can't be rolled out is scheduled again, after a delay which doubles
+ * 			with each failed attempt.
+ */
+
+#include "magma.h"
+
+// The accounts waiting to be rolled out, in the order they are due, and the thread processing them.
+struct {
+	bool_t running;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t available;
+	smtp_rollout_t *entries;
+} smtp_rollouts = {
+	.running = false,
+	.entries = NULL,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.available = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * @brief	Remove the oldest messages owned by a user until their storage usage falls below their storage quota.
+ * @param	usernum		the numerical id of the user.
+ * @return	1 if the storage usage is below the quota, 0 if the account is still over its quota after MAGMA_ROLLOUT_PASSES passes,
+ * 			or < 0 on failure, where
+ *         -1: An error occurred retrieving or removing the rollout messages.
+ *         -2: The user lock could not be acquired.
+ */
+int_t smtp_rollout_account(uint64_t usernum) {
+
+	row_t *row;
+	chr_t *path;
+	table_t *messages;
+	int64_t transaction;
+	uint32_t count, fetched;
+	uint64_t size, quota, freed;
+	uint64_t numbers[MAGMA_ROLLOUT_BATCH];
+	stringer_t *servers[MAGMA_ROLLOUT_BATCH];
+
+	for (uint32_t pass = 0; pass < MAGMA_ROLLOUT_PASSES; pass++) {
+
+		if (user_lock(usernum) != 1) {
+			log_pedantic("Could not lock the user account %lu.", usernum);
+			return -2;
+		}
+
+		// The usage is read again on every pass, because messages may have been delivered, or removed, since the last one.
+		if (!smtp_fetch_rollout_quota(usernum, &size, &quota)) {
+			user_unlock(usernum);
+			return -1;
+		}
+		else if (!quota || size < quota) {
+			user_unlock(usernum);
+			return 1;
+		}
+		else if (!(messages = smtp_fetch_rollmessages(usernum))) {
+			user_unlock(usernum);
+			return -1;
+		}
+
+		count = freed = 0;
+		fetched = res_row_count(messages);
+
+		// Only take as many of the oldest messages as are needed to get back under the quota. The comparison is written as a sum,
+		// because the recorded usage can be smaller than the messages it covers, and the difference would wrap around.
+		while (count < MAGMA_ROLLOUT_BATCH && freed + quota <= size && (row = res_row_next(messages))) {
+
+			if (!(servers[count] = res_field_string(row, 2))) {
+				break;
+			}
+
+			numbers[count] = res_field_uint64(row, 0);
+			freed += res_field_uint32(row, 1);
+			count++;
+		}
+
+		res_table_free(messages);
+
+		if (!count) {
+			user_unlock(usernum);
+			return -1;
+		}
+
+		if ((transaction = tran_start()) < 0) {
+			user_unlock(usernum);
+			for (uint32_t i = 0; i < count; i++) st_free(servers[i]);
+			return -1;
+		}
+		else if (!smtp_delete_rollmessages(usernum, numbers, count, freed, transaction)) {
+			tran_rollback(transaction);
+			user_unlock(usernum);
+			for (uint32_t i = 0; i < count; i++) st_free(servers[i]);
+			return -1;
+		}
+		else if (tran_commit(transaction)) {
+			log_pedantic("Could not commit the rollout transaction. { usernum = %lu }", usernum);
+			user_unlock(usernum);
+			for (uint32_t i = 0; i < count; i++) st_free(servers[i]);
+			return -1;
+		}
+
+		user_unlock(usernum);
+
+		// Increment the messages checkpoint_t so connected clients know messages have been removed.
+		serial_increment(OBJECT_MESSAGES, usernum);
+		stats_adjust_by_name("smtp.rollout.removed", count);
+
+		// The database records are gone, so an unlink failure only leaves behind an orphaned file.
+		for (uint32_t i = 0; i < count; i++) {
+			if ((path = mail_message_path(numbers[i], st_char_get(servers[i])))) {
+				if (unlink(path)) {
+					log_pedantic("Could not unlink the message %s. {unlink = -1}", path);
+				}
+				ns_free(path);
+			}
+			st_free(servers[i]);
+		}
+
+		if (freed + quota > size) {
+			return 1;
+		}
+
+		// The batch ended early, without freeing enough space, so the remaining messages couldn't be read.
+		else if (count < fetched) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Insert an account into the list of waiting accounts according to when it is due, and wake the rollout thread.
+ * @note	The caller must hold the rollout lock.
+ * @param	entry	a pointer to the waiting account.
+ * @return	This function returns no value.
+ */
+void smtp_rollout_insert(smtp_rollout_t *entry) {
+
+	smtp_rollout_t **holder;
+
+	for (holder = &(smtp_rollouts.entries); *holder && (*holder)->scheduled <= entry->scheduled; holder = &((*holder)->next));
+
+	entry->next = *holder;
+	*holder = entry;
+
+	pthread_cond_signal(&(smtp_rollouts.available));
+
+	return;
+}
+
+/**
+ * @brief	Schedule an account to be rolled out by the background thread.
+ * @note	An account which is already waiting isn't scheduled twice.
+ * @param	usernum		the numerical id of the user.
+ * @return	true if the account is waiting to be rolled out, or false if the rollout thread isn't available.
+ */
+bool_t smtp_rollout_schedule(uint64_t usernum) {
+
+	smtp_rollout_t *entry;
+
+	mutex_lock(&(smtp_rollouts.lock));
+
+	if (!smtp_rollouts.running) {
+		mutex_unlock(&(smtp_rollouts.lock));
+		return false;
+	}
+
+	// LOW: The waiting accounts are kept in a list, so a large backlog makes each check for a duplicate linear.
+	for (entry = smtp_rollouts.entries; entry && entry->usernum != usernum; entry = entry->next);
+
+	if (entry) {
+		mutex_unlock(&(smtp_rollouts.lock));
+		return true;
+	}
+	else if (!(entry = mm_alloc(sizeof(smtp_rollout_t)))) {
+		mutex_unlock(&(smtp_rollouts.lock));
+		return false;
+	}
+
+	entry->usernum = usernum;
+	entry->attempts = 0;
+	entry->scheduled = time(NULL);
+
+	smtp_rollout_insert(entry);
+	mutex_unlock(&(smtp_rollouts.lock));
+
+	stats_increment_by_name("smtp.rollout.scheduled");
+
+	return true;
+}
+
+/**
+ * @brief	Roll out accounts as they become due.
+ * @note	This is the entry point for the rollout thread created by smtp_rollout_start(). An account which is still over its
+ * 			quota after MAGMA_ROLLOUT_PASSES passes goes to the back of the waiting accounts, so it can't starve the others. An
+ * 			account which fails is retried later, until it has failed MAGMA_ROLLOUT_ATTEMPTS times, after which it waits for its
+ * 			next delivery to schedule it again.
+ * @return	This function returns no value.
+ */
+void smtp_rollout_worker(void) {
+
+	int_t state;
+	uint64_t delay;
+	smtp_rollout_t *entry, *holder;
+	struct timespec wakeup = { .tv_nsec = 0 };
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	mutex_lock(&(smtp_rollouts.lock));
+
+	while (smtp_rollouts.running) {
+
+		// Sleep until an account is scheduled, or until the first account is due.
+		if (!(entry = smtp_rollouts.entries)) {
+			pthread_cond_wait(&(smtp_rollouts.available), &(smtp_rollouts.lock));
+			continue;
+		}
+		else if (entry->scheduled > time(NULL)) {
+			wakeup.tv_sec = entry->scheduled;
+			pthread_cond_timedwait(&(smtp_rollouts.available), &(smtp_rollouts.lock), &wakeup);
+			continue;
+		}
+
+		smtp_rollouts.entries = entry->next;
+		mutex_unlock(&(smtp_rollouts.lock));
+
+		state = smtp_rollout_account(entry->usernum);
+
+		if (state < 0 && ++(entry->attempts) < MAGMA_ROLLOUT_ATTEMPTS) {
+			delay = (uint64_t)MAGMA_ROLLOUT_RETRY << (entry->attempts - 1);
+			log_pedantic("Unable to roll out the user account %lu. { attempts = %u / delay = %lu }", entry->usernum, entry->attempts, delay);
+			entry->scheduled = time(NULL) + delay;
+		}
+		else if (state < 0) {
+			log_pedantic("Unable to roll out the user account %lu. Giving up until its next delivery. { attempts = %u }", entry->usernum,
+				entry->attempts);
+			mm_free(entry);
+			entry = NULL;
+		}
+		else if (state == 0) {
+			entry->scheduled = time(NULL);
+		}
+		else {
+			mm_free(entry);
+			entry = NULL;
+		}
+
+		mutex_lock(&(smtp_rollouts.lock));
+
+		// A delivery may have scheduled the account again while it was being rolled out, in which case this entry is redundant.
+		if (entry) {
+
+			for (holder = smtp_rollouts.entries; holder && holder->usernum != entry->usernum; holder = holder->next);
+
+			if (holder || !smtp_rollouts.running) {
+				mm_free(entry);
+			}
+			else {
+				smtp_rollout_insert(entry);
+			}
+		}
+	}
+
+	mutex_unlock(&(smtp_rollouts.lock));
+
+	thread_stop();
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Stop the rollout thread, and discard the accounts still waiting.
+ * @return	This function returns no value.
+ */
+void smtp_rollout_stop(void) {
+
+	smtp_rollout_t *entry;
+
+	mutex_lock(&(smtp_rollouts.lock));
+	smtp_rollouts.running = false;
+	pthread_cond_broadcast(&(smtp_rollouts.available));
+	mutex_unlock(&(smtp_rollouts.lock));
+
+	if (smtp_rollouts.thread) {
+		thread_join(smtp_rollouts.thread);
+		smtp_rollouts.thread = 0;
+	}
+
+	while ((entry = smtp_rollouts.entries)) {
+		smtp_rollouts.entries = entry->next;
+		mm_free(entry);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Launch the rollout thread.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_rollout_start(void) {
+
+	smtp_rollouts.running = true;
+
+	if (thread_launch(&(smtp_rollouts.thread), &smtp_rollout_worker, NULL)) {
+		log_critical("Unable to launch the rollout thread.");
+		smtp_rollout_stop();
+		return false;
+	}
+
+	return true;
+}
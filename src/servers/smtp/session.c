@@ -22,6 +22,10 @@ void smtp_session_reset(connection_t *con) {
 		con->smtp.message = NULL;
 	}
 
+	st_cleanup(con->smtp.bdat.data);
+	con->smtp.bdat.data = NULL;
+	con->smtp.bdat.failed = false;
+
 	if (con->smtp.in_prefs) {
 		smtp_free_inbound(con->smtp.in_prefs);
 		con->smtp.in_prefs = NULL;
@@ -58,6 +62,7 @@ void smtp_session_destroy(connection_t *con) {
 
 	st_cleanup(con->smtp.helo);
 	st_cleanup(con->smtp.mailfrom);
+	st_cleanup(con->smtp.bdat.data);
 
 	if (con->smtp.message) {
 		mail_destroy_message(con->smtp.message);
@@ -110,7 +110,7 @@ void smtp_ehlo(connection_t *con) {
 	con->smtp.esmtp = true;
 
 	// If the user is connected via SSL already, or there is no SSL context, omit the STARTTLS parameter.
-	con_print(con, "250-%.*s\r\n250-8BITMIME\r\n%s250-PIPELINING\r\n250-SIZE %lu\r\n250-AUTH LOGIN PLAIN\r\n250-AUTH=LOGIN PLAIN\r\n250 EHLO COMPLETE\r\n",
+	con_print(con, "250-%.*s\r\n250-8BITMIME\r\n%s250-PIPELINING\r\n250-CHUNKING\r\n250-SIZE %lu\r\n250-AUTH LOGIN PLAIN\r\n250-AUTH=LOGIN PLAIN\r\n250 EHLO COMPLETE\r\n",
 		st_length_int(con->server->domain), st_char_get(con->server->domain), (con_secure(con) != 0 ? "" : "250-STARTTLS\r\n"),
 		magma.smtp.message_length_limit);
 
@@ -800,195 +800,195 @@ void smtp_rcpt_to(connection_t *con) {
 	return;
 }
 
-void smtp_data_finish(connection_t *con, size_t read, int_t checker) {
-
-	chr_t *stream;
-	int_t increment;
-
-	// In case we exit early.
-	stream = st_data_get(con->network.buffer);
-
-	// If there is no data in the buffer.
-	if (read == 0) {
-		read = con_read(con);
-	}
-
-	while (checker != 4 && status() && read > 0) {
-
-		stream = st_data_get(con->network.buffer);
-
-		for (increment = 0; increment < read && checker != 4; increment++) {
-			if (checker == 0 && *stream == '\n') {
-				checker++;
-			}
-			else if (checker == 1 && *stream == '.') {
-				checker++;
-			}
-			else if (checker == 2 && *stream == '\n') {
-				checker += 2;
-			}
-			else if (checker == 2 && *stream == '\r') {
-				checker++;
-			}
-			else if (checker == 3 && *stream == '\n') {
-				checker++;
-			}
-			else if (*stream == '\n') {
-				checker = 1;
-			}
-			else if (checker != 0) {
-				checker = 0;
-			}
-			stream++;
-		}
-
-		if (checker != 4) {
-			read = con_read(con);
-		}
-	}
-
-	// So that read line will get anything left in buffer.
-	if ((stream - st_char_get(con->network.buffer)) < read) {
-		st_data_set(&(con->network.line), st_data_get(con->network.buffer));
-		st_length_set(&(con->network.line), stream - st_char_get(con->network.buffer));
-	}
-
-	return;
-}
-
+/**
+ * @brief	Read the message data sent after a DATA command.
+ * @note	Each network read is processed a line at a time using memchr() to locate the line breaks, so the bulk of the message is
+ * 			moved using block copies instead of a byte by byte state machine. Along the way bare line feeds are converted into
+ * 			carriage return/line feed pairs, non-ASCII characters are dropped from the header, stuffed dots are removed and the
+ * 			terminating dot line is consumed, so the returned message is ready for mail_message_cleanup_opts() without dotstuffing.
+ * 			The buffer is sized using the SIZE parameter provided with the MAIL FROM command, when available, and then grows
+ * 			geometrically. If the message exceeds the size limit, or the buffer can't be expanded, the remaining data is read and
+ * 			discarded until the terminator is found so the connection stays in sync.
+ * @param	con			the client connection.
+ * @param	message		a pointer to a managed string that will receive the message data on success.
+ * @return	1 on success, -1 if a memory allocation failed, -2 if the message exceeded the size limit, -3 if the server is shutting down,
+ * 			or -4 if the connection was closed or timed out.
+ */
 int_t smtp_data_read(connection_t *con, stringer_t **message) {
 
-	chr_t *stream, *buffer;
-	stringer_t *result, *holder;
-	int_t read = 0, increment;
-	size_t used = 0, size = 128 * 1024;
-	int_t header = 1, checker = 1, carriage = 0;
+	int64_t read = 0;
+	int_t ret = 1, state = SMTP_DATA_LINE_START;
+	stringer_t *result = NULL, *holder;
+	chr_t *stream = NULL, *end, *newline, *output, *line, *scan, *check;
+	chr_t last = 0;
+	size_t used = 0, raw = 0, size = 128 * 1024, length, copy, expand;
+	bool_t header = true, complete = false, cr = false;
 
 	// In case we end early.
 	*message = NULL;
-	stream = st_data_get(con->network.buffer);
 
-	// Expand the stringer in 128 KB chunks.
-	if (!(result = st_alloc_opts(MAPPED_T | JOINTED | HEAP, size))) {
-		smtp_data_finish(con, 0, checker);
-		return -1;
+	// If the client provided the message size with the MAIL FROM command, allocate enough room up front. The extra room accounts
+	// for line feeds being expanded into carriage return/line feed pairs.
+	if (con->smtp.suggested_length && con->smtp.suggested_length <= con->smtp.max_length) {
+		size = con->smtp.suggested_length + (con->smtp.suggested_length / 32) + 1024;
 	}
 
-	// Setup the pointer into the stringer.
-	buffer = st_char_get(result);
-	read = con_read(con);
-
-	while (checker != 4 && read > 0 && status()) {
+	if (!(result = st_alloc_opts(MAPPED_T | JOINTED | HEAP, size))) {
+		log_pedantic("Attempted to allocate a buffer of %zu bytes to hold an incoming message, and failed. Reading till the end, and then " \
+			"returning an error.", size);
+		ret = -1;
+	}
 
-		// Setup the stream.
-		stream = st_data_get(con->network.buffer);
+	while (!complete && status() && (read = con_read(con)) > 0) {
 
-		// Size check.
-		if ((read + used) > con->smtp.max_length) {
-			log_pedantic("Message exceeded size limit of %zu bytes. Reading till the end, and then returning an error.", con->smtp.max_length);
-			smtp_data_finish(con, read, checker);
-			st_free(result);
-			return -2;
-		}
+		stream = st_char_get(con->network.buffer);
+		end = stream + read;
 
-		// Read in the new data.
-		for (increment = 0; checker != 4 && increment < read; increment++) {
+		while (!complete && stream < end) {
 
-			// Logic for detecting header mode.
-			if (header != 3) {
-				if (header == 0 && *stream == '\n') {
-					header++;
+			// Handle the start of a line, which is where we look for the terminator and stuffed dots.
+			if (state == SMTP_DATA_LINE_START) {
+				if (*stream == '.') {
+					state = SMTP_DATA_LINE_DOT;
+					stream++;
+					continue;
 				}
-				else if (header == 1 && *stream == '\n') {
-					header += 2;
+				state = SMTP_DATA_LINE_MIDDLE;
+			}
+			else if (state == SMTP_DATA_LINE_DOT) {
+				if (*stream == '\n') {
+					complete = true;
+					stream++;
+					continue;
 				}
-				else if (header == 1 && *stream == '\r') {
-					header++;
+				else if (*stream == '\r') {
+					state = SMTP_DATA_LINE_DOT_CR;
+					stream++;
+					continue;
 				}
-				else if (header == 2 && *stream == '\n') {
-					header++;
+
+				// The leading dot was stuffed, so it gets dropped.
+				state = SMTP_DATA_LINE_MIDDLE;
+				last = '.';
+				raw = 1;
+			}
+			else if (state == SMTP_DATA_LINE_DOT_CR) {
+				if (*stream == '\n') {
+					complete = true;
+					stream++;
+					continue;
 				}
-				else if (header != 0) {
-					header = 0;
+
+				// A stuffed dot followed by a stray carriage return, so we keep the carriage return and carry on.
+				if (ret == 1) {
+					*(st_char_get(result) + used++) = '\r';
 				}
-			}
 
-			// Logic for detecting the end of a message.
-			if (checker == 0 && *stream == '\n') {
-				checker++;
-			}
-			else if (checker == 1 && *stream == '.') {
-				checker++;
-			}
-			else if (checker == 2 && *stream == '\n') {
-				checker += 2;
-			}
-			else if (checker == 2 && *stream == '\r') {
-				checker++;
-			}
-			else if (checker == 3 && *stream == '\n') {
-				checker++;
-			}
-			else if (*stream == '\n') {
-				checker = 1;
-			}
-			else if (checker != 0) {
-				checker = 0;
+				cr = true;
+				state = SMTP_DATA_LINE_MIDDLE;
+				last = '\r';
+				raw = 2;
 			}
 
-			// Make sure every line ends with a carriage return, then line break.
-			if (*stream == '\n' && carriage == 0) {
-				*buffer++ = '\r';
-				used++;
+			// Find the end of the current line, or the end of the block if the line continues in the next read.
+			if ((newline = memchr(stream, '\n', end - stream))) {
+				length = newline - stream + 1;
 			}
-			else if (*stream == '\r') {
-				carriage = 1;
+			else {
+				length = end - stream;
 			}
-			else if (carriage != 0) {
-				carriage = 0;
+
+			// Keep track of the line content in front of the line break. The header copy drops non-ASCII bytes, so it can't be used to
+			// spot the empty line which ends the header.
+			if (length > (newline ? 1 : 0)) {
+				last = *(stream + length - (newline ? 2 : 1));
+				raw += length - (newline ? 1 : 0);
 			}
 
-			// In header mode, we only read in ASCII (0x00 to 0x7F) characters.
-			if (header != 3 && *stream >= 0) {
-				*buffer++ = *stream;
-				used++;
+			// Size check.
+			if (ret == 1 && used + length > con->smtp.max_length) {
+				log_pedantic("Message exceeded size limit of %zu bytes. Reading till the end, and then returning an error.", con->smtp.max_length);
+				ret = -2;
 			}
-			// Otherwise we read in anything.
-			else if (header == 3) {
-				*buffer++ = *stream;
-				used++;
+
+			// Make sure we have enough room in the buffer, growing it geometrically.
+			if (ret == 1 && used + length + 32 > size) {
+
+				expand = size * 2;
+
+				if (expand < used + length + 32) {
+					expand = used + length + 32;
+				}
+
+				if (!(holder = st_realloc(result, expand))) {
+					log_pedantic("Attempted to allocate a buffer of %zu bytes to hold an incoming message, and failed. Reading till the end, " \
+						"and then returning an error.", expand);
+					ret = -1;
+				}
+				else {
+					result = holder;
+					size = expand;
+				}
 			}
 
-			// Make sure we have enough room in the buffer.
-			if (used + 32 > size) {
-				if ((holder = st_realloc(result, size + (128 * 1024))) == NULL) {
-					log_pedantic("Attempted to allocate a buffer of %zu bytes to hold an incoming message, and failed. Returning an error to the client.", size + (128 * 1024));
-					smtp_data_finish(con, read, checker);
-					st_free(result);
-					return -1;
+			if (ret == 1) {
+
+				line = output = st_char_get(result) + used;
+
+				// Make sure every line ends with a carriage return, then line break.
+				if (newline && (newline == stream ? !cr : *(newline - 1) != '\r')) {
+					copy = length - 1;
+					mm_copy(output, stream, copy);
+					output += copy;
+					*output++ = '\r';
+					*output++ = '\n';
+				}
+				else {
+					mm_copy(output, stream, length);
+					output += length;
 				}
 
-				// Setup the pointers again.
-				size += 128 * 1024;
-				result = holder;
-				buffer = st_char_get(result) + used;
+				// In header mode, we only keep ASCII (0x00 to 0x7F) characters.
+				if (header) {
+
+					for (scan = check = line; check < output; check++) {
+						if (*check >= 0) {
+							*scan++ = *check;
+						}
+					}
+
+					output = scan;
+				}
+
+				used = output - st_char_get(result);
+				if (output != line) {
+					cr = (*(output - 1) == '\r');
+				}
+			}
+			else {
+				cr = (*(stream + length - 1) == '\r');
 			}
 
-			stream++;
-		}
+			// An empty line, either a bare line feed or a carriage return and line feed, marks the end of the header.
+			if (newline) {
+				if (header && (!raw || (raw == 1 && last == '\r'))) {
+					header = false;
+				}
+				state = SMTP_DATA_LINE_START;
+				raw = 0;
+			}
 
-		if (checker != 4) {
-			read = con_read(con);
+			stream += length;
 		}
 	}
 
 	// The server is shutting down or the client disconnected.
 	if (!status()) {
-		st_free(result);
+		st_cleanup(result);
 		return -3;
 	}
 	else if (read <= 0) {
-		st_free(result);
+		st_cleanup(result);
 		return -4;
 	}
 
@@ -998,6 +998,11 @@ int_t smtp_data_read(connection_t *con, stringer_t **message) {
 		st_length_set(&(con->network.line), stream - st_char_get(con->network.buffer));
 	}
 
+	if (ret != 1) {
+		st_cleanup(result);
+		return ret;
+	}
+
 	// Setup the output.
 	st_length_set(result, used);
 	*message = result;
@@ -1103,6 +1108,9 @@ void smtp_data_inbound(connection_t *con) {
 	smtp_inbound_prefs_t *current;
 	uint32_t perm_errors = 0, temp_errors = 0, delivered = 0, bounces = 0;
 
+	// Run the content checks shared by every recipient concurrently, before the recipients are processed one at a time.
+	smtp_content_check(con);
+
 	current = con->smtp.in_prefs;
 	while (current != NULL) {
 
@@ -1146,11 +1154,71 @@ void smtp_data_inbound(connection_t *con) {
 
 }
 
+/**
+ * @brief	Hand a fully received message off to the inbound or outbound processor.
+ * @note	This is shared by the DATA command, and the BDAT command once the last chunk has arrived. The caller is responsible for
+ * 			verifying the message sender and recipients. This function takes ownership of the message text, and requeues the connection.
+ * @param	con			a pointer to the connection object of the client that sent the message.
+ * @param	text		a managed string containing the message that was received.
+ * @param	dotstuffed	true if the message still contains dot-stuffed lines and the trailing dot, or false if the reader already removed them.
+ * @return	This function returns no value.
+ */
+void smtp_data_accept(connection_t *con, stringer_t *text, bool_t dotstuffed) {
+
+	smtp_message_t *message;
+
+	// Count the number of Received lines. Some servers return error code 446 when the number of received lines indicates a delivery
+	// loop. Unfortunately that is a temporary error code, which would result in the server attempting delivery again later. Since the
+	// problem is unlikely to correct itself, we decided to return a permanent error code instead.
+	if (mail_count_received(text) > magma.smtp.relay_limit) {
+		con_write_bl(con, "550 DATA FAILED - THE MESSAGE HAS TOO MANY RECEIVED HEADER LINES AND IS BEING REJECTED BECAUSE IT APPEARS TO BE CAUGHT IN A " \
+			"FORWARD LOOP\r\n", 138);
+		smtp_requeue(con);
+		st_free(text);
+		return;
+	}
+
+	// Setup the message structure and cleanup the message data.
+	if (mail_message_cleanup_opts(&text, dotstuffed) != 1) {
+		con_write_bl(con, "451 DATA FAILED - INTERNAL SERVER ERROR - PLEASE TRY AGAIN LATER\n\n", 66);
+		smtp_requeue(con);
+		st_free(text);
+		return;
+	}
+
+	// Create the message structure.
+	if (!(message = mail_create_message(text))) {
+		con_write_bl(con, "451 DATA FAILED - INTERNAL SERVER ERROR - PLEASE TRY AGAIN LATER\n\n", 66);
+		smtp_requeue(con);
+		st_free(text);
+		return;
+	}
+
+	// Add all of the required headers.
+	if (!mail_add_required_headers(con, message)) {
+		con_write_bl(con, "451 DATA FAILED - INTERNAL SERVER ERROR - PLEASE TRY AGAIN LATER\n\n", 66);
+		mail_destroy_message(message);
+		smtp_requeue(con);
+		return;
+	}
+
+	// Add the message context to the session.
+	con->smtp.message = message;
+
+	if (con->smtp.authenticated == true) {
+		requeue(&smtp_data_outbound, &smtp_requeue, con);
+	}
+	else {
+		requeue(&smtp_data_inbound, &smtp_requeue, con);
+	}
+
+	return;
+}
+
 void smtp_data(connection_t *con) {
 
 	int_t state;
 	stringer_t *text;
-	smtp_message_t *message;
 
 	// Make sure outsiders say HELO.
 	// If the remote host tries to send data before sending a MAIL FROM and RCPT TO, return a protocol error.
@@ -1169,10 +1237,22 @@ void smtp_data(connection_t *con) {
 		smtp_requeue(con);
 		return;
 	}
+	// The DATA and BDAT commands can't be mixed within the same transaction.
+	else if (con->smtp.bdat.data || con->smtp.bdat.failed) {
+		con_write_bl(con, "503 DATA REJECTED - THE MESSAGE IS BEING SENT USING BDAT\r\n", 58);
+		smtp_requeue(con);
+		return;
+	}
 
 	// Tell the user we are ready to receive.
 	con_write_bl(con, "354 Enter mail, end with \".\" on a line by itself.\r\n", 51);
 
+	// The client waits for the go ahead before sending the message, so release any responses held back for a pipelined group.
+	if (con->smtp.corked) {
+		con->smtp.corked = false;
+		net_set_cork(con->network.sockd, false);
+	}
+
 	if ((state = smtp_data_read(con, &text)) == -1) {
 		con_write_bl(con, "451 DATA FAILED - MEMORY ALLOCATION FAILED - PLEASE TRY AGAIN LATER\r\n", 69);
 		smtp_requeue(con);
@@ -1204,51 +1284,138 @@ void smtp_data(connection_t *con) {
 		return;
 	}
 
-	// Count the number of Received lines. Some servers return error code 446 when the number of received lines indicates a delivery
-	// loop. Unfortunately that is a temporary error code, which would result in the server attempting delivery again later. Since the
-	// problem is unlikely to correct itself, we decided to return a permanent error code instead.
-	if (mail_count_received(text) > magma.smtp.relay_limit) {
-		con_write_bl(con, "550 DATA FAILED - THE MESSAGE HAS TOO MANY RECEIVED HEADER LINES AND IS BEING REJECTED BECAUSE IT APPEARS TO BE CAUGHT IN A " \
-			"FORWARD LOOP\r\n", 138);
+	smtp_data_accept(con, text, false);
+	return;
+}
+
+/**
+ * @brief	Accept a chunk of message data sent using the BDAT command (RFC 3030).
+ * @note	Each chunk is read straight into the message buffer, and since BDAT data isn't dot-stuffed there is no terminator to scan
+ * 			for and nothing to unstuff. Once a chunk has been rejected the remaining chunks of the transaction are read and discarded,
+ * 			until the LAST chunk arrives or the session is reset. A rejected LAST chunk resets the transaction, and an accepted one is
+ * 			processed the same way a DATA message would be.
+ * @param	con		a pointer to the connection object of the client issuing the BDAT command.
+ * @return	This function returns no value.
+ */
+void smtp_bdat(connection_t *con) {
+
+	bool_t last;
+	int64_t nread;
+	uint64_t length;
+	chr_t *holder, discard[8192];
+	stringer_t *text, *resized;
+	size_t used = 0, left;
+
+	if (!smtp_parse_bdat(con, &length, &last)) {
+		con_write_bl(con, "501 BDAT SYNTAX ERROR - A CHUNK SIZE IS REQUIRED\r\n", 50);
 		smtp_requeue(con);
-		st_free(text);
 		return;
 	}
-
-	// Setup the message structure and cleanup the message data.
-	if (mail_message_cleanup(&text) != 1) {
-		con_write_bl(con, "451 DATA FAILED - INTERNAL SERVER ERROR - PLEASE TRY AGAIN LATER\n\n", 66);
-		smtp_requeue(con);
-		st_free(text);
+	// A chunk bigger than any message we accept can't be delivered, and consuming it could take forever, so drop the connection instead.
+	else if (length > magma.smtp.message_length_limit) {
+		con_print(con, "552 BDAT FAILED - THE CHUNK EXCEEDS THE %lu BYTE MESSAGE SIZE LIMIT - GOOD BYE\r\n", magma.smtp.message_length_limit);
+		smtp_quit(con);
 		return;
 	}
 
-	// Create the message structure.
-	if (!(message = mail_create_message(text))) {
-		con_write_bl(con, "451 DATA FAILED - INTERNAL SERVER ERROR - PLEASE TRY AGAIN LATER\n\n", 66);
-		smtp_requeue(con);
-		st_free(text);
+	// Make sure the transaction is ready to receive data, and that the chunk will fit. If it won't, we still have to consume the chunk,
+	// otherwise its contents would be interpreted as commands.
+	used = st_length_get(con->smtp.bdat.data);
+
+	if (!con->smtp.bdat.failed && ((con->smtp.helo == NULL && con->smtp.authenticated == false) || con->smtp.mailfrom == NULL ||
+		(con->smtp.authenticated == false && con->smtp.in_prefs == NULL) || (con->smtp.authenticated == true && con->smtp.out_prefs->recipients == NULL) ||
+		length > con->smtp.max_length || used > con->smtp.max_length - length)) {
+		con->smtp.bdat.failed = true;
+	}
+
+	// Expand the message buffer so the chunk can be read into its final location.
+	if (!con->smtp.bdat.failed && length) {
+
+		if (!con->smtp.bdat.data && !(con->smtp.bdat.data = st_alloc_opts(MAPPED_T | JOINTED | HEAP, length))) {
+			log_pedantic("Attempted to allocate a buffer of %lu bytes to hold an incoming message, and failed.", length);
+			con->smtp.bdat.failed = true;
+		}
+		else if (st_avail_get(con->smtp.bdat.data) < used + length) {
+
+			if (!(resized = st_realloc(con->smtp.bdat.data, used + length))) {
+				log_pedantic("Attempted to allocate a buffer of %zu bytes to hold an incoming message, and failed.", used + length);
+				con->smtp.bdat.failed = true;
+			}
+			else {
+				con->smtp.bdat.data = resized;
+			}
+
+		}
+
+	}
+
+	// Once the transaction has failed, the data received so far is no longer needed.
+	if (con->smtp.bdat.failed) {
+		st_cleanup(con->smtp.bdat.data);
+		con->smtp.bdat.data = NULL;
+		used = 0;
+	}
+
+	// Read the chunk, or throw it away if the transaction has failed.
+	left = length;
+
+	while (left && status()) {
+
+		holder = con->smtp.bdat.failed ? discard : st_char_get(con->smtp.bdat.data) + used + (length - left);
+
+		if ((nread = con_read_bl(con, holder, con->smtp.bdat.failed && left > sizeof(discard) ? sizeof(discard) : left)) <= 0) {
+			con_write_bl(con, "421 BDAT FAILED - THE CONNECTION TIMED OUT WHILE WAITING FOR DATA - GOOD BYE\r\n", 78);
+			smtp_quit(con);
+			return;
+		}
+
+		left -= nread;
+	}
+
+	if (!status()) {
+		con_write_bl(con, "451 BDAT FAILED - THE SERVER IS SHUTTING DOWN FOR MAINTENANCE - PLEASE TRY AGAIN LATER\r\n", 88);
+		smtp_quit(con);
 		return;
 	}
+	else if (con->smtp.bdat.failed) {
+
+		if ((con->smtp.helo == NULL && con->smtp.authenticated == false) || con->smtp.mailfrom == NULL ||
+			(con->smtp.authenticated == false && con->smtp.in_prefs == NULL) || (con->smtp.authenticated == true && con->smtp.out_prefs->recipients == NULL)) {
+			con_write_bl(con, "503 BDAT REJECTED - PLEASE PROVIDE A HELO, MAIL FROM AND RCPT AND TRY AGAIN\r\n", 77);
+		}
+		else {
+			con_print(con, "552 BDAT FAILED - SIZE LIMIT EXCEEDED - THIS MESSAGE MAY ONLY BE UP TO %zu BYTES IN LENGTH\r\n", con->smtp.max_length);
+		}
+
+		// Rejecting the last chunk ends the transaction, so the sender and recipients have to be provided again.
+		if (last) {
+			smtp_session_reset(con);
+		}
 
-	// Add all of the required headers.
-	if (!mail_add_required_headers(con, message)) {
-		con_write_bl(con, "451 DATA FAILED - INTERNAL SERVER ERROR - PLEASE TRY AGAIN LATER\n\n", 66);
-		mail_destroy_message(message);
 		smtp_requeue(con);
 		return;
 	}
 
-	// Add the message context to the session.
-	con->smtp.message = message;
+	if (con->smtp.bdat.data) {
+		st_length_set(con->smtp.bdat.data, used + length);
+	}
 
-	if (con->smtp.authenticated == true) {
-		requeue(&smtp_data_outbound, &smtp_requeue, con);
+	if (!last) {
+		con_print(con, "250 BDAT CHUNK ACCEPTED - %lu BYTES RECEIVED\r\n", length);
+		smtp_requeue(con);
+		return;
 	}
-	else {
-		requeue(&smtp_data_inbound, &smtp_requeue, con);
+	else if (st_empty(con->smtp.bdat.data)) {
+		con_write_bl(con, "554 BDAT FAILED - NO MESSAGE DATA WAS RECEIVED\r\n", 48);
+		smtp_session_reset(con);
+		smtp_requeue(con);
+		return;
 	}
 
+	text = con->smtp.bdat.data;
+	con->smtp.bdat.data = NULL;
+
+	smtp_data_accept(con, text, false);
 	return;
 }
 
@@ -21,6 +21,23 @@ void     smtp_bypass_free(void);
 int_t    smtp_check_filters(smtp_inbound_prefs_t *prefs, stringer_t **local);
 int_t    smtp_check_greylist(connection_t *con, smtp_inbound_prefs_t *prefs);
 int_t    smtp_check_rbl(connection_t *con);
+bool_t   smtp_check_rbl_send(int_t sockd, struct sockaddr_storage *server, uchr_t *packet, int_t length);
+bool_t   smtp_rbl_expired(smtp_rbl_entry_t *entry, time_t *now);
+int_t    smtp_rbl_cache_get(stringer_t *addr);
+void     smtp_rbl_cache_set(stringer_t *addr, int_t result, uint32_t ttl);
+void     smtp_rbl_prune(void);
+bool_t   smtp_rbl_start(void);
+void     smtp_rbl_stop(void);
+int_t    smtp_verdict_dkim(stringer_t *id, stringer_t *message);
+bool_t   smtp_verdict_expired(smtp_verdict_entry_t *entry, smtp_verdict_entry_t *current);
+int_t    smtp_verdict_get(stringer_t *key, uint64_t generation);
+stringer_t *  smtp_verdict_key(int_t check, stringer_t *message, stringer_t *output);
+void     smtp_verdict_prune(void);
+void     smtp_verdict_set(stringer_t *key, int_t result, uint64_t generation);
+stringer_t *  smtp_verdict_signed(stringer_t *header);
+bool_t   smtp_verdict_start(void);
+void     smtp_verdict_stop(void);
+int_t    smtp_verdict_virus(stringer_t *message);
 
 /// commands.c
 void smtp_requeue(connection_t *con);
@@ -32,20 +49,25 @@ void    smtp_sort(void);
 int_t         smtp_check_authorized_from(uint64_t usernum, stringer_t *address);
 int_t         smtp_check_receive_quota(connection_t *con, smtp_inbound_prefs_t *prefs);
 int_t         smtp_check_transmit_quota(uint64_t usernum, size_t num_recipients, smtp_outbound_prefs_t *prefs);
+bool_t        smtp_delete_rollmessages(uint64_t usernum, uint64_t *messages, uint32_t count, uint64_t size, int64_t transaction);
 int_t         smtp_fetch_authorization(stringer_t *username, stringer_t *verification, smtp_outbound_prefs_t **output);
 stringer_t *  smtp_fetch_autoreply(uint64_t autoreply, uint64_t usernum);
 int_t         smtp_fetch_inbound(stringer_t *address, smtp_inbound_prefs_t **output);
+int_t         smtp_fetch_lock(uint64_t usernum);
 table_t *     smtp_fetch_rollmessages(uint64_t usernum);
+bool_t        smtp_fetch_rollout_quota(uint64_t usernum, uint64_t *size, uint64_t *quota);
 int_t         smtp_get_action(chr_t *string, size_t length);
 uint64_t      smtp_insert_spamsig(smtp_inbound_prefs_t *prefs, uint64_t key, int_t code);
+int_t         smtp_load_inbound(stringer_t *address, smtp_inbound_prefs_t **output);
 void          smtp_update_receive_stats(connection_t *con, smtp_inbound_prefs_t *prefs);
 void          smtp_update_transmission_stats(connection_t *con);
 
 /// smtp.c
 void   smtp_auth_login(connection_t *con);
 void   smtp_auth_plain(connection_t *con);
+void   smtp_bdat(connection_t *con);
 void   smtp_data(connection_t *con);
-void   smtp_data(connection_t *con);
+void   smtp_data_accept(connection_t *con, stringer_t *text, bool_t dotstuffed);
 void   smtp_disabled(connection_t *con);
 void   smtp_ehlo(connection_t *con);
 void   smtp_helo(connection_t *con);
@@ -61,18 +83,88 @@ void   submission_init(connection_t *con);
 
 /// parse.c
 stringer_t *  smtp_parse_auth(stringer_t *data);
+bool_t        smtp_parse_bdat(connection_t *con, uint64_t *length, bool_t *last);
 stringer_t *  smtp_parse_helo_domain(connection_t *con);
 stringer_t *  smtp_parse_mail_from_path(connection_t *con);
 stringer_t *  smtp_parse_rcpt_to(connection_t *con);
 
+/// content.c
+uint32_t       smtp_content_cancel(smtp_content_t *content);
+void           smtp_content_check(connection_t *con);
+bool_t         smtp_content_decisive(connection_t *con, int_t virus);
+void           smtp_content_release(smtp_content_t *content);
+void           smtp_content_run(smtp_content_job_t *job);
+bool_t         smtp_content_start(void);
+void           smtp_content_stop(void);
+void           smtp_content_worker(void);
+
+/// greylist.c
+void      smtp_greylist_bloom_add(uint32_t shard, uint64_t hash);
+bool_t    smtp_greylist_bloom_check(uint32_t shard, uint64_t hash);
+int_t     smtp_greylist_lookup(uint64_t hash, uint64_t now, uint64_t *stamp, uint64_t *updated, uint64_t greytime);
+void      smtp_greylist_push(uint32_t shard, smtp_greylist_entry_t *entry);
+uint32_t  smtp_greylist_shard(uint64_t hash);
+bool_t    smtp_greylist_start(void);
+void      smtp_greylist_stop(void);
+void      smtp_greylist_store(uint64_t hash, uint64_t now, uint64_t stamp, uint64_t updated);
+void      smtp_greylist_unlink(uint32_t shard, smtp_greylist_entry_t *entry);
+
+/// prefs.c
+void                    smtp_prefs_account(smtp_inbound_prefs_t *prefs, uint64_t size);
+smtp_inbound_prefs_t *  smtp_prefs_copy(smtp_inbound_prefs_t *prefs, stringer_t *signet);
+void                    smtp_prefs_entry_free(smtp_prefs_entry_t *entry);
+bool_t                  smtp_prefs_expired(smtp_prefs_entry_t *entry, time_t *now);
+smtp_inbound_prefs_t *  smtp_prefs_get(stringer_t *address);
+void                    smtp_prefs_prune(void);
+void                    smtp_prefs_set(stringer_t *address, smtp_inbound_prefs_t *prefs, uint64_t serial);
+bool_t                  smtp_prefs_start(void);
+void                    smtp_prefs_stop(void);
+bool_t                  smtp_receiving_expired(smtp_receiving_entry_t *entry, time_t *now);
+bool_t                  smtp_receiving_get(uint64_t usernum, stringer_t *subnet, uint64_t *total, uint64_t *local);
+void                    smtp_receiving_increment(uint64_t usernum, stringer_t *subnet);
+void                    smtp_receiving_set(uint64_t usernum, stringer_t *subnet, uint64_t total, uint64_t local);
+
+/// rollout.c
+int_t    smtp_rollout_account(uint64_t usernum);
+void     smtp_rollout_insert(smtp_rollout_t *entry);
+bool_t   smtp_rollout_schedule(uint64_t usernum);
+bool_t   smtp_rollout_start(void);
+void     smtp_rollout_stop(void);
+void     smtp_rollout_worker(void);
+
+/// queue.c
+void           smtp_queue_bounce(placer_t mailfrom, stringer_t *failures, placer_t body, bool_t dotstuffed);
+void           smtp_queue_dead(smtp_queued_t *entry, chr_t *reason);
+void           smtp_queue_defer(smtp_queued_t *entry);
+void           smtp_queue_deliver(smtp_queued_t *entry);
+stringer_t *   smtp_queue_load(chr_t *name);
+int_t          smtp_queue_message(int_t premium, stringer_t *mailfrom, size_t send_size, smtp_recipients_t *recipients, stringer_t *message, bool_t dotstuffed);
+bool_t         smtp_queue_rewrite(smtp_queued_t *entry, stringer_t *prefix, smtp_recipients_t *recipients, placer_t body);
+void           smtp_queue_schedule(smtp_queued_t *entry);
+bool_t         smtp_queue_start(void);
+void           smtp_queue_stop(void);
+void           smtp_queue_worker(void);
+bool_t         smtp_queue_write(chr_t *name, stringer_t *header, stringer_t *message);
+
 /// relay.c
-void        smtp_client_close(client_t *client);
-client_t *  smtp_client_connect(int_t premium);
-int_t       smtp_client_send_data(client_t *client, stringer_t *message, bool_t dotstuffed);
-int_t       smtp_client_send_helo(client_t *client);
-int_t       smtp_client_send_mailfrom(client_t *client, stringer_t *mailfrom, size_t send_size);
-int_t       smtp_client_send_nullfrom(client_t *client);
-int_t       smtp_client_send_rcptto(client_t *client, stringer_t *rcptto);
+void             smtp_client_close(client_t *client);
+client_t *       smtp_client_connect(int_t premium);
+client_t *       smtp_client_connect_relay(relay_t *relay);
+int_t            smtp_client_select(int_t premium);
+int_t            smtp_client_send_body(client_t *client, stringer_t *message, bool_t dotstuffed);
+int_t            smtp_client_send_data(client_t *client, stringer_t *message, bool_t dotstuffed);
+int_t            smtp_client_send_ehlo(client_t *client, bool_t *pipelining);
+int_t            smtp_client_send_helo(client_t *client);
+int_t            smtp_client_send_mailfrom(client_t *client, stringer_t *mailfrom, size_t send_size);
+int_t            smtp_client_send_nullfrom(client_t *client);
+int_t            smtp_client_send_rcptto(client_t *client, stringer_t *rcptto);
+smtp_pooled_t *  smtp_pool_checkout(int_t premium);
+void             smtp_pool_close(smtp_pooled_t *pooled);
+void             smtp_pool_release(smtp_pooled_t *pooled, bool_t reuse);
+void             smtp_pool_result(client_t *client, smtp_delivery_t *result, int_t state);
+void             smtp_pool_stop(void);
+int_t            smtp_pool_transmit(smtp_pooled_t *pooled, stringer_t *mailfrom, size_t send_size, smtp_recipients_t *recipients, stringer_t *message,
+	bool_t dotstuffed, stringer_t **response, smtp_delivery_t *results);
 
 /// session.c
 void    smtp_add_inbound(connection_t *con, smtp_inbound_prefs_t *inbound);
@@ -11,9 +11,10 @@
  * @brief	Relay an outbound smtp message for a user.
  * @note	The following process occurs before the message will be sent:
  * 			1. Necessary outbound headers are attached to the message.*
- * 			2. An outbound connection to a mail relay server is established (with a premium or normal server pool).
- * 			3. Once the connection is negotiated, an RCPT TO command is issued for each of the message's recipients.
- * 			4. The mail message data is sent and the client connection is closed.
+ * 			2. If the outbound queue is enabled, the message is stored in the queue and delivered in the background. Otherwise
+ * 			   an outbound relay connection is checked out of the connection pool (with a premium or normal server pool).
+ * 			3. The envelope is sent, with an RCPT TO command for each of the message's recipients.
+ * 			4. The mail message data is sent and the connection is returned to the pool.
  * @param	con		a pointer to the connection object across which the outbound mail was attempted to be sent.
  * @param	result	a pointer to the address of a managed string that will receive the server's last response to the mail send attempt,
  * 			regardless of whether or not it was successful.
@@ -22,8 +23,7 @@
 int_t smtp_relay_message(connection_t *con, stringer_t **result) {
 
 	int_t state;
-	smtp_recipients_t *holder;
-	client_t *client;
+	smtp_pooled_t *pooled;
 
 	if (!result || !con || !con->smtp.message || !con->smtp.message->text || !con->smtp.out_prefs->recipients) {
 		log_pedantic("Passed a NULL pointer.");
@@ -38,73 +38,30 @@ int_t smtp_relay_message(connection_t *con, stringer_t **result) {
 		return -1;
 	}
 
-	// Open the connection to the SMTP server.
-	if (!(client = smtp_client_connect(con->smtp.out_prefs->importance))) {
-		log_pedantic("Could not relay the message.");
-		return -1;
-	}
+	// Ensure the message is properly dot stuffed before sending.
+	st_replace(&(con->smtp.message->text), PLACER("\n.", 2), PLACER("\n..", 3));
 
-	// Send HELO.
-	if (smtp_client_send_helo(client) != 1) {
-		log_pedantic("An error occurred while trying to say hello.");
-		smtp_client_close(client);
-		return -1;
+	// If the outbound queue is enabled, the message is delivered in the background. If the queue is disabled, or the message
+	// couldn't be queued, we fall back to relaying it directly.
+	if (smtp_queue_message(con->smtp.out_prefs->importance, con->smtp.mailfrom, 0, con->smtp.out_prefs->recipients, con->smtp.message->text, true) == 1) {
+		*result = st_import("250 MESSAGE QUEUED FOR DELIVERY\r\n", 33);
+		return 1;
 	}
 
-	// Send MAIL FROM.
-	if ((state = smtp_client_send_mailfrom(client, con->smtp.mailfrom, 0)) == -2) {
-		log_pedantic("An error occurred while trying to send the mail from.");
-		*result = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, &(client->line));
-		smtp_client_close(client);
-		return -1;
-	}
-	else if (state != 1) {
-		log_pedantic("An error occurred while trying to send the mail from.");
-		smtp_client_close(client);
+	// Check out a relay connection, which is either reused from the pool or freshly negotiated.
+	if (!(pooled = smtp_pool_checkout(con->smtp.out_prefs->importance))) {
+		log_pedantic("Could not relay the message.");
 		return -1;
 	}
 
-	// Send the RCPT TO command.
-	holder = con->smtp.out_prefs->recipients;
-
-	while (holder) {
-
-		if ((state = smtp_client_send_rcptto(client, holder->address)) == -2) {
-			log_pedantic("An error occurred while trying to send a rcpt to command.");
-			*result = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, &(client->line));
-			smtp_client_close(client);
-			return -1;
-		}
-		else if (state != 1) {
-			log_pedantic("An error occurred while trying to send a rcpt to command.");
-			smtp_client_close(client);
-			return -1;
-		}
+	// Send the envelope and the message. If the relay rejects either, the result will hold its response.
+	state = smtp_pool_transmit(pooled, con->smtp.mailfrom, 0, con->smtp.out_prefs->recipients, con->smtp.message->text, true, result, NULL);
+	smtp_pool_release(pooled, state == 1 || state == -2);
 
-		holder = (smtp_recipients_t *)holder->next;
-	}
-
-	// Ensure the message is properly dot stuffed before sending.
-	st_replace(&(con->smtp.message->text), PLACER("\n.", 2), PLACER("\n..", 3));
-
-	// Send the the message.
-	state = smtp_client_send_data(client, con->smtp.message->text, true);
-
-	if (state == -2) {
-		log_pedantic("An error occurred while trying to send the message.");
-		*result = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, &(client->line));
-		smtp_client_close(client);
+	if (state != 1) {
+		log_pedantic("An error occurred while trying to relay the message.");
 		return -1;
 	}
-	else if (state != 1) {
-		log_pedantic("An error occurred while trying to send the message.");
-		smtp_client_close(client);
-		return -1;
-	}
-
-	// Store the result.
-	*result = st_dupe_opts(MANAGED_T | CONTIGUOUS | HEAP, &(client->line));
-	smtp_client_close(client);
 
 	return 1;
 }
@@ -114,7 +71,8 @@ int_t smtp_forward_message(server_t *server, stringer_t *sender, stringer_t *add
 
 	int_t state;
 	stringer_t *new;
-	client_t *client;
+	smtp_pooled_t *pooled;
+	smtp_recipients_t recipient = { .address = address, .next = NULL };
 
 	if (!address || !message) {
 		log_pedantic("Passed a NULL pointer.");
@@ -129,51 +87,33 @@ int_t smtp_forward_message(server_t *server, stringer_t *sender, stringer_t *add
 	// Add the new message headers associated with this forward operation.
 	mail_add_forward_headers(server, &new, id, mark, signum, sigkey);
 
-	// Open the connection to the SMTP server. Always use the default servers for forwards.
-	if (!(client = smtp_client_connect(0))) {
-		log_pedantic("Could not relay the message.");
-		smtp_client_close(client);
+	// Queue the forward for background delivery if possible.
+	if (smtp_queue_message(0, sender, st_length_get(new), &recipient, new, true) == 1) {
 		st_free(new);
-		return -1;
+		return 1;
 	}
 
-	// Send HELO.
-	if (smtp_client_send_helo(client)!= 1) {
-		log_pedantic("An error occurred while trying to say hello.");
-		smtp_client_close(client);
+	// Check out a relay connection. Always use the default servers for forwards.
+	if (!(pooled = smtp_pool_checkout(0))) {
+		log_pedantic("Could not relay the message.");
 		st_free(new);
 		return -1;
 	}
 
-	// Send MAIL FROM.
-	if (smtp_client_send_mailfrom(client, sender, st_length_get(new)) != 1) {
-		log_pedantic("An error occurred while trying to send the mail from.");
-		smtp_client_close(client);
-		st_free(new);
-		return -1;
+	// Send the envelope and the message. If the relay rejects the forward, use a permanent failure code.
+	if ((state = smtp_pool_transmit(pooled, sender, st_length_get(new), &recipient, new, true, NULL, NULL)) == -2) {
+		log_pedantic("The relay rejected the forwarded message.");
+		state = -2;
 	}
-
-	// Send the RCPT TO command. If this fails, use a permanent failure code.
-	if ((state = smtp_client_send_rcptto(client, address)) != 1) {
-		log_pedantic("An error occurred while trying to send a rcpt to command.");
-		smtp_client_close(client);
-		st_free(new);
-		return -2;
-	}
-
-	// Send the the message.
-	if ((state = smtp_client_send_data(client, new, true)) != 1) {
+	else if (state != 1) {
 		log_pedantic("An error occurred while trying to send the message.");
-		smtp_client_close(client);
-		st_free(new);
-		return -1;
+		state = -1;
 	}
 
-	// Store the result.
-	smtp_client_close(client);
+	smtp_pool_release(pooled, state == 1 || state == -2);
 	st_free(new);
 
-	return 1;
+	return state;
 }
 
 int_t smtp_bounce(connection_t *con) {
@@ -182,8 +122,9 @@ int_t smtp_bounce(connection_t *con) {
 	struct tm ltime;
 	uint32_t number = 0;
 	chr_t date_buffer[1024];
+	int_t state;
 	smtp_inbound_prefs_t *prefs;
-	client_t *client;
+	smtp_pooled_t *pooled;
 	int_t explanations = SMTP_OUTCOME_SUCESS;
 	static const chr_t *date_format = "Date: %a, %d %b %Y %H:%M:%S %z\r\n";
 	stringer_t *message = NULL, *holder = NULL, *explain = NULL, *bounces = NULL, *signature = NULL, *id = MANAGEDBUF(16);
@@ -193,6 +134,8 @@ int_t smtp_bounce(connection_t *con) {
 		return 0;
 	}
 
+	smtp_recipients_t recipient = { .address = con->smtp.mailfrom, .next = NULL };
+
 	// Build the date string. Otherwise null the buffer so it doesn't get appended to the header.
 	if ((utime = time(&utime)) == -1 || !localtime_r(&utime, &ltime) || strftime(date_buffer, 1024, date_format, &ltime) <= 0) {
 		log_pedantic("Unable to retrieve the current time.");
@@ -209,34 +152,6 @@ int_t smtp_bounce(connection_t *con) {
 		st_sprint(id, "%lu", crc64_checksum(&utime, sizeof(time_t)));
 	}
 
-	// Open the connection to the SMTP server. Always use the default servers for forwards.
-	if (!(client = smtp_client_connect(0))) {
-		log_pedantic("Could not relay the message.");
-		smtp_client_close(client);
-		return 0;
-	}
-
-	// Send HELO.
-	if (smtp_client_send_helo(client)!= 1) {
-		log_pedantic("An error occurred while trying to say hello.");
-		smtp_client_close(client);
-		return 0;
-	}
-
-	// Send NULL MAIL FROM.
-	if (smtp_client_send_nullfrom(client) != 1) {
-		log_pedantic("An error occurred while trying to send the mail from.");
-		smtp_client_close(client);
-		return 0;
-	}
-
-	// Send the RCPT TO command. If this fails, use a permanent failure code.
-	if (smtp_client_send_rcptto(client, con->smtp.mailfrom) != 1) {
-		log_pedantic("An error occurred while trying to send a rcpt to command.");
-		smtp_client_close(client);
-		return 0;
-	}
-
 	// Loop through and build the bounce summary.
 	prefs = con->smtp.in_prefs;
 
@@ -345,13 +260,26 @@ int_t smtp_bounce(connection_t *con) {
 
 	}
 
-	// Transmit the bounce.
-	if (message && smtp_client_send_data(client, message, false) != 1) {
-		log_pedantic("An error occurred while trying to send the message.");
+	// Queue the bounce using a null return path if possible, otherwise transmit it directly. Always use the default servers for bounces.
+	if (message && smtp_queue_message(0, NULL, 0, &recipient, message, false) != 1) {
+
+		if (!(pooled = smtp_pool_checkout(0))) {
+			log_pedantic("Could not relay the message.");
+			st_cleanup(bounces);
+			st_cleanup(explain);
+			st_cleanup(signature);
+			st_cleanup(message);
+			return 0;
+		}
+
+		if ((state = smtp_pool_transmit(pooled, NULL, 0, &recipient, message, false, NULL, NULL)) != 1) {
+			log_pedantic("An error occurred while trying to send the message.");
+		}
+
+		smtp_pool_release(pooled, state == 1 || state == -2);
 	}
 
-	// Close the connection and cleanup.
-	smtp_client_close(client);
+	// Cleanup.
 	st_cleanup(bounces);
 	st_cleanup(explain);
 	st_cleanup(signature);
@@ -362,10 +290,11 @@ int_t smtp_bounce(connection_t *con) {
 
 int_t smtp_reply(stringer_t *from, stringer_t *to, uint64_t usernum, uint64_t autoreply, int_t spf, int_t dkim) {
 
+	int_t state;
 	time_t utime;
 	struct tm ltime;
-	client_t *client;
 	chr_t buffer[1024];
+	smtp_pooled_t *pooled;
 	static const chr_t *date_format = "Date: %a, %d %b %Y %H:%M:%S %z\r\n";
 	stringer_t *message = NULL, *holder = NULL, *signature = NULL, *text = NULL, *key = NULL, *id = MANAGEDBUF(16);
 
@@ -374,6 +303,8 @@ int_t smtp_reply(stringer_t *from, stringer_t *to, uint64_t usernum, uint64_t au
 		return 0;
 	}
 
+	smtp_recipients_t recipient = { .address = to, .next = NULL };
+
 	// Build the key.
 	if (snprintf(buffer, 1024, "magma.reply.replies.%lu.%lu.", usernum, autoreply) <= 0 || (key = st_merge("ns", buffer, to)) == NULL) {
 		log_pedantic("Unable to build the key.");
@@ -417,46 +348,6 @@ int_t smtp_reply(stringer_t *from, stringer_t *to, uint64_t usernum, uint64_t au
 		st_sprint(id, "%lu", crc64_checksum(&utime, sizeof(time_t)));
 	}
 
-	// Open the connection to the SMTP server. Always use the default servers for forwards.
-	if (!(client = smtp_client_connect(0))) {
-		log_pedantic("Could not relay the message.");
-		smtp_client_close(client);
-		lock_release(key);
-		st_free(text);
-		st_free(key);
-		return 0;
-	}
-
-	// Send HELO.
-	if (smtp_client_send_helo(client) != 1) {
-		log_pedantic("An error occurred while trying to say hello.");
-		smtp_client_close(client);
-		lock_release(key);
-		st_free(text);
-		st_free(key);
-		return 0;
-	}
-
-	// Send NULL MAIL FROM.
-	if (smtp_client_send_nullfrom(client) != 1) {
-		log_pedantic("An error occurred while trying to send the mail from.");
-		smtp_client_close(client);
-		lock_release(key);
-		st_free(text);
-		st_free(key);
-		return 0;
-	}
-
-	// Send the RCPT TO command. If this fails, use a permanent failure code.
-	if (smtp_client_send_rcptto(client, to) != 1) {
-		log_pedantic("An error occurred while trying to send a rcpt to command.");
-		smtp_client_close(client);
-		lock_release(key);
-		st_free(text);
-		st_free(key);
-		return 0;
-	}
-
 	// Build the autoreply message.
 	message = st_merge("nsnnnsnsn", "From: ", from, "\r\nSubject: Autoreply\r\n", buffer, "To: ", to, "\r\n\r\n", text, "\r\n\r\n");
 
@@ -471,16 +362,24 @@ int_t smtp_reply(stringer_t *from, stringer_t *to, uint64_t usernum, uint64_t au
 		}
 	}
 
-	// Transmit the auto reply and set the timestamp.
-	if (message != NULL && smtp_client_send_data(client, message, false) == 1) {
+	// Queue or transmit the auto reply using a null return path and set the timestamp. Always use the default servers for replies.
+	if (message != NULL && smtp_queue_message(0, NULL, 0, &recipient, message, false) == 1) {
 		cache_set_u64(key, time(NULL), 86460);
 	}
-	else if (message != NULL) {
-		log_pedantic("An error occurred while trying to send the message.");
+	else if (message != NULL && !(pooled = smtp_pool_checkout(0))) {
+		log_pedantic("Could not relay the message.");
 	}
+	else if (message != NULL) {
+
+		if ((state = smtp_pool_transmit(pooled, NULL, 0, &recipient, message, false, NULL, NULL)) == 1) {
+			cache_set_u64(key, time(NULL), 86460);
+		}
+		else {
+			log_pedantic("An error occurred while trying to send the message.");
+		}
 
-	// Close the connection and cleanup.
-	smtp_client_close(client);
+		smtp_pool_release(pooled, state == 1 || state == -2);
+	}
 
 	// Release the lock.
 	lock_release(key);
@@ -502,50 +401,27 @@ int_t smtp_reply(stringer_t *from, stringer_t *to, uint64_t usernum, uint64_t au
  */
 int_t smtp_send_message(stringer_t *to, stringer_t *from, stringer_t *message) {
 
-	client_t *client;
+	int_t state;
+	smtp_pooled_t *pooled;
+	smtp_recipients_t recipient = { .address = to, .next = NULL };
 
 	if (!to || !from || !message) {
 		log_pedantic("Passed a NULL pointer.");
 		return -1;
 	}
 
-	// Open the connection to the SMTP server.
-	if (!(client = smtp_client_connect(1))) {
+	// Check out a relay connection from the premium pool.
+	if (!(pooled = smtp_pool_checkout(1))) {
 		log_pedantic("Could not relay the message.");
-		smtp_client_close(client);
 		return -1;
 	}
 
-	// Send HELO.
-	if (smtp_client_send_helo(client)!= 1) {
-		log_pedantic("An error occurred while trying to say hello.");
-		smtp_client_close(client);
-		return -1;
-	}
-
-	// Send MAIL FROM.
-	if (smtp_client_send_mailfrom(client, from, 0) != 1) {
-		log_pedantic("An error occurred while trying to send the mail from.");
-		smtp_client_close(client);
-		return -1;
-	}
-
-	// Send the RCPT TO command.
-	if (smtp_client_send_rcptto(client, to) != 1) {
-		log_pedantic("An error occurred while trying to send a rcpt to command.");
-		smtp_client_close(client);
-		return -1;
-	}
-
-	// Send the the message.
-	if (smtp_client_send_data(client, message, false) != 1) {
+	// Send the envelope and the message.
+	if ((state = smtp_pool_transmit(pooled, from, 0, &recipient, message, false, NULL, NULL)) != 1) {
 		log_pedantic("An error occurred while trying to send the message.");
-		smtp_client_close(client);
-		return -1;
 	}
 
-	// Store the result.
-	smtp_client_close(client);
+	smtp_pool_release(pooled, state == 1 || state == -2);
 
-	return 1;
+	return (state == 1 ? 1 : -1);
 }
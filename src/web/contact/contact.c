@@ -7,6 +7,15 @@
 
 #include "magma.h"
 
+// The slots replaced when the contact message template is rendered.
+http_slot_t contact_message_slots[] = {
+	{ .xpath = "//xhtml:title", .attribute = NULL },
+	{ .xpath = "//xhtml:a[@id='nav_contact']", .attribute = "class" },
+	{ .xpath = "//xhtml:a[text()='Contact Lavabit']", .attribute = "class" },
+	{ .xpath = "//xhtml:div[@id='secondary']//xhtml:a[text()='Report Abuse']", .attribute = "class" },
+	{ .xpath = "//xhtml:p[@id='message']", .attribute = NULL }
+};
+
 /**
  * @brief	Display the contact or abuse notification form to the requesting user.
  * @note	Both the contact and abuse forms operate on the underlying template found in "contact/message"
@@ -18,44 +27,33 @@
 void contact_print_message(connection_t *con, chr_t *branch, chr_t *message) {
 
 	stringer_t *raw;
-	http_page_t *page;
+	http_template_t *template;
+	chr_t *values[] = { NULL, NULL, NULL, NULL, message };
 
-	if (!(page = http_page_get("contact/message"))) {
+	if (!(template = http_template_get("contact/message", contact_message_slots, sizeof(contact_message_slots) / sizeof(http_slot_t)))) {
 		http_print_500(con);
 		return;
 	}
 
-	// For contact page submissions.
+	// For contact page submissions, update the title and set the proper active indicators.
 	if (!st_cmp_cs_eq(NULLER(branch), PLACER("Contact", 7))) {
-		// Update the title.
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:title", (uchr_t *)"Lavabit ..::.. Contact");
-		// Set the proper active indicators.
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *)"//xhtml:a[@id='nav_contact']", (uchr_t *)"class", (uchr_t *)"active");
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *)"//xhtml:a[text()='Contact Lavabit']", (uchr_t *)"class", (uchr_t *)"active");
+		values[0] = "Lavabit ..::.. Contact";
+		values[1] = values[2] = "active";
 	}
 
-	// For abuse page submissions.
+	// For abuse page submissions, update the title and set the proper active indicators.
 	if (!st_cmp_cs_eq(NULLER(branch), PLACER("Abuse", 5))) {
-		// Update the title.
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:title", (uchr_t *)"Lavabit ..::.. Report Abuse");
-		// Set the proper active indicators.
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *)"//xhtml:div[@id='secondary']//xhtml:a[text()='Report Abuse']", (uchr_t *)"class", (uchr_t *)"active");
-	}
-
-	// Set the message.
-	if (message) {
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:p[@id='message']", (uchr_t *)message);
+		values[0] = "Lavabit ..::.. Report Abuse";
+		values[3] = "active";
 	}
 
-	if (!(raw = xml_dump_doc(page->doc_obj))) {
+	if (!(raw = http_template_render(template, values))) {
 		http_print_500_log(con, "Contact page could not be generated.");
-		http_page_free(page);
 		return;
 	}
 
-	http_response_header(con, 200, page->content->type, st_length_get(raw));
+	http_response_header(con, 200, template->type, st_length_get(raw));
 	con_write_st(con, raw);
-	http_page_free(page);
 	st_free(raw);
 
 	return;
@@ -990,44 +990,84 @@ void portal_endpoint_folders_tags(connection_t *con) {
  */
 void portal_endpoint_messages_list(connection_t *con) {
 
+	void *iter;
+	chr_t *key;
 	json_error_t err;
-	json_t *tags, *list, *entry;
-	inx_cursor_t *cursor;
+	meta_view_t *view;
 	meta_message_t *active;
-	uint64_t foldernum, count, current = 0, start = 0, limit = 0;
-	stringer_t *header, *fields[8];
-
-//	if ((count = json_object_size_d(con->http.portal.params)) && (count > 3 || count < 2)) {
-//		log_pedantic("Received invalid portal folder add request parameters { user = %.*s, count = %u }",
-//			(int)st_length_get(con->http.session->user->username), st_char_get(con->http.session->user->username), (unsigned int) count);
-//		portal_endpoint_error(con, 400, JSON_RPC_2_ERROR_SERVER_METHOD_PARAMS, "Invalid method parameters.");
-//		return;
-//	}
-//	else if ((count == 2 && json_unpack_ex_d(con->http.portal.params, &err, JSON_STRICT, "{s:s, s:s}", "context", &method, "name", &name)) ||
-//		(count == 3 && json_unpack_ex_d(con->http.portal.params, &err, JSON_STRICT, "{s:s, s:s, s:I}", "context", &method, "name", &name, "parentID", &parent))) {
-//		log_pedantic("Received invalid portal folder add request parameters { user = %.*s, errmsg = %s }",
-//			(int)st_length_get(con->http.session->user->username), st_char_get(con->http.session->user->username), err.text);
-//		portal_endpoint_error(con, 400, JSON_RPC_2_ERROR_SERVER_METHOD_PARAMS, "Invalid method parameters.");
-//		return;
-//	}
+	bool_t descending = false;
+	json_t *tags, *list, *entry, *value;
+	META_SORT sort = META_SORT_DATE;
+	int64_t position, step;
+	uint64_t foldernum = 0, count, current = 0, start = 0, limit = 0, after = 0;
+	stringer_t *fields[MAIL_SUMMARY_FIELDS];
+
 	// Check the session state. Method has 1 parameter.
 	if (!portal_validate_request (con, PORTAL_ENDPOINT_ERROR_MESSAGES_LIST, "messages.list", true, 0)) {
 		return;
 	}
-	// Validate the request format and extract the submitted values.
-	else if ((count = json_object_size_d(con->http.portal.params)) && (count < 1 || count > 3)) {
+	// Validate the request format. Only the folder is required, the paging and sorting parameters are optional.
+	else if ((count = json_object_size_d(con->http.portal.params)) < 1 || count > 6) {
 		log_pedantic("Received invalid portal messages list request parameters { user = %.*s, count = %u }",
 			(int)st_length_get(con->http.session->user->username), st_char_get(con->http.session->user->username), (unsigned int) count);
 		portal_endpoint_error(con, 400, JSON_RPC_2_ERROR_SERVER_METHOD_PARAMS, "Invalid method parameters.");
 		return;
 	}
-	// Validate the request format and extract the submitted values.
-	else if ((count == 1 && json_unpack_ex_d(con->http.portal.params, &err, JSON_STRICT, "{s:I}", "folderID", &foldernum)) ||
-	(count == 2 && json_unpack_ex_d(con->http.portal.params, &err, JSON_STRICT, "{s:I, s:I}", "folderID", &foldernum, "start", &start) &&
-	json_unpack_ex_d(con->http.portal.params, &err, JSON_STRICT, "{s:I, s:I}", "folderID", &foldernum, "limit", &limit)) ||
-	(count == 3 && json_unpack_ex_d(con->http.portal.params, &err, JSON_STRICT, "{s:I, s:I, s:I}", "folderID", &foldernum, "start", &start, "limit", &limit))) {
-		log_pedantic("Received invalid portal messages list request parameters { user = %.*s, errmsg = %s }",
-			(int)st_length_get(con->http.session->user->username), st_char_get(con->http.session->user->username), err.text);
+
+	// Extract the submitted values.
+	iter = json_object_iter_d(con->http.portal.params);
+
+	while (iter) {
+
+		if (!(key = (chr_t *)json_object_iter_key_d(iter)) || !(value = json_object_iter_value_d(iter))) {
+			break;
+		}
+		else if (json_is_integer(value) && json_integer_value_d(value) >= 0 && !st_cmp_cs_eq(NULLER(key), PLACER("folderID", 8))) {
+			foldernum = json_integer_value_d(value);
+		}
+		else if (json_is_integer(value) && json_integer_value_d(value) >= 0 && !st_cmp_cs_eq(NULLER(key), PLACER("start", 5))) {
+			start = json_integer_value_d(value);
+		}
+		else if (json_is_integer(value) && json_integer_value_d(value) >= 0 && !st_cmp_cs_eq(NULLER(key), PLACER("limit", 5))) {
+			limit = json_integer_value_d(value);
+		}
+		else if (json_is_integer(value) && json_integer_value_d(value) >= 0 && !st_cmp_cs_eq(NULLER(key), PLACER("after", 5))) {
+			after = json_integer_value_d(value);
+		}
+		else if (json_is_string(value) && !st_cmp_cs_eq(NULLER(key), PLACER("sort", 4)) &&
+			!st_cmp_ci_eq(NULLER((chr_t *)json_string_value_d(value)), PLACER("date", 4))) {
+			sort = META_SORT_DATE;
+		}
+		else if (json_is_string(value) && !st_cmp_cs_eq(NULLER(key), PLACER("sort", 4)) &&
+			!st_cmp_ci_eq(NULLER((chr_t *)json_string_value_d(value)), PLACER("sender", 6))) {
+			sort = META_SORT_SENDER;
+		}
+		else if (json_is_string(value) && !st_cmp_cs_eq(NULLER(key), PLACER("sort", 4)) &&
+			!st_cmp_ci_eq(NULLER((chr_t *)json_string_value_d(value)), PLACER("subject", 7))) {
+			sort = META_SORT_SUBJECT;
+		}
+		else if (json_is_string(value) && !st_cmp_cs_eq(NULLER(key), PLACER("sort", 4)) &&
+			!st_cmp_ci_eq(NULLER((chr_t *)json_string_value_d(value)), PLACER("size", 4))) {
+			sort = META_SORT_SIZE;
+		}
+		else if (json_is_string(value) && !st_cmp_cs_eq(NULLER(key), PLACER("order", 5)) &&
+			!st_cmp_ci_eq(NULLER((chr_t *)json_string_value_d(value)), PLACER("ascending", 9))) {
+			descending = false;
+		}
+		else if (json_is_string(value) && !st_cmp_cs_eq(NULLER(key), PLACER("order", 5)) &&
+			!st_cmp_ci_eq(NULLER((chr_t *)json_string_value_d(value)), PLACER("descending", 10))) {
+			descending = true;
+		}
+		else {
+			break;
+		}
+
+		iter = json_object_iter_next_d(con->http.portal.params, iter);
+	}
+
+	if (iter || !foldernum) {
+		log_pedantic("Received invalid portal messages list request parameters { user = %.*s }",
+			(int)st_length_get(con->http.session->user->username), st_char_get(con->http.session->user->username));
 		portal_endpoint_error(con, 400, JSON_RPC_2_ERROR_SERVER_METHOD_PARAMS, "Invalid method parameters.");
 		return;
 	}
@@ -1040,68 +1080,78 @@ void portal_endpoint_messages_list(connection_t *con) {
 	// Lock the user struct so message structures don't disappear while the request is being processed.
 	meta_user_rlock(con->http.session->user);
 
-	if ((cursor = inx_cursor_alloc(con->http.session->user->messages)))	{
-
-		while ((active = inx_cursor_value_next(cursor)) && (limit == 0 || current < limit)) {
-
-			// If a start value was provided, then skip the requested number of messagres before we start adding results
-			// to the response object.
-			if (active->foldernum == foldernum && start) {
-				start--;
-			}
-
-			// Otherwise add any messages in the matching folder, which can be loaded.
-			else if (active->foldernum == foldernum && (header = mail_load_header(active, con->http.session->user, con->server, true))) {
+	// An unknown folder doesn't hold any messages, so there's no reason to build a sorted view for it.
+	if (!con->http.session->user->messages || !meta_folders_by_number(con->http.session->user->folders, foldernum)) {
+		meta_user_unlock(con->http.session->user);
+		portal_endpoint_response(con, "{s:s, s:o, s:I}", "jsonrpc", "2.0", "result", list, "id", con->http.portal.id);
+		return;
+	}
+	else if (!(view = meta_views_get(con->http.session->user, con->server, foldernum, sort))) {
+		meta_user_unlock(con->http.session->user);
+		json_decref_d(list);
+		portal_endpoint_error(con, 500, JSON_RPC_2_ERROR_SERVER_INTERNAL, "Internal server error.");
+		return;
+	}
 
-				fields[0] = mail_header_fetch_cleaned(header, PLACER("From", 4));
-				fields[1] = mail_header_fetch_cleaned(header, PLACER("To", 2));
+	// The cursor is the last message of the previous page. Pages are found using its position in the view, instead of a count,
+	// so they don't shift when messages earlier in the folder are added or removed.
+	step = descending ? -1 : 1;
 
-				/// LOW: Add the ability to track the recipient email address for a message, even if its not provided in the To field.
-				fields[2] = mail_header_fetch_cleaned(header, PLACER("To", 2));
+	if (after && (position = meta_view_position(view, after)) < 0) {
+		meta_user_unlock(con->http.session->user);
+		json_decref_d(list);
+		portal_endpoint_error(con, 400, PORTAL_ENDPOINT_ERROR_REFERENCE | PORTAL_ENDPOINT_ERROR_MESSAGES_LIST, "Invalid message reference.");
+		return;
+	}
+	else if (after) {
+		position += step;
+	}
+	else {
+		position = descending ? view->count - 1 : 0;
+	}
 
-				fields[3] = mail_header_fetch_cleaned(header, PLACER("Reply-To", 8));
-				fields[4] = mail_header_fetch_cleaned(header, PLACER("Return-Path", 11));
-				fields[5] = mail_header_fetch_cleaned(header, PLACER("Subject", 7));
-				fields[6] = mail_header_fetch_cleaned(header, PLACER("Date", 4));
+	// If a start value was provided, then skip the requested number of messages before we start adding results to the response.
+	position = start < view->count ? position + (step * (int64_t)start) : -1;
 
-				/// LOW: Add snippet support.
-				fields[7] = st_import("...", 3);
+	for (; position >= 0 && position < (int64_t)view->count && (limit == 0 || current < limit); position += step) {
 
-				// Tags
-				if ((tags = json_array_d()) && active->tags && (count = ar_length_get(active->tags))) {
+		active = view->entries[position].message;
 
-					for (uint64_t i = 0; i < count; i++) {
-						json_array_append_new_d(tags, json_string_d(st_char_get(ar_field_st(active->tags, i))));
-					}
+		// Add any messages which can be loaded. The summary cache means the message usually doesn't have to be read from disk.
+		if (active->foldernum == foldernum && mail_summary_get(active, con->http.session->user, con->server, fields)) {
 
-				}
+			// Tags
+			if ((tags = json_array_d()) && active->tags && (count = ar_length_get(active->tags))) {
 
-				if (!(entry = json_pack_ex_d(&err, JSON_ENSURE_ASCII, "{s:I, s:o, s:o, s:S, s:S, s:S, s:S, s:S, s:S, s:I, s:I, s:S, s:I}", "messageID",
-					active->messagenum, "flags", portal_message_flags_array(active), "tags", tags, "from", st_char_get(fields[0]), "to", st_char_get(fields[1]),
-					"addressedTo", st_char_get(fields[2]), "replyTo", st_char_get(fields[3]), "returnPath", st_char_get(fields[4]), "subject",
-					st_char_get(fields[5]), "utc", active->created, "arrivalUtc", active->created, "snippet", st_char_get(fields[7]), "bytes",
-					active->size))) {
-					log_pedantic("Message packing attempt failed. { error = %s }", err.text);
-				}
-				else if (json_array_append_new_d(list, entry)) {
-					log_pedantic("The message object could not be appended to the result list. { error = %s }", err.text);
-					json_decref_d(entry);
+				for (uint64_t i = 0; i < count; i++) {
+					json_array_append_new_d(tags, json_string_d(st_char_get(ar_field_st(active->tags, i))));
 				}
 
-				// Release the header fields.
-				for (int_t i = 0; i <= 7; i++) {
-					st_cleanup(fields[i]);
-				}
+			}
 
-				// Release header string.
-				st_free(header);
+			/// LOW: Add the ability to track the recipient email address for a message, even if its not provided in the To field.
+			/// LOW: Add snippet support.
+			if (!(entry = json_pack_ex_d(&err, JSON_ENSURE_ASCII, "{s:I, s:o, s:o, s:S, s:S, s:S, s:S, s:S, s:S, s:I, s:I, s:S, s:I}", "messageID",
+				active->messagenum, "flags", portal_message_flags_array(active), "tags", tags, "from", st_char_get(fields[MAIL_SUMMARY_FROM]),
+				"to", st_char_get(fields[MAIL_SUMMARY_TO]), "addressedTo", st_char_get(fields[MAIL_SUMMARY_TO]), "replyTo",
+				st_char_get(fields[MAIL_SUMMARY_REPLY_TO]), "returnPath", st_char_get(fields[MAIL_SUMMARY_RETURN_PATH]), "subject",
+				st_char_get(fields[MAIL_SUMMARY_SUBJECT]), "utc", active->created, "arrivalUtc", active->created, "snippet", "...", "bytes",
+				active->size))) {
+				log_pedantic("Message packing attempt failed. { error = %s }", err.text);
+			}
+			else if (json_array_append_new_d(list, entry)) {
+				log_pedantic("The message object could not be appended to the result list. { error = %s }", err.text);
+				json_decref_d(entry);
+			}
 
-				// Track the number of messages that have been added.
-				current++;
+			// Release the header fields.
+			for (int_t i = 0; i < MAIL_SUMMARY_FIELDS; i++) {
+				st_cleanup(fields[i]);
 			}
-		}
 
-		inx_cursor_free(cursor);
+			// Track the number of messages that have been added.
+			current++;
+		}
 	}
 
 	meta_user_unlock(con->http.session->user);
@@ -1156,7 +1206,7 @@ void portal_endpoint_messages_copy(connection_t *con) {
 				portal_endpoint_error(con, 400, PORTAL_ENDPOINT_ERROR_REFERENCE | PORTAL_ENDPOINT_ERROR_MESSAGES_COPY, "Invalid message reference.");
 				commit = false;
 			}
-			else if (!meta_messages_copier(con->http.session->user, active, dst_folder, &copy, false, META_LOCKED)) {
+			else if (!meta_messages_copier(con->http.session->user, active, dst_folder, &copy, true, META_LOCKED)) {
 				portal_endpoint_error(con, 500, JSON_RPC_2_ERROR_SERVER_INTERNAL, "Internal server error.");
 				commit = false;
 			}
@@ -1173,8 +1223,7 @@ void portal_endpoint_messages_copy(connection_t *con) {
 
 		}
 
-		// If any messages are copied to a different folder we'll need to update the sequence numbers to reflect the new status.
-		meta_messages_update_sequences(con->http.session->user->folders, con->http.session->user->messages);
+		// Each copy is sequenced, and added to the target folder counters, as it gets made, so a full resequence isn't needed here.
 
 		if (commit) {
 
@@ -1210,6 +1259,7 @@ void portal_endpoint_messages_flag(connection_t *con) {
 	bool_t commit = true;
 	inx_cursor_t *cursor;
 	uint64_t folder, count;
+	meta_folder_t *counted = NULL;
 	meta_message_t *active = NULL;
 	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
 	json_t *flags = NULL, *messages, *collection = NULL, *entry = NULL;
@@ -1331,18 +1381,19 @@ void portal_endpoint_messages_flag(connection_t *con) {
 				break;
 			}
 
-			// Now update the messages structure.
+			// Now update the messages structure, and the folder counters along with it.
 			if ((cursor = inx_cursor_alloc(list))) {
+				counted = meta_folders_by_number(con->http.session->user->folders, folder);
 				while ((active = inx_cursor_value_next(cursor))) {
 					switch (action) {
 					case (PORTAL_ENDPOINT_ACTION_ADD):
-						active->status = active->status | bits;
+						meta_message_status_set(counted, active, active->status | bits);
 						break;
 					case (PORTAL_ENDPOINT_ACTION_REMOVE):
-						active->status = (active->status | bits) ^ bits;
+						meta_message_status_set(counted, active, (active->status | bits) ^ bits);
 						break;
 					case (PORTAL_ENDPOINT_ACTION_REPLACE):
-						active->status = ((active->status | MAIL_STATUS_USER_FLAGS) ^ MAIL_STATUS_USER_FLAGS) | bits;
+						meta_message_status_set(counted, active, ((active->status | MAIL_STATUS_USER_FLAGS) ^ MAIL_STATUS_USER_FLAGS) | bits);
 						break;
 					case (PORTAL_ENDPOINT_ACTION_LIST):
 						if (!(entry = json_pack_ex_d(&err, JSON_ENSURE_ASCII, "{s:I, s:o}", "messageID", active->messagenum, "flags", portal_message_flags_array(active)))) {
@@ -7,6 +7,11 @@
 
 #include "magma.h"
 
+// The slots replaced when the portal login template is rendered.
+http_slot_t portal_login_slots[] = {
+	{ .xpath = "//xhtml:p[@id='message']", .attribute = NULL }
+};
+
 /**
  * @brief	Display the http portal login page.
  * @note	The portal login page can be found in 'portal/login.template'
@@ -17,33 +22,18 @@
  */
 void portal_print_login(connection_t *con, chr_t *message) {
 
-	xmlNodePtr node;
 	stringer_t *raw;
-	http_page_t *page;
-	xmlXPathObjectPtr xpath_obj = NULL;
-
-	if ((page = http_page_get("portal/login")) == NULL) {
-		http_print_500(con);
-		return;
-	}
-
-	// Set the message.
-	if (message != NULL && (xpath_obj = xml_xpath_eval((uchr_t *)"//xhtml:p[@id='message']", page->xpath_ctx)) != NULL && xpath_obj->nodesetval != NULL &&
-		xpath_obj->nodesetval->nodeNr != 0 && xpath_obj->nodesetval->nodeTab[0] != NULL) {
-		node = (xmlNodePtr)xpath_obj->nodesetval->nodeTab[0];
-		xml_node_set_content(node, (uchr_t *)message);
-	}
+	http_template_t *template;
+	chr_t *values[] = { message };
 
-	if ((raw = xml_dump_doc(page->doc_obj)) == NULL) {
+	if (!(template = http_template_get("portal/login", portal_login_slots, sizeof(portal_login_slots) / sizeof(http_slot_t))) ||
+		!(raw = http_template_render(template, values))) {
 		http_print_500(con);
-		http_page_free(page);
 		return;
 	}
 
-	http_response_header(con, 200, page->content->type, st_length_get(raw));
-	//con_print(con, "HTTP/1.1 200 OK\r\nContent-Type: %.*s\r\nContent-Length: %u\r\n\r\n", st_length_get(page->content->type), st_char_get(page->content->type), st_length_get(raw));
+	http_response_header(con, 200, template->type, st_length_get(raw));
 	con_write_st(con, raw);
-	http_page_free(page);
 	st_free(raw);
 	return;
 }
@@ -9,6 +9,22 @@
 
 extern statistics_vp_t portal_stats[12];
 
+// The slots replaced when the statistics template is rendered.
+http_slot_t statistics_slots[] = {
+	{ .xpath = "//xhtml:p[@id='time']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='total_users']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='checked_email_today']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='checked_email_week']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='sent_email_today']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='sent_email_week']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='emails_received_today']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='emails_received_week']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='emails_sent_today']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='emails_sent_week']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='users_registered_today']", .attribute = NULL },
+	{ .xpath = "//xhtml:td[@id='users_registered_week']", .attribute = NULL }
+};
+
 /**
  * @brief	Display the statistics page to the requesting connection.
  * @param	con		a pointer to the connection object across which the server statistics will be transmitted.
@@ -17,12 +33,13 @@ extern statistics_vp_t portal_stats[12];
 void statistics_process(connection_t *con) {
 
 	time_t sm_time;
-	chr_t buffer[256];
 	stringer_t *raw;
 	struct tm tm_time;
-	http_page_t *page;
+	http_template_t *template;
+	chr_t buffer[256], counts[11][32];
+	chr_t *values[12] = { NULL };
 
-	if (!(page = http_page_get("statistics/statistics"))) {
+	if (!(template = http_template_get("statistics/statistics", statistics_slots, sizeof(statistics_slots) / sizeof(http_slot_t)))) {
 		http_print_500(con);
 		return;
 	}
@@ -35,30 +52,22 @@ void statistics_process(connection_t *con) {
 	}
 	else {
 		// Update the time.
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:p[@id='time']", (uchr_t *)buffer);
+		values[0] = buffer;
 	}
 
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='total_users']", portal_stats[portal_stat_total_users].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='checked_email_today']", portal_stats[portal_stat_users_checked_email_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='checked_email_week']", portal_stats[portal_stat_users_checked_email_week].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='sent_email_today']", portal_stats[portal_stat_users_sent_email_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='sent_email_week']", portal_stats[portal_stat_users_sent_email_week].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='emails_received_today']", portal_stats[portal_stat_emails_received_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='emails_received_week']", portal_stats[portal_stat_emails_received_week].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='emails_sent_today']", portal_stats[portal_stat_emails_sent_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='emails_sent_week']", portal_stats[portal_stat_emails_sent_week].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='users_registered_today']", portal_stats[portal_stat_users_registered_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='users_registered_week']", portal_stats[portal_stat_users_registered_week].val);
+	// The slots after the time follow the order of the portal statistics, up to the weekly registrations.
+	for (uint32_t i = portal_stat_total_users; i <= portal_stat_users_registered_week; i++) {
+		snprintf(counts[i], sizeof(counts[i]), "%lu", portal_stats[i].val);
+		values[i + 1] = counts[i];
+	}
 
-	if (!(raw = xml_dump_doc(page->doc_obj))) {
+	if (!(raw = http_template_render(template, values))) {
 		http_print_500(con);
-		http_page_free(page);
 		return;
 	}
 
-	http_response_header(con, 200, page->content->type, st_length_get(raw));
+	http_response_header(con, 200, template->type, st_length_get(raw));
 	con_write_st(con, raw);
-	http_page_free(page);
 	st_free(raw);
 
 	return;
@@ -7,6 +7,11 @@
 
 #include "magma.h"
 
+// The slots replaced when the teacher message template is rendered.
+http_slot_t teacher_message_slots[] = {
+	{ .xpath = "//xhtml:p[@id='message']", .attribute = NULL }
+};
+
 /**
  * @brief	Display a custom message to the remote client using the teacher/message template.
  * @param	con		the client connection to receive the message.
@@ -15,24 +20,17 @@
  */
 void teacher_print_message(connection_t *con, chr_t *message) {
 
-	http_page_t *page;
 	inx_cursor_t *cursor;
 	stringer_t *raw, *header;
+	http_template_t *template;
+	chr_t *values[] = { message };
 
-	if (!(page = http_page_get("teacher/message"))) {
+	if (!(template = http_template_get("teacher/message", teacher_message_slots, sizeof(teacher_message_slots) / sizeof(http_slot_t))) ||
+		!(raw = http_template_render(template, values))) {
 		http_print_500(con);
 		return;
 	}
 
-	// Set the message.
-	xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:p[@id='message']", (uchr_t *)message);
-
-	if (!(raw = xml_dump_doc(page->doc_obj))) {
-		http_print_500(con);
-		http_page_free(page);
-		return;
-	}
-
 	// TODO: This can be cleaned up?
 
 	con_print(con, "HTTP/1.1 200 OK\r\n");
@@ -46,9 +44,8 @@ void teacher_print_message(connection_t *con, chr_t *message) {
 		inx_cursor_free(cursor);
 	}
 
-	con_print(con, "Content-Type: %.*s\r\nContent-Length: %u\r\n\r\n", st_length_get(page->content->type), st_char_get(page->content->type), st_length_get(raw));
+	con_print(con, "Content-Type: %.*s\r\nContent-Length: %u\r\n\r\n", st_length_get(template->type), st_char_get(template->type), st_length_get(raw));
 	con_write_st(con, raw);
-	http_page_free(page);
 	st_free(raw);
 
 	return;
@@ -266,15 +263,20 @@ void teacher_process(connection_t *con) {
 	// Check for a cookie. Make sure the comparison value is at least 16 characters long; and then wrap it in a placer to ensure only 16 characters are considered.
 	else if (cookie && st_length_get(cookie) >= 16 && !st_cmp_cs_starts(teach->password, PLACER(st_char_get(cookie), 16))) {
 
-		// Train the engine.
-		// QUESTION: Is the reason we aren't checking the return value?
-		dspam_train(teach->usernum, teach->disposition, teach->signature);
+		// Queue the signature for training. The engine is trained in the background, so the result isn't known yet. If the queue
+		// won't take the signature, it's trained right away, and if that fails too, the signature is kept so the user can try again.
+		if (!dspam_training_add(teach->usernum, teach->signum, teach->disposition, teach->signature) &&
+			!dspam_train(teach->usernum, teach->disposition, teach->signature)) {
+			teacher_print_message(con, "The signature could not be trained right now. Please try again later.");
+		}
+		else {
 
-		// Delete the signature from the database.
-		teacher_data_delete(teach);
+			// Delete the signature from the database.
+			teacher_data_delete(teach);
 
-		// Print_t the output message.
-		teacher_print_message(con, "Signature data trained.");
+			// Print_t the output message.
+			teacher_print_message(con, "Signature data trained.");
+		}
 	}
 
 	else if (http_data_get(con, HTTP_DATA_POST, "submit")) {
@@ -283,12 +285,13 @@ void teacher_process(connection_t *con) {
 			st_cmp_cs_eq(teach->password, auth->tokens.verification)) {
 			teacher_print_form(con, teacher_add_error("//xhtml:input[@id='password']", "password_msg", "An invalid password was provided. Please try again."), teach);
 		}
+		// Queue the signature for training, or train it right away if the queue won't take it. If both fail, the signature is kept.
+		else if (!dspam_training_add(teach->usernum, teach->signum, teach->disposition, teach->signature) &&
+			!dspam_train(teach->usernum, teach->disposition, teach->signature)) {
+			teacher_print_message(con, "The signature could not be trained right now. Please try again later.");
+		}
 		else {
 
-			// Train the engine.
-			// QUESTION: Same question as above.
-			dspam_train(teach->usernum, teach->disposition, teach->signature);
-
 			// Add the cookie to the output, if necessary.
 			if ((pass = http_data_get(con, HTTP_DATA_POST, "cookie")) && pass->value && !st_cmp_cs_eq(pass->value, PLACER("on", 2))) {
 				teacher_add_cookie(con, teach);